@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "auto_tuner.h"
+#include "../benchmark/benchmark.h"
+#include "../motion-estimator/motion_estimator.h"
+
+namespace {
+
+// Frames before the timed ones, the first calls allocate buffers, build OpenCL kernels and fill the thread pool
+constexpr int WARMUP_FRAMES = 3;
+// Largest difference in degrees of a flow angle from the single-threaded one. Stripes compute the flow near their
+// edges without the pixels across it, so a layout that changes the angle of a zone by more is not a candidate.
+constexpr double ANGLE_TOLERANCE = 5.0;
+
+// Detectors of one process tune one after another, the later ones find the result of the first in the cache
+std::mutex tuning_mutex;
+
+bool isGpuBackend(ComputeBackend backend) {
+    return backend == ComputeBackend::OpenCL || backend == ComputeBackend::CUDA;
+}
+
+// Both found no motion, or both found it in about the same direction
+bool sameAngle(float reference, float candidate) {
+    if (std::isnan(reference) || std::isnan(candidate)) {
+        return std::isnan(reference) && std::isnan(candidate);
+    }
+    double difference = std::fmod(std::fabs(static_cast<double>(reference) - candidate), 360.0);
+    return std::min(difference, 360.0 - difference) <= ANGLE_TOLERANCE;
+}
+
+}
+
+AutoTuner::AutoTuner(const AppConfig& config) : config(config) {}
+
+ExecutionVariant AutoTuner::select(const cv::Size& roi_size, bool& measured) {
+    std::lock_guard<std::mutex> lock(tuning_mutex);
+
+    std::string key = cacheKey(config, roi_size);
+    ExecutionVariant best;
+    if (readCache(key, best)) {
+        measured = false;
+        std::cout << "Auto-tune: " << describe(best) << " from " << config.auto_tune_cache << std::endl;
+        return best;
+    }
+
+    measured = true;
+    std::vector<cv::Mat> frames = syntheticFrames(roi_size, WARMUP_FRAMES + std::max(1, config.auto_tune_frames) + 1);
+    best.frame_ms = std::numeric_limits<double>::infinity();
+    // The first candidate runs single-threaded, the others have to estimate the same angles to be chosen
+    std::vector<float> reference_angles, angles;
+    bool first = true;
+    for (auto& variant : candidates(config)) {
+        variant.frame_ms = measure(variant, frames, &angles);
+        if (first) {
+            reference_angles = angles;
+            first = false;
+        } else if (std::isfinite(variant.frame_ms) && !sameAngles(reference_angles, angles)) {
+            std::cout << "Auto-tune: " << describe(variant) << " changes the flow angles, skipped" << std::endl;
+            continue;
+        }
+        std::cout << "Auto-tune: " << describe(variant) << " takes " << variant.frame_ms << " ms per frame"
+                  << std::endl;
+        if (variant.frame_ms < best.frame_ms) {
+            best = variant;
+        }
+    }
+
+    if (!std::isfinite(best.frame_ms)) {
+        std::cerr << "Warning: No auto-tune candidate ran, keeping the configured settings" << std::endl;
+        return {config.use_gpu, config.use_multi_thread, config.thread_amount, config.flow_strips, 0.0};
+    }
+
+    std::cout << "Auto-tune: selected " << describe(best) << std::endl;
+    if (!writeCache(key, best)) {
+        std::cerr << "Warning: Could not write auto-tune cache " << config.auto_tune_cache << std::endl;
+    }
+    return best;
+}
+
+std::vector<ExecutionVariant> AutoTuner::candidates(const AppConfig& config) {
+    std::vector<ExecutionVariant> variants;
+    variants.push_back({false, false, config.thread_amount, config.flow_strips});
+
+    // Only Farnebäck splits its frames over its own threads, the other estimators run the CPU path on CPUThreaded
+    int hardware = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    if (config.algorithm == "FARNE" && hardware > 1) {
+        std::vector<int> thread_counts;
+        for (int threads = 2; threads < hardware; threads *= 2) {
+            thread_counts.push_back(threads);
+        }
+        thread_counts.push_back(hardware);
+
+        for (int threads : thread_counts) {
+            for (const char* strips : {"COLUMNS", "ROWS"}) {
+                variants.push_back({false, true, threads, strips});
+            }
+        }
+    }
+
+    AppConfig gpu = config;
+    gpu.use_gpu = true;
+    if (isGpuBackend(resolveComputeBackend(gpu))) {
+        variants.push_back({true, false, config.thread_amount, config.flow_strips});
+    }
+    return variants;
+}
+
+double AutoTuner::measure(const ExecutionVariant& variant, const std::vector<cv::Mat>& frames,
+                          std::vector<float>* angles) const {
+    if (angles) {
+        angles->clear();
+    }
+    AppConfig candidate = config;
+    apply(variant, candidate);
+    candidate.debug = false;
+
+    // A backend that fails on this machine is not a candidate, whether it reports it or throws
+    try {
+        return timeFrames(candidate, frames, angles);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Warning: Auto-tune candidate " << describe(variant) << " failed: " << e.what() << std::endl;
+        if (angles) {
+            angles->clear();
+        }
+        return std::numeric_limits<double>::infinity();
+    }
+}
+
+bool AutoTuner::sameAngles(const std::vector<float>& reference, const std::vector<float>& candidate) {
+    if (reference.size() != candidate.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < reference.size(); ++i) {
+        if (!sameAngle(reference[i], candidate[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double AutoTuner::timeFrames(const AppConfig& candidate, const std::vector<cv::Mat>& frames,
+                             std::vector<float>* angles) const {
+    std::unique_ptr<MotionEstimator> estimator = createMotionEstimator(candidate);
+    if (!estimator || frames.size() < 2) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    std::vector<cv::Mat> grays(frames.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        cv::cvtColor(frames[i], grays[i], cv::COLOR_BGR2GRAY);
+    }
+
+    std::vector<EstimatorZone> zones = {{cv::Rect(cv::Point(), frames[0].size()), candidate.threshold}};
+    std::vector<MotionEstimate> estimates;
+    cv::Mat hsv;
+    std::vector<double> times;
+    Benchmark timer;
+    for (size_t i = 1; i < frames.size(); ++i) {
+        timer.start();
+        estimator->estimate(frames[i], grays[i], grays[i - 1], zones, estimates, hsv, nullptr);
+        double elapsed = timer.stop();
+
+        if (estimates.empty() || estimates[0].kind == EstimateKind::None) {
+            return std::numeric_limits<double>::infinity();
+        }
+        if (angles) {
+            angles->push_back(estimates[0].move_mode);
+        }
+        if (static_cast<int>(i) > WARMUP_FRAMES) {
+            times.push_back(elapsed);
+        }
+    }
+    if (times.empty()) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+    return times[times.size() / 2];
+}
+
+std::string AutoTuner::cacheKey(const AppConfig& config, const cv::Size& roi_size) {
+    std::ostringstream key;
+    key << config.algorithm << " " << roi_size.width << "x" << roi_size.height
+        << " cores " << std::thread::hardware_concurrency() << " opencv " << CV_VERSION
+        << " levels " << config.levels << " winsize " << config.winsize << " iterations " << config.iterations
+        << " poly_n " << config.poly_n << " regions " << config.flow_region_mode
+        << " corners " << config.max_corners << " yolo " << config.yolo_input_size;
+    return key.str();
+}
+
+std::string AutoTuner::hostName() {
+#ifdef _WIN32
+    const char* name = std::getenv("COMPUTERNAME");
+    return name ? name : "";
+#else
+    char name[256] = {};
+    if (gethostname(name, sizeof(name) - 1) != 0) {
+        return "";
+    }
+    return name;
+#endif
+}
+
+std::vector<cv::Mat> AutoTuner::syntheticFrames(const cv::Size& size, int count) {
+    cv::RNG rng(7);
+    cv::Mat background(size, CV_8UC3);
+    rng.fill(background, cv::RNG::UNIFORM, 0, 255);
+    cv::GaussianBlur(background, background, cv::Size(7, 7), 0);
+
+    cv::Size blob(std::max(4, size.width / 16), std::max(8, size.height / 5));
+    cv::Mat texture(blob, CV_8UC3);
+    rng.fill(texture, cv::RNG::UNIFORM, 0, 255);
+
+    cv::Rect frame_rect(cv::Point(), size);
+    int travel = std::max(1, size.height - blob.height);
+    std::vector<cv::Mat> frames(count);
+    for (int i = 0; i < count; ++i) {
+        background.copyTo(frames[i]);
+        for (int b = 0; b < 3; ++b) {
+            int x = size.width * (b + 1) / 4 - blob.width / 2;
+            int y = travel - (i * 3 + b * travel / 3) % travel;
+            cv::Rect rect = cv::Rect(cv::Point(x, y), blob) & frame_rect;
+            if (!rect.empty()) {
+                texture(cv::Rect(cv::Point(), rect.size())).copyTo(frames[i](rect));
+            }
+        }
+    }
+    return frames;
+}
+
+void AutoTuner::apply(const ExecutionVariant& variant, AppConfig& config) {
+    config.use_gpu = variant.use_gpu;
+    config.use_multi_thread = variant.use_multi_thread;
+    config.thread_amount = variant.thread_amount;
+    config.flow_strips = variant.flow_strips;
+}
+
+bool AutoTuner::matches(const ExecutionVariant& variant, const AppConfig& config) {
+    return variant.use_gpu == config.use_gpu && variant.use_multi_thread == config.use_multi_thread &&
+           variant.thread_amount == config.thread_amount && variant.flow_strips == config.flow_strips;
+}
+
+std::string AutoTuner::describe(const ExecutionVariant& variant) const {
+    AppConfig candidate = config;
+    apply(variant, candidate);
+
+    std::ostringstream out;
+    ComputeBackend backend = resolveComputeBackend(candidate);
+    out << config.algorithm << " on " << computeBackendName(backend);
+    if (backend == ComputeBackend::CPUThreaded) {
+        out << " with " << variant.thread_amount << " threads in " << variant.flow_strips;
+    }
+    return out.str();
+}
+
+bool AutoTuner::readCache(const std::string& key, ExecutionVariant& variant) const {
+    std::ifstream file(config.auto_tune_cache);
+    if (!file.is_open()) {
+        return false;
+    }
+    nlohmann::json cache = nlohmann::json::parse(file, nullptr, false);
+    if (cache.is_discarded() || !cache.contains("entries")) {
+        std::cerr << "Warning: Ignoring unreadable auto-tune cache " << config.auto_tune_cache << std::endl;
+        return false;
+    }
+
+    std::string host = hostName();
+    for (const auto& entry : cache["entries"]) {
+        if (entry.value("host", "") == host && entry.value("key", "") == key) {
+            variant.use_gpu = entry.value("use_gpu", false);
+            variant.use_multi_thread = entry.value("use_multi_thread", false);
+            variant.thread_amount = entry.value("thread_amount", -1);
+            variant.flow_strips = entry.value("flow_strips", "COLUMNS");
+            variant.frame_ms = entry.value("frame_ms", 0.0);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AutoTuner::writeCache(const std::string& key, const ExecutionVariant& variant) const {
+    // Entries of other hosts and keys are kept, the file may be shared between machines
+    nlohmann::json cache = {{"entries", nlohmann::json::array()}};
+    std::ifstream existing(config.auto_tune_cache);
+    if (existing.is_open()) {
+        nlohmann::json old = nlohmann::json::parse(existing, nullptr, false);
+        if (!old.is_discarded() && old.contains("entries") && old["entries"].is_array()) {
+            cache = old;
+        }
+    }
+
+    std::string host = hostName();
+    auto& entries = cache["entries"];
+    for (auto it = entries.begin(); it != entries.end();) {
+        it = (it->value("host", "") == host && it->value("key", "") == key) ? entries.erase(it) : it + 1;
+    }
+    entries.push_back({
+        {"host", host},
+        {"key", key},
+        {"use_gpu", variant.use_gpu},
+        {"use_multi_thread", variant.use_multi_thread},
+        {"thread_amount", variant.thread_amount},
+        {"flow_strips", variant.flow_strips},
+        {"frame_ms", variant.frame_ms}
+    });
+
+    // Written next to the target and moved in place, a detector starting meanwhile never reads a partial file
+    std::string temp_path = config.auto_tune_cache + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        out << cache.dump(2) << "\n";
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, config.auto_tune_cache, error);
+    return !error;
+}
@@ -0,0 +1,58 @@
+#ifndef AUTO_TUNER_H
+#define AUTO_TUNER_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "../motion-detector/motion_detector.h"
+
+// Execution settings of one candidate, they replace use_gpu, use_multi_thread, thread_amount and flow_strips
+struct ExecutionVariant {
+    bool use_gpu = false;
+    bool use_multi_thread = false;
+    int thread_amount = -1;
+    std::string flow_strips = "COLUMNS";
+    double frame_ms = 0.0;   // median estimate time per frame, 0 before it was measured
+};
+
+// Picks the fastest way to run the configured estimator on this machine. Every candidate is timed on synthetic
+// frames of the ROI size, one that estimates other flow angles than the single-threaded run is skipped, and the
+// winner is stored in a cache file under the host name, the ROI size and the settings that change the cost of a
+// frame. Later startups with the same key reuse it without measuring.
+class AutoTuner {
+public:
+    explicit AutoTuner(const AppConfig& config);
+
+    // Fastest variant for roi_size. measured is false when it came from the cache, the configured settings are
+    // returned when no candidate ran.
+    ExecutionVariant select(const cv::Size& roi_size, bool& measured);
+
+    // Single thread first, then the thread counts and strip layouts of Farnebäck, then the GPU where one is present
+    static std::vector<ExecutionVariant> candidates(const AppConfig& config);
+    // Median time per frame of variant over frames, infinity when the estimator could not run it or threw. angles
+    // gets the flow angle of every decided frame, to compare the variant with the single-threaded one.
+    double measure(const ExecutionVariant& variant, const std::vector<cv::Mat>& frames,
+                   std::vector<float>* angles = nullptr) const;
+    // Same motion found on every frame, with angles no further apart than the tuning tolerance
+    static bool sameAngles(const std::vector<float>& reference, const std::vector<float>& candidate);
+
+    static std::string cacheKey(const AppConfig& config, const cv::Size& roi_size);
+    static std::string hostName();
+    // Textured background with a few person sized blobs walking up, so background subtraction and blob crops
+    // have the work of a real crosswalk
+    static std::vector<cv::Mat> syntheticFrames(const cv::Size& size, int count);
+
+    static void apply(const ExecutionVariant& variant, AppConfig& config);
+    static bool matches(const ExecutionVariant& variant, const AppConfig& config);
+
+private:
+    AppConfig config;
+
+    std::string describe(const ExecutionVariant& variant) const;
+    double timeFrames(const AppConfig& candidate, const std::vector<cv::Mat>& frames, std::vector<float>* angles) const;
+    bool readCache(const std::string& key, ExecutionVariant& variant) const;
+    bool writeCache(const std::string& key, const ExecutionVariant& variant) const;
+};
+
+#endif //AUTO_TUNER_H
@@ -4,12 +4,14 @@
 #include <iomanip>
 #include <chrono>
 #include <filesystem>
+#include <functional>
 #include <sstream>
 
 #include "benchmark.h"
+#include "../utils/allocation_counter.h"
 
 #include <algorithm>
-#include <unordered_map>
+#include <cmath>
 
 struct Benchmark::Impl {
     std::chrono::high_resolution_clock::time_point start_time;
@@ -32,40 +34,96 @@ Benchmark::~Benchmark() {
     delete impl;
 }
 
-std::vector<CrossIntent> loadGroundTruthCrossingIntent(const std::string& json_filepath) {
-    std::vector<CrossIntent> crossing_intent_data;
+// Streams "state_per_frame" entries of every pedestrian to onState without building a JSON document
+class CrossingStateHandler : public nlohmann::json_sax<nlohmann::json> {
+public:
+    explicit CrossingStateHandler(const std::function<void(int, bool)>& onState) : onState(onState) {}
+
+    bool null() override { return value(); }
+    bool boolean(bool) override { return value(); }
+    bool number_integer(number_integer_t) override { return value(); }
+    bool number_unsigned(number_unsigned_t) override { return value(); }
+    bool number_float(number_float_t, const string_t&) override { return value(); }
+    bool binary(binary_t&) override { return value(); }
+
+    bool string(string_t& state) override {
+        if (depth == state_depth) {
+            // "zebra felé" means moving towards crossing (is_crossing = true)
+            // "áll" means standing/stopped (is_crossing = false)
+            onState(std::stoi(last_key), state == "zebra felé");
+        }
+        return value();
+    }
+
+    bool start_object(std::size_t) override {
+        depth++;
+        if (entering_states) {
+            state_depth = depth;
+        }
+        entering_states = false;
+        return true;
+    }
+
+    bool key(string_t& key) override {
+        last_key = key;
+        entering_states = depth != state_depth && key == "state_per_frame";
+        return true;
+    }
+
+    bool end_object() override {
+        if (depth == state_depth) {
+            state_depth = -1;
+        }
+        depth--;
+        return true;
+    }
+
+    bool start_array(std::size_t) override { return value(); }
+    bool end_array() override { return true; }
 
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& e) override {
+        std::cerr << "Error parsing JSON at byte " << position << ": " << e.what() << std::endl;
+        return false;
+    }
+
+private:
+    const std::function<void(int, bool)>& onState;
+    std::string last_key;
+    int depth = 0;
+    int state_depth = -1;
+    bool entering_states = false;
+
+    bool value() {
+        entering_states = false;
+        return true;
+    }
+};
+
+static bool parseCrossingStates(const std::string& json_filepath, const std::function<void(int, bool)>& onState) {
     std::ifstream file(json_filepath);
     if (!file.is_open()) {
         std::cerr << "Error opening JSON file: " << json_filepath << std::endl;
-        return crossing_intent_data;
+        return false;
     }
 
-    nlohmann::json j;
+    CrossingStateHandler handler(onState);
     try {
-        file >> j;
+        return nlohmann::json::sax_parse(file, &handler);
     } catch (const std::exception& e) {
         std::cerr << "Error parsing JSON: " << e.what() << std::endl;
-        return crossing_intent_data;
+        return false;
     }
+}
 
-    for (const auto& pedestrian : j["pedestrians"]) {
-        const auto& state_per_frame = pedestrian["state_per_frame"];
-
-        for (auto it = state_per_frame.begin(); it != state_per_frame.end(); ++it) {
-            int frame = std::stoi(it.key());
-            std::string state = it.value();
-
-            // "zebra felé" means moving towards crossing (is_crossing = true)
-            // "áll" means standing/stopped (is_crossing = false)
-            bool is_crossing = (state == "zebra felé");
+std::vector<CrossIntent> loadGroundTruthCrossingIntent(const std::string& json_filepath) {
+    std::vector<CrossIntent> crossing_intent_data;
 
-            crossing_intent_data.push_back({frame, is_crossing});
-        }
-    }
+    parseCrossingStates(json_filepath, [&](int frame, bool is_crossing) {
+        crossing_intent_data.push_back({frame, is_crossing});
+    });
 
     // Sort by frame number since multiple pedestrians might overlap
-    std::sort(crossing_intent_data.begin(), crossing_intent_data.end(),
+    std::stable_sort(crossing_intent_data.begin(), crossing_intent_data.end(),
               [](const CrossIntent& a, const CrossIntent& b) {
                   return a.frame_index < b.frame_index;
               });
@@ -73,32 +131,82 @@ std::vector<CrossIntent> loadGroundTruthCrossingIntent(const std::string& json_f
     return crossing_intent_data;
 }
 
+GroundTruth::GroundTruth(const std::vector<CrossIntent>& intents) {
+    for (const auto& intent : intents) {
+        add(intent.frame_index, intent.is_crossing);
+    }
+}
+
+void GroundTruth::add(int frame_index, bool is_crossing) {
+    if (frame_index < 0) {
+        return;
+    }
+    if (static_cast<size_t>(frame_index) >= states.size()) {
+        states.resize(static_cast<size_t>(frame_index) + 1, UNANNOTATED);
+    }
+    if (states[frame_index] == UNANNOTATED) {
+        states[frame_index] = NOT_CROSSING;
+        annotated++;
+    }
+    // Several pedestrians can be annotated on the same frame, the frame is crossing if any of them crosses
+    if (is_crossing) {
+        states[frame_index] = CROSSING;
+    }
+}
 
-CrossingMetrics calculateCrossingMetrics(const std::vector<BenchmarkResult>& results, const std::vector<CrossIntent>& ground_truth) {
-    CrossingMetrics metrics = {0.0, 0.0, 0.0, 0, 0, 0, 0};
+bool GroundTruth::isCrossing(int frame_index) const {
+    return frame_index >= 0 && static_cast<size_t>(frame_index) < states.size() && states[frame_index] == CROSSING;
+}
+
+size_t GroundTruth::annotatedFrames() const {
+    return annotated;
+}
+
+GroundTruth loadGroundTruth(const std::string& json_filepath) {
+    GroundTruth ground_truth;
+    parseCrossingStates(json_filepath, [&](int frame, bool is_crossing) {
+        ground_truth.add(frame, is_crossing);
+    });
+    return ground_truth;
+}
+
+CrossingMetricsAccumulator::CrossingMetricsAccumulator(const GroundTruth& ground_truth) : ground_truth(&ground_truth) {
+}
 
-    std::unordered_map<int, bool> ground_truth_map;
-    for (const auto& truth : ground_truth) {
-        ground_truth_map[truth.frame_index] = truth.is_crossing;
+void CrossingMetricsAccumulator::add(int frame_index, bool predicted_crossing) {
+    bool ground_truth_value = ground_truth->isCrossing(frame_index);
+
+    if (predicted_crossing && ground_truth_value) {
+        true_positives++;
+    } else if (predicted_crossing && !ground_truth_value) {
+        false_positives++;
+    } else if (!predicted_crossing && !ground_truth_value) {
+        true_negatives++;
+    } else {
+        false_negatives++;
     }
 
-    for (const auto& result : results) {
-        bool ground_truth_value = false;
-        auto it = ground_truth_map.find(result.frame_index);
-        if (it != ground_truth_map.end()) {
-            ground_truth_value = it->second;
-        }
+    current = crossingMetricsFromCounts(true_positives, false_positives, true_negatives, false_negatives);
+}
 
-        if (result.is_crossing && ground_truth_value) {
-            metrics.true_positives++;
-        } else if (result.is_crossing && !ground_truth_value) {
-            metrics.false_positives++;
-        } else if (!result.is_crossing && !ground_truth_value) {
-            metrics.true_negatives++;
-        } else if (!result.is_crossing && ground_truth_value) {
-            metrics.false_negatives++;
-        }
+const CrossingMetrics& CrossingMetricsAccumulator::metrics() const {
+    return current;
+}
+
+CrossingMetrics calculateCrossingMetrics(const std::vector<BenchmarkResult>& results, const GroundTruth& ground_truth) {
+    CrossingMetricsAccumulator accumulator(ground_truth);
+    for (const auto& result : results) {
+        accumulator.add(result.frame_index, result.is_crossing);
     }
+    return accumulator.metrics();
+}
+
+CrossingMetrics calculateCrossingMetrics(const std::vector<BenchmarkResult>& results, const std::vector<CrossIntent>& ground_truth) {
+    return calculateCrossingMetrics(results, GroundTruth(ground_truth));
+}
+
+CrossingMetrics crossingMetricsFromCounts(int true_positives, int false_positives, int true_negatives, int false_negatives) {
+    CrossingMetrics metrics = {0.0, 0.0, 0.0, true_positives, false_positives, true_negatives, false_negatives};
 
     int total_crossing = metrics.true_positives + metrics.false_negatives;
     int total_not_crossing = metrics.true_negatives + metrics.false_positives;
@@ -113,12 +221,90 @@ CrossingMetrics calculateCrossingMetrics(const std::vector<BenchmarkResult>& res
 
     metrics.balanced_accuracy = (metrics.crossing_accuracy + metrics.not_crossing_accuracy) / 2.0;
 
+    metrics.precision = (metrics.true_positives + metrics.false_positives > 0)
+        ? static_cast<double>(metrics.true_positives) / (metrics.true_positives + metrics.false_positives)
+        : 0.0;
+    metrics.recall = metrics.crossing_accuracy;
+    metrics.f1_score = (metrics.precision + metrics.recall > 0)
+        ? 2 * (metrics.precision * metrics.recall) / (metrics.precision + metrics.recall)
+        : 0.0;
+
+    double beta = 2.0;
+    metrics.f2_score = (metrics.precision + metrics.recall > 0)
+        ? (1 + beta * beta) * (metrics.precision * metrics.recall) / ((beta * beta * metrics.precision) + metrics.recall)
+        : 0.0;
+
     return metrics;
 }
 
+double calculateMeanAllocations(const std::vector<BenchmarkResult>& results) {
+    double total = 0.0;
+    size_t decided = 0;
+    for (const auto& r : results) {
+        if (r.decided) {
+            total += r.allocations;
+            decided++;
+        }
+    }
+    return decided > 0 ? total / decided : 0.0;
+}
+
+// Nearest-rank percentile, so the reported value is always a measured value
+static double nearestRankPercentile(std::vector<double>& values, double percentile) {
+    if (values.empty()) {
+        return 0.0;
+    }
+
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * values.size()));
+    size_t index = std::min(values.size() - 1, rank > 0 ? rank - 1 : 0);
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+double calculateLatencyPercentile(const std::vector<BenchmarkResult>& results, double percentile) {
+    std::vector<double> latencies;
+    latencies.reserve(results.size());
+    for (const auto& r : results) {
+        if (r.decided) {
+            latencies.push_back(r.frame_time_ms);
+        }
+    }
+    return nearestRankPercentile(latencies, percentile);
+}
+
+double calculateAverageFps(const std::vector<BenchmarkResult>& results) {
+    double total_fps = 0.0;
+    size_t decided = 0;
+    for (const auto& r : results) {
+        if (!r.decided) {
+            continue;
+        }
+        decided++;
+        if (r.frame_time_ms > 0.0) {
+            total_fps += 1000.0 / r.frame_time_ms;
+        }
+    }
+    return decided > 0 ? total_fps / decided : 0.0;
+}
+
+double calculateCaptureLatencyPercentile(const std::vector<BenchmarkResult>& results, double percentile) {
+    std::vector<double> latencies;
+    latencies.reserve(results.size());
+    for (const auto& r : results) {
+        latencies.push_back(r.capture_latency_ms);
+    }
+    return nearestRankPercentile(latencies, percentile);
+}
+
+double calculateTimeToFirstDecision(const std::vector<BenchmarkResult>& results) {
+    return results.empty() ? 0.0 : results.front().time_since_start_ms;
+}
+
 void saveResultToCSV(const std::string& filename,
                      const std::vector<BenchmarkResult>& results,
-                     const std::vector<CrossIntent>& ground_truth) {
+                     const GroundTruth& ground_truth,
+                     const CrossingMetrics& metrics,
+                     const std::vector<BackgroundCost>& background) {
     std::ofstream file(filename);
 
     if (!file.is_open()) {
@@ -126,17 +312,22 @@ void saveResultToCSV(const std::string& filename,
         return;
     }
 
-    double total_fps = 0.0;
-    for (const auto& r : results) {
-        if (r.process_time_ms > 0.0) {
-            total_fps += 1000.0 / r.process_time_ms;
-        }
-    }
-    double average_fps = results.empty() ? 0.0 : total_fps / results.size();
-
-    CrossingMetrics metrics = calculateCrossingMetrics(results, ground_truth);
+    double average_fps = calculateAverageFps(results);
 
     file << "Average FPS:," << std::fixed << std::setprecision(3) << average_fps << "\n";
+    file << "Time to First Decision ms:," << calculateTimeToFirstDecision(results) << "\n";
+
+    // Only builds that count allocations have the allocation columns
+    bool allocations = AllocationCounter::enabled();
+    if (allocations) {
+        file << "Allocations per Frame:," << std::setprecision(2) << calculateMeanAllocations(results) << "\n";
+    }
+    for (const auto& cost : background) {
+        double ms_per_frame = cost.frames > 0 ? cost.busy_ms / cost.frames : 0.0;
+        file << cost.name << " ms per Frame:," << std::setprecision(3) << ms_per_frame << "\n";
+        file << cost.name << " Frames:," << cost.frames << "\n";
+        file << cost.name << " Dropped Frames:," << cost.dropped << "\n";
+    }
     file << "\n=== Crossing Intent Metrics ===\n";
     file << "Balanced Accuracy:," << std::setprecision(2) << (metrics.balanced_accuracy * 100) << "%\n";
     file << "Crossing Class Accuracy:," << std::setprecision(2) << (metrics.crossing_accuracy * 100) << "%\n";
@@ -147,37 +338,21 @@ void saveResultToCSV(const std::string& filename,
     file << "True Negatives (Not Crossing):," << metrics.true_negatives << "\n";
     file << "False Negatives (Missed Crossing):," << metrics.false_negatives << "\n";
 
-    double precision = (metrics.true_positives + metrics.false_positives > 0)
-        ? static_cast<double>(metrics.true_positives) / (metrics.true_positives + metrics.false_positives)
-        : 0.0;
-    double recall = (metrics.true_positives + metrics.false_negatives > 0)
-        ? static_cast<double>(metrics.true_positives) / (metrics.true_positives + metrics.false_negatives)
-        : 0.0;
-    double f1_score = (precision + recall > 0)
-        ? 2 * (precision * recall) / (precision + recall)
-        : 0.0;
-
     file << "\n=== Additional Metrics ===\n";
-    file << "Precision:," << std::setprecision(2) << (precision * 100) << "%\n";
-    file << "Recall:," << std::setprecision(2) << (recall * 100) << "%\n";
-    file << "F1 Score:," << std::setprecision(2) << (f1_score * 100) << "%\n";
-
-    file << "\nFrame Index,Use GPU,FPS,Predicted Intent,Groundtruth Intent,Correct\n";
+    file << "Precision:," << std::setprecision(2) << (metrics.precision * 100) << "%\n";
+    file << "Recall:," << std::setprecision(2) << (metrics.recall * 100) << "%\n";
+    file << "F1 Score:," << std::setprecision(2) << (metrics.f1_score * 100) << "%\n";
 
-    std::unordered_map<int, bool> ground_truth_map;
-    for (const auto& gt : ground_truth) {
-        ground_truth_map[gt.frame_index] = gt.is_crossing;
-    }
+    // Only governed runs have the quality level column
+    bool governed = !results.empty() && results.front().quality_level >= 0;
+    file << "\nFrame Index,Use GPU,FPS,Predicted Intent,Groundtruth Intent,Correct"
+         << (allocations ? ",Allocations" : "") << (governed ? ",Quality Level" : "") << "\n";
 
     for (const auto& r : results) {
-        double fps = (r.process_time_ms > 0.0) ? 1000.0 / r.process_time_ms : 0.0;
+        // A skipped stride frame took no decision time of its own
+        double fps = (r.decided && r.frame_time_ms > 0.0) ? 1000.0 / r.frame_time_ms : 0.0;
         bool predicted_intent = r.is_crossing;
-
-        bool groundtruth_intent = false;
-        auto gt_it = ground_truth_map.find(r.frame_index);
-        if (gt_it != ground_truth_map.end()) {
-            groundtruth_intent = gt_it->second;
-        }
+        bool groundtruth_intent = ground_truth.isCrossing(r.frame_index);
 
         bool correct = (predicted_intent == groundtruth_intent);
 
@@ -186,7 +361,14 @@ void saveResultToCSV(const std::string& filename,
              << std::fixed << std::setprecision(3) << fps << ","
              << (predicted_intent ? "Yes" : "No") << ","
              << (groundtruth_intent ? "Yes" : "No") << ","
-             << (correct ? "Yes" : "No") << "\n";
+             << (correct ? "Yes" : "No");
+        if (allocations) {
+            file << "," << r.allocations;
+        }
+        if (governed) {
+            file << "," << r.quality_level;
+        }
+        file << "\n";
     }
     file.close();
     std::cout << "Results saved to " << filename << std::endl;
@@ -203,6 +385,16 @@ std::string getTimestamp() {
 }
 
 void saveBenchmarkResults(const std::vector<BenchmarkResult>& results, const std::string& annotationFile, const std::string& testIdentifier) {
+    saveBenchmarkResults(results, loadGroundTruth(annotationFile), testIdentifier);
+}
+
+void saveBenchmarkResults(const std::vector<BenchmarkResult>& results, const GroundTruth& ground_truth, const std::string& testIdentifier) {
+    saveBenchmarkResults(results, ground_truth, calculateCrossingMetrics(results, ground_truth), testIdentifier);
+}
+
+void saveBenchmarkResults(const std::vector<BenchmarkResult>& results, const GroundTruth& ground_truth,
+                          const CrossingMetrics& metrics, const std::string& testIdentifier,
+                          const std::vector<BackgroundCost>& background) {
     std::string results_dir = "results";
     if (!std::filesystem::exists(results_dir)) {
         if (!std::filesystem::create_directory(results_dir)) {
@@ -218,17 +410,15 @@ void saveBenchmarkResults(const std::vector<BenchmarkResult>& results, const std
     std::cout << "Saving benchmark results..." << std::endl;
     std::cout << "Current working directory: " << std::filesystem::current_path() << std::endl;
 
-    auto ground_truth = loadGroundTruthCrossingIntent(annotationFile);
-
-    saveResultToCSV(detail_filename, results, ground_truth);
+    saveResultToCSV(detail_filename, results, ground_truth, metrics, background);
 
-    appendToSummaryCSV(summary_filename, testIdentifier, results, ground_truth, detail_filename);
+    appendToSummaryCSV(summary_filename, testIdentifier, results, metrics, detail_filename);
 }
 
 void appendToSummaryCSV(const std::string& summary_file,
                         const std::string& testIdentifier,
                         const std::vector<BenchmarkResult>& results,
-                        const std::vector<CrossIntent>& ground_truth,
+                        const CrossingMetrics& metrics,
                         const std::string& detail_filename) {
 
     bool file_exists = std::filesystem::exists(summary_file);
@@ -239,34 +429,17 @@ void appendToSummaryCSV(const std::string& summary_file,
         return;
     }
 
+    // New columns only ever go at the end, so rows appended to a summary written by an older build keep their
+    // leading columns in the place its header names them
     if (!file_exists) {
         file << "Test ID,Timestamp,Avg FPS,Balanced Accuracy,Crossing Accuracy,Not Crossing Accuracy,"
-             << "Precision,Recall,F1 Score,F2 Score,TP,FP,TN,FN,Total Frames,Detail File\n";
-    }
-
-    CrossingMetrics metrics = calculateCrossingMetrics(results, ground_truth);
-
-    double total_fps = 0.0;
-    for (const auto& r : results) {
-        if (r.process_time_ms > 0.0) {
-            total_fps += 1000.0 / r.process_time_ms;
-        }
+             << "Precision,Recall,F1 Score,F2 Score,TP,FP,TN,FN,Total Frames,Detail File,"
+             << "P50 Latency ms,P95 Latency ms,P99 Latency ms,"
+             << "P50 Capture Latency ms,P95 Capture Latency ms,P99 Capture Latency ms,"
+             << "Time to First Decision ms\n";
     }
-    double avg_fps = results.empty() ? 0.0 : total_fps / results.size();
-
-    double precision = (metrics.true_positives + metrics.false_positives > 0)
-        ? static_cast<double>(metrics.true_positives) / (metrics.true_positives + metrics.false_positives)
-        : 0.0;
-    double recall = (metrics.true_positives + metrics.false_negatives > 0)
-        ? static_cast<double>(metrics.true_positives) / (metrics.true_positives + metrics.false_negatives)
-        : 0.0;
-    double f1_score = (precision + recall > 0)
-        ? 2 * (precision * recall) / (precision + recall)
-        : 0.0;
 
-    double beta = 2.0;
-    double f2_score = (1 + beta * beta) * (precision * recall) /
-                      ((beta * beta * precision) + recall);
+    double avg_fps = calculateAverageFps(results);
 
     std::string detail_file_short = std::filesystem::path(detail_filename).filename().string();
 
@@ -276,16 +449,23 @@ void appendToSummaryCSV(const std::string& summary_file,
          << std::setprecision(4) << metrics.balanced_accuracy << ","
          << metrics.crossing_accuracy << ","
          << metrics.not_crossing_accuracy << ","
-         << precision << ","
-         << recall << ","
-         << f1_score << ","
-         << f2_score << ","
+         << metrics.precision << ","
+         << metrics.recall << ","
+         << metrics.f1_score << ","
+         << metrics.f2_score << ","
          << metrics.true_positives << ","
          << metrics.false_positives << ","
          << metrics.true_negatives << ","
          << metrics.false_negatives << ","
          << results.size() << ","
-         << detail_file_short << "\n";
+         << detail_file_short << ","
+         << std::setprecision(3) << calculateLatencyPercentile(results, 50.0) << ","
+         << calculateLatencyPercentile(results, 95.0) << ","
+         << calculateLatencyPercentile(results, 99.0) << ","
+         << calculateCaptureLatencyPercentile(results, 50.0) << ","
+         << calculateCaptureLatencyPercentile(results, 95.0) << ","
+         << calculateCaptureLatencyPercentile(results, 99.0) << ","
+         << calculateTimeToFirstDecision(results) << "\n";
 
     file.close();
     std::cout << "Summary appended to " << summary_file << std::endl;
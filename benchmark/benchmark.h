@@ -20,8 +20,22 @@ private:
 struct BenchmarkResult {
     int frame_index;
     bool use_gpu;
-    double process_time_ms;
+    double frame_time_ms;              // time to decide the whole frame, every zone of a multi-zone frame gets the same
     bool is_crossing;
+    int allocations = 0;   // heap allocations while deciding the frame, 0 unless allocation counting is built in
+    double capture_latency_ms = 0.0;   // from the frame capture to its decision, waiting for the detector included
+    double time_since_start_ms = 0.0;  // from the start of the run to this decision, model loading and seeking included
+    int quality_level = -1;            // quality governor step the frame was decided at, -1 without the governor
+    bool decided = true;               // false for a stride frame the governor skipped, it repeats the last decision
+                                       // and is left out of the FPS and latency figures
+};
+
+// Work done next to the frame loop on another thread, reported on its own lines so it is not hidden in the frame time
+struct BackgroundCost {
+    std::string name;
+    int frames;
+    int dropped;
+    double busy_ms;   // total time the thread spent working
 };
 
 struct CrossIntent {
@@ -37,13 +51,65 @@ struct CrossingMetrics {
     int false_positives;  // Predicted crossing, was not crossing
     int true_negatives;   // Correctly predicted not crossing
     int false_negatives;  // Predicted not crossing, was crossing
+    double precision = 0.0;
+    double recall = 0.0;
+    double f1_score = 0.0;
+    double f2_score = 0.0;
+};
+
+// Crossing intent indexed by frame. Frames without annotation count as not crossing, frames with several
+// annotated pedestrians count as crossing if any of them crosses.
+class GroundTruth {
+public:
+    GroundTruth() = default;
+    explicit GroundTruth(const std::vector<CrossIntent>& intents);
+
+    void add(int frame_index, bool is_crossing);
+    bool isCrossing(int frame_index) const;
+    size_t annotatedFrames() const;
+
+private:
+    enum : char { UNANNOTATED = 0, NOT_CROSSING = 1, CROSSING = 2 };
+
+    std::vector<char> states;
+    size_t annotated = 0;
+};
+
+// Confusion matrix and derived metrics, updated with every frame so they can be read while a run is in progress.
+// The ground truth must outlive the accumulator.
+class CrossingMetricsAccumulator {
+public:
+    explicit CrossingMetricsAccumulator(const GroundTruth& ground_truth);
+
+    void add(int frame_index, bool predicted_crossing);
+    const CrossingMetrics& metrics() const;
+
+private:
+    const GroundTruth* ground_truth;
+    int true_positives = 0;
+    int false_positives = 0;
+    int true_negatives = 0;
+    int false_negatives = 0;
+    CrossingMetrics current{};
 };
 
 std::string getTimestamp();
-std::vector<CrossIntent> loadGroundTruthCrossingIntent(const std::string& xml_filepath);
+std::vector<CrossIntent> loadGroundTruthCrossingIntent(const std::string& json_filepath);
+GroundTruth loadGroundTruth(const std::string& json_filepath);
+CrossingMetrics calculateCrossingMetrics(const std::vector<BenchmarkResult>& results, const GroundTruth& ground_truth);
 CrossingMetrics calculateCrossingMetrics(const std::vector<BenchmarkResult>& results, const std::vector<CrossIntent>& ground_truth);
-void saveResultToCSV(const std::string& filename, const std::vector<BenchmarkResult>& results);
+CrossingMetrics crossingMetricsFromCounts(int true_positives, int false_positives, int true_negatives, int false_negatives);
+// Decision time figures, frames the quality governor skipped are left out
+double calculateMeanAllocations(const std::vector<BenchmarkResult>& results);
+double calculateLatencyPercentile(const std::vector<BenchmarkResult>& results, double percentile);
+double calculateAverageFps(const std::vector<BenchmarkResult>& results);
+double calculateCaptureLatencyPercentile(const std::vector<BenchmarkResult>& results, double percentile);
+// Startup cost of a run, the time since start of its first decision
+double calculateTimeToFirstDecision(const std::vector<BenchmarkResult>& results);
+void saveResultToCSV(const std::string& filename, const std::vector<BenchmarkResult>& results, const GroundTruth& ground_truth, const CrossingMetrics& metrics, const std::vector<BackgroundCost>& background = {});
 void saveBenchmarkResults(const std::vector<BenchmarkResult>& results, const std::string& annotationFile, const std::string& testIdentifier);
-void appendToSummaryCSV(const std::string& summary_file, const std::string& test_config, const std::vector<BenchmarkResult>& results, const std::vector<CrossIntent>& ground_truth, const std::string& detail_filename);
+void saveBenchmarkResults(const std::vector<BenchmarkResult>& results, const GroundTruth& ground_truth, const std::string& testIdentifier);
+void saveBenchmarkResults(const std::vector<BenchmarkResult>& results, const GroundTruth& ground_truth, const CrossingMetrics& metrics, const std::string& testIdentifier, const std::vector<BackgroundCost>& background = {});
+void appendToSummaryCSV(const std::string& summary_file, const std::string& test_config, const std::vector<BenchmarkResult>& results, const CrossingMetrics& metrics, const std::string& detail_filename);
 
 #endif //BENCHMARK_H
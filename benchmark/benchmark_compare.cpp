@@ -0,0 +1,273 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <unordered_map>
+
+#include "benchmark_compare.h"
+
+static std::vector<std::string> splitCSVLine(const std::string& line) {
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ',')) {
+        if (!field.empty() && field.back() == '\r') {
+            field.pop_back();
+        }
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+std::vector<SummaryRow> loadSummaryCSV(const std::string& filename) {
+    std::vector<SummaryRow> rows;
+
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error opening summary file: " << filename << std::endl;
+        return rows;
+    }
+
+    std::string line;
+    if (!std::getline(file, line)) {
+        std::cerr << "Error: summary file is empty: " << filename << std::endl;
+        return rows;
+    }
+
+    std::unordered_map<std::string, size_t> columns;
+    std::vector<std::string> header = splitCSVLine(line);
+    for (size_t i = 0; i < header.size(); ++i) {
+        columns[header[i]] = i;
+    }
+
+    for (const char* required : {"Test ID", "Avg FPS", "Balanced Accuracy"}) {
+        if (columns.find(required) == columns.end()) {
+            std::cerr << "Error: summary file " << filename << " has no '" << required << "' column" << std::endl;
+            return rows;
+        }
+    }
+
+    bool has_latency = columns.count("P50 Latency ms") && columns.count("P95 Latency ms") && columns.count("P99 Latency ms");
+    bool has_startup = columns.count("Time to First Decision ms") > 0;
+
+    int line_number = 1;
+    while (std::getline(file, line)) {
+        line_number++;
+        if (line.empty() || line == "\r") {
+            continue;
+        }
+
+        std::vector<std::string> fields = splitCSVLine(line);
+        if (fields.size() < header.size()) {
+            std::cerr << "Warning: skipping malformed line " << line_number << " in " << filename << std::endl;
+            continue;
+        }
+
+        try {
+            SummaryRow row{};
+            row.test_id = fields[columns["Test ID"]];
+            row.timestamp = columns.count("Timestamp") ? fields[columns["Timestamp"]] : "";
+            row.avg_fps = std::stod(fields[columns["Avg FPS"]]);
+            row.balanced_accuracy = std::stod(fields[columns["Balanced Accuracy"]]);
+            row.total_frames = columns.count("Total Frames") ? std::stoi(fields[columns["Total Frames"]]) : 0;
+            row.has_latency = has_latency;
+            if (has_latency) {
+                row.p50_latency_ms = std::stod(fields[columns["P50 Latency ms"]]);
+                row.p95_latency_ms = std::stod(fields[columns["P95 Latency ms"]]);
+                row.p99_latency_ms = std::stod(fields[columns["P99 Latency ms"]]);
+            }
+            row.has_startup = has_startup;
+            if (has_startup) {
+                row.time_to_first_decision_ms = std::stod(fields[columns["Time to First Decision ms"]]);
+            }
+            rows.push_back(row);
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: skipping line " << line_number << " in " << filename << ": " << e.what() << std::endl;
+        }
+    }
+
+    return rows;
+}
+
+static double median(std::vector<double> values) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    double upper = values[middle];
+    if (values.size() % 2 == 1) {
+        return upper;
+    }
+    double lower = *std::max_element(values.begin(), values.begin() + middle);
+    return (lower + upper) / 2.0;
+}
+
+// Scaled median absolute deviation, a spread estimate that a single outlier run cannot inflate
+static double robustDeviation(const std::vector<double>& values) {
+    if (values.size() < 2) {
+        return 0.0;
+    }
+    double center = median(values);
+    std::vector<double> deviations;
+    for (double v : values) {
+        deviations.push_back(std::abs(v - center));
+    }
+    return 1.4826 * median(deviations);
+}
+
+namespace {
+    enum class Direction { HigherIsBetter, LowerIsBetter };
+
+    struct MetricSpec {
+        const char* name;
+        double SummaryRow::*field;
+        Direction direction;
+        bool relative;
+        bool SummaryRow::*present;   // nullptr for columns every summary has
+    };
+}
+
+ComparisonReport compareSummaries(const std::vector<SummaryRow>& baseline, const std::vector<SummaryRow>& candidate,
+                                  const RegressionThresholds& thresholds) {
+    static const MetricSpec specs[] = {
+        {"Avg FPS", &SummaryRow::avg_fps, Direction::HigherIsBetter, true, nullptr},
+        {"P50 Latency ms", &SummaryRow::p50_latency_ms, Direction::LowerIsBetter, true, &SummaryRow::has_latency},
+        {"P95 Latency ms", &SummaryRow::p95_latency_ms, Direction::LowerIsBetter, true, &SummaryRow::has_latency},
+        {"P99 Latency ms", &SummaryRow::p99_latency_ms, Direction::LowerIsBetter, true, &SummaryRow::has_latency},
+        {"Time to First Decision ms", &SummaryRow::time_to_first_decision_ms, Direction::LowerIsBetter, true,
+         &SummaryRow::has_startup},
+        {"Balanced Accuracy", &SummaryRow::balanced_accuracy, Direction::HigherIsBetter, false, nullptr},
+    };
+
+    std::map<std::string, std::vector<const SummaryRow*>> baseline_runs, candidate_runs;
+    for (const auto& row : baseline) {
+        baseline_runs[row.test_id].push_back(&row);
+    }
+    for (const auto& row : candidate) {
+        candidate_runs[row.test_id].push_back(&row);
+    }
+
+    ComparisonReport report;
+
+    for (const auto& [test_id, base_rows] : baseline_runs) {
+        auto candidate_it = candidate_runs.find(test_id);
+        if (candidate_it == candidate_runs.end()) {
+            report.missing_in_candidate.push_back(test_id);
+            continue;
+        }
+        const auto& cand_rows = candidate_it->second;
+
+        for (const auto& spec : specs) {
+            std::vector<double> base_values, cand_values;
+            for (const auto* row : base_rows) {
+                if (!spec.present || row->*spec.present) {
+                    base_values.push_back(row->*spec.field);
+                }
+            }
+            for (const auto* row : cand_rows) {
+                if (!spec.present || row->*spec.present) {
+                    cand_values.push_back(row->*spec.field);
+                }
+            }
+            if (base_values.empty() || cand_values.empty()) {
+                continue;
+            }
+
+            double base = median(base_values);
+            double cand = median(cand_values);
+            // Only the baseline runs set the jitter to expect, an unstable candidate must not widen its own limit
+            double noise = robustDeviation(base_values);
+
+            MetricComparison comparison;
+            comparison.test_id = test_id;
+            comparison.metric = spec.name;
+            comparison.baseline = base;
+            comparison.candidate = cand;
+            comparison.relative = spec.relative;
+
+            if (spec.relative) {
+                if (base <= 0.0) {
+                    continue;
+                }
+                double tolerance = spec.direction == Direction::HigherIsBetter ? thresholds.fps_drop : thresholds.latency_increase;
+                comparison.change = (cand - base) / base;
+                comparison.allowed = std::max(tolerance, thresholds.noise_factor * noise / base);
+            } else {
+                comparison.change = cand - base;
+                comparison.allowed = std::max(thresholds.accuracy_drop, thresholds.noise_factor * noise);
+            }
+
+            comparison.regressed = spec.direction == Direction::HigherIsBetter
+                ? comparison.change < -comparison.allowed
+                : comparison.change > comparison.allowed;
+
+            if (comparison.regressed) {
+                report.regressions++;
+            }
+            report.comparisons.push_back(comparison);
+        }
+    }
+
+    for (const auto& [test_id, rows] : candidate_runs) {
+        if (baseline_runs.find(test_id) == baseline_runs.end()) {
+            report.new_in_candidate.push_back(test_id);
+        }
+    }
+
+    return report;
+}
+
+bool ComparisonReport::passed(const RegressionThresholds& thresholds) const {
+    return regressions == 0 && (!thresholds.fail_on_missing || missing_in_candidate.empty());
+}
+
+void printComparisonReport(const ComparisonReport& report, std::ostream& out) {
+    size_t id_width = 8;
+    for (const auto& c : report.comparisons) {
+        id_width = std::max(id_width, c.test_id.size());
+    }
+
+    out << std::left << std::setw(static_cast<int>(id_width) + 2) << "Test ID"
+        << std::setw(20) << "Metric"
+        << std::right << std::setw(12) << "Baseline"
+        << std::setw(12) << "Candidate"
+        << std::setw(11) << "Change"
+        << std::setw(11) << "Allowed"
+        << "  Status\n";
+
+    for (const auto& c : report.comparisons) {
+        std::ostringstream change, allowed;
+        change << std::fixed << std::showpos;
+        allowed << std::fixed;
+        if (c.relative) {
+            change << std::setprecision(1) << c.change * 100.0 << "%";
+            allowed << std::setprecision(1) << c.allowed * 100.0 << "%";
+        } else {
+            change << std::setprecision(4) << c.change;
+            allowed << std::setprecision(4) << c.allowed;
+        }
+
+        out << std::left << std::setw(static_cast<int>(id_width) + 2) << c.test_id
+            << std::setw(20) << c.metric
+            << std::right << std::fixed << std::setprecision(c.relative ? 2 : 4)
+            << std::setw(12) << c.baseline
+            << std::setw(12) << c.candidate
+            << std::setw(11) << change.str()
+            << std::setw(11) << allowed.str()
+            << "  " << (c.regressed ? "REGRESSED" : "ok") << "\n";
+    }
+
+    for (const auto& test_id : report.missing_in_candidate) {
+        out << "Missing in candidate: " << test_id << "\n";
+    }
+    for (const auto& test_id : report.new_in_candidate) {
+        out << "New in candidate (not compared): " << test_id << "\n";
+    }
+
+    out << "\n" << report.comparisons.size() << " metrics compared, " << report.regressions << " regressed, "
+        << report.missing_in_candidate.size() << " configurations missing in candidate" << std::endl;
+}
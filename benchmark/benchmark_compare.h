@@ -0,0 +1,55 @@
+#ifndef BENCHMARK_COMPARE_H
+#define BENCHMARK_COMPARE_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct SummaryRow {
+    std::string test_id;
+    std::string timestamp;
+    double avg_fps;
+    double balanced_accuracy;
+    double p50_latency_ms;
+    double p95_latency_ms;
+    double p99_latency_ms;
+    bool has_latency;      // older summaries were written without the percentile columns
+    int total_frames;
+    double time_to_first_decision_ms = 0.0;
+    bool has_startup = false;   // nor with the startup column
+};
+
+struct RegressionThresholds {
+    double fps_drop = 0.10;           // relative
+    double latency_increase = 0.10;   // relative
+    double accuracy_drop = 0.02;      // absolute, balanced accuracy is 0..1
+    double noise_factor = 3.0;        // allowed change grows to this many robust deviations of the baseline runs
+    bool fail_on_missing = false;
+};
+
+struct MetricComparison {
+    std::string test_id;
+    std::string metric;
+    double baseline;
+    double candidate;
+    double change;     // relative for performance metrics, absolute for accuracy
+    double allowed;
+    bool relative;
+    bool regressed;
+};
+
+struct ComparisonReport {
+    std::vector<MetricComparison> comparisons;
+    std::vector<std::string> missing_in_candidate;
+    std::vector<std::string> new_in_candidate;
+    int regressions = 0;
+
+    bool passed(const RegressionThresholds& thresholds) const;
+};
+
+std::vector<SummaryRow> loadSummaryCSV(const std::string& filename);
+ComparisonReport compareSummaries(const std::vector<SummaryRow>& baseline, const std::vector<SummaryRow>& candidate,
+                                  const RegressionThresholds& thresholds);
+void printComparisonReport(const ComparisonReport& report, std::ostream& out);
+
+#endif //BENCHMARK_COMPARE_H
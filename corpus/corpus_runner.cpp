@@ -0,0 +1,365 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "corpus_runner.h"
+
+#ifndef _WIN32
+#include <csignal>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+static const std::string JOB_CONFIG_FILE = "config.yml";
+static const std::string JOB_LOG_FILE = "job.log";
+static const std::string SUMMARY_FILE = "benchmark_summary.csv";
+
+CorpusRunner::CorpusRunner(const std::string& manifestFile) : CorpusRunner(YAML::LoadFile(manifestFile)) {}
+
+CorpusRunner::CorpusRunner(const YAML::Node& manifest) {
+    base_config = YAML::LoadFile(manifest["base_config"].as<std::string>());
+    detector = manifest["detector"].as<std::string>("./ZebraFlash");
+    output_dir = manifest["output_dir"].as<std::string>("corpus_results");
+    workers = manifest["workers"].as<int>(-1);
+    memory_limit_mb = manifest["memory_limit_mb"].as<int>(0);
+    timeout_s = manifest["timeout_s"].as<int>(0);
+    retries = manifest["retries"].as<int>(1);
+
+    for (const auto& node : manifest["videos"]) {
+        CorpusVideo video;
+        video.src = node["src"].as<std::string>();
+        video.annot = node["annot"].as<std::string>("");
+        video.name = node["name"].as<std::string>(std::filesystem::path(video.src).stem().string());
+        videos.push_back(video);
+    }
+
+    // Without overlays every video runs once with the base config
+    if (manifest["configs"]) {
+        for (const auto& node : manifest["configs"]) {
+            overlays.push_back({node["name"].as<std::string>(), node["overlay"]});
+        }
+    }
+    if (overlays.empty()) {
+        overlays.push_back({"base", YAML::Node(YAML::NodeType::Map)});
+    }
+}
+
+static bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Jobs run in their own directory, so input paths that exist from here are made absolute. Outputs such as
+// record_path stay relative and end up in the job directory.
+static void absoluteInputPaths(YAML::Node node) {
+    if (node.IsSequence()) {
+        for (auto child : node) {
+            absoluteInputPaths(child);
+        }
+        return;
+    }
+    if (!node.IsMap()) {
+        return;
+    }
+
+    for (auto it = node.begin(); it != node.end(); ++it) {
+        const std::string key = it->first.as<std::string>();
+        YAML::Node value = it->second;
+        if (!value.IsScalar()) {
+            absoluteInputPaths(value);
+            continue;
+        }
+
+        bool path_key = endsWith(key, "_src") || endsWith(key, "_annot") || endsWith(key, "_path") ||
+                        endsWith(key, "_dir");
+        std::string path = value.as<std::string>();
+        std::error_code error;
+        if (path_key && !path.empty() && std::filesystem::path(path).is_relative() &&
+            std::filesystem::exists(path, error)) {
+            node[key] = std::filesystem::absolute(path).string();
+        }
+    }
+}
+
+std::vector<CorpusJob> CorpusRunner::buildJobs() const {
+    std::vector<CorpusJob> jobs;
+
+    for (const auto& overlay : overlays) {
+        for (const auto& video : videos) {
+            CorpusJob job;
+            job.test_id = overlay.name + "_" + video.name;
+            job.video = video.name;
+
+            // Overlays are applied on the YAML level so they use the same keys as params_input_file.yml
+            job.config = YAML::Clone(base_config);
+            for (auto it = overlay.values.begin(); it != overlay.values.end(); ++it) {
+                job.config[it->first.as<std::string>()] = YAML::Clone(it->second);
+            }
+            job.config["video_src"] = video.src;
+            job.config["video_annot"] = video.annot;
+            job.config["debug"] = false;    // no window can be opened from a batch job
+            job.config["display"] = false;
+            absoluteInputPaths(job.config);
+
+            jobs.push_back(job);
+        }
+    }
+
+    return jobs;
+}
+
+std::string CorpusRunner::jobDir(const std::string& output_dir, const CorpusJob& job) {
+    return (std::filesystem::path(output_dir) / "jobs" / job.test_id).string();
+}
+
+bool CorpusRunner::prepareJob(const CorpusJob& job) const {
+    std::filesystem::path dir = jobDir(output_dir, job);
+
+    // A retry starts without the results of the failed attempt
+    std::error_code error;
+    std::filesystem::remove_all(dir / "results", error);
+    std::filesystem::create_directories(dir, error);
+    if (error) {
+        std::cerr << "Error: Could not create job directory " << dir << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    std::ofstream file(dir / JOB_CONFIG_FILE);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << (dir / JOB_CONFIG_FILE) << " for writing." << std::endl;
+        return false;
+    }
+    file << job.config << "\n";
+    return file.good();
+}
+
+#ifndef _WIN32
+
+long CorpusRunner::startJob(const CorpusJob& job, bool single_threaded) const {
+    // Everything the child needs is prepared before fork, after it only async-signal-safe calls are made
+    std::string dir = jobDir(output_dir, job);
+    std::string program = std::filesystem::absolute(detector).string();
+    rlim_t memory_limit = static_cast<rlim_t>(memory_limit_mb) * 1024 * 1024;
+
+    // Jobs are already spread over the cores, nested OpenCV threading would only oversubscribe them
+    const std::string threads_variable = "OPENCV_FOR_THREADS_NUM=";
+    std::vector<std::string> environment;
+    for (char** variable = environ; *variable; ++variable) {
+        if (!single_threaded || std::string(*variable).compare(0, threads_variable.size(), threads_variable) != 0) {
+            environment.push_back(*variable);
+        }
+    }
+    if (single_threaded) {
+        environment.push_back(threads_variable + "1");
+    }
+    std::vector<char*> envp;
+    for (auto& variable : environment) {
+        envp.push_back(variable.data());
+    }
+    envp.push_back(nullptr);
+
+    std::string config_arg = JOB_CONFIG_FILE;
+    std::string test_id_arg = job.test_id;
+    char* argv[] = {program.data(), config_arg.data(), test_id_arg.data(), nullptr};
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Error: Could not start job " << job.test_id << std::endl;
+        return -1;
+    }
+    if (pid > 0) {
+        return pid;
+    }
+
+    if (chdir(dir.c_str()) != 0) {
+        _exit(127);
+    }
+
+    int log = open(JOB_LOG_FILE.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (log >= 0) {
+        dup2(log, STDOUT_FILENO);
+        dup2(log, STDERR_FILENO);
+        close(log);
+    }
+
+    if (memory_limit > 0) {
+        rlimit limit{memory_limit, memory_limit};
+        setrlimit(RLIMIT_AS, &limit);
+    }
+
+    execve(program.c_str(), argv, envp.data());
+    _exit(127);
+}
+
+bool CorpusRunner::run() {
+    std::vector<CorpusJob> jobs = buildJobs();
+    if (jobs.empty()) {
+        std::cerr << "Error: corpus has no videos" << std::endl;
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(output_dir, error);
+
+    int pool = workers > 0 ? workers : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::cout << "Running " << jobs.size() << " corpus jobs on " << pool << " worker processes" << std::endl;
+
+    struct RunningJob {
+        size_t job;
+        pid_t pid;
+        std::chrono::steady_clock::time_point started;
+        bool killed;
+    };
+
+    std::deque<size_t> pending;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        pending.push_back(i);
+    }
+    std::vector<RunningJob> running;
+
+    auto finishAttempt = [&](size_t i, const std::string& failure, bool retry) {
+        CorpusJob& job = jobs[i];
+        if (failure.empty()) {
+            job.succeeded = true;
+            std::cout << "Job " << job.test_id << " finished" << std::endl;
+            return;
+        }
+        std::cerr << "Job " << job.test_id << " " << failure << " (attempt " << job.attempts << ", log "
+                  << (std::filesystem::path(jobDir(output_dir, job)) / JOB_LOG_FILE).string() << ")" << std::endl;
+        if (retry && job.attempts <= retries) {
+            pending.push_back(i);
+        }
+    };
+
+    while (!pending.empty() || !running.empty()) {
+        while (static_cast<int>(running.size()) < pool && !pending.empty()) {
+            size_t i = pending.front();
+            pending.pop_front();
+
+            jobs[i].attempts++;
+            pid_t pid = prepareJob(jobs[i]) ? static_cast<pid_t>(startJob(jobs[i], pool > 1)) : -1;
+            if (pid < 0) {
+                finishAttempt(i, "could not be started", false);
+                continue;
+            }
+            running.push_back({i, pid, std::chrono::steady_clock::now(), false});
+        }
+
+        // Only the job processes are reaped, children the embedding program started itself are left alone
+        int status = 0;
+        auto it = std::find_if(running.begin(), running.end(), [&status](const RunningJob& r) {
+            return waitpid(r.pid, &status, WNOHANG) == r.pid;
+        });
+        if (it != running.end()) {
+            RunningJob finished = *it;
+            running.erase(it);
+
+            // The detector reports most errors on stderr and still exits with 0, a job without a summary failed
+            std::filesystem::path summary = std::filesystem::path(jobDir(output_dir, jobs[finished.job])) / "results" /
+                                            SUMMARY_FILE;
+            if (finished.killed) {
+                finishAttempt(finished.job, "timed out after " + std::to_string(timeout_s) + " s", true);
+            } else if (WIFSIGNALED(status)) {
+                finishAttempt(finished.job, "crashed with signal " + std::to_string(WTERMSIG(status)), true);
+            } else if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+                finishAttempt(finished.job, "failed with exit code " + std::to_string(WEXITSTATUS(status)), true);
+            } else if (!std::filesystem::exists(summary, error)) {
+                finishAttempt(finished.job, "produced no results", false);
+            } else {
+                finishAttempt(finished.job, "", false);
+            }
+            continue;
+        }
+
+        if (timeout_s > 0) {
+            auto now = std::chrono::steady_clock::now();
+            for (auto& job : running) {
+                if (!job.killed && now - job.started > std::chrono::seconds(timeout_s)) {
+                    kill(job.pid, SIGKILL);
+                    job.killed = true;
+                }
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    int rows = gatherResults(jobs, output_dir);
+
+    int failed = 0;
+    for (const auto& job : jobs) {
+        failed += job.succeeded ? 0 : 1;
+    }
+    std::cout << "Corpus finished: " << jobs.size() - failed << " of " << jobs.size() << " jobs succeeded, " << rows
+              << " summary rows in " << (std::filesystem::path(output_dir) / SUMMARY_FILE).string() << std::endl;
+    return failed == 0;
+}
+
+#else
+
+long CorpusRunner::startJob(const CorpusJob&, bool) const {
+    return -1;
+}
+
+bool CorpusRunner::run() {
+    std::cerr << "Error: the corpus runner is not available on Windows" << std::endl;
+    return false;
+}
+
+#endif
+
+int CorpusRunner::gatherResults(const std::vector<CorpusJob>& jobs, const std::string& output_dir) {
+    // The combined summary belongs to this run, a second run of the corpus replaces it instead of repeating its rows
+    std::filesystem::path summary_path = std::filesystem::path(output_dir) / SUMMARY_FILE;
+    bool has_header = false;
+    std::ofstream summary(summary_path, std::ios::trunc);
+    if (!summary.is_open()) {
+        std::cerr << "Error: Could not open summary file " << summary_path << std::endl;
+        return 0;
+    }
+
+    int rows = 0;
+    for (const auto& job : jobs) {
+        if (!job.succeeded) {
+            continue;
+        }
+
+        std::filesystem::path results_dir = std::filesystem::path(jobDir(output_dir, job)) / "results";
+        std::ifstream job_summary(results_dir / SUMMARY_FILE);
+        std::string line;
+        bool header = true;
+        while (std::getline(job_summary, line)) {
+            if (header) {
+                header = false;
+                if (!has_header) {
+                    summary << line << "\n";
+                    has_header = true;
+                }
+                continue;
+            }
+            if (!line.empty()) {
+                summary << line << "\n";
+                rows++;
+            }
+        }
+
+        // The summary rows name their detail file, it keeps its name in the per video directory
+        std::error_code error;
+        std::filesystem::path video_dir = std::filesystem::path(output_dir) / job.video;
+        std::filesystem::create_directories(video_dir, error);
+        for (const auto& entry : std::filesystem::directory_iterator(results_dir, error)) {
+            if (entry.path().filename() != SUMMARY_FILE) {
+                std::filesystem::rename(entry.path(), video_dir / entry.path().filename(), error);
+            }
+        }
+    }
+
+    return rows;
+}
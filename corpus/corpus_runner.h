@@ -0,0 +1,63 @@
+#ifndef CORPUS_RUNNER_H
+#define CORPUS_RUNNER_H
+
+#include <yaml-cpp/yaml.h>
+#include <string>
+#include <vector>
+
+struct CorpusVideo {
+    std::string name;
+    std::string src;
+    std::string annot;
+};
+
+// Named set of config keys applied on top of the base config, with the same keys as params_input_file.yml
+struct CorpusOverlay {
+    std::string name;
+    YAML::Node values;
+};
+
+struct CorpusJob {
+    std::string test_id;   // <overlay>_<video>
+    std::string video;
+    YAML::Node config;     // complete detector config of the job
+    int attempts = 0;
+    bool succeeded = false;
+};
+
+// Evaluation of many videos under many config overlays. Every job runs the detector executable in its own process
+// and working directory, so a crash or a runaway clip only costs that job. Jobs are scheduled over a pool of worker
+// processes, restarted up to retries times, and their summary rows and detail files are gathered into output_dir.
+class CorpusRunner {
+public:
+    explicit CorpusRunner(const std::string& manifestFile);
+    explicit CorpusRunner(const YAML::Node& manifest);
+
+    // Every overlay on every video, in overlay-major order
+    std::vector<CorpusJob> buildJobs() const;
+    // True when every job succeeded
+    bool run();
+
+    // Writes the summary rows of the finished jobs to output_dir/benchmark_summary.csv, replacing the one of an
+    // earlier run, and moves their detail files to output_dir/<video>/. Returns the number of rows gathered.
+    static int gatherResults(const std::vector<CorpusJob>& jobs, const std::string& output_dir);
+    static std::string jobDir(const std::string& output_dir, const CorpusJob& job);
+
+private:
+    YAML::Node base_config;
+    std::string detector;
+    std::string output_dir;
+    int workers;
+    int memory_limit_mb;   // address space limit of each job, 0 for none
+    int timeout_s;         // jobs running longer are killed, 0 for none
+    int retries;
+    std::vector<CorpusVideo> videos;
+    std::vector<CorpusOverlay> overlays;
+
+    // Writes config.yml into the job directory, false when the directory cannot be created
+    bool prepareJob(const CorpusJob& job) const;
+    // Process ID of the started job, -1 when it could not be started
+    long startJob(const CorpusJob& job, bool single_threaded) const;
+};
+
+#endif //CORPUS_RUNNER_H
@@ -0,0 +1,270 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "decision_publisher.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+int64_t DecisionPublisher::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool DecisionPublisher::parseMode(const std::string& name, DecisionOutputMode& mode) {
+    if (name == "UDS") {
+        mode = DecisionOutputMode::UDS;
+        return true;
+    }
+    if (name == "SHM") {
+        mode = DecisionOutputMode::SHM;
+        return true;
+    }
+    return false;
+}
+
+bool DecisionPublisher::isOpen() const {
+    return socket_fd >= 0 || mailbox != nullptr;
+}
+
+int DecisionPublisher::publishedMessages() const {
+    return published;
+}
+
+int DecisionPublisher::droppedMessages() const {
+    return dropped;
+}
+
+double DecisionPublisher::busyMilliseconds() const {
+    return busy_ms;
+}
+
+double DecisionPublisher::latencyPercentile(double percentile) const {
+    if (latencies_ms.empty()) {
+        return 0.0;
+    }
+
+    // Nearest rank, like the frame latency percentiles
+    std::vector<double> sorted = latencies_ms;
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * sorted.size()));
+    size_t index = std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0);
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+void DecisionPublisher::publish(int zone, int frame_index, int64_t capture_time_ns, int location, bool is_crossing,
+                                float move_mode) {
+    if (!isOpen()) {
+        return;
+    }
+
+    int64_t start = now();
+
+    if (static_cast<size_t>(zone) >= last_locations.size()) {
+        last_locations.resize(zone + 1, -1);
+    }
+    bool transition = last_locations[zone] != location;
+    last_locations[zone] = location;
+    if (edges_only && !transition) {
+        return;
+    }
+
+    DecisionMessage message{};
+    message.magic = DECISION_MESSAGE_MAGIC;
+    message.type = static_cast<uint32_t>(transition ? DecisionMessageType::Transition : DecisionMessageType::Heartbeat);
+    message.sequence = sequence++;
+    message.frame_index = frame_index;
+    message.capture_time_ns = capture_time_ns;
+    message.publish_time_ns = start;
+    message.zone = zone;
+    message.location = location;
+    message.move_mode = move_mode;
+    message.is_crossing = is_crossing ? 1 : 0;
+
+    if (send(message)) {
+        published++;
+    } else {
+        dropped++;
+    }
+
+    double latency_ms = (now() - start) / 1e6;
+    busy_ms += latency_ms;
+    if (latencies_ms.size() < DECISION_LATENCY_WINDOW) {
+        latencies_ms.push_back(latency_ms);
+    } else {
+        latencies_ms[next_latency] = latency_ms;
+        next_latency = (next_latency + 1) % DECISION_LATENCY_WINDOW;
+    }
+}
+
+#ifdef _WIN32
+
+DecisionPublisher::DecisionPublisher(DecisionOutputMode mode, const std::string& path, bool edges_only)
+    : mode(mode), path(path), edges_only(edges_only) {
+    std::cerr << "Warning: decision output is not supported on Windows" << std::endl;
+}
+
+DecisionPublisher::~DecisionPublisher() = default;
+
+bool DecisionPublisher::send(const DecisionMessage&) {
+    return false;
+}
+
+DecisionMailboxReader::~DecisionMailboxReader() = default;
+
+bool DecisionMailboxReader::open(const std::string&) {
+    return false;
+}
+
+bool DecisionMailboxReader::read(DecisionMessage&) {
+    return false;
+}
+
+#else
+
+DecisionPublisher::DecisionPublisher(DecisionOutputMode mode, const std::string& path, bool edges_only)
+    : mode(mode), path(path), edges_only(edges_only) {
+    latencies_ms.reserve(DECISION_LATENCY_WINDOW);
+    if (mode == DecisionOutputMode::UDS) {
+        if (path.size() >= sizeof(sockaddr_un::sun_path)) {
+            std::cerr << "Error: decision output socket path too long: " << path << std::endl;
+            return;
+        }
+
+        // The consumer binds the socket, datagrams are sent without connecting so it can start and restart any time
+        socket_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (socket_fd < 0) {
+            std::cerr << "Error: Could not create decision output socket" << std::endl;
+        }
+        return;
+    }
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(DecisionMailbox)) != 0) {
+        std::cerr << "Error: Could not create decision mailbox " << path << std::endl;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return;
+    }
+
+    void* memory = mmap(nullptr, sizeof(DecisionMailbox), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Error: Could not map decision mailbox " << path << std::endl;
+        return;
+    }
+
+    // A new run starts an empty ring, readers of the last run see the sequence restart
+    mailbox = static_cast<DecisionMailbox*>(memory);
+    mailbox->slot_count = DECISION_MAILBOX_SLOTS;
+    mailbox->written.store(0, std::memory_order_relaxed);
+    for (auto& slot : mailbox->slots) {
+        slot.sequence.store(0, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    mailbox->magic = DECISION_MESSAGE_MAGIC;
+}
+
+DecisionPublisher::~DecisionPublisher() {
+    if (socket_fd >= 0) {
+        ::close(socket_fd);
+    }
+    if (mailbox) {
+        munmap(mailbox, sizeof(DecisionMailbox));
+    }
+}
+
+bool DecisionPublisher::send(const DecisionMessage& message) {
+    if (mode == DecisionOutputMode::UDS) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        // A missing or full consumer socket fails right away, the message is dropped
+        ssize_t sent = sendto(socket_fd, &message, sizeof(message), MSG_DONTWAIT,
+                              reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+        return sent == static_cast<ssize_t>(sizeof(message));
+    }
+
+    uint64_t n = mailbox->written.load(std::memory_order_relaxed);
+    DecisionMailbox::Slot& slot = mailbox->slots[n % DECISION_MAILBOX_SLOTS];
+
+    slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&slot.message, &message, sizeof(message));
+    slot.sequence.store(2 * (n + 1), std::memory_order_release);
+    mailbox->written.store(n + 1, std::memory_order_release);
+    return true;
+}
+
+DecisionMailboxReader::~DecisionMailboxReader() {
+    if (mailbox) {
+        munmap(const_cast<DecisionMailbox*>(mailbox), sizeof(DecisionMailbox));
+    }
+}
+
+bool DecisionMailboxReader::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    void* memory = mmap(nullptr, sizeof(DecisionMailbox), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    mailbox = static_cast<const DecisionMailbox*>(memory);
+    next = mailbox->written.load(std::memory_order_acquire);
+    return true;
+}
+
+bool DecisionMailboxReader::read(DecisionMessage& message) {
+    if (!mailbox) {
+        return false;
+    }
+
+    while (true) {
+        uint64_t written = mailbox->written.load(std::memory_order_acquire);
+        if (next >= written) {
+            return false;
+        }
+        if (written - next > DECISION_MAILBOX_SLOTS) {
+            lost += written - next - DECISION_MAILBOX_SLOTS;
+            next = written - DECISION_MAILBOX_SLOTS;
+        }
+
+        const DecisionMailbox::Slot& slot = mailbox->slots[next % DECISION_MAILBOX_SLOTS];
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        std::memcpy(&message, &slot.message, sizeof(message));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+
+        if (before == after && before == 2 * (next + 1)) {
+            next++;
+            return true;
+        }
+        // The writer lapped the reader while it copied, the slot now holds a newer message
+        if (before > 2 * (next + 1) || after > 2 * (next + 1)) {
+            lost++;
+            next++;
+        }
+    }
+}
+
+#endif
+
+uint64_t DecisionMailboxReader::lostMessages() const {
+    return lost;
+}
@@ -0,0 +1,117 @@
+#ifndef DECISION_PUBLISHER_H
+#define DECISION_PUBLISHER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr uint32_t DECISION_MESSAGE_MAGIC = 0x5A464431;   // "ZFD1"
+constexpr uint32_t DECISION_MAILBOX_SLOTS = 64;
+// Publish times kept for the latency percentiles, the oldest is replaced so a long run keeps a fixed footprint
+constexpr size_t DECISION_LATENCY_WINDOW = 4096;
+
+enum class DecisionMessageType : uint32_t {
+    Heartbeat = 1,    // sent for every frame unless only edges are published
+    Transition = 2    // the decision of the zone changed with this frame
+};
+
+// Fixed size binary message, in host byte order. Times are nanoseconds of the monotonic clock, which processes on
+// the same host share.
+struct DecisionMessage {
+    uint32_t magic;
+    uint32_t type;               // DecisionMessageType
+    uint64_t sequence;           // counts every published message, gaps mean lost messages
+    int64_t frame_index;
+    int64_t capture_time_ns;     // when the frame was read
+    int64_t publish_time_ns;
+    int32_t zone;                // index in the zones list, 0 without zones
+    int32_t location;            // 0 up, 1 other, 2 difference, 3 waiting
+    float move_mode;             // NaN without motion
+    uint32_t is_crossing;
+};
+
+static_assert(sizeof(DecisionMessage) == 56, "DecisionMessage is a wire format");
+
+// Shared memory layout of the SHM output. Every slot is a seqlock: its sequence is odd while the message is written
+// and 2 * (n + 1) once message n is complete. Readers copy a slot and check the sequence again, the writer never
+// waits for them.
+struct DecisionMailbox {
+    uint32_t magic;
+    uint32_t slot_count;
+    std::atomic<uint64_t> written;      // messages published so far, message n lives in slot n % slot_count
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        DecisionMessage message;
+    } slots[DECISION_MAILBOX_SLOTS];
+};
+
+enum class DecisionOutputMode {
+    UDS,    // datagrams to a UNIX domain socket bound by the consumer
+    SHM     // seqlock ring in a shared memory file
+};
+
+// Publishes decisions to a local consumer such as an LED controller. Publishing never blocks: a datagram the
+// consumer socket cannot take right away is counted as dropped, and the shared memory ring simply overwrites what
+// the reader did not read. Only the detection thread may publish.
+class DecisionPublisher {
+public:
+    DecisionPublisher(DecisionOutputMode mode, const std::string& path, bool edges_only);
+    ~DecisionPublisher();
+
+    DecisionPublisher(const DecisionPublisher&) = delete;
+    DecisionPublisher& operator=(const DecisionPublisher&) = delete;
+
+    bool isOpen() const;
+
+    // Sends the heartbeat of the zone, or only its transitions with edges_only
+    void publish(int zone, int frame_index, int64_t capture_time_ns, int location, bool is_crossing, float move_mode);
+
+    int publishedMessages() const;
+    int droppedMessages() const;
+    // Total time spent in publish, and percentiles over the last DECISION_LATENCY_WINDOW publishes, in milliseconds
+    double busyMilliseconds() const;
+    double latencyPercentile(double percentile) const;
+
+    static int64_t now();
+    static bool parseMode(const std::string& name, DecisionOutputMode& mode);
+
+private:
+    DecisionOutputMode mode;
+    std::string path;
+    bool edges_only;
+
+    int socket_fd = -1;
+    DecisionMailbox* mailbox = nullptr;
+
+    uint64_t sequence = 0;
+    int published = 0;
+    int dropped = 0;
+    std::vector<int> last_locations;
+    std::vector<double> latencies_ms;   // ring of the last publish times, next_latency is the oldest once full
+    size_t next_latency = 0;
+    double busy_ms = 0.0;
+
+    bool send(const DecisionMessage& message);
+};
+
+// Reads the SHM output from another process
+class DecisionMailboxReader {
+public:
+    ~DecisionMailboxReader();
+
+    // Only messages published after open are read
+    bool open(const std::string& path);
+    // Next unread message, false when there is none. Messages overwritten before they were read are skipped and
+    // counted in lost.
+    bool read(DecisionMessage& message);
+    uint64_t lostMessages() const;
+
+private:
+    const DecisionMailbox* mailbox = nullptr;
+    uint64_t next = 0;
+    uint64_t lost = 0;
+};
+
+#endif //DECISION_PUBLISHER_H
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <tuple>
+
+#include "equivalence_harness.h"
+#include "../benchmark/benchmark.h"
+
+namespace {
+
+// Divergences printed by printEquivalenceReport, the CSV has all of them
+constexpr size_t PRINTED_DIVERGENCES = 10;
+
+const char* voteName(int vote) {
+    switch (vote) {
+        case 0: return "up";
+        case 1: return "other";
+        case 2: return "difference";
+        case 3: return "waiting";
+    }
+    return "none";
+}
+
+// Frame the margins of config turn into roi_size, so beginFrames gives the whole ROI back
+cv::Size frameSize(const AppConfig& config, const cv::Size& roi_size) {
+    return {roi_size.width + config.col_start + config.col_end, roi_size.height + config.row_start + config.row_end};
+}
+
+// Everything that places a zone or turns its flow into votes and decisions, the annotation file is not compared
+bool sameZone(const ZoneConfig& a, const ZoneConfig& b) {
+    return std::tie(a.name, a.row_start, a.row_end, a.col_start, a.col_end, a.angle_up_min, a.angle_up_max,
+                    a.angle_down_min, a.angle_down_max, a.threshold, a.size, a.moving_up_lock_frames) ==
+           std::tie(b.name, b.row_start, b.row_end, b.col_start, b.col_end, b.angle_up_min, b.angle_up_max,
+                    b.angle_down_min, b.angle_down_max, b.threshold, b.size, b.moving_up_lock_frames);
+}
+
+bool sameMargins(const AppConfig& a, const AppConfig& b) {
+    return a.row_start == b.row_start && a.row_end == b.row_end && a.col_start == b.col_start &&
+           a.col_end == b.col_end &&
+           std::equal(a.zones.begin(), a.zones.end(), b.zones.begin(), b.zones.end(), sameZone);
+}
+
+double fraction(int count, int total) {
+    return total > 0 ? static_cast<double>(count) / total : 0.0;
+}
+
+}
+
+int EquivalenceReport::comparedZoneFrames() const {
+    return frames * zones;
+}
+
+double EquivalenceReport::speedup() const {
+    return candidate_ms > 0.0 ? reference_ms / candidate_ms : 0.0;
+}
+
+bool EquivalenceReport::passed(const EquivalenceTolerance& tolerance) const {
+    int total = comparedZoneFrames();
+    return total > 0 &&
+           fraction(angle_mismatches, total) <= tolerance.angle_mismatch &&
+           fraction(vote_mismatches, total) <= tolerance.vote_mismatch &&
+           fraction(decision_mismatches, total) <= tolerance.decision_mismatch;
+}
+
+EquivalenceHarness::EquivalenceHarness(const AppConfig& reference, const AppConfig& candidate,
+                                       const EquivalenceTolerance& tolerance)
+    : reference(reference), candidate(candidate), tolerance(tolerance) {}
+
+double EquivalenceHarness::angleDifference(float reference, float candidate) {
+    bool reference_motion = !std::isnan(reference);
+    bool candidate_motion = !std::isnan(candidate);
+    if (!reference_motion && !candidate_motion) {
+        return 0.0;
+    }
+    if (reference_motion != candidate_motion) {
+        return std::nan("");
+    }
+    double difference = std::fmod(std::fabs(static_cast<double>(reference) - candidate), 360.0);
+    return std::min(difference, 360.0 - difference);
+}
+
+EquivalenceReport EquivalenceHarness::compare(const std::vector<cv::Mat>& roi_frames, int first_frame_index) const {
+    size_t next_frame = 0;
+    return compare([&](cv::Mat& roi_frame) {
+        if (next_frame >= roi_frames.size()) {
+            return false;
+        }
+        roi_frame = roi_frames[next_frame++];
+        return true;
+    }, first_frame_index);
+}
+
+EquivalenceReport EquivalenceHarness::compare(const std::function<bool(cv::Mat&)>& nextFrame,
+                                              int first_frame_index) const {
+    EquivalenceReport report;
+    if (!sameMargins(reference, candidate)) {
+        std::cerr << "Error: The reference and the candidate must use the same margins and zones" << std::endl;
+        return report;
+    }
+
+    cv::Mat frame;
+    if (!nextFrame(frame)) {
+        return report;
+    }
+
+    MotionDetector reference_detector(reference);
+    MotionDetector candidate_detector(candidate);
+    if (reference_detector.beginFrames(frameSize(reference, frame.size())).empty() ||
+        candidate_detector.beginFrames(frameSize(candidate, frame.size())).empty()) {
+        return report;
+    }
+
+    Benchmark timer;
+    double reference_total = 0.0, candidate_total = 0.0;
+    int reference_votes = 0, candidate_votes = 0;
+    for (int i = 0; i == 0 || nextFrame(frame); ++i) {
+        timer.start();
+        const std::vector<FrameDecision>& decided = reference_detector.decideNext(frame);
+        double reference_elapsed = timer.stop();
+        std::vector<FrameDecision> expected = decided;
+
+        timer.start();
+        const std::vector<FrameDecision>& actual = candidate_detector.decideNext(frame);
+        double candidate_elapsed = timer.stop();
+
+        // The first frame only seeds both detectors, and may include the startup of the estimators
+        if (i == 0) {
+            continue;
+        }
+        if (expected.size() != actual.size() || expected.empty()) {
+            std::cerr << "Error: The reference and the candidate decided different zones" << std::endl;
+            return EquivalenceReport();
+        }
+
+        report.frames++;
+        report.zones = static_cast<int>(expected.size());
+        reference_total += reference_elapsed;
+        candidate_total += candidate_elapsed;
+
+        for (size_t zone = 0; zone < expected.size(); ++zone) {
+            double angle = angleDifference(expected[zone].move_mode, actual[zone].move_mode);
+            bool angle_differs = std::isnan(angle) || angle > tolerance.angle_degrees;
+            bool vote_differs = expected[zone].vote != actual[zone].vote;
+            bool decision_differs = expected[zone].is_crossing != actual[zone].is_crossing;
+
+            if (!std::isnan(angle)) {
+                report.max_angle_difference = std::max(report.max_angle_difference, angle);
+            }
+            if (angle_differs || vote_differs || decision_differs) {
+                // Numbered like processFrames, whose first result is the first frame after the seed
+                report.divergences.push_back({first_frame_index + i - 1, static_cast<int>(zone),
+                                              expected[zone], actual[zone]});
+            }
+            report.angle_mismatches += angle_differs ? 1 : 0;
+            report.vote_mismatches += vote_differs ? 1 : 0;
+            report.decision_mismatches += decision_differs ? 1 : 0;
+            reference_votes += expected[zone].vote != -1 ? 1 : 0;
+            candidate_votes += actual[zone].vote != -1 ? 1 : 0;
+        }
+    }
+
+    // An estimator that fails on every frame, such as YOLO without its weights, agrees with another failing one
+    if (report.frames > 0 && (reference_votes == 0 || candidate_votes == 0)) {
+        std::cerr << "Error: The " << (reference_votes == 0 ? "reference" : "candidate")
+                  << " estimator did not vote on any frame" << std::endl;
+        return EquivalenceReport();
+    }
+
+    report.reference_ms = report.frames > 0 ? reference_total / report.frames : 0.0;
+    report.candidate_ms = report.frames > 0 ? candidate_total / report.frames : 0.0;
+    return report;
+}
+
+void printEquivalenceReport(const EquivalenceReport& report, const EquivalenceTolerance& tolerance,
+                            std::ostream& out) {
+    int total = report.comparedZoneFrames();
+
+    auto line = [&](const char* name, int count, double allowed) {
+        out << std::left << std::setw(10) << name << std::right << std::setw(8) << count << " of " << total
+            << std::fixed << std::setprecision(2) << std::setw(9) << fraction(count, total) * 100.0 << "%"
+            << "  allowed " << allowed * 100.0 << "%" << (fraction(count, total) > allowed ? "  DIVERGED" : "")
+            << "\n";
+    };
+
+    out << "Compared " << report.frames << " frames in " << report.zones << " zones\n";
+    line("Angle", report.angle_mismatches, tolerance.angle_mismatch);
+    line("Vote", report.vote_mismatches, tolerance.vote_mismatch);
+    line("Decision", report.decision_mismatches, tolerance.decision_mismatch);
+    out << std::fixed << std::setprecision(2) << "Largest angle difference " << report.max_angle_difference
+        << " degrees, tolerance " << tolerance.angle_degrees << "\n"
+        << "Reference " << std::setprecision(3) << report.reference_ms << " ms, candidate " << report.candidate_ms
+        << " ms per frame, speedup " << std::setprecision(2) << report.speedup() << "x\n";
+
+    size_t printed = 0;
+    for (const auto& d : report.divergences) {
+        if (printed++ == PRINTED_DIVERGENCES) {
+            out << "... " << report.divergences.size() - PRINTED_DIVERGENCES << " more zone frames differ\n";
+            break;
+        }
+        out << "  frame " << d.frame_index << " zone " << d.zone << std::setprecision(1)
+            << ": angle " << d.reference.move_mode << " / " << d.candidate.move_mode
+            << ", vote " << voteName(d.reference.vote) << " / " << voteName(d.candidate.vote)
+            << ", crossing " << d.reference.is_crossing << " / " << d.candidate.is_crossing << "\n";
+    }
+    out << std::endl;
+}
+
+bool writeDivergenceCSV(const EquivalenceReport& report, const std::string& filename) {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << filename << " for writing." << std::endl;
+        return false;
+    }
+
+    file << "Frame Index,Zone,Reference Angle,Candidate Angle,Angle Difference,Reference Vote,Candidate Vote,"
+            "Reference Crossing,Candidate Crossing\n";
+    for (const auto& d : report.divergences) {
+        file << d.frame_index << "," << d.zone << ","
+             << d.reference.move_mode << "," << d.candidate.move_mode << ","
+             << EquivalenceHarness::angleDifference(d.reference.move_mode, d.candidate.move_mode) << ","
+             << voteName(d.reference.vote) << "," << voteName(d.candidate.vote) << ","
+             << d.reference.is_crossing << "," << d.candidate.is_crossing << "\n";
+    }
+    return true;
+}
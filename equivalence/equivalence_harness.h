@@ -0,0 +1,71 @@
+#ifndef EQUIVALENCE_HARNESS_H
+#define EQUIVALENCE_HARNESS_H
+
+#include <opencv2/opencv.hpp>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../motion-detector/motion_detector.h"
+
+struct EquivalenceTolerance {
+    double angle_degrees = 1.0;       // largest angle difference of a zone frame that still counts as equal
+    double angle_mismatch = 0.0;      // fractions of the compared zone frames that may differ
+    double vote_mismatch = 0.0;
+    double decision_mismatch = 0.0;
+};
+
+// Zone frame on which the candidate did not match the reference, frame_index counts like processFrames
+struct FrameDivergence {
+    int frame_index;
+    int zone;
+    FrameDecision reference;
+    FrameDecision candidate;
+};
+
+struct EquivalenceReport {
+    int frames = 0;                       // decided frames, the seeding frame is not counted
+    int zones = 0;
+    int angle_mismatches = 0;             // past the tolerance, or motion found by only one of the two
+    int vote_mismatches = 0;
+    int decision_mismatches = 0;
+    double max_angle_difference = 0.0;    // over the zone frames where both found motion
+    double reference_ms = 0.0;            // mean decision time per frame
+    double candidate_ms = 0.0;
+    std::vector<FrameDivergence> divergences;   // zone frames with any mismatch, in frame order
+
+    int comparedZoneFrames() const;
+    // Reference time over candidate time, above 1 when the candidate is faster
+    double speedup() const;
+    bool passed(const EquivalenceTolerance& tolerance) const;
+};
+
+// Runs a reference and a candidate detector side by side on the same ROI frames and compares the angle, the vote
+// and the decision of every zone frame. Both decide each frame in turn, so their times are taken under the same
+// conditions. The configs may differ in anything but the margins and the zones, typically the reference keeps the
+// plain settings and the candidate turns on the optimization under test.
+class EquivalenceHarness {
+public:
+    EquivalenceHarness(const AppConfig& reference, const AppConfig& candidate,
+                       const EquivalenceTolerance& tolerance = EquivalenceTolerance());
+
+    // Empty report when the two configs do not decide the same zones, or when one of them never voted
+    EquivalenceReport compare(const std::vector<cv::Mat>& roi_frames, int first_frame_index = 0) const;
+    // Takes ROI frames from nextFrame until it returns false, so long scenes never have to be held in memory
+    EquivalenceReport compare(const std::function<bool(cv::Mat&)>& nextFrame, int first_frame_index = 0) const;
+
+    // Difference of two flow angles in degrees on the circle, NaN when only one of them is NaN
+    static double angleDifference(float reference, float candidate);
+
+private:
+    AppConfig reference;
+    AppConfig candidate;
+    EquivalenceTolerance tolerance;
+};
+
+void printEquivalenceReport(const EquivalenceReport& report, const EquivalenceTolerance& tolerance,
+                            std::ostream& out);
+bool writeDivergenceCSV(const EquivalenceReport& report, const std::string& filename);
+
+#endif //EQUIVALENCE_HARNESS_H
@@ -0,0 +1,372 @@
+#include <iostream>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+
+#include "frame_cache.h"
+
+static const char FRAME_CACHE_MAGIC[8] = {'Z', 'F', 'C', 'A', 'C', 'H', 'E', '1'};
+static const uint32_t FRAME_CACHE_VERSION = 1;
+static const size_t FRAME_CACHE_ALIGNMENT = 64;
+
+static void sourceStamp(const std::string& source, uint64_t& size, int64_t& mtime) {
+    size = 0;
+    mtime = 0;
+
+    std::error_code error;
+    if (std::filesystem::is_regular_file(source, error)) {
+        size = static_cast<uint64_t>(std::filesystem::file_size(source, error));
+        mtime = static_cast<int64_t>(std::filesystem::last_write_time(source, error).time_since_epoch().count());
+    }
+}
+
+static void writeVarint(std::vector<uchar>& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uchar>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uchar>(value));
+}
+
+static bool readVarint(const uchar* in, size_t in_size, size_t& pos, size_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in_size) {
+            return false;
+        }
+        uchar byte = in[pos++];
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Stream of (zero run, literal run, literal bytes) over the byte difference to the previous frame. Static
+// background gives long zero runs, a literal run only ends at four or more zero deltas in a row.
+static void encodeDeltaRLE(const uchar* current, const uchar* previous, size_t n, std::vector<uchar>& out) {
+    out.clear();
+
+    auto delta = [&](size_t i) -> uchar {
+        return static_cast<uchar>(current[i] - (previous ? previous[i] : 0));
+    };
+
+    size_t i = 0;
+    while (i < n) {
+        size_t zero_start = i;
+        while (i < n && delta(i) == 0) {
+            i++;
+        }
+        size_t zeros = i - zero_start;
+
+        size_t literal_start = i;
+        size_t zero_streak = 0;
+        while (i < n) {
+            if (delta(i) == 0) {
+                if (++zero_streak == 4) {
+                    i -= 3;
+                    break;
+                }
+            } else {
+                zero_streak = 0;
+            }
+            i++;
+        }
+        size_t literals = i - literal_start;
+
+        writeVarint(out, zeros);
+        writeVarint(out, literals);
+        for (size_t j = literal_start; j < literal_start + literals; ++j) {
+            out.push_back(delta(j));
+        }
+    }
+}
+
+// previous may point to out, every byte is read before it is overwritten
+static bool decodeDeltaRLE(const uchar* in, size_t in_size, const uchar* previous, uchar* out, size_t n) {
+    size_t pos = 0;
+    size_t i = 0;
+
+    while (i < n) {
+        size_t zeros, literals;
+        if (!readVarint(in, in_size, pos, zeros) || !readVarint(in, in_size, pos, literals)) {
+            return false;
+        }
+        if (zeros + literals == 0 || i + zeros + literals > n || pos + literals > in_size) {
+            return false;
+        }
+
+        if (previous == nullptr) {
+            std::memset(out + i, 0, zeros);
+        } else if (previous != out) {
+            std::memcpy(out + i, previous + i, zeros);
+        }
+        i += zeros;
+
+        for (size_t j = 0; j < literals; ++j, ++i) {
+            out[i] = static_cast<uchar>(in[pos++] + (previous ? previous[i] : 0));
+        }
+    }
+
+    return true;
+}
+
+std::string frameCachePath(const std::string& cache_dir, const FrameCacheKey& key) {
+    std::ostringstream description;
+    description << key.source << "|" << key.upper_margin << "|" << key.bottom_margin << "|" << key.left_margin << "|"
+                << key.right_margin << "|" << key.seek << "|" << key.seek_end << "|" << (key.gray ? "GRAY" : "BGR");
+
+    std::ostringstream name;
+    name << std::filesystem::path(key.source).stem().string() << "_"
+         << std::hex << std::setw(16) << std::setfill('0') << std::hash<std::string>{}(description.str()) << ".zfc";
+
+    return (std::filesystem::path(cache_dir) / name.str()).string();
+}
+
+FrameCacheWriter::~FrameCacheWriter() {
+    discard();
+}
+
+bool FrameCacheWriter::isOpen() const {
+    return file.is_open();
+}
+
+bool FrameCacheWriter::open(const std::string& path, const FrameCacheKey& key, FrameCacheCompression compression,
+                            int keyframe_interval) {
+    discard();
+
+    this->path = path;
+    temp_path = path + ".tmp";
+
+    std::error_code error;
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent, error);
+    }
+
+    file.open(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not create frame cache " << temp_path << std::endl;
+        return false;
+    }
+
+    header = FrameCacheHeader{};
+    std::memcpy(header.magic, FRAME_CACHE_MAGIC, sizeof(header.magic));
+    header.version = FRAME_CACHE_VERSION;
+    header.header_size = sizeof(FrameCacheHeader);
+    std::strncpy(header.source, key.source.c_str(), sizeof(header.source) - 1);
+    header.upper_margin = key.upper_margin;
+    header.bottom_margin = key.bottom_margin;
+    header.left_margin = key.left_margin;
+    header.right_margin = key.right_margin;
+    header.seek = key.seek;
+    header.seek_end = key.seek_end;
+    header.type = key.gray ? CV_8UC1 : CV_8UC3;
+    header.compression = static_cast<uint32_t>(compression);
+    header.keyframe_interval = static_cast<uint32_t>(std::max(1, keyframe_interval));
+    sourceStamp(key.source, header.source_size, header.source_mtime);
+
+    index.clear();
+    previous.release();
+
+    // Placeholder, the final header is written by finish() once the frame count and index are known
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    return file.good();
+}
+
+static void padToAlignment(std::ofstream& file) {
+    static const char zeros[FRAME_CACHE_ALIGNMENT] = {};
+    std::streamoff position = file.tellp();
+    size_t padding = (FRAME_CACHE_ALIGNMENT - position % FRAME_CACHE_ALIGNMENT) % FRAME_CACHE_ALIGNMENT;
+    file.write(zeros, static_cast<std::streamsize>(padding));
+}
+
+bool FrameCacheWriter::write(const cv::Mat& roi_frame) {
+    if (!file.is_open()) {
+        return false;
+    }
+
+    if (header.type == CV_8UC1 && roi_frame.channels() == 3) {
+        cv::cvtColor(roi_frame, converted, cv::COLOR_BGR2GRAY);
+    } else if (roi_frame.isContinuous()) {
+        converted = roi_frame;
+    } else {
+        roi_frame.copyTo(converted);
+    }
+
+    if (index.empty()) {
+        header.width = converted.cols;
+        header.height = converted.rows;
+    }
+
+    if (converted.cols != header.width || converted.rows != header.height || converted.type() != header.type) {
+        std::cerr << "Error: frame cache expects " << header.width << "x" << header.height
+                  << " frames of a single type, discarding " << temp_path << std::endl;
+        discard();
+        return false;
+    }
+
+    padToAlignment(file);
+    FrameCacheIndexEntry entry{static_cast<uint64_t>(file.tellp()), 0};
+    size_t frame_bytes = converted.total() * converted.elemSize();
+
+    if (header.compression == static_cast<uint32_t>(FrameCacheCompression::DeltaRLE)) {
+        bool keyframe = index.size() % header.keyframe_interval == 0;
+        encodeDeltaRLE(converted.data, keyframe ? nullptr : previous.data, frame_bytes, encoded);
+        file.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+        entry.size = encoded.size();
+        converted.copyTo(previous);
+    } else {
+        file.write(reinterpret_cast<const char*>(converted.data), static_cast<std::streamsize>(frame_bytes));
+        entry.size = frame_bytes;
+    }
+
+    index.push_back(entry);
+    return file.good();
+}
+
+bool FrameCacheWriter::finish() {
+    if (!file.is_open()) {
+        return false;
+    }
+
+    padToAlignment(file);
+    header.index_offset = static_cast<uint64_t>(file.tellp());
+    header.frame_count = static_cast<int32_t>(index.size());
+    file.write(reinterpret_cast<const char*>(index.data()),
+        static_cast<std::streamsize>(index.size() * sizeof(FrameCacheIndexEntry)));
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    bool ok = file.good();
+    file.close();
+
+    std::error_code error;
+    if (ok) {
+        std::filesystem::rename(temp_path, path, error);
+        ok = !error;
+    }
+    if (!ok) {
+        std::cerr << "Error: Could not write frame cache " << path << std::endl;
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+
+    std::cout << "Frame cache saved to " << path << " (" << index.size() << " frames)" << std::endl;
+    return true;
+}
+
+void FrameCacheWriter::discard() {
+    if (file.is_open()) {
+        file.close();
+        std::error_code error;
+        std::filesystem::remove(temp_path, error);
+    }
+    index.clear();
+    previous.release();
+}
+
+bool FrameCacheReader::open(const std::string& path) {
+    header = nullptr;
+    index = nullptr;
+    decoded_index = -1;
+
+    if (!mapping.open(path)) {
+        return false;
+    }
+
+    if (mapping.size() < sizeof(FrameCacheHeader)) {
+        mapping.close();
+        return false;
+    }
+
+    const auto* candidate = reinterpret_cast<const FrameCacheHeader*>(mapping.data());
+    bool valid = std::memcmp(candidate->magic, FRAME_CACHE_MAGIC, sizeof(candidate->magic)) == 0 &&
+                 candidate->version == FRAME_CACHE_VERSION &&
+                 candidate->header_size == sizeof(FrameCacheHeader) &&
+                 candidate->frame_count > 0 &&
+                 candidate->index_offset + candidate->frame_count * sizeof(FrameCacheIndexEntry) <= mapping.size();
+    if (!valid) {
+        std::cerr << "Warning: ignoring invalid frame cache " << path << std::endl;
+        mapping.close();
+        return false;
+    }
+
+    header = candidate;
+    index = reinterpret_cast<const FrameCacheIndexEntry*>(mapping.data() + header->index_offset);
+    return true;
+}
+
+bool FrameCacheReader::matches(const FrameCacheKey& key) const {
+    if (header == nullptr) {
+        return false;
+    }
+
+    uint64_t source_size;
+    int64_t source_mtime;
+    sourceStamp(key.source, source_size, source_mtime);
+
+    return key.source == std::string(header->source, strnlen(header->source, sizeof(header->source))) &&
+           key.upper_margin == header->upper_margin && key.bottom_margin == header->bottom_margin &&
+           key.left_margin == header->left_margin && key.right_margin == header->right_margin &&
+           key.seek == header->seek && key.seek_end == header->seek_end &&
+           (key.gray ? CV_8UC1 : CV_8UC3) == header->type &&
+           source_size == header->source_size && source_mtime == header->source_mtime;
+}
+
+int FrameCacheReader::frameCount() const {
+    return header ? header->frame_count : 0;
+}
+
+int FrameCacheReader::firstFrameIndex() const {
+    return header ? header->seek : 0;
+}
+
+bool FrameCacheReader::frame(int frame_index, cv::Mat& out) {
+    if (header == nullptr || frame_index < 0 || frame_index >= header->frame_count) {
+        return false;
+    }
+
+    size_t frame_bytes = static_cast<size_t>(header->width) * header->height * CV_ELEM_SIZE(header->type);
+
+    if (header->compression == static_cast<uint32_t>(FrameCacheCompression::None)) {
+        const FrameCacheIndexEntry& entry = index[frame_index];
+        if (entry.size != frame_bytes || entry.offset + entry.size > mapping.size()) {
+            return false;
+        }
+        // The mapping is read-only, the Mat only borrows it
+        out = cv::Mat(header->height, header->width, header->type,
+            const_cast<unsigned char*>(mapping.data() + entry.offset));
+        return true;
+    }
+
+    if (frame_index == decoded_index) {
+        out = decoded;
+        return true;
+    }
+
+    decoded.create(header->height, header->width, header->type);
+
+    int keyframe = frame_index - frame_index % static_cast<int>(header->keyframe_interval);
+    int start = (decoded_index >= keyframe && decoded_index < frame_index) ? decoded_index + 1 : keyframe;
+
+    for (int i = start; i <= frame_index; ++i) {
+        const FrameCacheIndexEntry& entry = index[i];
+        if (entry.offset + entry.size > mapping.size()) {
+            decoded_index = -1;
+            return false;
+        }
+        const uchar* previous = (i == keyframe) ? nullptr : decoded.data;
+        if (!decodeDeltaRLE(mapping.data() + entry.offset, entry.size, previous, decoded.data, frame_bytes)) {
+            decoded_index = -1;
+            return false;
+        }
+        decoded_index = i;
+    }
+
+    out = decoded;
+    return true;
+}
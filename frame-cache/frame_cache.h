@@ -0,0 +1,103 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../utils/mapped_file.h"
+
+// Everything that decides which frames end up in a cache file, a cache is only reused when all of it matches
+struct FrameCacheKey {
+    std::string source;
+    int upper_margin;
+    int bottom_margin;
+    int left_margin;
+    int right_margin;
+    int seek;
+    int seek_end;
+    bool gray;
+};
+
+enum class FrameCacheCompression : uint32_t {
+    None = 0,     // frames are stored raw and handed out zero-copy from the mapping
+    DeltaRLE = 1  // byte difference to the previous frame, run-length coded, decoded into a reused buffer
+};
+
+#pragma pack(push, 1)
+struct FrameCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    char source[512];
+    int32_t upper_margin;
+    int32_t bottom_margin;
+    int32_t left_margin;
+    int32_t right_margin;
+    int32_t seek;
+    int32_t seek_end;
+    int32_t frame_count;
+    int32_t width;
+    int32_t height;
+    int32_t type;
+    uint32_t compression;
+    uint32_t keyframe_interval;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t index_offset;   // frame_count entries of FrameCacheIndexEntry
+};
+
+struct FrameCacheIndexEntry {
+    uint64_t offset;
+    uint64_t size;
+};
+#pragma pack(pop)
+
+class FrameCacheWriter {
+public:
+    ~FrameCacheWriter();
+
+    bool open(const std::string& path, const FrameCacheKey& key, FrameCacheCompression compression,
+              int keyframe_interval = 30);
+    bool write(const cv::Mat& roi_frame);
+    bool finish();   // writes the index and moves the file in place, an unfinished cache is discarded
+    void discard();
+
+    bool isOpen() const;
+
+private:
+    std::string path;
+    std::string temp_path;
+    std::ofstream file;
+    FrameCacheHeader header{};
+    std::vector<FrameCacheIndexEntry> index;
+    cv::Mat previous;
+    cv::Mat converted;
+    std::vector<uchar> encoded;
+};
+
+class FrameCacheReader {
+public:
+    bool open(const std::string& path);
+    bool matches(const FrameCacheKey& key) const;
+
+    int frameCount() const;
+    int firstFrameIndex() const;
+
+    // Raw caches return a read-only view into the mapping, compressed caches decode into a buffer that is
+    // reused by the next call. Either way the returned Mat must not be written to.
+    bool frame(int index, cv::Mat& out);
+
+private:
+    MappedFile mapping;
+    const FrameCacheHeader* header = nullptr;
+    const FrameCacheIndexEntry* index = nullptr;
+    cv::Mat decoded;
+    int decoded_index = -1;
+};
+
+std::string frameCachePath(const std::string& cache_dir, const FrameCacheKey& key);
+
+#endif //FRAME_CACHE_H
@@ -0,0 +1,219 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "frame_index.h"
+
+static const char FRAME_INDEX_MAGIC[8] = {'Z', 'F', 'I', 'N', 'D', 'E', 'X', '1'};
+// Version 2 orders the entries by presentation time, version 1 kept the packet order
+static const uint32_t FRAME_INDEX_VERSION = 2;
+
+static void sourceStamp(const std::string& source, uint64_t& size, int64_t& mtime) {
+    size = 0;
+    mtime = 0;
+
+    std::error_code error;
+    if (std::filesystem::is_regular_file(source, error)) {
+        size = static_cast<uint64_t>(std::filesystem::file_size(source, error));
+        mtime = static_cast<int64_t>(std::filesystem::last_write_time(source, error).time_since_epoch().count());
+    }
+}
+
+std::string FrameIndex::sidecarPath(const std::string& source) {
+    return source + ".zfidx";
+}
+
+bool FrameIndex::build(const std::string& source, const std::string& path) {
+    cv::VideoCapture cap;
+    bool raw_packets = false;
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7)
+    // Raw packets are not decoded, the scan only reads the container
+    raw_packets = cap.open(source, cv::CAP_FFMPEG, {cv::CAP_PROP_FORMAT, -1});
+#endif
+    if (!raw_packets && !cap.open(source)) {
+        std::cerr << "Error: Could not open video source: " << source << std::endl;
+        return false;
+    }
+
+    FrameIndexHeader header{};
+    std::memcpy(header.magic, FRAME_INDEX_MAGIC, sizeof(header.magic));
+    header.version = FRAME_INDEX_VERSION;
+    header.header_size = sizeof(FrameIndexHeader);
+    header.exact_keyframes = raw_packets ? 1 : 0;
+    header.fps = cap.get(cv::CAP_PROP_FPS);
+    sourceStamp(source, header.source_size, header.source_mtime);
+
+    std::vector<FrameIndexEntry> entries;
+    while (cap.grab()) {
+        FrameIndexEntry entry{};
+        // The presentation time of the packet or frame, raw packets come in decode order and are sorted by it below
+        entry.timestamp_ms = cap.get(cv::CAP_PROP_POS_MSEC);
+        entry.keyframe = entries.empty() ? 1 : 0;
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7)
+        if (raw_packets && cap.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0.0) {
+            entry.keyframe = 1;
+        }
+#endif
+        entries.push_back(entry);
+    }
+    cap.release();
+
+    if (entries.empty()) {
+        std::cerr << "Error: No frames in " << source << std::endl;
+        return false;
+    }
+    header.frame_count = static_cast<int32_t>(entries.size());
+
+    // With B-frames a packet is decoded before the frames shown ahead of it, frame numbers count presentation order
+    if (raw_packets) {
+        std::stable_sort(entries.begin(), entries.end(), [](const FrameIndexEntry& a, const FrameIndexEntry& b) {
+            return a.timestamp_ms < b.timestamp_ms;
+        });
+        entries[0].keyframe = 1;
+    }
+
+    // Written next to the target and moved in place, a reader never sees a partial index
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open file " << temp_path << " for writing." << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()),
+                   static_cast<std::streamsize>(entries.size() * sizeof(FrameIndexEntry)));
+        if (!file.good()) {
+            std::cerr << "Error: Failed to write frame index " << temp_path << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    if (error) {
+        std::cerr << "Error: Could not move frame index to " << path << ": " << error.message() << std::endl;
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
+
+bool FrameIndex::load(const std::string& path, const std::string& source) {
+    entries.clear();
+    keyframes.clear();
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    bool valid = file.good() &&
+                 std::memcmp(header.magic, FRAME_INDEX_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == FRAME_INDEX_VERSION &&
+                 header.header_size == sizeof(FrameIndexHeader) &&
+                 header.frame_count > 0;
+    if (!valid) {
+        std::cerr << "Warning: ignoring invalid frame index " << path << std::endl;
+        return false;
+    }
+
+    uint64_t source_size;
+    int64_t source_mtime;
+    sourceStamp(source, source_size, source_mtime);
+    if (source_size != header.source_size || source_mtime != header.source_mtime) {
+        std::cerr << "Warning: ignoring frame index " << path << ", the video changed since it was built" << std::endl;
+        return false;
+    }
+
+    entries.resize(header.frame_count);
+    file.read(reinterpret_cast<char*>(entries.data()),
+              static_cast<std::streamsize>(entries.size() * sizeof(FrameIndexEntry)));
+    if (!file.good()) {
+        std::cerr << "Warning: ignoring truncated frame index " << path << std::endl;
+        entries.clear();
+        return false;
+    }
+
+    for (int i = 0; i < header.frame_count; ++i) {
+        if (entries[i].keyframe) {
+            keyframes.push_back(i);
+        }
+    }
+    return true;
+}
+
+int FrameIndex::frameCount() const {
+    return static_cast<int>(entries.size());
+}
+
+double FrameIndex::fps() const {
+    return header.fps;
+}
+
+bool FrameIndex::exactKeyframes() const {
+    return header.exact_keyframes != 0;
+}
+
+bool FrameIndex::isKeyframe(int frame) const {
+    return frame >= 0 && frame < frameCount() && entries[frame].keyframe != 0;
+}
+
+double FrameIndex::timestampMs(int frame) const {
+    return entries[std::clamp(frame, 0, frameCount() - 1)].timestamp_ms;
+}
+
+int FrameIndex::keyframeBefore(int frame) const {
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), frame);
+    return next == keyframes.begin() ? 0 : *(next - 1);
+}
+
+bool FrameIndex::seekIndexed(cv::VideoCapture& cap, int frame) const {
+    // The keyframe is grabbed to check where the capture landed, so it has to come before the target frame
+    int keyframe = keyframeBefore(frame - 1);
+    cap.set(cv::CAP_PROP_POS_FRAMES, keyframe);
+    if (!cap.grab()) {
+        return false;
+    }
+
+    if (header.fps > 0.0 && std::abs(cap.get(cv::CAP_PROP_POS_MSEC) - timestampMs(keyframe)) > 500.0 / header.fps) {
+        return false;
+    }
+
+    for (int i = keyframe + 1; i < frame; ++i) {
+        if (!cap.grab()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FrameIndex::seek(cv::VideoCapture& cap, const std::string& source, int frame) {
+    if (frame <= 0) {
+        return;
+    }
+
+    // Without a keyframe table only frame 0 is marked, the indexed seek would decode from the start every time
+    FrameIndex index;
+    if (!index.load(sidecarPath(source), source) || !index.exactKeyframes() || frame >= index.frameCount()) {
+        cap.set(cv::CAP_PROP_POS_FRAMES, frame);
+        return;
+    }
+
+    if (index.seekIndexed(cap, frame)) {
+        return;
+    }
+
+    // The backend landed somewhere else, decoding from the start is slow but always exact
+    std::cerr << "Warning: indexed seek to frame " << frame << " of " << source << " missed, decoding from the start"
+              << std::endl;
+    cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+    int grabbed = 0;
+    while (grabbed < frame && cap.grab()) {
+        grabbed++;
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef FRAME_INDEX_H
+#define FRAME_INDEX_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#pragma pack(push, 1)
+struct FrameIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int32_t frame_count;
+    uint32_t exact_keyframes;   // 0 when the backend could not report keyframes, only frame 0 is marked then
+    double fps;
+    uint64_t source_size;
+    int64_t source_mtime;
+};
+
+// Entries are in presentation order, frame i of the index is the i-th frame a decoder returns
+struct FrameIndexEntry {
+    double timestamp_ms;
+    uint8_t keyframe;
+};
+#pragma pack(pop)
+
+// Keyframe positions and timestamps of every frame of a video, stored in a sidecar file next to it. Seeking with
+// it jumps to the keyframe before the target and decodes forward, so it is exact and its cost is bounded by the
+// keyframe interval instead of the position in the clip.
+class FrameIndex {
+public:
+    // Scans source once and writes its index to path. Keyframes are read from the packets without decoding
+    // where OpenCV supports it, otherwise every frame is decoded.
+    static bool build(const std::string& source, const std::string& path);
+    static std::string sidecarPath(const std::string& source);
+
+    // False when the file is missing, invalid or was built from another version of source
+    bool load(const std::string& path, const std::string& source);
+
+    int frameCount() const;
+    double fps() const;
+    // True when the keyframes were read from the packets, otherwise only frame 0 is marked
+    bool exactKeyframes() const;
+    bool isKeyframe(int frame) const;
+    double timestampMs(int frame) const;
+    // Last keyframe at or before frame
+    int keyframeBefore(int frame) const;
+
+    // Positions cap so its next read returns frame. Uses the sidecar of source when there is a valid one with
+    // exact keyframes, otherwise it falls back to CAP_PROP_POS_FRAMES.
+    static void seek(cv::VideoCapture& cap, const std::string& source, int frame);
+
+private:
+    FrameIndexHeader header{};
+    std::vector<FrameIndexEntry> entries;
+    std::vector<int> keyframes;
+
+    // Positions cap with the loaded index, false when the landing frame does not have the indexed timestamp
+    bool seekIndexed(cv::VideoCapture& cap, int frame) const;
+};
+
+#endif //FRAME_INDEX_H
@@ -0,0 +1,178 @@
+#include <iostream>
+
+#include "frame_push.h"
+
+FramePushDetector::FramePushDetector(const AppConfig& config) : detector(config) {}
+
+FramePushDetector::~FramePushDetector() {
+    stop();
+}
+
+void FramePushDetector::releaseFrame(PushedFrame& frame) {
+    if (frame.release) {
+        frame.release();
+        frame.release = nullptr;
+    }
+}
+
+static cv::Mat wrap(const PushedFrame& frame, int rows, int type, const uint8_t* data, size_t stride) {
+    // The header points into the caller buffer, nothing is copied
+    return cv::Mat(rows, frame.width, type, const_cast<uint8_t*>(data), stride > 0 ? stride : cv::Mat::AUTO_STEP);
+}
+
+bool FramePushDetector::roiImage(const PushedFrame& frame, const cv::Rect& roi, bool color, cv::Mat& converted,
+                                 cv::Mat& image) {
+    if (!frame.data || frame.width <= 0 || frame.height <= 0) {
+        return false;
+    }
+
+    switch (frame.format) {
+        case PixelFormat::BGR:
+            image = wrap(frame, frame.height, CV_8UC3, frame.data, frame.stride)(roi);
+            return true;
+        case PixelFormat::GRAY:
+            image = wrap(frame, frame.height, CV_8UC1, frame.data, frame.stride)(roi);
+            if (color) {
+                cv::cvtColor(image, converted, cv::COLOR_GRAY2BGR);
+                image = converted;
+            }
+            return true;
+        case PixelFormat::BGRA:
+            cv::cvtColor(wrap(frame, frame.height, CV_8UC4, frame.data, frame.stride)(roi), converted,
+                         color ? cv::COLOR_BGRA2BGR : cv::COLOR_BGRA2GRAY);
+            image = converted;
+            return true;
+        case PixelFormat::RGB:
+            cv::cvtColor(wrap(frame, frame.height, CV_8UC3, frame.data, frame.stride)(roi), converted,
+                         color ? cv::COLOR_RGB2BGR : cv::COLOR_RGB2GRAY);
+            image = converted;
+            return true;
+        case PixelFormat::NV12: {
+            if (frame.width % 2 != 0 || frame.height % 2 != 0) {
+                return false;
+            }
+            cv::Mat luma = wrap(frame, frame.height, CV_8UC1, frame.data, frame.stride);
+            if (!color) {
+                image = luma(roi);
+                return true;
+            }
+            // The chroma rows cover two luma rows each, so the whole frame is converted and cropped after
+            size_t luma_stride = frame.stride > 0 ? frame.stride : static_cast<size_t>(frame.width);
+            const uint8_t* chroma = frame.chroma ? frame.chroma : frame.data + luma_stride * frame.height;
+            cv::Mat uv(frame.height / 2, frame.width / 2, CV_8UC2, const_cast<uint8_t*>(chroma),
+                       frame.chroma_stride > 0 ? frame.chroma_stride : luma_stride);
+            cv::cvtColorTwoPlane(luma, uv, converted, cv::COLOR_YUV2BGR_NV12);
+            image = converted(roi);
+            return true;
+        }
+        case PixelFormat::YUYV: {
+            if (frame.width % 2 != 0) {
+                return false;
+            }
+            // Two pixels share their chroma, an ROI on pixel pairs is converted alone
+            cv::Mat packed = wrap(frame, frame.height, CV_8UC2, frame.data, frame.stride);
+            int code = color ? cv::COLOR_YUV2BGR_YUYV : cv::COLOR_YUV2GRAY_YUYV;
+            if (roi.x % 2 == 0 && roi.width % 2 == 0) {
+                cv::cvtColor(packed(roi), converted, code);
+                image = converted;
+            } else {
+                cv::cvtColor(packed, converted, code);
+                image = converted(roi);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FramePushDetector::decide(PushedFrame& frame, PushDecision& decision) {
+    cv::Size size(frame.width, frame.height);
+
+    // The margins are resolved against the first frame, like against the capture size in run
+    if (!started) {
+        started = true;
+        frame_size = size;
+        roi = detector.beginFrames(size);
+        color = detector.needsColorFrames();
+        if (!roi.empty() && (roi & cv::Rect(cv::Point(), size)) != roi) {
+            std::cerr << "Error: The margins do not fit pushed frames of " << size.width << "x" << size.height
+                      << std::endl;
+            roi = cv::Rect();
+        }
+    }
+
+    cv::Mat image;
+    if (roi.empty() || size != frame_size || !roiImage(frame, roi, color, converted, image)) {
+        rejected++;
+        releaseFrame(frame);
+        return false;
+    }
+
+    timer.start();
+    bool decided = !detector.decideNext(image).empty();
+    decision.elapsed_ms = timer.stop();
+
+    // The detector keeps its own gray copy, the caller buffer is free again
+    releaseFrame(frame);
+
+    // decision keeps its zones buffer across frames, so handing the decisions over allocates nothing
+    decision.frame_index = frame_index++;
+    decision.timestamp_ns = frame.timestamp_ns;
+    detector.takeDecisions(decision.zones);
+    return decided;
+}
+
+bool FramePushDetector::push(PushedFrame& frame, PushDecision& decision) {
+    return decide(frame, decision);
+}
+
+bool FramePushDetector::start(const DecisionCallback& callback) {
+    if (worker.joinable()) {
+        return false;
+    }
+
+    // A closed mailbox cannot be reopened, its drops are kept in rejected
+    if (mailbox) {
+        rejected += mailbox->droppedCount();
+    }
+    mailbox = std::make_unique<LatestMailbox<PushedFrame>>();
+    on_decision = callback;
+    worker = std::thread(&FramePushDetector::workerLoop, this);
+    return true;
+}
+
+void FramePushDetector::pushAsync(PushedFrame& frame) {
+    if (!worker.joinable()) {
+        rejected++;
+        releaseFrame(frame);
+        return;
+    }
+
+    // frame gets the previous slot content back: a frame the worker never took, or one it already released
+    mailbox->publish(frame);
+    releaseFrame(frame);
+}
+
+void FramePushDetector::stop() {
+    if (!worker.joinable()) {
+        return;
+    }
+    mailbox->close();
+    worker.join();
+}
+
+size_t FramePushDetector::droppedFrames() const {
+    return rejected + (mailbox ? mailbox->droppedCount() : 0);
+}
+
+void FramePushDetector::workerLoop() {
+    PushedFrame frame;
+    PushDecision decision;
+
+    // take hands the released frame back to the slot, so a frame in the slot with a release is always undecided
+    while (mailbox->take(frame)) {
+        if (decide(frame, decision) && on_decision) {
+            on_decision(decision);
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef FRAME_PUSH_H
+#define FRAME_PUSH_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../benchmark/benchmark.h"
+#include "../motion-detector/motion_detector.h"
+#include "../utils/latest_mailbox.h"
+
+enum class PixelFormat {
+    BGR,    // 3 bytes per pixel
+    BGRA,   // 4 bytes per pixel
+    RGB,    // 3 bytes per pixel
+    GRAY,   // 1 byte per pixel
+    NV12,   // luma plane followed by an interleaved UV plane at half resolution
+    YUYV    // 2 bytes per pixel, packed 4:2:2
+};
+
+// Frame in a buffer owned by the caller, e.g. a DMA buffer of a camera SDK. The detector reads it in place and
+// calls release once it no longer reads it.
+struct PushedFrame {
+    const uint8_t* data = nullptr;     // first row, the luma plane for NV12
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;                 // bytes per row, 0 for rows without padding
+    PixelFormat format = PixelFormat::BGR;
+    const uint8_t* chroma = nullptr;   // UV plane of NV12, nullptr when it directly follows the luma plane
+    size_t chroma_stride = 0;          // 0 for the luma stride
+    int64_t timestamp_ns = 0;          // clock of the caller, only handed back with the decision
+    std::function<void()> release;     // called exactly once, for dropped and rejected frames as well
+};
+
+struct PushDecision {
+    // Counts the frames that reached the detector from 0, the seeding frame has index 0. Rejected frames and frames
+    // replaced before the worker took them are not counted, droppedFrames has those.
+    int frame_index = 0;
+    int64_t timestamp_ns = 0;             // of the decided frame
+    double elapsed_ms = 0.0;              // time spent deciding the frame
+    std::vector<FrameDecision> zones;     // one per zone, move_mode is the angle in degrees, NaN without motion
+};
+
+// MotionDetector for applications that own the capture. Frames are pushed as pointers into caller memory and
+// decided either on the calling thread or on a worker thread that always takes the newest frame. BGR frames are
+// read without any copy, and so are gray frames and the luma plane of NV12 for frame differencing, the only
+// estimator that does not need color. The other formats, and gray for the estimators that run MOG2 or YOLO, are
+// converted once per frame, only over the ROI where the layout allows it, into a reused buffer.
+// All pushed frames must have the size of the first one.
+class FramePushDetector {
+public:
+    using DecisionCallback = std::function<void(const PushDecision&)>;
+
+    explicit FramePushDetector(const AppConfig& config);
+    // Stops the worker, the frame waiting for it is still decided
+    ~FramePushDetector();
+
+    FramePushDetector(const FramePushDetector&) = delete;
+    FramePushDetector& operator=(const FramePushDetector&) = delete;
+
+    // Decides frame on the calling thread and releases it before returning. False when the frame was rejected or
+    // only seeded the detector, decision is filled otherwise. Must not be used while the worker runs.
+    bool push(PushedFrame& frame, PushDecision& decision);
+
+    // Starts the worker, on_decision is called on it for every decided frame
+    bool start(const DecisionCallback& on_decision);
+    // Returns right away. A frame that is replaced before the worker takes it is released undecided.
+    void pushAsync(PushedFrame& frame);
+    // Waits for the frame the worker is deciding and the one waiting for it
+    void stop();
+
+    // Frames rejected for their size or format, and frames replaced before the worker took them
+    size_t droppedFrames() const;
+
+    // ROI of frame as an image the estimator can read: a view into the caller buffer where the format allows it,
+    // otherwise converted into converted. BGR stays BGR, the other formats give a gray image unless color is set.
+    // False for a frame the layout of its format does not allow.
+    static bool roiImage(const PushedFrame& frame, const cv::Rect& roi, bool color, cv::Mat& converted,
+                         cv::Mat& image);
+
+private:
+    MotionDetector detector;
+    cv::Rect roi;
+    cv::Size frame_size;
+    bool color = false;     // the estimator needs BGR, see MotionEstimator::needsColor
+    bool started = false;   // beginFrames was called
+    int frame_index = 0;
+    cv::Mat converted;
+    Benchmark timer;
+
+    std::unique_ptr<LatestMailbox<PushedFrame>> mailbox;
+    DecisionCallback on_decision;
+    std::thread worker;
+    std::atomic<size_t> rejected{0};
+
+    bool decide(PushedFrame& frame, PushDecision& decision);
+    void workerLoop();
+    static void releaseFrame(PushedFrame& frame);
+};
+
+#endif //FRAME_PUSH_H
@@ -3,13 +3,26 @@
 #include <yaml-cpp/yaml.h>
 
 #include "motion-detector/motion_detector.h"
+#include "segment-runner/segment_runner.h"
 
 const std::string INPUT_FILE = "../../config/params_input_file.yml";
 
-int main() {
+// Usage: ZebraFlash [config.yml] [test_id]
+int main(int argc, char** argv) {
+    std::string config_file = argc > 1 ? argv[1] : INPUT_FILE;
+    std::string test_id = argc > 2 ? argv[2] : "";
+
     try {
-        MotionDetector detector(INPUT_FILE);
-        detector.run();
+        MotionDetector detector(config_file, test_id);
+        // Long recordings can be split over the cores, live sources always run as one stream
+        if (detector.getConfig().segments > 1 && !detector.getConfig().live_source) {
+            SegmentRunner runner(detector.getConfig(), test_id);
+            if (!runner.run()) {
+                return 1;
+            }
+        } else {
+            detector.run();
+        }
     } catch (const std::exception& e) {
         std::cout << e.what() << std::endl;
         return 1;
@@ -0,0 +1,52 @@
+#include "detector_metrics.h"
+
+static const char* const STAGE_NAMES[] = {"read", "decide", "publish", "output"};
+static const char* const STATE_NAMES[] = {"up", "other", "difference", "waiting"};
+
+DetectorMetrics::DetectorMetrics(const std::vector<std::string>& zone_names) {
+    for (const auto& name : zone_names) {
+        zones.emplace_back().name = name;
+    }
+}
+
+void DetectorMetrics::write(std::ostream& out) const {
+    MetricsExporter::writeHeader(out, "zebraflash_frames_processed_total", "counter", "Frames decided.");
+    out << "zebraflash_frames_processed_total " << frames_processed.get() << "\n";
+
+    MetricsExporter::writeHeader(out, "zebraflash_decisions_total", "counter", "Decisions per zone and state.");
+    for (const auto& zone : zones) {
+        for (size_t state = 0; state < zone.decisions.size(); ++state) {
+            out << "zebraflash_decisions_total{zone=\"" << zone.name << "\",state=\"" << STATE_NAMES[state] << "\"} "
+                << zone.decisions[state].get() << "\n";
+        }
+    }
+
+    MetricsExporter::writeHeader(out, "zebraflash_zone_location", "gauge",
+                                 "Last decision per zone: 0 up, 1 other, 2 difference, 3 waiting.");
+    for (const auto& zone : zones) {
+        out << "zebraflash_zone_location{zone=\"" << zone.name << "\"} " << zone.location.get() << "\n";
+    }
+    MetricsExporter::writeHeader(out, "zebraflash_zone_locked", "gauge", "1 while the moving up lock holds.");
+    for (const auto& zone : zones) {
+        out << "zebraflash_zone_locked{zone=\"" << zone.name << "\"} " << zone.locked.get() << "\n";
+    }
+    MetricsExporter::writeHeader(out, "zebraflash_zone_lock_counter", "gauge", "Frames the moving up lock has held.");
+    for (const auto& zone : zones) {
+        out << "zebraflash_zone_lock_counter{zone=\"" << zone.name << "\"} " << zone.lock_counter.get() << "\n";
+    }
+
+    MetricsExporter::writeHeader(out, "zebraflash_decision_messages_total", "counter",
+                                 "Decision output messages by result.");
+    out << "zebraflash_decision_messages_total{result=\"published\"} " << messages_published.get() << "\n";
+    out << "zebraflash_decision_messages_total{result=\"dropped\"} " << messages_dropped.get() << "\n";
+
+    MetricsExporter::writeHeader(out, "zebraflash_stage_latency_seconds", "histogram",
+                                 "Time spent per frame loop stage.");
+    for (size_t i = 0; i < stages.size(); ++i) {
+        stages[i].write(out, "zebraflash_stage_latency_seconds", std::string("stage=\"") + STAGE_NAMES[i] + "\"");
+    }
+
+    MetricsExporter::writeHeader(out, "zebraflash_capture_latency_seconds", "histogram",
+                                 "Time from frame capture to its decision.");
+    capture_latency.write(out, "zebraflash_capture_latency_seconds");
+}
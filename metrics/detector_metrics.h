@@ -0,0 +1,45 @@
+#ifndef DETECTOR_METRICS_H
+#define DETECTOR_METRICS_H
+
+#include <array>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "metrics.h"
+
+// Parts of the frame loop that get their own latency histogram
+enum class FrameStage {
+    Read,      // waiting for and decoding the next frame
+    Decide,    // estimator and decision layer
+    Publish,   // decision output
+    Output     // live view and recorder hand-over
+};
+
+// Metrics of one detector. Only the frame thread writes them, the exporter reads them when it is scraped.
+class DetectorMetrics {
+public:
+    struct Zone {
+        std::string name;
+        std::array<MetricCounter, 4> decisions;   // per directions_map column
+        MetricGauge location;
+        MetricGauge locked;
+        MetricGauge lock_counter;
+    };
+
+    explicit DetectorMetrics(const std::vector<std::string>& zone_names);
+
+    MetricCounter frames_processed;
+    MetricCounter messages_published;
+    MetricCounter messages_dropped;
+    LatencyHistogram capture_latency;
+    std::array<LatencyHistogram, 4> stages;
+    std::deque<Zone> zones;   // a deque, the atomics cannot be moved
+
+    LatencyHistogram& stage(FrameStage frame_stage) { return stages[static_cast<size_t>(frame_stage)]; }
+
+    void write(std::ostream& out) const;
+};
+
+#endif //DETECTOR_METRICS_H
@@ -0,0 +1,247 @@
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "metrics.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+void LatencyHistogram::observe(double seconds) {
+    size_t bucket = 0;
+    while (bucket < BOUNDS.size() && seconds > BOUNDS[bucket]) {
+        bucket++;
+    }
+    buckets[bucket].add();
+    sum.store(sum.load(std::memory_order_relaxed) + seconds, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::write(std::ostream& out, const std::string& name, const std::string& labels) const {
+    std::string prefix = labels.empty() ? "" : labels + ",";
+
+    // Buckets are stored per range and summed here, so observe only touches one of them
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < BOUNDS.size(); ++i) {
+        cumulative += buckets[i].get();
+        out << name << "_bucket{" << prefix << "le=\"" << BOUNDS[i] << "\"} " << cumulative << "\n";
+    }
+    cumulative += buckets[BOUNDS.size()].get();
+    out << name << "_bucket{" << prefix << "le=\"+Inf\"} " << cumulative << "\n";
+
+    std::string braces = labels.empty() ? "" : "{" + labels + "}";
+    out << name << "_sum" << braces << " " << sum.load(std::memory_order_relaxed) << "\n";
+    out << name << "_count" << braces << " " << cumulative << "\n";
+}
+
+MetricsExporter::MetricsExporter(int port, const std::string& file, int interval_ms)
+    : port(port), file(file), interval_ms(interval_ms > 0 ? interval_ms : 1000) {}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+void MetricsExporter::addCollector(const Collector& collector) {
+    collectors.push_back(collector);
+}
+
+void MetricsExporter::writeHeader(std::ostream& out, const std::string& name, const std::string& type,
+                                  const std::string& help) {
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+}
+
+void MetricsExporter::addCounter(const std::string& name, const std::string& help,
+                                 const std::function<double()>& value) {
+    collectors.push_back([name, help, value](std::ostream& out) {
+        writeHeader(out, name, "counter", help);
+        out << name << " " << value() << "\n";
+    });
+}
+
+void MetricsExporter::addGauge(const std::string& name, const std::string& help,
+                               const std::function<double()>& value) {
+    collectors.push_back([name, help, value](std::ostream& out) {
+        writeHeader(out, name, "gauge", help);
+        out << name << " " << value() << "\n";
+    });
+}
+
+double MetricsExporter::residentBytes() {
+#ifdef __linux__
+    // Second field of statm, in pages
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    if (statm >> pages >> resident) {
+        return static_cast<double>(resident) * static_cast<double>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0.0;
+}
+
+std::string MetricsExporter::render() const {
+    // Enough digits that large counters and byte sizes are not rounded
+    std::ostringstream out;
+    out.precision(15);
+    for (const auto& collector : collectors) {
+        collector(out);
+    }
+
+    writeHeader(out, "process_resident_memory_bytes", "gauge", "Resident memory size in bytes.");
+    out << "process_resident_memory_bytes " << residentBytes() << "\n";
+    return out.str();
+}
+
+bool MetricsExporter::start() {
+    if (port > 0 && !openEndpoint()) {
+        return false;
+    }
+    if (port <= 0 && file.empty()) {
+        return false;
+    }
+
+    stopping = false;
+    thread = std::thread(&MetricsExporter::serveLoop, this);
+    return true;
+}
+
+void MetricsExporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    // The last state stays readable after the run
+    if (!file.empty()) {
+        writeFile();
+    }
+#ifndef _WIN32
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        listen_fd = -1;
+    }
+#endif
+}
+
+bool MetricsExporter::writeFile() const {
+    // Written next to the target and moved in place, a scraper never reads a partial file
+    std::string temp_path = file + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Error: Could not open file " << temp_path << " for writing." << std::endl;
+            return false;
+        }
+        out << render();
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, file, error);
+    return !error;
+}
+
+#ifndef _WIN32
+
+bool MetricsExporter::openEndpoint() {
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "Error: Could not create the metrics socket" << std::endl;
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Only local scrapers, the endpoint has no authentication
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd, 4) != 0) {
+        std::cerr << "Error: Could not listen for metrics on 127.0.0.1:" << port << std::endl;
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void MetricsExporter::serveClient(int client_fd) const {
+    // The request is only read so the client does not see a reset, any path gets the metrics
+    pollfd client{client_fd, POLLIN, 0};
+    char request[1024];
+    if (poll(&client, 1, 500) > 0) {
+        (void)recv(client_fd, request, sizeof(request), 0);
+    }
+
+    std::string body = render();
+    std::string response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(client_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            break;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    close(client_fd);
+}
+
+#else
+
+bool MetricsExporter::openEndpoint() {
+    std::cerr << "Error: the metrics endpoint is not available on Windows, use metrics_file" << std::endl;
+    return false;
+}
+
+void MetricsExporter::serveClient(int) const {}
+
+#endif
+
+void MetricsExporter::serveLoop() {
+    auto next_write = std::chrono::steady_clock::now();
+
+    while (true) {
+        if (!file.empty() && std::chrono::steady_clock::now() >= next_write) {
+            writeFile();
+            next_write += std::chrono::milliseconds(interval_ms);
+        }
+
+#ifndef _WIN32
+        if (listen_fd >= 0) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping) {
+                    return;
+                }
+            }
+            // Short timeout so stop is noticed without a wake up of the socket
+            pollfd listener{listen_fd, POLLIN, 0};
+            if (poll(&listener, 1, 100) > 0) {
+                int client_fd = accept(listen_fd, nullptr, nullptr);
+                if (client_fd >= 0) {
+                    serveClient(client_fd);
+                }
+            }
+            continue;
+        }
+#endif
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (wake.wait_until(lock, next_write, [this] { return stopping; })) {
+            return;
+        }
+    }
+}
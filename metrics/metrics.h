@@ -0,0 +1,101 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Counter with a single writing thread, read by the exporter. The writer only does a relaxed load and store, so
+// counting costs no locked instruction on the hot path.
+class MetricCounter {
+public:
+    void add(uint64_t n = 1) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    void set(uint64_t n) { value.store(n, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value{0};
+};
+
+class MetricGauge {
+public:
+    void set(double n) { value.store(n, std::memory_order_relaxed); }
+    double get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value{0.0};
+};
+
+// Latency histogram in seconds with fixed buckets from 0.5 ms to 2 s, single writer like MetricCounter
+class LatencyHistogram {
+public:
+    static constexpr std::array<double, 12> BOUNDS = {0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5,
+                                                      1.0, 2.0};
+
+    void observe(double seconds);
+    // Cumulative buckets, sum and count of the histogram name, labels are added to every sample
+    void write(std::ostream& out, const std::string& name, const std::string& labels = "") const;
+
+private:
+    std::array<MetricCounter, BOUNDS.size() + 1> buckets;   // the last one is +Inf
+    std::atomic<double> sum{0.0};
+};
+
+// Serves metrics in the Prometheus text exposition format, either on http://127.0.0.1:port/metrics or by rewriting
+// a text file every interval. The metrics are only read when they are served, the collectors run on the exporter
+// thread and must only read atomics or take short locks.
+class MetricsExporter {
+public:
+    using Collector = std::function<void(std::ostream&)>;
+
+    // port 0 disables the endpoint and an empty file the text file, the interval only applies to the file
+    MetricsExporter(int port, const std::string& file, int interval_ms);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // Collectors are added before start, what they read must outlive the exporter
+    void addCollector(const Collector& collector);
+    // Single sample metrics read at scrape time
+    void addCounter(const std::string& name, const std::string& help, const std::function<double()>& value);
+    void addGauge(const std::string& name, const std::string& help, const std::function<double()>& value);
+
+    bool start();
+    void stop();
+
+    // Every collector plus the process metrics, as served
+    std::string render() const;
+
+    // Writes the HELP and TYPE lines of a metric
+    static void writeHeader(std::ostream& out, const std::string& name, const std::string& type,
+                            const std::string& help);
+    // Resident set size of this process in bytes, 0 where it cannot be read
+    static double residentBytes();
+
+private:
+    int port;
+    std::string file;
+    int interval_ms;
+    std::vector<Collector> collectors;
+
+    int listen_fd = -1;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread thread;
+
+    bool openEndpoint();
+    void serveLoop();
+    void serveClient(int client_fd) const;
+    bool writeFile() const;
+};
+
+#endif //METRICS_H
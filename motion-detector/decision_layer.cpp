@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <climits>
+#include <limits>
+
+#include "decision_layer.h"
+
+#include "motion_detector.h"
+#include "../utils/motion_utils.h"
+
+// The directions map used to be an int map that was assigned 3.5f for upward movement, so an up vote always weighed 3
+static const std::array<int, 4> VOTE_WEIGHTS[] = {
+    {3, 0, 0, 0},
+    {0, 1, 0, 0},
+    {0, 0, 1, 0},
+    {0, 0, 0, 1}
+};
+
+DecisionLayer::DecisionLayer(const AppConfig& config)
+    : angle_up_min(config.angle_up_min),
+      angle_up_max(config.angle_up_max),
+      angle_down_min(config.angle_down_min),
+      angle_down_max(config.angle_down_max),
+      moving_up_lock_frames(config.moving_up_lock_frames),
+      directions_map(std::max(1, config.size), std::array<int, 4>{}) {
+}
+
+DirectionVote DecisionLayer::classifyFlow(float move_mode) const {
+    bool is_moving_up =
+        MotionUtils::isAngleInRange(move_mode, angle_up_min, angle_up_max) ||
+        MotionUtils::isAngleInRange(move_mode, angle_down_min, angle_down_max);
+
+    if (is_moving_up) {
+        return DirectionVote::Up;
+    }
+    if (move_mode < angle_up_min || angle_up_max < move_mode ||
+        move_mode < angle_down_min || angle_down_max < move_mode) {
+        return DirectionVote::Other;
+    }
+    // No movement, the mode is NaN
+    return DirectionVote::Waiting;
+}
+
+DirectionVote DecisionLayer::classifyDetections(float move_mode, bool has_detections) const {
+    if (!has_detections) {
+        return DirectionVote::Waiting;
+    }
+
+    bool is_moving_up =
+        MotionUtils::isAngleInRange(move_mode, angle_up_min, angle_up_max) ||
+        MotionUtils::isAngleInRange(move_mode, angle_down_min, angle_down_max);
+
+    if (is_moving_up) {
+        return DirectionVote::Up;
+    }
+    if (move_mode > 5.0f) {
+        return DirectionVote::Other;
+    }
+    return DirectionVote::Difference;
+}
+
+void DecisionLayer::vote(DirectionVote direction) {
+    const std::array<int, 4>& weights = VOTE_WEIGHTS[static_cast<int>(direction)];
+    std::array<int, 4>& row = directions_map[oldest];
+
+    for (size_t j = 0; j < row.size(); ++j) {
+        column_sums[j] += weights[j] - row[j];
+    }
+    row = weights;
+
+    oldest = (oldest + 1) % directions_map.size();
+    votes++;
+}
+
+int DecisionLayer::decide() {
+    // Same as the maximum column mean, every column is divided by the same map size
+    int loc = static_cast<int>(std::distance(column_sums.begin(), std::max_element(column_sums.begin(), column_sums.end())));
+    return applyMovingUpLock(loc);
+}
+
+int DecisionLayer::voteCount() const {
+    return votes;
+}
+
+bool DecisionLayer::isLocked() const {
+    return is_moving_up_locked;
+}
+
+int DecisionLayer::lockCounter() const {
+    return moving_up_lock_counter;
+}
+
+bool DecisionLayer::isCrossing(int location) {
+    return location == 0 || location == 2;
+}
+
+int DecisionLayer::applyMovingUpLock(int current_loc) {
+
+    if (moving_up_lock_frames == 0) {
+        return current_loc;
+    }
+
+    if (is_moving_up_locked) {
+        moving_up_lock_counter++;
+
+        if (moving_up_lock_counter >= moving_up_lock_frames) {
+            is_moving_up_locked = false;
+            moving_up_lock_counter = 0;
+            return current_loc;
+        } else {
+            return 0;
+        }
+    }
+
+    if (current_loc == 0) {
+        is_moving_up_locked = true;
+        moving_up_lock_counter = 0;
+    }
+
+    return current_loc;
+}
+
+std::vector<cv::Rect> DecisionLayer::selectDetections(const std::vector<RawDetection>& candidates,
+                                                      float confidence_threshold, float nms_threshold) {
+    std::vector<cv::Rect> boxes;
+    std::vector<float> confidences;
+
+    for (const auto& candidate : candidates) {
+        if (candidate.confidence >= confidence_threshold && candidate.class_score > confidence_threshold) {
+            boxes.push_back(candidate.box);
+            confidences.push_back(candidate.confidence);
+        }
+    }
+
+    std::vector<int> indices;
+    cv::dnn::NMSBoxes(boxes, confidences, confidence_threshold, nms_threshold, indices);
+
+    std::vector<cv::Rect> detections;
+    detections.reserve(indices.size());
+    for (int idx : indices) {
+        detections.push_back(boxes[idx]);
+    }
+    return detections;
+}
+
+float DecisionLayer::calculateMotionFromDetections(const std::vector<cv::Rect>& previous_detections,
+                                                   const std::vector<cv::Rect>& current_detections) {
+    if (previous_detections.empty() || current_detections.empty()) {
+        return INT_MIN;
+    }
+
+    std::vector<float> motion_angles;
+
+    for (const auto& current_box: current_detections) {
+        cv::Point2f current_center(current_box.x + current_box.width / 2.0f,
+            current_box.y + current_box.height / 2.0f);
+
+        float min_distance = std::numeric_limits<float>::max();
+        cv::Point2f best_match_center;
+        bool found_match = false;
+
+        for (const auto& prev_box: previous_detections) {
+            cv::Point2f prev_center(prev_box.x + prev_box.width / 2.0f,
+                prev_box.y + prev_box.height / 2.0f);
+
+            float distance = cv::norm(current_center - prev_center);
+            if (distance < min_distance && distance < 100.0f) { //thresold for matching
+                min_distance = distance;
+                best_match_center = prev_center;
+                found_match = true;
+            }
+        }
+
+        //TODO: better angle detection and calculation
+        if (found_match) {
+            cv::Point2f motion_vector = current_center - best_match_center;
+            float motion_angle = atan2(motion_vector.y, motion_vector.x) * 180.0f / CV_PI;
+            if (motion_angle < 0) {
+                motion_angle += 360.0f;
+            }
+            motion_angles.push_back(motion_angle);
+        }
+    }
+
+    return MotionUtils::calculateMode(motion_angles);
+}
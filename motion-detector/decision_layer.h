@@ -0,0 +1,67 @@
+#ifndef DECISION_LAYER_H
+#define DECISION_LAYER_H
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <vector>
+
+struct AppConfig;
+
+// Columns of the directions map, the decision is the column with the highest mean over the last `size` votes
+enum class DirectionVote {
+    Up = 0,
+    Other = 1,
+    Difference = 2,
+    Waiting = 3
+};
+
+// YOLO person candidate before thresholding and NMS
+struct RawDetection {
+    cv::Rect box;
+    float confidence;
+    float class_score;
+};
+
+// Everything after the estimators: angle classification, the directions map vote and the moving up lock.
+// It only depends on the tuning parameters, so live processing and trace replay share it.
+class DecisionLayer {
+public:
+    explicit DecisionLayer(const AppConfig& config);
+
+    DirectionVote classifyFlow(float move_mode) const;
+    DirectionVote classifyDetections(float move_mode, bool has_detections) const;
+
+    void vote(DirectionVote direction);
+    int decide();   // winning column after the moving up lock
+
+    int voteCount() const;
+    bool isLocked() const;
+    int lockCounter() const;
+
+    static bool isCrossing(int location);
+
+    static std::vector<cv::Rect> selectDetections(const std::vector<RawDetection>& candidates, float confidence_threshold,
+                                                  float nms_threshold);
+    static float calculateMotionFromDetections(const std::vector<cv::Rect>& previous_detections,
+                                               const std::vector<cv::Rect>& current_detections);
+
+private:
+    int angle_up_min;
+    int angle_up_max;
+    int angle_down_min;
+    int angle_down_max;
+    int moving_up_lock_frames;
+
+    // Ring of the last `size` votes with running column sums, the oldest vote is replaced by the next one
+    std::vector<std::array<int, 4>> directions_map;
+    std::array<int, 4> column_sums{};
+    size_t oldest = 0;
+    int votes = 0;
+
+    bool is_moving_up_locked = false;
+    int moving_up_lock_counter = 0;
+
+    int applyMovingUpLock(int current_loc);
+};
+
+#endif //DECISION_LAYER_H
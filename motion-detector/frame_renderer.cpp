@@ -0,0 +1,112 @@
+#include "frame_renderer.h"
+
+static std::string locationText(int loc) {
+    if (loc == 0) {
+        return "Moving up (LED ON!)";
+    }
+    else if (loc == 1) {
+        return "Other directions";
+    }
+    else if (loc == 2) {
+        return "Difference (LED ON!)";
+    }
+    return "WAITING";
+}
+
+FrameRenderer::FrameRenderer(const std::string& window_name)
+    : window_name(window_name), render_thread(&FrameRenderer::renderLoop, this) {
+}
+
+FrameRenderer::~FrameRenderer() {
+    mailbox.close();
+    render_thread.join();
+}
+
+void FrameRenderer::submit(RenderSnapshot& snapshot) {
+    mailbox.publish(snapshot);
+}
+
+bool FrameRenderer::quitRequested() const {
+    return quit_requested.load();
+}
+
+size_t FrameRenderer::droppedFrames() const {
+    return mailbox.droppedCount();
+}
+
+void FrameRenderer::renderLoop() {
+    // HighGUI is only used from this thread, windows belong to the thread that created them
+    cv::namedWindow(window_name, cv::WINDOW_NORMAL);
+
+    RenderSnapshot snapshot;
+    cv::Mat flow_bgr;
+    while (mailbox.take(snapshot)) {
+        drawOverlay(snapshot);
+        cv::imshow(window_name, snapshot.frame);
+
+        if (!snapshot.flow.empty()) {
+            cv::cvtColor(snapshot.flow, flow_bgr, cv::COLOR_HSV2BGR);
+            cv::imshow("Flow", flow_bgr);
+        }
+        for (const auto& view : snapshot.debug_views) {
+            cv::imshow(view.name, view.image);
+        }
+
+        if (cv::waitKey(1) == 'q') {
+            quit_requested = true;
+        }
+    }
+
+    cv::destroyAllWindows();
+}
+
+void FrameRenderer::drawOverlay(RenderSnapshot& snapshot) {
+    cv::Mat& frame = snapshot.frame;
+    double roi_scale = snapshot.roi_width / 500.0;
+
+    if (snapshot.zones.size() == 1) {
+        const RenderZone& zone = snapshot.zones[0];
+
+        int text_thinkness = 6;
+
+        cv::putText(frame, "Angle: " + std::to_string(static_cast<int>(zone.move_mode)),
+                cv::Point(30, 150), cv::FONT_HERSHEY_COMPLEX,
+                roi_scale, cv::Scalar(0, 0, 255), 6);
+
+        cv::putText(frame, locationText(zone.location), cv::Point(30, 90), cv::FONT_HERSHEY_COMPLEX,
+            frame.cols / 500.0, cv::Scalar(0, 0, 255), text_thinkness);
+
+        if (zone.locked) {
+            std::string lock_info = "LOCKED: " + std::to_string(zone.lock_counter) +
+                                    "/" + std::to_string(zone.lock_frames);
+            cv::putText(frame, lock_info, cv::Point(30, 240), cv::FONT_HERSHEY_COMPLEX,
+                roi_scale, cv::Scalar(255, 0, 255), 3);
+        }
+    } else {
+        // Every zone is outlined with its own state
+        for (const auto& zone : snapshot.zones) {
+            cv::Scalar color = zone.is_crossing ? cv::Scalar(0, 0, 255) : cv::Scalar(0, 255, 0);
+
+            std::string label = zone.name + ": " + locationText(zone.location);
+            if (zone.locked) {
+                label += " LOCKED";
+            }
+
+            cv::rectangle(frame, zone.rect, color, 3);
+            cv::putText(frame, label, zone.rect.tl() + cv::Point(10, 40), cv::FONT_HERSHEY_COMPLEX,
+                frame.cols / 1000.0, color, 3);
+        }
+    }
+
+    cv::putText(frame, "FPS: " + std::to_string(snapshot.fps), cv::Point(30, 200), cv::FONT_HERSHEY_COMPLEX,
+                roi_scale, cv::Scalar(0, 255, 0), 3);
+
+    if (snapshot.balanced_accuracy >= 0) {
+        cv::putText(frame, "Balanced accuracy: " + std::to_string(static_cast<int>(snapshot.balanced_accuracy * 100)) + "%",
+                    cv::Point(30, 290), cv::FONT_HERSHEY_COMPLEX, roi_scale, cv::Scalar(0, 255, 0), 3);
+    }
+
+    if (!snapshot.roi.empty()) {
+        cv::rectangle(frame, snapshot.roi.tl(), snapshot.roi.br(), cv::Scalar(0, 255, 0), 3);
+    }
+}
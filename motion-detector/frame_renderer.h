@@ -0,0 +1,67 @@
+#ifndef FRAME_RENDERER_H
+#define FRAME_RENDERER_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../motion-estimator/motion_estimator.h"
+#include "../utils/latest_mailbox.h"
+
+// Decision state of one zone as it is drawn
+struct RenderZone {
+    std::string name;
+    cv::Rect rect;         // in display frame coordinates
+    float move_mode;
+    int location;
+    bool is_crossing;
+    bool locked;
+    int lock_counter;
+    int lock_frames;
+};
+
+// Everything the live view needs from one processed frame. The detector fills it and hands it over, the buffers
+// come back through the mailbox so they are reused.
+struct RenderSnapshot {
+    cv::Mat frame;                        // display frame, the overlays are drawn on it
+    cv::Mat flow;                         // HSV flow drawing, only filled in debug mode
+    std::vector<DebugView> debug_views;   // estimator debug images, only filled in debug mode
+    cv::Rect roi;                         // outlined on full frames, empty when the frame is already the ROI
+    int roi_width;                        // text scales with the ROI width
+    std::vector<RenderZone> zones;        // one zone is written as text, several are outlined
+    double fps;
+    double balanced_accuracy;             // negative without ground truth
+};
+
+// Draws and shows snapshots on its own thread, so the detector never waits for putText, imshow or waitKey. Only the
+// newest snapshot is drawn, older ones are dropped when drawing falls behind.
+class FrameRenderer {
+public:
+    explicit FrameRenderer(const std::string& window_name);
+    ~FrameRenderer();
+
+    FrameRenderer(const FrameRenderer&) = delete;
+    FrameRenderer& operator=(const FrameRenderer&) = delete;
+
+    // Hands snapshot to the render thread, snapshot gets older buffers back to fill next
+    void submit(RenderSnapshot& snapshot);
+
+    // True once q was pressed in a window
+    bool quitRequested() const;
+    size_t droppedFrames() const;
+
+    // Draws the decisions, FPS, accuracy and ROI of snapshot onto snapshot.frame
+    static void drawOverlay(RenderSnapshot& snapshot);
+
+private:
+    std::string window_name;
+    LatestMailbox<RenderSnapshot> mailbox;
+    std::atomic<bool> quit_requested{false};
+    std::thread render_thread;
+
+    void renderLoop();
+};
+
+#endif //FRAME_RENDERER_H
@@ -0,0 +1,97 @@
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+
+#include "live_grabber.h"
+#include "../frame-index/frame_index.h"
+
+LiveFrameGrabber::~LiveFrameGrabber() {
+    close();
+}
+
+bool LiveFrameGrabber::open(const std::string& source, int seek, int seek_end) {
+    if (grab_thread.joinable()) {
+        close();
+    }
+    capture.release();
+    stopping = false;
+    grabbed = 0;
+    mailbox = std::make_unique<LatestMailbox<GrabbedFrame>>();
+
+    if (!capture.open(source)) {
+        return false;
+    }
+
+    frame_size = cv::Size(static_cast<int>(capture.get(cv::CAP_PROP_FRAME_WIDTH)),
+                          static_cast<int>(capture.get(cv::CAP_PROP_FRAME_HEIGHT)));
+
+    // Only files can seek, and only files would be read faster than they were filmed
+    if (std::filesystem::is_regular_file(source)) {
+        FrameIndex::seek(capture, source, seek);
+        pace_fps = capture.get(cv::CAP_PROP_FPS);
+        first_index = seek;
+        frames_left = seek_end > seek ? seek_end - seek : -1;
+    } else {
+        pace_fps = 0.0;
+        first_index = 0;
+        frames_left = -1;
+    }
+
+    grab_thread = std::thread(&LiveFrameGrabber::grabLoop, this);
+    return true;
+}
+
+void LiveFrameGrabber::close() {
+    stopping = true;
+    if (mailbox) {
+        mailbox->close();
+    }
+    if (grab_thread.joinable()) {
+        grab_thread.join();
+    }
+    capture.release();
+}
+
+cv::Size LiveFrameGrabber::frameSize() const {
+    return frame_size;
+}
+
+bool LiveFrameGrabber::next(GrabbedFrame& frame) {
+    return mailbox && mailbox->take(frame);
+}
+
+int LiveFrameGrabber::grabbedFrames() const {
+    return grabbed.load();
+}
+
+size_t LiveFrameGrabber::droppedFrames() const {
+    return mailbox ? mailbox->droppedCount() : 0;
+}
+
+void LiveFrameGrabber::grabLoop() {
+    GrabbedFrame frame;
+    auto frame_period = std::chrono::duration<double>(pace_fps > 0.0 ? 1.0 / pace_fps : 0.0);
+    auto next_grab = std::chrono::steady_clock::now();
+
+    while (!stopping && frames_left != 0) {
+        if (pace_fps > 0.0) {
+            std::this_thread::sleep_until(next_grab);
+            next_grab += std::chrono::duration_cast<std::chrono::steady_clock::duration>(frame_period);
+        }
+
+        if (!capture.read(frame.image) || frame.image.empty()) {
+            break;
+        }
+        frame.capture_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+
+        frame.frame_index = first_index + grabbed++;
+        if (frames_left > 0) {
+            frames_left--;
+        }
+        mailbox->publish(frame);
+    }
+
+    // The detector still gets the last frame, then next returns false
+    mailbox->close();
+}
@@ -0,0 +1,55 @@
+#ifndef LIVE_GRABBER_H
+#define LIVE_GRABBER_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "../utils/latest_mailbox.h"
+
+struct GrabbedFrame {
+    cv::Mat image;
+    int frame_index = 0;           // position in a file, count since open for a stream
+    int64_t capture_time_ns = 0;   // monotonic clock, the same as DecisionPublisher::now
+};
+
+// Reads a live source on its own thread and keeps only the newest frame, so a detector slower than the camera
+// always works on the present instead of a growing backlog. Files are read at their own frame rate to stand in for
+// a camera.
+class LiveFrameGrabber {
+public:
+    ~LiveFrameGrabber();
+
+    // Starts grabbing from position seek, seek_end stops a file there when it is positive
+    bool open(const std::string& source, int seek, int seek_end);
+    void close();
+
+    cv::Size frameSize() const;
+
+    // Waits for a frame that was not returned yet, false once the source ended. frame gets an older buffer back.
+    bool next(GrabbedFrame& frame);
+
+    int grabbedFrames() const;
+    // Frames replaced by a newer one before the detector took them
+    size_t droppedFrames() const;
+
+private:
+    cv::VideoCapture capture;
+    cv::Size frame_size;
+    double pace_fps = 0.0;   // 0 for real live sources
+    int frames_left = -1;    // -1 without seek_end
+    int first_index = 0;
+
+    // A closed mailbox cannot be reopened, every open starts a new one
+    std::unique_ptr<LatestMailbox<GrabbedFrame>> mailbox;
+    std::atomic<bool> stopping{false};
+    std::atomic<int> grabbed{0};
+    std::thread grab_thread;
+
+    void grabLoop();
+};
+
+#endif //LIVE_GRABBER_H
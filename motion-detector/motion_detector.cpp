@@ -1,35 +1,38 @@
 #include <iostream>
-#include <opencv2/core/ocl.hpp>
-
-#ifdef HAVE_CUDA
-#include <opencv2/cudaoptflow.hpp>
-#include <opencv2/cudaarithm.hpp>
-#endif
 
 #include "motion_detector.h"
 
-#include <fstream>
-#include <thread>
+#include <algorithm>
+#include <filesystem>
 
+#include "../auto-tuner/auto_tuner.h"
 #include "../benchmark/benchmark.h"
+#include "../utils/allocation_counter.h"
+#include "../utils/frame_difference.h"
+#include "../frame-index/frame_index.h"
+#include "../thread-pool/thread_pool.h"
 #include "../utils/motion_utils.h"
+#include "live_grabber.h"
 
-MotionDetector::MotionDetector(const std::string &configFile, const std::string& testIdentifier) {
-    loadConfig(configFile);
+MotionDetector::MotionDetector(const std::string &configFile, const std::string& testIdentifier)
+    : config_(parseConfig(YAML::LoadFile(configFile))) {
     this->testIdentifier = testIdentifier;
+}
 
-    directions_map.resize(config_.size, std::vector<int>(4, 0));
-    backSub = cv::createBackgroundSubtractorMOG2(500, 16, true);
+MotionDetector::MotionDetector(const AppConfig& config, const std::string& testIdentifier)
+    : config_(config) {
+    this->testIdentifier = testIdentifier;
 }
 
 AppConfig& MotionDetector::getConfig() {
     return config_;
 }
 
-void MotionDetector::loadConfig(const std::string &configFile) {
-    YAML::Node config = YAML::LoadFile(configFile);
+AppConfig MotionDetector::parseConfig(const YAML::Node& config) {
+    AppConfig config_;
 
     config_.video_src = config["video_src"].as<std::string>();
+    config_.live_source = config["live_source"].as<bool>(false);
     config_.video_annot = config["video_annot"].as<std::string>();
     config_.size = config["size"].as<int>();
     config_.seek = config["seek"].as<int>();
@@ -52,13 +55,30 @@ void MotionDetector::loadConfig(const std::string &configFile) {
     config_.iterations = config["iterations"].as<int>();
     config_.poly_n = config["poly_n"].as<int>();
     config_.poly_sigma = config["poly_sigma"].as<double>();
+    config_.dis_preset = config["dis_preset"].as<std::string>("FAST");
+    config_.dis_patch_size = config["dis_patch_size"].as<int>(-1);
+    config_.dis_patch_stride = config["dis_patch_stride"].as<int>(-1);
+    config_.difference_vote = config["difference_vote"].as<bool>(false);
     config_.max_corners = config["max_corners"].as<int>();
     config_.quality_level = config["quality_level"].as<double>();
     config_.min_distance = config["min_distance"].as<int>();
     config_.debug = config["debug"].as<bool>();
+    config_.display = config["display"].as<bool>(true);
+    config_.record_path = config["record_path"].as<std::string>("");
+    config_.record_fourcc = config["record_fourcc"].as<std::string>("mp4v");
+    config_.record_fps = config["record_fps"].as<double>(30.0);
+    config_.record_queue_size = config["record_queue_size"].as<int>(8);
+    config_.record_drop_policy = config["record_drop_policy"].as<std::string>("OLDEST");
+    config_.decision_output = config["decision_output"].as<std::string>("");
+    config_.decision_output_path = config["decision_output_path"].as<std::string>("/tmp/zebraflash_decisions");
+    config_.decision_output_edges_only = config["decision_output_edges_only"].as<bool>(false);
     config_.use_gpu = config["use_gpu"].as<bool>();
     config_.use_multi_thread = config["use_multi_thread"].as<bool>();
     config_.thread_amount = config["thread_amount"].as<int>();
+    config_.flow_strips = config["flow_strips"].as<std::string>("COLUMNS");
+    config_.auto_tune = config["auto_tune"].as<bool>(false);
+    config_.auto_tune_cache = config["auto_tune_cache"].as<std::string>("zebraflash_tuning.json");
+    config_.auto_tune_frames = config["auto_tune_frames"].as<int>(20);
     config_.algorithm = config["algorithm"].as<std::string>();
     config_.yolo_weights_path = config["yolo_weights_path"].as<std::string>();
     config_.yolo_config_path = config["yolo_config_path"].as<std::string>();
@@ -66,907 +86,873 @@ void MotionDetector::loadConfig(const std::string &configFile) {
     config_.yolo_confidence_threshold = config["yolo_confidence_threshold"].as<float>();
     config_.yolo_nms_threshold = config["yolo_nms_threshold"].as<float>();
     config_.yolo_input_size = config["yolo_input_size"].as<int>();
+    config_.yolo_warmup_runs = config["yolo_warmup_runs"].as<int>(1);
     config_.moving_up_lock_frames = config["moving_up_lock_frames"].as<int>();
-}
-
-void MotionDetector::initializeParallelProcessing() {
-    if (config_.use_multi_thread) {
-        config_.thread_amount = config_.thread_amount == -1 ? std::thread::hardware_concurrency() : config_.thread_amount;
-        thread_pool = std::make_unique<ThreadPool>(config_.thread_amount);
-    }
-
-    if (cv::ocl::haveOpenCL() && config_.use_gpu) {
-        cv::ocl::setUseOpenCL(true);
-        if (cv::ocl::useOpenCL()) {
-            std::cout << "Using GPU acceleration via OpenCL" << std::endl;
-        } else {
-            std::cout << "OpenCL is available, but not in use." << std::endl;
+    config_.frame_cache_dir = config["frame_cache_dir"].as<std::string>("");
+    config_.frame_cache_format = config["frame_cache_format"].as<std::string>("BGR");
+    config_.frame_cache_compression = config["frame_cache_compression"].as<bool>(false);
+    config_.estimator_trace_path = config["estimator_trace_path"].as<std::string>("");
+    config_.estimator_trace_min_magnitude = config["estimator_trace_min_magnitude"].as<float>(0.5f);
+    config_.estimator_trace_min_confidence = config["estimator_trace_min_confidence"].as<float>(0.1f);
+    config_.flow_region_mode = config["flow_region_mode"].as<std::string>("FULL");
+    config_.flow_region_padding = config["flow_region_padding"].as<int>(16);
+    config_.flow_region_min_area = config["flow_region_min_area"].as<double>(50.0);
+    config_.segments = config["segments"].as<int>(1);
+    config_.segment_warmup = config["segment_warmup"].as<int>(150);
+    config_.quality_target_ms = config["quality_target_ms"].as<double>(0.0);
+    config_.quality_window = config["quality_window"].as<int>(30);
+    config_.quality_upgrade_headroom = config["quality_upgrade_headroom"].as<double>(0.7);
+    config_.metrics_port = config["metrics_port"].as<int>(0);
+    config_.metrics_file = config["metrics_file"].as<std::string>("");
+    config_.metrics_interval_ms = config["metrics_interval_ms"].as<int>(1000);
+
+    if (config["zones"]) {
+        for (const auto& node : config["zones"]) {
+            ZoneConfig zone;
+            zone.name = node["name"].as<std::string>("zone" + std::to_string(config_.zones.size() + 1));
+            zone.row_start = node["upper_margin"].as<int>(config_.row_start);
+            zone.row_end = node["bottom_margin"].as<int>(config_.row_end);
+            zone.col_start = node["left_margin"].as<int>(config_.col_start);
+            zone.col_end = node["right_margin"].as<int>(config_.col_end);
+            zone.angle_up_min = node["angle_up_min"].as<int>(config_.angle_up_min);
+            zone.angle_up_max = node["angle_up_max"].as<int>(config_.angle_up_max);
+            zone.angle_down_min = node["angle_down_min"].as<int>(config_.angle_down_min);
+            zone.angle_down_max = node["angle_down_max"].as<int>(config_.angle_down_max);
+            zone.threshold = node["threshold"].as<double>(config_.threshold);
+            zone.size = node["size"].as<int>(config_.size);
+            zone.moving_up_lock_frames = node["moving_up_lock_frames"].as<int>(config_.moving_up_lock_frames);
+            zone.video_annot = node["video_annot"].as<std::string>(config_.video_annot);
+            config_.zones.push_back(zone);
+        }
+    }
+
+    // The ROI becomes the union of the zones, so decoding, cropping and caching still work on one region
+    if (!config_.zones.empty()) {
+        config_.row_start = config_.zones[0].row_start;
+        config_.row_end = config_.zones[0].row_end;
+        config_.col_start = config_.zones[0].col_start;
+        config_.col_end = config_.zones[0].col_end;
+        for (const auto& zone : config_.zones) {
+            config_.row_start = std::min(config_.row_start, zone.row_start);
+            config_.row_end = std::min(config_.row_end, zone.row_end);
+            config_.col_start = std::min(config_.col_start, zone.col_start);
+            config_.col_end = std::min(config_.col_end, zone.col_end);
         }
-    } else {
-        cv::ocl::setUseOpenCL(false);
-        std::cout << "GPU acceleration disabled (by config or unavailable)." << std::endl;
     }
+
+    return config_;
 }
 
-float MotionDetector::detectMotion(cv::Mat& frame, cv::Mat& gray, cv::Mat& gray_previous, cv::Mat& hsv) {
-    float result;
-    if (config_.algorithm == "FARNE") {
-        result = detectFarneOpticalFlowMotion(frame, gray, gray_previous, hsv);
+cv::Rect MotionDetector::zoneRect(const AppConfig& config, const ZoneConfig& zone, const cv::Size& roi_size) {
+    cv::Rect roi(cv::Point(), roi_size);
+    if (config.zones.empty()) {
+        return roi;
     }
-    else if (config_.algorithm == "LK") {
-        result = detectLKOpticalFlowMotion(frame, gray, gray_previous, hsv);
-    }
-    else if (config_.algorithm == "YOLO") {
-        result = detectYOLOMotion(frame);
+
+    // The union margins are taken from the zones, config margins are absolute once a video is opened
+    int top = zone.row_start, bottom = zone.row_end, left = zone.col_start, right = zone.col_end;
+    for (const auto& other : config.zones) {
+        top = std::min(top, other.row_start);
+        bottom = std::min(bottom, other.row_end);
+        left = std::min(left, other.col_start);
+        right = std::min(right, other.col_end);
     }
 
-    return result;
+    cv::Rect rect(zone.col_start - left, zone.row_start - top,
+                  roi_size.width - (zone.col_start - left) - (zone.col_end - right),
+                  roi_size.height - (zone.row_start - top) - (zone.row_end - bottom));
+    return rect & roi;
 }
 
-static cv::cuda::GpuMat d_gray_previous, d_gray, d_flow;
+AppConfig MotionDetector::zoneConfig(const AppConfig& config, const ZoneConfig& zone) {
+    AppConfig zone_config = config;
+    zone_config.angle_up_min = zone.angle_up_min;
+    zone_config.angle_up_max = zone.angle_up_max;
+    zone_config.angle_down_min = zone.angle_down_min;
+    zone_config.angle_down_max = zone.angle_down_max;
+    zone_config.threshold = zone.threshold;
+    zone_config.size = zone.size;
+    zone_config.moving_up_lock_frames = zone.moving_up_lock_frames;
+    zone_config.video_annot = zone.video_annot;
+    zone_config.zones.clear();
+    return zone_config;
+}
 
-float MotionDetector::detectFarneOpticalFlowMotion(cv::Mat& frame, cv::Mat& gray, cv::Mat& gray_previous, cv::Mat& hsv) {
-    cv::Mat flow(gray.size(), CV_32FC2);
-    cv::Mat mask, ang, ang_180, mag, fgMask;
+void MotionDetector::initializeZones() {
+    zones.clear();
+    estimator_zones.clear();
 
-    backSub->apply(frame, fgMask);
+    if (config_.zones.empty()) {
+        zones.push_back({"", ZoneConfig{}, config_, DecisionLayer(config_)});
+        return;
+    }
 
-    cv::morphologyEx(fgMask, fgMask, cv::MORPH_OPEN, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3,3 )));
-    std::vector<std::vector<cv::Point>> contours;
-    findContours(fgMask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    for (const auto& zone : config_.zones) {
+        AppConfig zone_config = zoneConfig(config_, zone);
+        zones.push_back({zone.name, zone, zone_config, DecisionLayer(zone_config)});
+    }
+}
 
-    cv::Mat motionMask = cv::Mat::ones(frame.size(), CV_8UC1) * 255;
-    for (const auto& contour : contours) {
-        double area = cv::contourArea(contour);
-        if (area > 12000) {
-            cv::Rect bound = cv::boundingRect(contour);
-            rectangle(motionMask, bound, cv::Scalar(0), cv::FILLED);
-        }
+void MotionDetector::locateZones(const cv::Size& roi_size) {
+    zones_size = roi_size;
+    // Flow magnitudes shrink with a frame scaled by the governor and grow with its stride, so do the thresholds
+    estimator_zones.clear();
+    for (const auto& zone : zones) {
+        double threshold = governor ? governor->current().scaledMagnitude(zone.config.threshold)
+                                    : zone.config.threshold;
+        estimator_zones.push_back({zoneRect(config_, zone.zone, roi_size), threshold});
     }
+}
 
-    cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
-    cv::Mat gray_filtered_previous, gray_filtered;
-    gray_previous.copyTo(gray_filtered_previous, motionMask);
-    gray.copyTo(gray_filtered, motionMask);
+bool MotionDetector::initializeEstimator() {
+    AllocationCounter::install();
+    estimator = createMotionEstimator(config_);
 
-    if (config_.debug) {
-        cv::imshow("Pedestrian Motion (Farnebäck)", gray_filtered);
+    governor.reset();
+    frame_quality_level = -1;
+    frame_decided = true;
+    if (estimator && config_.quality_target_ms > 0.0) {
+        governor = std::make_unique<QualityGovernor>(config_, config_.quality_target_ms, config_.quality_window,
+                                                     config_.quality_upgrade_headroom);
     }
+    return estimator != nullptr;
+}
 
+void MotionDetector::tuneExecution(const cv::Size& roi_size) {
+    if (!config_.auto_tune) {
+        return;
+    }
 
-    if (config_.use_gpu && cv::cuda::getCudaEnabledDeviceCount() > 0) {
-#ifdef HAVE_CUDA
-        try {
-            cv::cuda::Stream stream;
-            d_gray.upload(gray_filtered, stream);
-            d_gray_previous.upload(gray_filtered_previous, stream);
-
-            if (d_flow.size() != gray_filtered.size() || d_flow.type() != CV_32FC2) {
-                d_flow.release();
-                d_flow.create(gray_filtered.size(), CV_32FC2);
-            }
+    AutoTuner tuner(config_);
+    bool measured = false;
+    ExecutionVariant variant = tuner.select(roi_size, measured);
 
-            static auto farneback = cv::cuda::FarnebackOpticalFlow::create(
-                config_.levels, config_.pyr_scale, false, config_.winsize, config_.iterations, config_.poly_n, config_.poly_sigma, 0);
+    // Measuring left the global OpenCL switch of the last candidate, so a measured variant is always recreated
+    if (!measured && AutoTuner::matches(variant, config_)) {
+        return;
+    }
+    AutoTuner::apply(variant, config_);
+    estimator = createMotionEstimator(config_);
+}
 
-            farneback->calc(d_gray_previous, d_gray, d_flow, stream);
+cv::Mat& MotionDetector::governedFrame(cv::Mat& roi_frame) {
+    double scale = governor->current().scale;
+    if (scale >= 1.0) {
+        return roi_frame;
+    }
+    cv::resize(roi_frame, scaled_frame, cv::Size(), scale, scale, cv::INTER_AREA);
+    return scaled_frame;
+}
 
-            std::vector<cv::cuda::GpuMat> d_flow_channels(3);
-            cv::cuda::split(d_flow, d_flow_channels, stream);
+void MotionDetector::observeQuality(int64_t decide_start) {
+    double frame_ms = static_cast<double>(DecisionPublisher::now() - decide_start) / 1e6;
+    if (!governor->observe(frame_ms)) {
+        return;
+    }
 
-            cv::cuda::GpuMat d_mag, d_ang;
-            cv::cuda::cartToPolar(d_flow_channels[0], d_flow_channels[1], d_mag, d_ang, true, stream);
+    const QualityLevel& level = governor->current();
+    estimator->setQuality(level);
+    // The thresholds follow the stride as well as the scale, the zones are located again for the next frame
+    estimator_zones.clear();
+    std::cout << "Quality level " << governor->level() << " at " << frame_ms << " ms per frame (scale "
+              << level.scale << ", stride " << level.frame_stride << ")" << std::endl;
+}
 
-            cv::cuda::GpuMat d_ang_180;
-            cv::cuda::divide(d_ang, cv::Scalar(2.0), d_ang_180);
+// Gray input comes from gray frame caches. It is copied because cached frames may live in a reused decode buffer.
+static void toGray(const cv::Mat& frame, cv::Mat& gray) {
+    if (frame.channels() == 1) {
+        frame.copyTo(gray);
+    } else {
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    }
+}
 
-            cv::cuda::GpuMat d_mask;
-            cv::cuda::threshold(d_mag, d_mask, config_.threshold, 255, cv::THRESH_BINARY, stream);
+void MotionDetector::decideFrame(cv::Mat& roi_frame, cv::Mat& gray_previous) {
+    uint64_t allocations_before = AllocationCounter::count();
+    int64_t decide_start = DecisionPublisher::now();
 
-            d_mask.download(mask, stream);
-            d_ang.download(ang, stream);
-            d_ang_180.download(ang_180, stream);
-            d_mag.download(mag, stream);
-            stream.waitForCompletion();
+    // Frames between the strides of the governor keep the decisions of the last decided frame
+    if (governor) {
+        frame_quality_level = governor->level();
+        frame_decided = !governor->skipFrame();
+        if (!frame_decided) {
+            frame_allocations = 0;
+            return;
         }
-        catch (const cv::Exception& e) {
-            std::cerr << "CUDA Optical Flow failed: " << e.what() << std::endl;
-            return -1.0f;
-        }
-#endif
-    } else if (config_.use_gpu && cv::ocl::haveOpenCL()) {
-        try {
-            cv::UMat u_gray_previous, u_gray, u_flow;
-            cv::calcOpticalFlowFarneback(gray_filtered_previous, gray_filtered, flow, config_.pyr_scale,
-                config_.levels, config_.winsize, config_.iterations,
-                config_.poly_n, config_.poly_sigma, 0);
-
-            flow.copyTo(u_flow);
-
-            std::vector<cv::UMat> u_flow_channels(2);
-            cv::split(u_flow, u_flow_channels);
-
-            cv::UMat u_mag, u_ang;
-            cv::cartToPolar(u_flow_channels[0], u_flow_channels[1], u_mag, u_ang, true);
-
-            cv::UMat u_ang_180;
-            cv::divide(u_ang, cv::Scalar(2.0), u_ang_180);
-
-            cv::UMat u_mask;
-            cv::threshold(u_mag, u_mask, config_.threshold, 255, cv::THRESH_BINARY);
-
-            u_mask.copyTo(mask);
-            u_ang.copyTo(ang);
-            u_ang_180.copyTo(ang_180);
-            u_mag.copyTo(mag);
-        } catch (const cv::Exception& e) {
-            std::cerr << "OpenCL post-processing failed: " << e.what() << std::endl;
-            return -1.0f;
-        }
-    } else if (config_.use_multi_thread) {
-        int cols_per_thread = gray_filtered.cols / config_.thread_amount;
-        std::vector<std::future<void>> futures;
-        std::vector<cv::Mat> flow_parts(config_.thread_amount);
-
-        for (int i = 0; i < config_.thread_amount; i++) {
-            int start_col = i * cols_per_thread;
-            int end_col = (i == config_.thread_amount - 1) ? gray_filtered.cols : (i + 1) * cols_per_thread;
+    }
+    cv::Mat& frame = governor ? governedFrame(roi_frame) : roi_frame;
 
-            cv::Range col_range(start_col, end_col);
-            cv::Mat gray_section = gray_filtered(cv::Range::all(), col_range);
-            cv::Mat prev_section = gray_filtered_previous(cv::Range::all(), col_range);
+    // After a scale change the previous frame is brought to the new size and the zones are located again
+    if (gray_previous.size() != frame.size()) {
+        cv::resize(gray_previous, gray, frame.size(), 0, 0, cv::INTER_AREA);
+        std::swap(gray_previous, gray);
+    }
 
-            flow_parts[i] = cv::Mat(gray_section.rows, end_col - start_col, CV_32FC2);
+    toGray(frame, gray);
+    hsv.create(frame.size(), CV_8UC3);
+    hsv.setTo(cv::Scalar(0, 255, 0));
 
-            futures.push_back(thread_pool->enqueue([=, &flow_parts]() {
-                cv::calcOpticalFlowFarneback(prev_section, gray_section, flow_parts[i],
-                    config_.pyr_scale, config_.levels, config_.winsize, config_.iterations, config_.poly_n, config_.poly_sigma, 0);
-            }));
-        }
+    if (estimator_zones.empty() || zones_size != frame.size()) {
+        locateZones(frame.size());
+    }
 
-        for (auto& future : futures) {
-            future.get();
-        }
+    EstimatorFrame* trace_frame = nullptr;
+    if (recording_trace) {
+        trace_frame = &estimator_trace.frames.emplace_back();
+    }
 
-        for (int i = 0; i < config_.thread_amount; i++) {
-            int start_col = i * cols_per_thread;
-            int end_col = (i == config_.thread_amount - 1) ? gray.cols : (i + 1) * cols_per_thread;
+    estimator->estimate(frame, gray, gray_previous, estimator_zones, estimates, hsv, trace_frame);
 
-            cv::Range col_range(start_col, end_col);
-            flow_parts[i].copyTo(flow(cv::Range::all(), col_range));
-        }
+    // The changed pixel count is set for the full ROI, a scaled frame has fewer pixels
+    int threshold_count = governor
+        ? static_cast<int>(std::lround(governor->current().scaledArea(config_.threshold_count)))
+        : config_.threshold_count;
 
-        std::vector<cv::Mat> flow_channels(2);
-        cv::split(flow, flow_channels);
+    decisions.clear();
+    for (size_t i = 0; i < zones.size(); ++i) {
+        DecisionLayer& decision_layer = zones[i].decision_layer;
+        const MotionEstimate& estimate = estimates[i];
 
-        cv::cartToPolar(flow_channels[0], flow_channels[1], mag, ang, true);
+        int vote = -1;
+        if (estimate.kind != EstimateKind::None) {
+            DirectionVote direction = DirectionVote::Waiting;
+            switch (estimate.kind) {
+                case EstimateKind::Flow:
+                    direction = decision_layer.classifyFlow(estimate.move_mode);
+                    break;
+                case EstimateKind::Detections:
+                    direction = decision_layer.classifyDetections(estimate.move_mode, estimate.has_detections);
+                    break;
+                case EstimateKind::Difference:
+                    direction = DirectionVote::Difference;
+                    break;
+                default:
+                    break;
+            }
 
-        ang_180 = ang / 2;
-        mask = mag > config_.threshold;
-    }
-    else {
-        cv::calcOpticalFlowFarneback(gray_filtered_previous, gray_filtered, flow, config_.pyr_scale, config_.levels,
-            config_.winsize, config_.iterations, config_.poly_n, config_.poly_sigma, 0);
+            // Flow finds no direction when the change is too small or too fast to track, the frame difference
+            // still sees it
+            if (direction == DirectionVote::Waiting && estimate.kind != EstimateKind::Detections &&
+                config_.difference_vote) {
+                const cv::Rect& rect = estimator_zones[i].rect;
+                if (FrameDifference::hasChanged(gray(rect), gray_previous(rect), config_.binary_threshold,
+                                                threshold_count)) {
+                    direction = DirectionVote::Difference;
+                }
+            }
 
-        //TODO: need to cleanup this code
-        std::vector<cv::Mat> flow_channels(2);
-        cv::split(flow, flow_channels);
+            decision_layer.vote(direction);
+            vote = static_cast<int>(direction);
+        }
 
-        cv::cartToPolar(flow_channels[0], flow_channels[1], mag, ang, true);
+        int loc = decision_layer.decide();
+        decisions.push_back({estimate.move_mode, loc, DecisionLayer::isCrossing(loc), vote});
+    }
 
-        ang_180 = ang / 2;
-        mask = mag > config_.threshold;
+    // An estimator fails for all zones at once, so the first one tells if the frame voted
+    if (trace_frame) {
+        trace_frame->voted = estimates[0].kind != EstimateKind::None;
     }
 
-    std::vector<cv::Point> non_zero_points;
-    cv::findNonZero(mask, non_zero_points);
+    // The older buffer is overwritten by the next frame
+    std::swap(gray_previous, gray);
 
-    std::vector<float> move_sense;
-    for (const auto& pt : non_zero_points) {
-        move_sense.push_back(ang.at<float>(pt));
+    frame_allocations = static_cast<int>(AllocationCounter::count() - allocations_before);
+    if (governor) {
+        observeQuality(decide_start);
     }
+}
 
-    float move_mode = MotionUtils::calculateMode(move_sense);
-    bool is_moving_up =
-        MotionUtils::isAngleInRange(move_mode, config_.angle_up_min, config_.angle_up_max) ||
-        MotionUtils::isAngleInRange(move_mode, config_.angle_down_min, config_.angle_down_max);
-
+void MotionDetector::describeFrame(const cv::Mat& frame, double elapsed, double balanced_accuracy) {
+    snapshot.roi_width = frame.cols;
+    snapshot.fps = 1000.0 / elapsed;
+    snapshot.balanced_accuracy = balanced_accuracy;
+
+    // Cached frames are already cropped, only full frames get the ROI outline and offset zones
+    bool full_frame = snapshot.frame.size() != frame.size();
+    snapshot.roi = full_frame
+        ? cv::Rect(cv::Point(config_.col_start, config_.row_start), cv::Point(config_.col_end, config_.row_end))
+        : cv::Rect();
+    cv::Point offset = full_frame ? cv::Point(config_.col_start, config_.row_start) : cv::Point();
+
+    snapshot.zones.resize(zones.size());
+    for (size_t i = 0; i < zones.size(); ++i) {
+        const DecisionLayer& decision_layer = zones[i].decision_layer;
+        RenderZone& zone = snapshot.zones[i];
+        zone.name = zones[i].name;
+        // The governor may decide a scaled ROI, the zones are drawn on the full one
+        cv::Rect rect = zones_size == frame.size() ? estimator_zones[i].rect
+                                                   : zoneRect(config_, zones[i].zone, frame.size());
+        zone.rect = rect + offset;
+        zone.move_mode = decisions[i].move_mode;
+        zone.location = decisions[i].location;
+        zone.is_crossing = decisions[i].is_crossing;
+        zone.locked = decision_layer.isLocked();
+        zone.lock_counter = decision_layer.lockCounter();
+        zone.lock_frames = zones[i].config.moving_up_lock_frames;
+    }
+
+    // Debug images are copies, the estimator buffers are reused by the next frame
     if (config_.debug) {
-        std::cout << move_mode << std::endl;
-    }
-
-    if (is_moving_up) {
-        directions_map[directions_map.size() - 1][0] = 3.5f;
-        directions_map[directions_map.size() - 1][1] = 0;
-        directions_map[directions_map.size() - 1][2] = 0;
-        directions_map[directions_map.size() - 1][3] = 0;
-    }
-    else if (move_mode < config_.angle_up_min || config_.angle_up_max < move_mode ||
-        move_mode < config_.angle_down_min || config_.angle_down_max < move_mode) {
-        directions_map[directions_map.size() - 1][0] = 0;
-        directions_map[directions_map.size() - 1][1] = 1;
-        directions_map[directions_map.size() - 1][2] = 0;
-        directions_map[directions_map.size() - 1][3] = 0;
-    }
-    else { //No movement detected
-        // cv::Mat fg_mask;
-        // backSub->apply(frame, fg_mask);
-        //
-        // cv::Mat fg_mask_blurred;
-        // cv::GaussianBlur(fg_mask, fg_mask_blurred, cv::Size(7, 7), 0);
-        //
-        // cv::Mat tresh_frame;
-        // cv::threshold(fg_mask_blurred, tresh_frame, config_.binary_threshold, 255, cv::THRESH_BINARY);
-        //
-        // if (config_.debug) {
-        //     cv::imshow("tresh_frame", tresh_frame);
-        // }
-        //
-        // if (cv::countNonZero(tresh_frame) > config_.threshold_count) {
-        //     directions_map[directions_map.size() - 1][0] = 0;
-        //     directions_map[directions_map.size() - 1][1] = 0;
-        //     directions_map[directions_map.size() - 1][2] = 1;
-        //     directions_map[directions_map.size() - 1][3] = 0;
-        // }
-        { //No movement, no difference detected
-            directions_map[directions_map.size() - 1][0] = 0;
-            directions_map[directions_map.size() - 1][1] = 0;
-            directions_map[directions_map.size() - 1][2] = 0;
-            directions_map[directions_map.size() - 1][3] = 1;
+        hsv.copyTo(snapshot.flow);
+        const std::vector<DebugView>& views = estimator->debugViews();
+        snapshot.debug_views.resize(views.size());
+        for (size_t i = 0; i < views.size(); ++i) {
+            snapshot.debug_views[i].name = views[i].name;
+            views[i].image.copyTo(snapshot.debug_views[i].image);
         }
     }
+}
 
-    MotionUtils::roll(directions_map);
-
-    if (hsv.empty() || hsv.type() != CV_8UC3) {
-        hsv = cv::Mat(frame.size(), CV_8UC3, cv::Scalar(0, 255, 0));
+std::unique_ptr<DecisionPublisher> MotionDetector::createDecisionPublisher() const {
+    if (config_.decision_output.empty()) {
+        return nullptr;
     }
 
-    std::vector<cv::Mat> hsv_channels;
-    cv::split(hsv, hsv_channels);
-
-    if (hsv_channels.size() == 3) {
-        if (ang_180.size() != hsv_channels[0].size()) {
-            cv::resize(ang_180, ang_180, hsv_channels[0].size());
-        }
-        ang_180.convertTo(hsv_channels[0], hsv_channels[0].type());
-
-        if (mag.size() != hsv_channels[2].size()) {
-            cv::resize(mag, mag, hsv_channels[2].size());
-        }
-        cv::normalize(mag, hsv_channels[2], 0, 255, cv::NORM_MINMAX, CV_8U);
+    DecisionOutputMode mode;
+    if (!DecisionPublisher::parseMode(config_.decision_output, mode)) {
+        std::cerr << "Error: Unknown decision output " << config_.decision_output << std::endl;
+        return nullptr;
+    }
 
-        cv::merge(hsv_channels, hsv);
-    } else {
-        std::cerr << "Error: hsv_channels does not have 3 elements!" << std::endl;
+    auto publisher = std::make_unique<DecisionPublisher>(mode, config_.decision_output_path,
+                                                         config_.decision_output_edges_only);
+    if (!publisher->isOpen()) {
+        return nullptr;
     }
+    return publisher;
+}
 
-    return move_mode;
+bool MotionDetector::hasLiveOutput() const {
+    return config_.display || !config_.record_path.empty();
 }
 
-float MotionDetector::detectLKOpticalFlowMotion(cv::Mat& frame, cv::Mat& gray, cv::Mat& gray_previous, cv::Mat& hsv) {
-    std::vector<cv::Point2f> prev_pts, curr_pts;
-    std::vector<uchar> status;
-    std::vector<float> err;
+FrameCacheKey MotionDetector::frameCacheKey() const {
+    // Estimators that need color input always use BGR caches
+    bool gray_cache = config_.frame_cache_format == "GRAY" && !estimator->needsColor();
+    return {config_.video_src, config_.row_start, config_.row_end, config_.col_start, config_.col_end,
+            config_.seek, config_.seek_end, gray_cache};
+}
 
-    cv::Mat fgMask;
+void MotionDetector::run() {
+    start_time_ns = DecisionPublisher::now();
+    if (!initializeEstimator()) {
+        return;
+    }
+    initializeZones();
 
-    backSub->apply(frame, fgMask);
+    if (config_.live_source) {
+        runLive();
+        return;
+    }
 
-    cv::morphologyEx(fgMask, fgMask, cv::MORPH_OPEN, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3,3 )));
-    std::vector<std::vector<cv::Point>> contours;
-    findContours(fgMask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    // Caching only makes sense for files, a live stream never repeats
+    FrameCacheKey cache_key = frameCacheKey();
+    std::string cache_path;
+    if (!config_.frame_cache_dir.empty() && std::filesystem::is_regular_file(config_.video_src)) {
+        cache_path = frameCachePath(config_.frame_cache_dir, cache_key);
+    }
 
-    cv::Mat motionMask = cv::Mat::ones(frame.size(), CV_8UC1) * 255;
-    for (const auto& contour : contours) {
-        double area = cv::contourArea(contour);
-        cv::Rect bound = cv::boundingRect(contour);
+    FrameCacheReader cache_reader;
+    if (!cache_path.empty() && cache_reader.open(cache_path) && cache_reader.matches(cache_key)) {
+        std::cout << "Reading decoded frames from cache " << cache_path << std::endl;
+        runFromCache(cache_reader);
+        return;
+    }
 
-        double aspectRatio = static_cast<double>(bound.height) / bound.width;
+    cv::VideoCapture cap(config_.video_src);
 
-        if (area > 12000 || aspectRatio > 2.5) {
-            rectangle(motionMask, bound, cv::Scalar(0), cv::FILLED);
-        }
+    if (!cap.isOpened()) {
+        std::cerr << "Error: Could not open video source: " << config_.video_src << std::endl;
+        return;
     }
 
-    cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
-    cv::Mat gray_filtered_previous, gray_filtered;
-    gray_previous.copyTo(gray_filtered_previous, motionMask);
-    gray.copyTo(gray_filtered, motionMask);
-
-    if (config_.debug) {
-        cv::imshow("Pedestrian Motion (LK)", gray_filtered);
-    }
-
-    if (config_.use_gpu && cv::cuda::getCudaEnabledDeviceCount() > 0) {
-#ifdef HAVE_CUDA
-        cv::goodFeaturesToTrack(gray_filtered_previous, prev_pts, config_.max_corners, config_.quality_level, config_.min_distance,
-            cv::Mat(), 7, false, 0.04);
-        if (prev_pts.empty()) {
-            // No features to track - set to WAITING status
-            directions_map[directions_map.size() - 1][0] = 0;
-            directions_map[directions_map.size() - 1][1] = 0;
-            directions_map[directions_map.size() - 1][2] = 0;
-            directions_map[directions_map.size() - 1][3] = 1;
-            MotionUtils::roll(directions_map);
-            return -1.0f;
-        }
+    int height = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+    int width = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
 
-        cv::cuda::GpuMat d_prev_pts(prev_pts);
-        cv::cuda::GpuMat d_gray_prev(gray_filtered_previous);
-        cv::cuda::GpuMat d_gray(gray_filtered);
-        cv::cuda::GpuMat d_curr_pts, d_status, d_err;
+    config_.row_end = height - config_.row_end;
+    config_.col_end = width - config_.col_end;
 
-        auto lk = cv::cuda::SparsePyrLKOpticalFlow::create();
-        lk->calc(d_gray_prev, d_gray, d_prev_pts, d_curr_pts, d_status, d_err);
+    FrameIndex::seek(cap, config_.video_src, config_.seek);
 
-        cv::Mat h_curr_pts, h_status;
-        d_curr_pts.download(h_curr_pts);
-        d_status.download(h_status);
+    cv::Mat frame_previous;
+    cap >> frame_previous;
+    if (frame_previous.empty()) {
+        std::cerr << "Error: Failed to grab first frame" << std::endl;
+        return;
+    }
 
-        curr_pts.resize(prev_pts.size());
-        status.resize(prev_pts.size());
+    cv::Range rows(config_.row_start, config_.row_end);
+    cv::Range cols(config_.col_start, config_.col_end);
 
-        for (size_t i = 0; i < prev_pts.size(); ++i) {
-            if (h_status.at<uchar>(i)) {
-                curr_pts[i] = h_curr_pts.at<cv::Point2f>(i);
-                status[i] = 1;
-            } else {
-                status[i] = 0;
-            }
-        }
-#endif
-    } else if (config_.use_gpu && cv::ocl::haveOpenCL()) {
-        cv::UMat u_gray_previous, u_gray;
-
-        gray_filtered_previous.copyTo(u_gray_previous);
-        gray_filtered.copyTo(u_gray);
-
-        cv::goodFeaturesToTrack(u_gray_previous, prev_pts, config_.max_corners, config_.quality_level, config_.min_distance,
-            cv::Mat(), 7, false, 0.04);
-
-        if (prev_pts.empty()) {
-            // No features to track - set to WAITING status
-            directions_map[directions_map.size() - 1][0] = 0;
-            directions_map[directions_map.size() - 1][1] = 0;
-            directions_map[directions_map.size() - 1][2] = 0;
-            directions_map[directions_map.size() - 1][3] = 1;
-            MotionUtils::roll(directions_map);
-            return -1.0f;
-        }
-        cv::calcOpticalFlowPyrLK(u_gray_previous, u_gray, prev_pts, curr_pts, status, err);
-    } else {
-        cv::goodFeaturesToTrack(gray_filtered_previous, prev_pts, config_.max_corners, config_.quality_level, config_.min_distance,
-            cv::Mat(), 7, false, 0.04);
-
-        if (prev_pts.empty()) {
-            // No features to track - set to WAITING status
-            directions_map[directions_map.size() - 1][0] = 0;
-            directions_map[directions_map.size() - 1][1] = 0;
-            directions_map[directions_map.size() - 1][2] = 0;
-            directions_map[directions_map.size() - 1][3] = 1;
-            MotionUtils::roll(directions_map);
-            return -1.0f;
+    FrameCacheWriter cache_writer;
+    if (!cache_path.empty()) {
+        FrameCacheCompression compression = config_.frame_cache_compression
+            ? FrameCacheCompression::DeltaRLE : FrameCacheCompression::None;
+        if (cache_writer.open(cache_path, cache_key, compression)) {
+            cache_writer.write(frame_previous(rows, cols));
         }
-
-        cv::calcOpticalFlowPyrLK(gray_filtered_previous, gray, prev_pts, curr_pts, status, err);
     }
 
-    std::vector<float> move_sense;
+    cv::Mat gray_previous;
+    toGray(frame_previous(rows, cols), gray_previous);
 
-    for (size_t i = 0; i < status.size(); ++i) {
-        if (status[i]) {
-            float dx = curr_pts[i].x - prev_pts[i].x;
-            float dy = curr_pts[i].y - prev_pts[i].y;
-            float magnitude = std::sqrt(dx * dx + dy * dy);
+    cv::Mat frame;
+    bool first_frame = true;
+    bool reached_end = false;
 
-            // FIXME: CHECK IF WORKS: Filter - only consider moderate velocities typical of pedestrians
-            if (magnitude > config_.threshold && magnitude < 10) {
-                float angle = std::atan2(dy, dx) * 180.0f / CV_PI;
-                if (angle < 0) angle += 360.0f;
-                move_sense.push_back(angle);
-            }
+    processStream([&](cv::Mat& roi_frame, cv::Mat& display_frame, int&, int64_t& capture_time_ns) {
+        // seek_end is checked after each processed frame, like before, so at least one frame is always processed
+        if (!first_frame && config_.seek_end > 0 && cap.get(cv::CAP_PROP_POS_FRAMES) >= config_.seek_end) {
+            reached_end = true;
+            return false;
         }
-    }
-
-    // if (move_sense.empty()) {
-    //     cv::Mat fg_mask;
-    //     backSub->apply(frame, fg_mask);
-    //
-    //     cv::Mat blurred, tresh_frame;
-    //     cv::GaussianBlur(fg_mask, blurred, cv::Size(7, 7), 0);
-    //     cv::threshold(blurred, tresh_frame, config_.binary_threshold, 255, cv::THRESH_BINARY);
-    //
-    //     if (config_.debug) {
-    //         cv::imshow("LK threshold frame", tresh_frame);
-    //     }
-    //
-    //     if (cv::countNonZero(tresh_frame) > config_.threshold_count) {
-    //         // Difference detected
-    //         directions_map[directions_map.size() - 1][0] = 0;
-    //         directions_map[directions_map.size() - 1][1] = 0;
-    //         directions_map[directions_map.size() - 1][2] = 1;
-    //         directions_map[directions_map.size() - 1][3] = 0;
-    //     }
-    //     else {
-    //         // No movement, no difference detected - WAITING
-    //         directions_map[directions_map.size() - 1][0] = 0;
-    //         directions_map[directions_map.size() - 1][1] = 0;
-    //         directions_map[directions_map.size() - 1][2] = 0;
-    //         directions_map[directions_map.size() - 1][3] = 1;
-    //     }
-    //
-    //     MotionUtils::roll(directions_map);
-    //
-    //     if (hsv.empty() || hsv.type() != CV_8UC3) {
-    //         hsv = cv::Mat(frame.size(), CV_8UC3, cv::Scalar(0, 255, 0));
-    //     }
-    //     return -1.0f;
-    // }
-
-    float move_mode = MotionUtils::calculateMode(move_sense);
-    bool is_moving_up =
-        MotionUtils::isAngleInRange(move_mode, config_.angle_up_min, config_.angle_up_max) ||
-        MotionUtils::isAngleInRange(move_mode, config_.angle_down_min, config_.angle_down_max);
+        first_frame = false;
 
-    if (config_.debug) {
-        std::cout << "LK Mode: " << move_mode << std::endl;
-    }
-
-    if (is_moving_up) {
-        directions_map[directions_map.size() - 1][0] = 3.5f;
-        directions_map[directions_map.size() - 1][1] = 0;
-        directions_map[directions_map.size() - 1][2] = 0;
-        directions_map[directions_map.size() - 1][3] = 0;
-    }
-    else if (move_mode < config_.angle_up_min || config_.angle_up_max < move_mode ||
-             move_mode < config_.angle_down_min || config_.angle_down_max < move_mode) {
-        directions_map[directions_map.size() - 1][0] = 0;
-        directions_map[directions_map.size() - 1][1] = 1;
-        directions_map[directions_map.size() - 1][2] = 0;
-        directions_map[directions_map.size() - 1][3] = 0;
-    }
-    else {
-        // cv::Mat fg_mask;
-        // backSub->apply(frame, fg_mask);
-        //
-        // cv::Mat blurred, tresh_frame;
-        // cv::GaussianBlur(fg_mask, blurred, cv::Size(7, 7), 0);
-        // cv::threshold(blurred, tresh_frame, config_.binary_threshold, 255, cv::THRESH_BINARY);
-        //
-        // if (config_.debug) {
-        //     cv::imshow("LK threshold frame", tresh_frame);
-        // }
-        //
-        // if (cv::countNonZero(tresh_frame) > config_.threshold_count) {
-        //     directions_map[directions_map.size() - 1][0] = 0;
-        //     directions_map[directions_map.size() - 1][1] = 0;
-        //     directions_map[directions_map.size() - 1][2] = 1;
-        //     directions_map[directions_map.size() - 1][3] = 0;
-        // }
-        {
-            directions_map[directions_map.size() - 1][0] = 0;
-            directions_map[directions_map.size() - 1][1] = 0;
-            directions_map[directions_map.size() - 1][2] = 0;
-            directions_map[directions_map.size() - 1][3] = 1;
+        if (!cap.read(frame) || frame.empty()) {
+            std::cerr << "Error: Failed to grab frame" << std::endl;
+            reached_end = true;
+            return false;
         }
-    }
-
-    MotionUtils::roll(directions_map);
-
-    if (hsv.empty() || hsv.type() != CV_8UC3) {
-        hsv = cv::Mat(frame.size(), CV_8UC3, cv::Scalar(0, 255, 0));
-    }
+        capture_time_ns = DecisionPublisher::now();
 
-    std::vector<cv::Mat> hsv_channels;
-    cv::split(hsv, hsv_channels);
-    if (hsv_channels.size() == 3) {
-        cv::Mat ang_map(frame.size(), CV_32F, cv::Scalar(0));
-        for (size_t i = 0; i < prev_pts.size(); ++i) {
-            if (status[i]) {
-                float dx = curr_pts[i].x - prev_pts[i].x;
-                float dy = curr_pts[i].y - prev_pts[i].y;
-                float angle = std::atan2(dy, dx) * 180.0f / CV_PI;
-                if (angle < 0) angle += 360.0f;
-                ang_map.at<float>(prev_pts[i]) = angle / 2;
-            }
+        // The display copy reuses the buffer of a previous frame
+        if (hasLiveOutput()) {
+            frame.copyTo(display_frame);
         }
+        roi_frame = frame(rows, cols);
 
-        cv::Mat mag_map(frame.size(), CV_32F, cv::Scalar(0));
-        for (size_t i = 0; i < prev_pts.size(); ++i) {
-            if (status[i]) {
-                float dx = curr_pts[i].x - prev_pts[i].x;
-                float dy = curr_pts[i].y - prev_pts[i].y;
-                float magnitude = std::sqrt(dx * dx + dy * dy);
-                mag_map.at<float>(prev_pts[i]) = magnitude;
-            }
+        if (cache_writer.isOpen()) {
+            cache_writer.write(roi_frame);
         }
+        return true;
+    }, gray_previous, config_.seek);
 
-        ang_map.convertTo(hsv_channels[0], hsv_channels[0].type());
-        cv::normalize(mag_map, hsv_channels[2], 0, 255, cv::NORM_MINMAX, CV_8U);
-        cv::merge(hsv_channels, hsv);
-    }
-
-    if (config_.debug) {
-        cv::Mat output_frame = frame.clone();
-        for (size_t i = 0; i < status.size(); ++i) {
-            if (status[i]) {
-                cv::line(output_frame, prev_pts[i], curr_pts[i], cv::Scalar(0, 255, 0), 2);
-                cv::circle(output_frame, curr_pts[i], 3, cv::Scalar(0, 0, 255), -1);
-            }
+    // A run stopped early would leave a cache that does not cover the configured range
+    if (cache_writer.isOpen()) {
+        if (reached_end) {
+            cache_writer.finish();
+        } else {
+            cache_writer.discard();
         }
-        cv::imshow("LK Optical Flow", output_frame);
     }
 
-    return move_mode;
+    cap.release();
 }
 
-bool MotionDetector::initializeYOLO() {
-    if (yolo_initialized) {
-        return true;
+void MotionDetector::runLive() {
+    // A live source is never cached, frames that arrive while the detector is busy are replaced by newer ones
+    LiveFrameGrabber grabber;
+    if (!grabber.open(config_.video_src, config_.seek, config_.seek_end)) {
+        std::cerr << "Error: Could not open video source: " << config_.video_src << std::endl;
+        return;
     }
-    try {
-        yolo_network = cv::dnn::readNetFromDarknet(config_.yolo_config_path, config_.yolo_weights_path);
-
-         if (config_.use_gpu && cv::cuda::getCudaEnabledDeviceCount() > 0) {
-            yolo_network.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
-            yolo_network.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
-            std::cout << "YOLO using GPU acceleration" << std::endl;
-         } else if (config_.use_gpu && cv::ocl::haveOpenCL()) {
-             yolo_network.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-             yolo_network.setPreferableTarget(cv::dnn::DNN_TARGET_OPENCL);
-             std::cout << "YOLO using OpenCL GPU acceleration" << std::endl;
-         } else {
-            yolo_network.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-            yolo_network.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
-            std::cout << "YOLO using CPU" << std::endl;
-        }
-
-        std::ifstream class_file(config_.yolo_classes_path);
-        if (class_file.is_open()) {
-            std::string line;
-            while (getline(class_file, line)) {
-                class_names.push_back(line);
-            }
-            class_file.close();
-        }
 
-        yolo_initialized = true;
-        std::cout << "YOLO initialized successfully with " << class_names.size() << " classes" << std::endl;
-        return true;
+    cv::Size frame_size = grabber.frameSize();
+    config_.row_end = frame_size.height - config_.row_end;
+    config_.col_end = frame_size.width - config_.col_end;
 
-    } catch (const cv::Exception& e) {
-        std::cerr << "Failed to initialize YOLO: " << e.what() << std::endl;
-        return false;
-    }
-}
+    cv::Range rows(config_.row_start, config_.row_end);
+    cv::Range cols(config_.col_start, config_.col_end);
 
-float MotionDetector::detectYOLOMotion(cv::Mat& frame) {
-    if (!initializeYOLO()) {
-        return -1.0f;
+    GrabbedFrame grabbed;
+    if (!grabber.next(grabbed)) {
+        std::cerr << "Error: Failed to grab first frame" << std::endl;
+        return;
     }
 
-    cv::Mat blob;
-    cv::dnn::blobFromImage(frame, blob, 1.0 / 255.0, cv::Size(config_.yolo_input_size, config_.yolo_input_size),
-        cv::Scalar(0, 0, 0), true, false, CV_32F);
-
-    yolo_network.setInput(blob);
-
-    // int64 start_time = cv::getTickCount();
+    cv::Mat gray_previous;
+    toGray(grabbed.image(rows, cols), gray_previous);
 
-    std::vector<cv::Mat> outputs;
-    try {
-        yolo_network.forward(outputs, yolo_network.getUnconnectedOutLayersNames());
-    } catch (const cv::Exception& e) {
-        std::cerr << "YOLO forward pass failed: " << e.what() << std::endl;
-        return -1.0f;
-    }
+    live_grabber = &grabber;
 
-    // int64 end_time = cv::getTickCount();
-    // double time_taken_ms = (end_time - start_time) * 1000.0 / cv::getTickFrequency();
-    // std::cout << "Difference took " << time_taken_ms << " ms" << std::endl;
+    processStream([&](cv::Mat& roi_frame, cv::Mat& display_frame, int& frame_index, int64_t& capture_time_ns) {
+        if (!grabber.next(grabbed)) {
+            return false;
+        }
+        // The frame index follows the source, so dropped frames are skipped in the ground truth as well. Results
+        // are numbered from the seeding frame, like the file runs.
+        frame_index = grabbed.frame_index - 1;
+        capture_time_ns = grabbed.capture_time_ns;
 
-    std::vector<cv::Rect> boxes;
-    std::vector<float> confidences;
-    std::vector<int> class_ids;
+        if (hasLiveOutput()) {
+            grabbed.image.copyTo(display_frame);
+        }
+        roi_frame = grabbed.image(rows, cols);
+        return true;
+    }, gray_previous, grabbed.frame_index);
 
-    for (auto& output : outputs) {
-        for (int i = 0; i < output.rows; ++i) {
-            const float* data = output.ptr<float>(i);
-            float confidence = data[4];
+    live_grabber = nullptr;
+    grabber.close();
+    std::cout << "Live source grabbed " << grabber.grabbedFrames() << " frames, dropped "
+              << grabber.droppedFrames() << " stale frames" << std::endl;
+}
 
-            if (confidence >= config_.yolo_confidence_threshold) {
-                cv::Mat scores = output.row(i).colRange(5, output.cols);
-                cv::Point class_id_point;
-                double max_class_score;
-                minMaxLoc(scores, 0, &max_class_score, 0, &class_id_point);
+void MotionDetector::runFromCache(FrameCacheReader& cache_reader) {
+    cv::Mat first_frame;
+    if (!cache_reader.frame(0, first_frame)) {
+        std::cerr << "Error: Failed to read first frame from cache" << std::endl;
+        return;
+    }
 
-                if (max_class_score > config_.yolo_confidence_threshold && class_id_point.x == 0) {
-                    int center_x = static_cast<int>(data[0] * frame.cols);
-                    int center_y = static_cast<int>(data[1] * frame.rows);
-                    int width = static_cast<int>(data[2] * frame.cols);
-                    int height = static_cast<int>(data[3] * frame.rows);
-                    int left = center_x - width / 2;
-                    int top = center_y - height / 2;
+    cv::Mat gray_previous;
+    toGray(first_frame, gray_previous);
 
-                    boxes.push_back(cv::Rect(left, top, width, height));
-                    confidences.push_back(confidence);
-                    class_ids.push_back(class_id_point.x);
-                }
-            }
+    int next_frame = 1;
+    processStream([&](cv::Mat& roi_frame, cv::Mat& display_frame, int&, int64_t& capture_time_ns) {
+        if (next_frame >= cache_reader.frameCount() || !cache_reader.frame(next_frame++, roi_frame)) {
+            return false;
         }
-    }
+        capture_time_ns = DecisionPublisher::now();
 
-    if (config_.debug) {
-        for (size_t i = 0; i < boxes.size(); ++i) {
-            std::cout << "Detection " << i
-                      << ": class_id=" << class_ids[i]
-                      << ", confidence=" << confidences[i]
-                      << ", box=" << boxes[i] << std::endl;
+        // The cached frame is read-only, overlays go on a copy
+        if (!hasLiveOutput()) {
+            return true;
         }
-    }
-
-    std::vector<int> indices;
-    cv::dnn::NMSBoxes(boxes, confidences, config_.yolo_confidence_threshold, config_.yolo_nms_threshold, indices);
+        if (roi_frame.channels() == 1) {
+            cv::cvtColor(roi_frame, display_frame, cv::COLOR_GRAY2BGR);
+        } else {
+            roi_frame.copyTo(display_frame);
+        }
+        return true;
+    }, gray_previous, cache_reader.firstFrameIndex());
+}
 
-    std::vector<cv::Rect> current_detections;
-    cv::Mat display_frame = frame.clone();
+std::unique_ptr<MetricsExporter> MotionDetector::createMetricsExporter(const DetectorMetrics& detector_metrics,
+                                                                      const FrameRenderer* renderer,
+                                                                      const VideoRecorder* recorder) const {
+    auto exporter = std::make_unique<MetricsExporter>(config_.metrics_port, config_.metrics_file,
+                                                      config_.metrics_interval_ms);
+    exporter->addCollector([&detector_metrics](std::ostream& out) { detector_metrics.write(out); });
 
-    for (int idx : indices) {
-        if (class_ids[idx] == 0) {
-            cv::rectangle(display_frame, boxes[idx], cv::Scalar(0, 255, 0), 2);
-            std::string label = cv::format("Pedestrian: %.2f", confidences[idx]);
-            int baseLine = 0;
-            cv::Size labelSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
-            int top = std::max(boxes[idx].y, labelSize.height);
-            cv::putText(display_frame, label, cv::Point(boxes[idx].x, top - 5),
-                        cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 255, 0), 1);
+    // The background threads keep their own counters, they are only read here
+    const LiveFrameGrabber* grabber = live_grabber;
+    exporter->addCollector([grabber, renderer, recorder](std::ostream& out) {
+        MetricsExporter::writeHeader(out, "zebraflash_frames_dropped_total", "counter",
+                                     "Frames dropped by the stage that fell behind.");
+        if (grabber) {
+            out << "zebraflash_frames_dropped_total{stage=\"source\"} " << grabber->droppedFrames() << "\n";
         }
-
-        current_detections.push_back(boxes[idx]);
+        if (renderer) {
+            out << "zebraflash_frames_dropped_total{stage=\"display\"} " << renderer->droppedFrames() << "\n";
+        }
+        if (recorder) {
+            out << "zebraflash_frames_dropped_total{stage=\"recorder\"} " << recorder->droppedFrames() << "\n";
+        }
+    });
+    if (grabber) {
+        exporter->addCounter("zebraflash_frames_grabbed_total", "Frames read from the live source.",
+                             [grabber]() { return static_cast<double>(grabber->grabbedFrames()); });
     }
-
-    if (config_.debug) {
-        cv::imshow("Pedestrian Detections", display_frame);
-        cv::waitKey(1);
+    if (recorder) {
+        exporter->addGauge("zebraflash_recorder_queue_depth", "Frames waiting for the encoder.",
+                           [recorder]() { return static_cast<double>(recorder->queuedFrames()); });
+    }
+    if (const ThreadPool* pool = estimator->threadPool()) {
+        exporter->addGauge("zebraflash_pool_workers", "Threads of the estimator pool.",
+                           [pool]() { return static_cast<double>(pool->size()); });
+        exporter->addGauge("zebraflash_pool_busy_workers", "Estimator pool threads running a task.",
+                           [pool]() { return static_cast<double>(pool->busyWorkers()); });
     }
 
-    float move_mode = calculateMotionFromDetections(current_detections);
-
-    previous_detections = current_detections;
-
-    updateDirectionsFromYOLO(move_mode, current_detections);
-
-    return move_mode;
+    if (!exporter->start()) {
+        std::cerr << "Error: Could not start the metrics exporter" << std::endl;
+        return nullptr;
+    }
+    if (config_.metrics_port > 0) {
+        std::cout << "Serving metrics on http://127.0.0.1:" << config_.metrics_port << "/metrics" << std::endl;
+    }
+    return exporter;
 }
 
-float MotionDetector::calculateMotionFromDetections(const std::vector<cv::Rect>& current_detections) {
-    if (previous_detections.empty() || current_detections.empty()) {
-        return INT_MIN;
+void MotionDetector::recordFrameMetrics(DetectorMetrics& detector_metrics, const DecisionPublisher* publisher,
+                                        int64_t read_start, int64_t read_end, int64_t decide_end,
+                                        int64_t publish_end, int64_t capture_time_ns) const {
+    int64_t output_end = DecisionPublisher::now();
+    detector_metrics.frames_processed.add();
+    detector_metrics.stage(FrameStage::Read).observe(static_cast<double>(read_end - read_start) / 1e9);
+    detector_metrics.stage(FrameStage::Decide).observe(static_cast<double>(decide_end - read_end) / 1e9);
+    detector_metrics.stage(FrameStage::Publish).observe(static_cast<double>(publish_end - decide_end) / 1e9);
+    detector_metrics.stage(FrameStage::Output).observe(static_cast<double>(output_end - publish_end) / 1e9);
+    detector_metrics.capture_latency.observe(static_cast<double>(decide_end - capture_time_ns) / 1e9);
+
+    for (size_t i = 0; i < zones.size(); ++i) {
+        DetectorMetrics::Zone& zone = detector_metrics.zones[i];
+        zone.decisions[decisions[i].location].add();
+        zone.location.set(decisions[i].location);
+        zone.locked.set(zones[i].decision_layer.isLocked() ? 1.0 : 0.0);
+        zone.lock_counter.set(zones[i].decision_layer.lockCounter());
+    }
+
+    if (publisher) {
+        detector_metrics.messages_published.set(static_cast<uint64_t>(publisher->publishedMessages()));
+        detector_metrics.messages_dropped.set(static_cast<uint64_t>(publisher->droppedMessages()));
     }
+}
 
-    std::vector<float> motion_angles;
-
-    for (const auto& current_box: current_detections) {
-        cv::Point2f current_center(current_box.x + current_box.width / 2.0f,
-            current_box.y + current_box.height / 2.0f);
+void MotionDetector::processStream(const std::function<bool(cv::Mat&, cv::Mat&, int&, int64_t&)>& nextFrame,
+                                   cv::Mat& gray_previous, int frame_index) {
+    Benchmark timer;
+    tuneExecution(gray_previous.size());
+    beginTrace(frame_index);
 
-        float min_distance = std::numeric_limits<float>::max();
-        cv::Point2f best_match_center;
-        bool found_match = false;
+    // Every zone gets its own results and metrics, accumulated per frame so they can be shown live and nothing is
+    // recomputed at the end. Ground truth is loaded for all zones first, the accumulators point into it.
+    std::vector<std::vector<BenchmarkResult>> results(zones.size());
+    std::vector<GroundTruth> ground_truths;
+    for (const auto& zone : zones) {
+        ground_truths.push_back(loadGroundTruth(zone.config.video_annot));
+    }
+    std::vector<CrossingMetricsAccumulator> metrics(ground_truths.begin(), ground_truths.end());
 
-        for (const auto& prev_box: previous_detections) {
-            cv::Point2f prev_center(prev_box.x + prev_box.width / 2.0f,
-                prev_box.y + prev_box.height / 2.0f);
+    // Drawing and encoding run on their own threads, the detector only fills a snapshot and never waits for them
+    std::unique_ptr<FrameRenderer> renderer;
+    if (config_.display) {
+        renderer = std::make_unique<FrameRenderer>(WINDOW_NAME);
+    }
+    std::unique_ptr<DecisionPublisher> publisher = createDecisionPublisher();
+    std::unique_ptr<VideoRecorder> recorder;
+    if (!config_.record_path.empty()) {
+        recorder = std::make_unique<VideoRecorder>(config_.record_path, config_.record_fourcc, config_.record_fps,
+            config_.record_queue_size, VideoRecorder::parseDropPolicy(config_.record_drop_policy));
+    }
 
-            float distance = cv::norm(current_center - prev_center);
-            if (distance < min_distance && distance < 100.0f) { //thresold for matching
-                min_distance = distance;
-                best_match_center = prev_center;
-                found_match = true;
-            }
+    // Only the frame thread writes the metrics, the exporter thread reads them when it is scraped
+    std::unique_ptr<DetectorMetrics> detector_metrics;
+    std::unique_ptr<MetricsExporter> exporter;
+    if (config_.metrics_port > 0 || !config_.metrics_file.empty()) {
+        std::vector<std::string> zone_names;
+        for (const auto& zone : zones) {
+            zone_names.push_back(zone.name.empty() ? "main" : zone.name);
         }
-
-        //TODO: better angle detection and calculation
-        if (found_match) {
-            cv::Point2f motion_vector = current_center - best_match_center;
-            float motion_angle = atan2(motion_vector.y, motion_vector.x) * 180.0f / CV_PI;
-            if (motion_angle < 0) {
-                motion_angle += 360.0f;
-            }
-            motion_angles.push_back(motion_angle);
+        detector_metrics = std::make_unique<DetectorMetrics>(zone_names);
+        exporter = createMetricsExporter(*detector_metrics, renderer.get(), recorder.get());
+        if (!exporter) {
+            detector_metrics.reset();
         }
     }
 
-    return MotionUtils::calculateMode(motion_angles);
-}
+    cv::Mat frame;
+    int64_t capture_time_ns = 0;
+    int64_t read_start = DecisionPublisher::now();
 
-void MotionDetector::updateDirectionsFromYOLO(float move_mode, const std::vector<cv::Rect>& detections) {
+    while (nextFrame(frame, snapshot.frame, frame_index, capture_time_ns)) {
+        int64_t read_end = DecisionPublisher::now();
+        timer.start();
+        decideFrame(frame, gray_previous);
+        double elapsed = timer.stop();
+        int64_t decide_end = DecisionPublisher::now();
+        double capture_latency = static_cast<double>(decide_end - capture_time_ns) / 1e6;
+
+        // Published before anything else, the actuator should not wait for the benchmark or the display
+        if (publisher) {
+            for (size_t i = 0; i < zones.size(); ++i) {
+                publisher->publish(static_cast<int>(i), frame_index, capture_time_ns, decisions[i].location,
+                                   decisions[i].is_crossing, decisions[i].move_mode);
+            }
+        }
+        int64_t publish_end = DecisionPublisher::now();
 
-    //TODO: Compare this to the other detections way, maybe make it to a separate function
-    if (detections.empty()) {
-        directions_map[directions_map.size() - 1][0] = 0;
-        directions_map[directions_map.size() - 1][1] = 0;
-        directions_map[directions_map.size() - 1][2] = 0;
-        directions_map[directions_map.size() - 1][3] = 1;
-    } else {
+        // The zones are decided from one estimator pass that cannot be split between them, so every zone records the
+        // time of the whole frame and its FPS is the rate of the pass
+        for (size_t i = 0; i < zones.size(); ++i) {
+            results[i].push_back({
+                frame_index,
+                config_.use_gpu,
+                elapsed,
+                decisions[i].is_crossing,
+                frame_allocations,
+                capture_latency,
+                static_cast<double>(decide_end - start_time_ns) / 1e6,
+                frame_quality_level,
+                frame_decided
+            });
+            metrics[i].add(frame_index, decisions[i].is_crossing);
+        }
+        frame_index++;
 
-        bool is_moving_up =
-            MotionUtils::isAngleInRange(move_mode, config_.angle_up_min, config_.angle_up_max) ||
-            MotionUtils::isAngleInRange(move_mode, config_.angle_down_min, config_.angle_down_max);
-
-        if (is_moving_up) {
-            directions_map[directions_map.size() - 1][0] = 3.5f;
-            directions_map[directions_map.size() - 1][1] = 0;
-            directions_map[directions_map.size() - 1][2] = 0;
-            directions_map[directions_map.size() - 1][3] = 0;
-        } else if (move_mode > 5.0f) {
-            // Other directions
-            directions_map[directions_map.size() - 1][0] = 0;
-            directions_map[directions_map.size() - 1][1] = 1;
-            directions_map[directions_map.size() - 1][2] = 0;
-            directions_map[directions_map.size() - 1][3] = 0;
-        } else {
-            directions_map[directions_map.size() - 1][0] = 0;
-            directions_map[directions_map.size() - 1][1] = 0;
-            directions_map[directions_map.size() - 1][2] = 1;
-            directions_map[directions_map.size() - 1][3] = 0;
+        if (hasLiveOutput()) {
+            bool has_accuracy = zones.size() == 1 && ground_truths[0].annotatedFrames() > 0;
+            describeFrame(frame, elapsed, has_accuracy ? metrics[0].metrics().balanced_accuracy : -1.0);
+        }
+        if (recorder) {
+            recorder->push(snapshot);
+        }
+        if (renderer) {
+            renderer->submit(snapshot);
+        }
+
+        if (detector_metrics) {
+            recordFrameMetrics(*detector_metrics, publisher.get(), read_start, read_end, decide_end, publish_end,
+                               capture_time_ns);
+        }
+        if (renderer && renderer->quitRequested()) {
+            break;
         }
+        read_start = DecisionPublisher::now();
     }
 
-    MotionUtils::roll(directions_map);
-}
+    // The collectors read the renderer and the recorder, the exporter goes first
+    exporter.reset();
 
-bool MotionDetector::processFrame(cv::Mat& frame, cv::Mat& orig_frame, cv::Mat& gray_previous) {
-    frame = frame(cv::Range(config_.row_start, config_.row_end), cv::Range(config_.col_start, config_.col_end));
+    if (renderer && renderer->droppedFrames() > 0) {
+        std::cout << "Live view dropped " << renderer->droppedFrames() << " frames" << std::endl;
+    }
+    renderer.reset();
 
-    cv::Mat gray;
-    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    std::vector<BackgroundCost> background;
+    if (publisher) {
+        background.push_back({"Decision Output", publisher->publishedMessages(), publisher->droppedMessages(),
+                              publisher->busyMilliseconds()});
+        std::cout << "Published " << publisher->publishedMessages() << " decision messages, dropped "
+                  << publisher->droppedMessages() << ", publish latency p50 "
+                  << publisher->latencyPercentile(50.0) * 1000.0 << " us, p99 "
+                  << publisher->latencyPercentile(99.0) * 1000.0 << " us" << std::endl;
+    }
+    if (recorder) {
+        recorder->finish();
+        background.push_back({"Recorder", recorder->recordedFrames(), recorder->droppedFrames(),
+                              recorder->busyMilliseconds()});
+        std::cout << "Recorded " << recorder->recordedFrames() << " frames to " << config_.record_path << ", dropped "
+                  << recorder->droppedFrames() << std::endl;
+    }
 
-    cv::Mat hsv(frame.size(), CV_8UC3, cv::Scalar(0, 255, 0));
+    finishTrace();
 
-    float move_mode = detectMotion(frame, gray, gray_previous, hsv);
+    if (zones.size() == 1) {
+        saveBenchmarkResults(results[0], ground_truths[0], metrics[0].metrics(), testIdentifier, background);
+        return;
+    }
+    for (size_t i = 0; i < zones.size(); ++i) {
+        saveBenchmarkResults(results[i], ground_truths[i], metrics[i].metrics(), testIdentifier + "_" + zones[i].name,
+                             background);
+    }
+}
 
-    int loc = MotionUtils::calculateMaxMeanColumn(directions_map);
+std::vector<BenchmarkResult> MotionDetector::processFrames(const std::vector<cv::Mat>& roi_frames, int first_frame_index) {
+    size_t next_frame = 0;
+    return processFrames([&](cv::Mat& roi_frame) {
+        if (next_frame >= roi_frames.size()) {
+            return false;
+        }
+        roi_frame = roi_frames[next_frame++];
+        return true;
+    }, first_frame_index);
+}
 
-    loc = applyMovingUpLock(loc);
+std::vector<BenchmarkResult> MotionDetector::processFrames(const std::function<bool(cv::Mat&)>& nextFrame,
+                                                           int first_frame_index) {
+    std::vector<BenchmarkResult> results;
+    start_time_ns = DecisionPublisher::now();
 
-    std::string text;
-    if (loc == 0) {
-        text = "Moving up (LED ON!)";
-    }
-    else if (loc == 1) {
-        text = "Other directions";
-    }
-    else if (loc == 2) {
-        text = "Difference (LED ON!)";
-    }
-    else {
-        text = "WAITING";
+    cv::Mat frame;
+    if (!nextFrame(frame)) {
+        return results;
     }
 
-    cv::Mat rgb;
-    cv::cvtColor(hsv, rgb, cv::COLOR_HSV2BGR);
+    if (!initializeEstimator()) {
+        return results;
+    }
+    initializeZones();
 
-    int text_thinkness = 6;
+    cv::Mat gray_previous;
+    toGray(frame, gray_previous);
+    tuneExecution(gray_previous.size());
+    beginTrace(first_frame_index);
 
-    cv::putText(orig_frame, "Angle: " + std::to_string(static_cast<int>(move_mode)),
-            cv::Point(30, 150), cv::FONT_HERSHEY_COMPLEX,
-            frame.cols / 500.0, cv::Scalar(0, 0, 255), 6);
+    Benchmark timer;
 
-    cv::putText(orig_frame, text, cv::Point(30, 90), cv::FONT_HERSHEY_COMPLEX,
-        orig_frame.cols / 500.0, cv::Scalar(0, 0, 255), text_thinkness);
+    int frame_index = first_frame_index;
+    while (nextFrame(frame)) {
+        timer.start();
+        decideFrame(frame, gray_previous);
+        double elapsed = timer.stop();
 
-    if (is_moving_up_locked) {
-        std::string lock_info = "LOCKED: " + std::to_string(moving_up_lock_counter) +
-                                "/" + std::to_string(config_.moving_up_lock_frames);
-        cv::putText(orig_frame, lock_info, cv::Point(30, 240), cv::FONT_HERSHEY_COMPLEX,
-            frame.cols / 500.0, cv::Scalar(255, 0, 255), 3);
+        results.push_back({
+            frame_index++,
+            config_.use_gpu,
+            elapsed,
+            decisions[0].is_crossing,
+            frame_allocations,
+            0.0,
+            static_cast<double>(DecisionPublisher::now() - start_time_ns) / 1e6,
+            frame_quality_level,
+            frame_decided
+        });
     }
 
-    gray_previous = gray;
+    finishTrace();
 
-    return loc == 0 || loc == 2;
+    return results;
 }
 
-int MotionDetector::applyMovingUpLock(int current_loc) {
-
-    if (config_.moving_up_lock_frames == 0) {
-        return current_loc;
+cv::Rect MotionDetector::beginFrames(const cv::Size& frame_size) {
+    start_time_ns = DecisionPublisher::now();
+    if (!initializeEstimator()) {
+        return cv::Rect();
     }
+    initializeZones();
 
-    if (is_moving_up_locked) {
-        moving_up_lock_counter++;
+    config_.row_end = frame_size.height - config_.row_end;
+    config_.col_end = frame_size.width - config_.col_end;
+    pushed_gray_previous.release();
+    decisions.clear();
 
-        if (moving_up_lock_counter >= config_.moving_up_lock_frames) {
-            is_moving_up_locked = false;
-            moving_up_lock_counter = 0;
-            return current_loc;
-        } else {
-            return 0;
-        }
-    }
+    return cv::Rect(config_.col_start, config_.row_start, config_.col_end - config_.col_start,
+                    config_.row_end - config_.row_start);
+}
 
-    if (current_loc == 0) {
-        is_moving_up_locked = true;
-        moving_up_lock_counter = 0;
+const std::vector<FrameDecision>& MotionDetector::decideNext(const cv::Mat& roi_frame) {
+    if (pushed_gray_previous.empty()) {
+        toGray(roi_frame, pushed_gray_previous);
+        tuneExecution(roi_frame.size());
+        decisions.clear();
+        return decisions;
     }
 
-    return current_loc;
+    // decideFrame only reads the frame, the header copy keeps the caller's Mat untouched
+    cv::Mat frame = roi_frame;
+    decideFrame(frame, pushed_gray_previous);
+    return decisions;
 }
 
-void MotionDetector::run() {
-    initializeParallelProcessing();
+void MotionDetector::takeDecisions(std::vector<FrameDecision>& out) {
+    if (governor) {
+        out = decisions;
+    } else {
+        out.swap(decisions);
+    }
+}
 
-    cv::namedWindow(WINDOW_NAME, cv::WINDOW_NORMAL);
-    cv::VideoCapture cap(config_.video_src);
+bool MotionDetector::needsColorFrames() const {
+    return estimator && estimator->needsColor();
+}
 
-    if (!cap.isOpened()) {
-        std::cerr << "Error: Could not open video source: " << config_.video_src << std::endl;
+void MotionDetector::beginTrace(int first_frame_index) {
+    recording_trace = !config_.estimator_trace_path.empty();
+    if (!recording_trace) {
         return;
     }
 
-    Benchmark timer;
-    std::vector<BenchmarkResult> results;
-    int frame_index = config_.seek;
-
-    int height = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
-    int width = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
-
-    config_.row_end = height - config_.row_end;
-    config_.col_end = width - config_.col_end;
-
-    cap.set(cv::CAP_PROP_POS_FRAMES, config_.seek);
-
-    cv::Mat frame_previous;
-    cap >> frame_previous;
-    if (frame_previous.empty()) {
-        std::cerr << "Error: Failed to grab first frame" << std::endl;
+    // A trace replays one decision layer, the per zone split is not recorded
+    if (zones.size() > 1) {
+        std::cerr << "Warning: estimator traces are not recorded with several zones" << std::endl;
+        recording_trace = false;
         return;
     }
 
-    cv::Mat gray_previous;
-    cv::cvtColor(frame_previous(cv::Range(config_.row_start, config_.row_end), cv::Range(config_.col_start, config_.col_end)),
-                 gray_previous, cv::COLOR_BGR2GRAY);
-
-    cv::Mat frame, orig_frame;
-    bool grabbed;
-
-    while (true) {
-        grabbed = cap.read(frame);
-
-        if (!grabbed || frame.empty()) {
-            std::cerr << "Error: Failed to grab frame" << std::endl;
-            break;
-        }
-
-        orig_frame = frame.clone();
-
-        timer.start();
-        bool crossing_intent = processFrame(frame, orig_frame, gray_previous);
-        double elapsed = timer.stop();
-
-        cv::putText(orig_frame, "FPS: " + std::to_string(1000.0 / elapsed), cv::Point(30, 200), cv::FONT_HERSHEY_COMPLEX,
-                    frame.cols / 500.0, cv::Scalar(0, 255, 0), 3);
-
-        results.push_back({
-            frame_index++,
-            config_.use_gpu,
-            elapsed,
-            crossing_intent
-        });
-
-        cv::rectangle(orig_frame, cv::Point(config_.col_start, config_.row_start), cv::Point(config_.col_end, config_.row_end),
-            cv::Scalar(0, 255, 0), 3);
-        cv::imshow(WINDOW_NAME, orig_frame);
+    estimator_trace = EstimatorTrace{};
+    estimator_trace.algorithm = config_.algorithm;
+    estimator_trace.video_src = config_.video_src;
+    estimator_trace.video_annot = config_.video_annot;
+    estimator_trace.first_frame_index = first_frame_index;
+    estimator->describeTrace(estimator_trace);
+}
 
-        if (cv::waitKey(1) == 'q' || (config_.seek_end > 0 && cap.get(cv::CAP_PROP_POS_FRAMES) >= config_.seek_end)) {
-            break;
-        }
+void MotionDetector::finishTrace() {
+    if (recording_trace) {
+        estimator_trace.save(config_.estimator_trace_path);
+        estimator_trace.frames.clear();
+        recording_trace = false;
     }
-
-    saveBenchmarkResults(results, config_.video_annot, testIdentifier);
-
-    cap.release();
-    cv::destroyAllWindows();
-}
\ No newline at end of file
+}
@@ -3,10 +3,37 @@
 
 #include <opencv2/opencv.hpp>
 #include <yaml-cpp/yaml.h>
+#include <functional>
 #include <string>
 #include <vector>
 
-#include "../thread-pool/thread_pool.h"
+#include "../decision-output/decision_publisher.h"
+#include "../frame-cache/frame_cache.h"
+#include "../metrics/detector_metrics.h"
+#include "../motion-estimator/motion_estimator.h"
+#include "../quality-governor/quality_governor.h"
+#include "../replay/estimator_trace.h"
+#include "decision_layer.h"
+#include "frame_renderer.h"
+#include "video_recorder.h"
+
+// Crosswalk zone with its own decision parameters. The margins count from the frame edges like the main ROI,
+// the other fields default to the top level values.
+struct ZoneConfig {
+    std::string name;
+    int row_start;
+    int row_end;
+    int col_start;
+    int col_end;
+    int angle_up_min;
+    int angle_up_max;
+    int angle_down_min;
+    int angle_down_max;
+    double threshold;
+    int size;
+    int moving_up_lock_frames;
+    std::string video_annot;
+};
 
 struct AppConfig {
     std::string video_src;
@@ -26,19 +53,37 @@ struct AppConfig {
     double threshold;
     int binary_threshold;
     int threshold_count;
+    bool difference_vote;
     double pyr_scale;
     int levels;
     int winsize;
     int iterations;
     int poly_n;
     double poly_sigma;
+    std::string dis_preset;
+    int dis_patch_size;
+    int dis_patch_stride;
     int max_corners;
     double quality_level;
     int min_distance;
     bool debug;
+    bool display;
+    std::string record_path;
+    std::string record_fourcc;
+    double record_fps;
+    int record_queue_size;
+    std::string record_drop_policy;
+    std::string decision_output;
+    std::string decision_output_path;
+    bool decision_output_edges_only;
+    bool live_source;
     bool use_gpu;
     bool use_multi_thread;
     int thread_amount;
+    std::string flow_strips;
+    bool auto_tune;
+    std::string auto_tune_cache;
+    int auto_tune_frames;
     std::string algorithm;
     std::string yolo_weights_path;
     std::string yolo_config_path;
@@ -46,48 +91,154 @@ struct AppConfig {
     float yolo_confidence_threshold;
     float yolo_nms_threshold;
     int yolo_input_size;
+    int yolo_warmup_runs;
     int moving_up_lock_frames;
+    std::string frame_cache_dir;
+    std::string frame_cache_format;
+    bool frame_cache_compression;
+    std::string estimator_trace_path;
+    float estimator_trace_min_magnitude;
+    float estimator_trace_min_confidence;
+    std::string flow_region_mode;
+    int flow_region_padding;
+    double flow_region_min_area;
+    int segments;
+    int segment_warmup;
+    double quality_target_ms;
+    int quality_window;
+    double quality_upgrade_headroom;
+    int metrics_port;
+    std::string metrics_file;
+    int metrics_interval_ms;
+    std::vector<ZoneConfig> zones;   // empty for a single zone covering the ROI, otherwise the ROI is their union
+};
+
+struct BenchmarkResult;
+class LiveFrameGrabber;
+
+struct FrameDecision {
+    float move_mode;
+    int location;       // winning directions_map column after the lock: 0 up, 1 other, 2 difference, 3 waiting
+    bool is_crossing;
+    int vote = -1;      // DirectionVote of this frame, -1 when the estimator failed and the frame did not vote
 };
 
 class MotionDetector {
 public:
     MotionDetector(const std::string& configFile, const std::string& testIdentifier  = "");
+    MotionDetector(const AppConfig& config, const std::string& testIdentifier  = "");
     void run();
 
+    // Headless processing of already cropped ROI frames, the first frame only seeds the previous gray image.
+    // The frames are only read, so the same decoded clip can be shared by several detectors. With several zones
+    // the results are the ones of the first zone.
+    std::vector<BenchmarkResult> processFrames(const std::vector<cv::Mat>& roi_frames, int first_frame_index);
+    // Same for frames read one at a time, nextFrame returns false after the last one. The frame it fills may be
+    // overwritten by the next call.
+    std::vector<BenchmarkResult> processFrames(const std::function<bool(cv::Mat&)>& nextFrame, int first_frame_index);
+
+    // Frame by frame processing for embedding, without a capture. beginFrames applies the margins for frames of
+    // frame_size and returns the ROI inside them, an empty rect when the estimator cannot be created. decideNext
+    // then takes ROI frames like processFrames: the first one only seeds the previous gray image and returns no
+    // decisions, the others one decision per zone. The frame is not referenced after decideNext returns.
+    cv::Rect beginFrames(const cv::Size& frame_size);
+    const std::vector<FrameDecision>& decideNext(const cv::Mat& roi_frame);
+    // Swaps the decisions of the last decideNext into out and keeps the buffer out held for the next frame. With the
+    // quality governor they are copied instead, the frames it skips repeat them.
+    void takeDecisions(std::vector<FrameDecision>& out);
+    // True when decideNext needs color ROI frames, otherwise gray ones are enough
+    bool needsColorFrames() const;
+
     AppConfig& getConfig();
 
+    static AppConfig parseConfig(const YAML::Node& config);
+
+    // Zone rectangle inside the ROI of a frame with roi_size, config holds the union margins
+    static cv::Rect zoneRect(const AppConfig& config, const ZoneConfig& zone, const cv::Size& roi_size);
+    // The detector config with the decision parameters of the zone
+    static AppConfig zoneConfig(const AppConfig& config, const ZoneConfig& zone);
+
 private:
+    // Decision state of one zone, every zone reads the same estimator pass over the ROI
+    struct Zone {
+        std::string name;
+        ZoneConfig zone;
+        AppConfig config;
+        DecisionLayer decision_layer;
+    };
+
     AppConfig config_;
     const std::string WINDOW_NAME = "window";
     std::string testIdentifier;
 
-    std::vector<std::vector<int>> directions_map;
-    cv::Ptr<cv::BackgroundSubtractor> backSub;
-
-    std::unique_ptr<ThreadPool> thread_pool;
-
-    bool is_moving_up_locked = false;
-    int moving_up_lock_counter = 0;
-
-    //YOLO fields, may need a separate file for YOLO
-    cv::dnn::Net yolo_network;
-    std::vector<std::string> class_names;
-    std::vector<cv::Rect> previous_detections;
-    bool yolo_initialized = false;
-
-    void loadConfig(const std::string& configFile);
-    void initializeParallelProcessing();
-    bool processFrame(cv::Mat& frame, cv::Mat& orig_frame, cv::Mat& gray_previous);
-    int applyMovingUpLock(int current_loc);
-    float detectMotion(cv::Mat& frame, cv::Mat& gray, cv::Mat& gray_previous, cv::Mat& hsv);
-    float detectFarneOpticalFlowMotion(cv::Mat& frame, cv::Mat& gray, cv::Mat& gray_previous, cv::Mat& hsv);
-    float detectLKOpticalFlowMotion(cv::Mat& frame, cv::Mat& gray, cv::Mat& gray_previous, cv::Mat& hsv);
-
-    //YOLO methods
-    bool initializeYOLO();
-    float detectYOLOMotion(cv::Mat& frame);
-    float calculateMotionFromDetections(const std::vector<cv::Rect>& current_detections);
-    void updateDirectionsFromYOLO(float motion_magnitude, const std::vector<cv::Rect>& detections);
+    std::vector<Zone> zones;
+    std::vector<EstimatorZone> estimator_zones;
+    std::vector<MotionEstimate> estimates;
+    std::vector<FrameDecision> decisions;
+    std::unique_ptr<MotionEstimator> estimator;
+
+    // Per frame images kept across frames, they are only reallocated when the ROI size changes
+    cv::Mat gray;
+    cv::Mat hsv;
+    cv::Mat scaled_frame;
+    int frame_allocations = 0;
+    cv::Size zones_size;   // ROI size the estimator zones were located for
+
+    // Set with quality_target_ms, frame_quality_level is the ladder step of the last frame or -1 without it
+    std::unique_ptr<QualityGovernor> governor;
+    int frame_quality_level = -1;
+    bool frame_decided = true;   // false when the governor skipped the last frame, it repeats the decisions
+
+    // Filled for the render thread, its buffers come back from the renderer
+    RenderSnapshot snapshot;
+
+    // Steady clock time the run started, the time to first decision counts from it
+    int64_t start_time_ns = 0;
+
+    // Previous gray ROI of beginFrames and decideNext
+    cv::Mat pushed_gray_previous;
+
+    // Set while runLive processes its source, for the drop metrics
+    const LiveFrameGrabber* live_grabber = nullptr;
+
+    bool recording_trace = false;
+    EstimatorTrace estimator_trace;
+
+    bool initializeEstimator();
+    // With auto_tune, replaces the execution settings by the fastest ones for roi_size and recreates the estimator
+    void tuneExecution(const cv::Size& roi_size);
+    void initializeZones();
+    void locateZones(const cv::Size& roi_size);
+    // Publisher for decision_output, nullptr when it is off or could not be opened
+    std::unique_ptr<DecisionPublisher> createDecisionPublisher() const;
+    // Exporter for metrics_port or metrics_file, nullptr when it could not be started. The renderer and the recorder
+    // may be null and must outlive the exporter.
+    std::unique_ptr<MetricsExporter> createMetricsExporter(const DetectorMetrics& detector_metrics,
+                                                           const FrameRenderer* renderer,
+                                                           const VideoRecorder* recorder) const;
+    // Stage times of the last frame from the loop timestamps, and the decisions and lock state of every zone
+    void recordFrameMetrics(DetectorMetrics& detector_metrics, const DecisionPublisher* publisher, int64_t read_start,
+                            int64_t read_end, int64_t decide_end, int64_t publish_end, int64_t capture_time_ns) const;
+    // True when the display frame is needed, for the live view or the recorder
+    bool hasLiveOutput() const;
+    FrameCacheKey frameCacheKey() const;
+    void runFromCache(FrameCacheReader& cache_reader);
+    // Frames from a live source, only the newest frame is processed when the detector falls behind
+    void runLive();
+    // nextFrame fills the ROI and display frames and the capture time, a source that skips frames also moves
+    // frame_index to the frame it returns
+    void processStream(const std::function<bool(cv::Mat&, cv::Mat&, int&, int64_t&)>& nextFrame,
+                       cv::Mat& gray_previous, int frame_index);
+    // Leaves one decision per zone in decisions and the drawn flow in hsv
+    void decideFrame(cv::Mat& roi_frame, cv::Mat& gray_previous);
+    // The ROI frame at the scale of the quality level
+    cv::Mat& governedFrame(cv::Mat& roi_frame);
+    // Hands the time of the frame to the governor and applies a new quality level to the estimator
+    void observeQuality(int64_t decide_start);
+    // Fills snapshot with the decisions of the last frame, snapshot.frame already holds the display frame
+    void describeFrame(const cv::Mat& frame, double elapsed, double balanced_accuracy);
+    void beginTrace(int first_frame_index);
+    void finishTrace();
 };
 
 #endif //MOTION_DETECTOR_H
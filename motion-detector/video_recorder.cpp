@@ -0,0 +1,154 @@
+#include <iostream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "video_recorder.h"
+
+namespace {
+
+// CPU time of the calling thread, so time the recorder thread waits to be scheduled is not counted as its work
+double threadCpuMilliseconds() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    auto ticks = [](const FILETIME& time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return static_cast<double>(ticks(kernel) + ticks(user)) / 10000.0;
+#else
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<double>(now.tv_sec) * 1000.0 + static_cast<double>(now.tv_nsec) / 1e6;
+#endif
+}
+
+}
+
+VideoRecorder::VideoRecorder(const std::string& path, const std::string& fourcc, double fps, size_t queue_size,
+                             RecorderDropPolicy drop_policy)
+    : path(path), fps(fps), drop_policy(drop_policy), queue(std::max<size_t>(1, queue_size)) {
+    std::string code = fourcc + "    ";
+    this->fourcc = cv::VideoWriter::fourcc(code[0], code[1], code[2], code[3]);
+    writer_thread = std::thread(&VideoRecorder::writeLoop, this);
+}
+
+VideoRecorder::~VideoRecorder() {
+    finish();
+}
+
+RecorderDropPolicy VideoRecorder::parseDropPolicy(const std::string& name) {
+    if (name == "NEWEST") {
+        return RecorderDropPolicy::Newest;
+    }
+    if (name != "OLDEST") {
+        std::cerr << "Warning: Unknown recorder drop policy " << name << ", using OLDEST" << std::endl;
+    }
+    return RecorderDropPolicy::Oldest;
+}
+
+void VideoRecorder::push(const RenderSnapshot& snapshot) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Frames pushed after finish or a failed open are counted, recorded and dropped frames add up to the pushed
+        if (finished) {
+            dropped++;
+            return;
+        }
+
+        if (count == queue.size()) {
+            dropped++;
+            if (drop_policy == RecorderDropPolicy::Newest) {
+                return;
+            }
+            head = (head + 1) % queue.size();
+            count--;
+        }
+
+        // Copied into the slot so the caller can reuse its snapshot, the slot buffers are reused
+        RenderSnapshot& slot = queue[(head + count) % queue.size()];
+        snapshot.frame.copyTo(slot.frame);
+        slot.roi = snapshot.roi;
+        slot.roi_width = snapshot.roi_width;
+        slot.zones = snapshot.zones;
+        slot.fps = snapshot.fps;
+        slot.balanced_accuracy = snapshot.balanced_accuracy;
+        count++;
+    }
+    ready.notify_one();
+}
+
+void VideoRecorder::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    ready.notify_one();
+    if (writer_thread.joinable()) {
+        writer_thread.join();
+    }
+}
+
+int VideoRecorder::recordedFrames() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return recorded;
+}
+
+int VideoRecorder::droppedFrames() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return dropped;
+}
+
+int VideoRecorder::queuedFrames() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<int>(count);
+}
+
+double VideoRecorder::busyMilliseconds() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return busy_ms;
+}
+
+void VideoRecorder::writeLoop() {
+    RenderSnapshot snapshot;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return count > 0 || finished; });
+            if (count == 0) {
+                break;
+            }
+            // The slot gets the buffers of the last written frame back
+            std::swap(snapshot, queue[head]);
+            head = (head + 1) % queue.size();
+            count--;
+        }
+
+        double start_ms = threadCpuMilliseconds();
+        if (!writer.isOpened() && !writer.open(path, fourcc, fps, snapshot.frame.size())) {
+            std::cerr << "Error: Could not open video writer " << path << std::endl;
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+            dropped += static_cast<int>(count) + 1;
+            count = 0;
+            break;
+        }
+
+        FrameRenderer::drawOverlay(snapshot);
+        writer.write(snapshot.frame);
+        double elapsed = threadCpuMilliseconds() - start_ms;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        recorded++;
+        busy_ms += elapsed;
+    }
+
+    writer.release();
+}
@@ -0,0 +1,67 @@
+#ifndef VIDEO_RECORDER_H
+#define VIDEO_RECORDER_H
+
+#include <opencv2/opencv.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_renderer.h"
+
+// What push does when the queue is full
+enum class RecorderDropPolicy {
+    Oldest,   // the oldest queued frame is replaced, the video keeps up with the stream
+    Newest    // the pushed frame is discarded, the queued frames are kept
+};
+
+// Writes annotated frames to a video file on its own thread. Frames wait in a bounded queue of reused buffers, push
+// only copies the snapshot and never waits for the encoder. When the queue is full a frame is dropped as the policy
+// says. The overlay is drawn on the recorder thread.
+class VideoRecorder {
+public:
+    VideoRecorder(const std::string& path, const std::string& fourcc, double fps, size_t queue_size,
+                  RecorderDropPolicy drop_policy);
+    ~VideoRecorder();
+
+    VideoRecorder(const VideoRecorder&) = delete;
+    VideoRecorder& operator=(const VideoRecorder&) = delete;
+
+    // Queues a copy of the display frame and overlay of snapshot
+    void push(const RenderSnapshot& snapshot);
+    // Writes the queued frames and closes the file
+    void finish();
+
+    int recordedFrames() const;
+    int droppedFrames() const;
+    // Frames waiting for the encoder
+    int queuedFrames() const;
+    // CPU time the recorder thread spent drawing and encoding
+    double busyMilliseconds() const;
+
+    static RecorderDropPolicy parseDropPolicy(const std::string& name);
+
+private:
+    std::string path;
+    int fourcc;
+    double fps;
+    RecorderDropPolicy drop_policy;
+
+    mutable std::mutex mutex;
+    std::condition_variable ready;
+    std::vector<RenderSnapshot> queue;   // ring buffer, its snapshots keep their buffers
+    size_t head = 0;
+    size_t count = 0;
+    bool finished = false;
+    int recorded = 0;
+    int dropped = 0;
+    double busy_ms = 0.0;
+
+    cv::VideoWriter writer;
+    std::thread writer_thread;
+
+    void writeLoop();
+};
+
+#endif //VIDEO_RECORDER_H
@@ -0,0 +1,56 @@
+#include <cmath>
+
+#include "motion_estimator.h"
+#include "../motion-detector/motion_detector.h"
+#include "../quality-governor/quality_governor.h"
+#include "../utils/frame_difference.h"
+
+namespace {
+
+// Frame differencing only: a zone votes difference when more than threshold_count of its pixels changed by more
+// than binary_threshold, otherwise waiting. It never measures a direction, so it costs a single pass over the ROI.
+class DifferenceEstimator : public MotionEstimator {
+public:
+    explicit DifferenceEstimator(const AppConfig& config);
+
+    void estimate(const cv::Mat& frame, const cv::Mat& gray, const cv::Mat& gray_previous,
+                  const std::vector<EstimatorZone>& zones, std::vector<MotionEstimate>& estimates, cv::Mat& hsv,
+                  EstimatorFrame* trace_frame) override;
+    void describeTrace(EstimatorTrace& trace) const override;
+    void setQuality(const QualityLevel& level) override;
+    ComputeBackend backend() const override { return ComputeBackend::CPU; }
+
+private:
+    int binary_threshold;
+    int configured_count;   // for the full ROI
+    int threshold_count;
+};
+
+DifferenceEstimator::DifferenceEstimator(const AppConfig& config)
+    : binary_threshold(config.binary_threshold), configured_count(config.threshold_count),
+      threshold_count(config.threshold_count) {
+}
+
+void DifferenceEstimator::setQuality(const QualityLevel& level) {
+    threshold_count = static_cast<int>(std::lround(level.scaledArea(configured_count)));
+}
+
+void DifferenceEstimator::describeTrace(EstimatorTrace&) const {
+}
+
+void DifferenceEstimator::estimate(const cv::Mat&, const cv::Mat& gray, const cv::Mat& gray_previous,
+                                   const std::vector<EstimatorZone>& zones, std::vector<MotionEstimate>& estimates,
+                                   cv::Mat&, EstimatorFrame*) {
+    estimates.resize(zones.size());
+    for (size_t i = 0; i < zones.size(); ++i) {
+        bool changed = FrameDifference::hasChanged(gray(zones[i].rect), gray_previous(zones[i].rect),
+            binary_threshold, threshold_count);
+        estimates[i] = {changed ? EstimateKind::Difference : EstimateKind::Still, -1.0f, false};
+    }
+}
+
+}
+
+std::unique_ptr<MotionEstimator> createDifferenceEstimator(const AppConfig& config, ComputeBackend) {
+    return std::make_unique<DifferenceEstimator>(config);
+}
@@ -0,0 +1,129 @@
+#include <iostream>
+
+#include "motion_estimator.h"
+#include "../motion-detector/motion_detector.h"
+#include "../quality-governor/quality_governor.h"
+
+namespace {
+
+// Dense Inverse Search flow, a much cheaper dense flow than Farnebäck on the CPU. It uses the same foreground mask
+// and angle mode as Farnebäck. OpenCV parallelizes DIS internally, so CPUThreaded runs the CPU path. There is no
+// CUDA DIS, a CUDA device falls back to the CPU path with a warning.
+template <ComputeBackend Backend>
+class DISEstimator : public MotionEstimator {
+public:
+    explicit DISEstimator(const AppConfig& config);
+
+    void estimate(const cv::Mat& frame, const cv::Mat& gray, const cv::Mat& gray_previous,
+                  const std::vector<EstimatorZone>& zones, std::vector<MotionEstimate>& estimates, cv::Mat& hsv,
+                  EstimatorFrame* trace_frame) override;
+    void describeTrace(EstimatorTrace& trace) const override;
+    void setQuality(const QualityLevel& level) override { area_scale = level.scaledArea(1.0); }
+    // MOG2 models the background on the color frame, a gray one gives it other foreground
+    bool needsColor() const override { return true; }
+    ComputeBackend backend() const override { return Backend; }
+
+private:
+    AppConfig config;
+    double area_scale = 1.0;
+    cv::Ptr<cv::BackgroundSubtractor> back_sub;
+    cv::Ptr<cv::DISOpticalFlow> dis;
+    FlowBuffers buffers;
+    cv::UMat u_previous, u_current, u_flow, u_mag, u_ang;
+    std::vector<cv::UMat> u_flow_channels;
+};
+
+static int disPreset(const std::string& preset) {
+    if (preset == "ULTRAFAST") {
+        return cv::DISOpticalFlow::PRESET_ULTRAFAST;
+    }
+    if (preset == "MEDIUM") {
+        return cv::DISOpticalFlow::PRESET_MEDIUM;
+    }
+    if (preset != "FAST") {
+        std::cerr << "Warning: Unknown DIS preset " << preset << ", using FAST" << std::endl;
+    }
+    return cv::DISOpticalFlow::PRESET_FAST;
+}
+
+template <ComputeBackend Backend>
+DISEstimator<Backend>::DISEstimator(const AppConfig& config)
+    : config(config), back_sub(cv::createBackgroundSubtractorMOG2(500, 16, true)),
+      dis(cv::DISOpticalFlow::create(disPreset(config.dis_preset))) {
+    // Negative values keep the preset
+    if (config.dis_patch_size > 0) {
+        dis->setPatchSize(config.dis_patch_size);
+    }
+    if (config.dis_patch_stride > 0) {
+        dis->setPatchStride(config.dis_patch_stride);
+    }
+}
+
+template <ComputeBackend Backend>
+void DISEstimator<Backend>::describeTrace(EstimatorTrace& trace) const {
+    trace.min_magnitude = config.estimator_trace_min_magnitude;
+    trace.max_magnitude = 0.0f;
+}
+
+template <ComputeBackend Backend>
+void DISEstimator<Backend>::estimate(const cv::Mat& frame, const cv::Mat& gray, const cv::Mat& gray_previous,
+                                     const std::vector<EstimatorZone>& zones, std::vector<MotionEstimate>& estimates,
+                                     cv::Mat& hsv, EstimatorFrame* trace_frame) {
+    FlowEstimatorUtils::foregroundMask(*back_sub, frame, FOREGROUND_MAX_AREA * area_scale, 0, buffers);
+    FlowEstimatorUtils::maskFrames(gray_previous, gray, buffers);
+
+    if (config.debug) {
+        showDebug("Pedestrian Motion (DIS)", buffers.gray_filtered);
+    }
+
+    cv::Mat& mag = buffers.mag;
+    cv::Mat& ang = buffers.ang;
+    try {
+        if constexpr (Backend == ComputeBackend::OpenCL) {
+            buffers.gray_filtered_previous.copyTo(u_previous);
+            buffers.gray_filtered.copyTo(u_current);
+
+            dis->calc(u_previous, u_current, u_flow);
+
+            cv::split(u_flow, u_flow_channels);
+            cv::cartToPolar(u_flow_channels[0], u_flow_channels[1], u_mag, u_ang, true);
+
+            u_mag.copyTo(mag);
+            u_ang.copyTo(ang);
+        } else {
+            dis->calc(buffers.gray_filtered_previous, buffers.gray_filtered, buffers.flow);
+
+            cv::split(buffers.flow, buffers.flow_channels);
+            cv::cartToPolar(buffers.flow_channels[0], buffers.flow_channels[1], mag, ang, true);
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "DIS Optical Flow failed: " << e.what() << std::endl;
+        estimates.assign(zones.size(), {EstimateKind::None, -1.0f, false});
+        return;
+    }
+
+    if (trace_frame) {
+        FlowHistogramBuilder histogram(config.estimator_trace_min_magnitude, 0.0f);
+        histogram.addField(ang, mag);
+        histogram.finish(trace_frame->cells);
+    }
+
+    FlowEstimatorUtils::zoneFlowEstimates(mag, ang, zones, estimates, buffers.move_sense);
+
+    if (config.debug) {
+        for (const auto& estimate : estimates) {
+            std::cout << "DIS Mode: " << estimate.move_mode << std::endl;
+        }
+    }
+
+    FlowEstimatorUtils::drawFlow(ang, mag, hsv, buffers.hsv_channels);
+}
+
+}
+
+std::unique_ptr<MotionEstimator> createDISEstimator(const AppConfig& config, ComputeBackend backend) {
+    if (backend == ComputeBackend::OpenCL) {
+        return std::make_unique<DISEstimator<ComputeBackend::OpenCL>>(config);
+    }
+    return std::make_unique<DISEstimator<ComputeBackend::CPU>>(config);
+}
@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <iostream>
+#include <future>
+#include <thread>
+
+#ifdef HAVE_CUDA
+#include <opencv2/cudaoptflow.hpp>
+#include <opencv2/cudaarithm.hpp>
+#endif
+
+#include "motion_estimator.h"
+#include "../motion-detector/motion_detector.h"
+#include "../quality-governor/quality_governor.h"
+#include "../thread-pool/thread_pool.h"
+
+namespace {
+
+// Dense Farnebäck flow on the frame with large foreground blobs masked out. Each backend only differs in how the
+// polar flow field is computed, everything after it is shared. With flow_region_mode BLOBS the flow is only computed
+// around the remaining foreground blobs, so its cost follows the pedestrians instead of the ROI area.
+template <ComputeBackend Backend>
+class FarnebackEstimator : public MotionEstimator {
+public:
+    explicit FarnebackEstimator(const AppConfig& config);
+
+    void estimate(const cv::Mat& frame, const cv::Mat& gray, const cv::Mat& gray_previous,
+                  const std::vector<EstimatorZone>& zones, std::vector<MotionEstimate>& estimates, cv::Mat& hsv,
+                  EstimatorFrame* trace_frame) override;
+    void describeTrace(EstimatorTrace& trace) const override;
+    void setQuality(const QualityLevel& level) override;
+    // MOG2 models the background on the color frame, a gray one gives it other foreground
+    bool needsColor() const override { return true; }
+    ComputeBackend backend() const override { return Backend; }
+    const ThreadPool* threadPool() const override { return thread_pool.get(); }
+
+private:
+    AppConfig config;
+    cv::Ptr<cv::BackgroundSubtractor> back_sub;
+    FlowBuffers buffers;
+    cv::UMat u_previous, u_current, u_flow, u_mag, u_ang;
+    std::vector<cv::UMat> u_flow_channels;
+    bool blob_regions;
+    bool row_strips;
+    double area_scale = 1.0;   // of the quality governor step, the area limits are set for the full ROI
+
+    std::unique_ptr<ThreadPool> thread_pool;
+    std::vector<cv::Mat> flow_parts;
+
+#ifdef HAVE_CUDA
+    cv::Ptr<cv::cuda::FarnebackOpticalFlow> farneback;
+    cv::cuda::Stream stream;
+    cv::cuda::GpuMat d_gray_previous, d_gray, d_flow, d_mag, d_ang;
+    std::vector<cv::cuda::GpuMat> d_flow_channels;
+#endif
+
+    // Magnitude and angle in degrees of the flow from previous to current, false when the backend failed
+    bool calcPolarFlow(const cv::Mat& previous, const cv::Mat& current, cv::Mat& mag, cv::Mat& ang);
+    // Stripes of a frame, no more than the threads and each at least two windows wide, thinner ones lose the motion
+    // across their edges and leave nothing to compute on small ROIs
+    int stripCount(const cv::Size& size) const;
+    // Part i of the stripes, a column or a row stripe computed by one thread
+    cv::Rect stripRect(const cv::Size& size, int i, int stripes) const;
+    // Polar flow only inside the padded blob crops, zero everywhere else
+    bool calcBlobFlow(const cv::Mat& previous, const cv::Mat& current, const std::vector<cv::Rect>& blobs,
+                      cv::Mat& mag, cv::Mat& ang);
+};
+
+template <ComputeBackend Backend>
+FarnebackEstimator<Backend>::FarnebackEstimator(const AppConfig& config)
+    : config(config), back_sub(cv::createBackgroundSubtractorMOG2(500, 16, true)),
+      blob_regions(config.flow_region_mode == "BLOBS"), row_strips(config.flow_strips == "ROWS") {
+    if constexpr (Backend == ComputeBackend::CPUThreaded) {
+        if (this->config.thread_amount == -1) {
+            this->config.thread_amount = static_cast<int>(std::thread::hardware_concurrency());
+        }
+        thread_pool = std::make_unique<ThreadPool>(this->config.thread_amount);
+        flow_parts.resize(this->config.thread_amount);
+    }
+#ifdef HAVE_CUDA
+    if constexpr (Backend == ComputeBackend::CUDA) {
+        farneback = cv::cuda::FarnebackOpticalFlow::create(config.levels, config.pyr_scale, false, config.winsize,
+            config.iterations, config.poly_n, config.poly_sigma, 0);
+    }
+#endif
+}
+
+template <ComputeBackend Backend>
+void FarnebackEstimator<Backend>::setQuality(const QualityLevel& level) {
+    config.levels = level.levels;
+    config.iterations = level.iterations;
+    config.winsize = level.winsize;
+    area_scale = level.scaledArea(1.0);
+#ifdef HAVE_CUDA
+    if constexpr (Backend == ComputeBackend::CUDA) {
+        farneback->setNumLevels(level.levels);
+        farneback->setNumIters(level.iterations);
+        farneback->setWinSize(level.winsize);
+    }
+#endif
+}
+
+template <ComputeBackend Backend>
+void FarnebackEstimator<Backend>::describeTrace(EstimatorTrace& trace) const {
+    trace.min_magnitude = config.estimator_trace_min_magnitude;
+    trace.max_magnitude = 0.0f;
+}
+
+template <ComputeBackend Backend>
+bool FarnebackEstimator<Backend>::calcPolarFlow(const cv::Mat& previous, const cv::Mat& current, cv::Mat& mag,
+                                                cv::Mat& ang) {
+    if constexpr (Backend == ComputeBackend::CUDA) {
+#ifdef HAVE_CUDA
+        try {
+            d_gray.upload(current, stream);
+            d_gray_previous.upload(previous, stream);
+
+            farneback->calc(d_gray_previous, d_gray, d_flow, stream);
+
+            cv::cuda::split(d_flow, d_flow_channels, stream);
+            cv::cuda::cartToPolar(d_flow_channels[0], d_flow_channels[1], d_mag, d_ang, true, stream);
+
+            d_mag.download(mag, stream);
+            d_ang.download(ang, stream);
+            stream.waitForCompletion();
+        }
+        catch (const cv::Exception& e) {
+            std::cerr << "CUDA Optical Flow failed: " << e.what() << std::endl;
+            return false;
+        }
+#endif
+    } else if constexpr (Backend == ComputeBackend::OpenCL) {
+        try {
+            previous.copyTo(u_previous);
+            current.copyTo(u_current);
+
+            cv::calcOpticalFlowFarneback(u_previous, u_current, u_flow, config.pyr_scale, config.levels,
+                config.winsize, config.iterations, config.poly_n, config.poly_sigma, 0);
+
+            cv::split(u_flow, u_flow_channels);
+            cv::cartToPolar(u_flow_channels[0], u_flow_channels[1], u_mag, u_ang, true);
+
+            u_mag.copyTo(mag);
+            u_ang.copyTo(ang);
+        } catch (const cv::Exception& e) {
+            std::cerr << "OpenCL Optical Flow failed: " << e.what() << std::endl;
+            return false;
+        }
+    } else {
+        cv::Mat& flow = buffers.flow;
+        flow.create(current.size(), CV_32FC2);
+
+        if constexpr (Backend == ComputeBackend::CPUThreaded) {
+            // Stripes are computed independently and stitched back together
+            std::vector<std::future<void>> futures;
+            int stripes = stripCount(current.size());
+
+            for (int i = 0; i < stripes; i++) {
+                cv::Rect strip = stripRect(current.size(), i, stripes);
+                cv::Mat current_section = current(strip);
+                cv::Mat previous_section = previous(strip);
+
+                futures.push_back(thread_pool->enqueue([this, i, current_section, previous_section]() {
+                    cv::calcOpticalFlowFarneback(previous_section, current_section, flow_parts[i], config.pyr_scale,
+                        config.levels, config.winsize, config.iterations, config.poly_n, config.poly_sigma, 0);
+                }));
+            }
+
+            for (auto& future : futures) {
+                future.get();
+            }
+
+            for (int i = 0; i < stripes; i++) {
+                flow_parts[i].copyTo(flow(stripRect(current.size(), i, stripes)));
+            }
+        } else {
+            cv::calcOpticalFlowFarneback(previous, current, flow, config.pyr_scale, config.levels, config.winsize,
+                config.iterations, config.poly_n, config.poly_sigma, 0);
+        }
+
+        cv::split(flow, buffers.flow_channels);
+        cv::cartToPolar(buffers.flow_channels[0], buffers.flow_channels[1], mag, ang, true);
+    }
+    return true;
+}
+
+template <ComputeBackend Backend>
+int FarnebackEstimator<Backend>::stripCount(const cv::Size& size) const {
+    int length = row_strips ? size.height : size.width;
+    int widest = length / std::max(1, 2 * config.winsize);
+    return std::max(1, std::min(config.thread_amount, widest));
+}
+
+template <ComputeBackend Backend>
+cv::Rect FarnebackEstimator<Backend>::stripRect(const cv::Size& size, int i, int stripes) const {
+    // Row stripes are contiguous in memory, column stripes keep the vertical motion of a pedestrian in one stripe
+    int length = row_strips ? size.height : size.width;
+    int per_thread = length / stripes;
+    int start = i * per_thread;
+    int end = (i == stripes - 1) ? length : start + per_thread;
+    return row_strips ? cv::Rect(0, start, size.width, end - start) : cv::Rect(start, 0, end - start, size.height);
+}
+
+template <ComputeBackend Backend>
+bool FarnebackEstimator<Backend>::calcBlobFlow(const cv::Mat& previous, const cv::Mat& current,
+                                               const std::vector<cv::Rect>& blobs, cv::Mat& mag, cv::Mat& ang) {
+    mag.create(current.size(), CV_32F);
+    mag.setTo(cv::Scalar(0));
+    ang.create(current.size(), CV_32F);
+    ang.setTo(cv::Scalar(0));
+
+    std::vector<cv::Rect> crops = FlowEstimatorUtils::blobCrops(blobs, config.flow_region_padding, current.size());
+
+    if constexpr (Backend == ComputeBackend::CPUThreaded) {
+        // Merged crops do not overlap, so every task writes its own part of mag and ang
+        std::vector<std::future<void>> futures;
+        for (const auto& crop : crops) {
+            cv::Mat crop_mag = mag(crop), crop_ang = ang(crop);
+            futures.push_back(thread_pool->enqueue([this, crop, &previous, &current, crop_mag, crop_ang]() mutable {
+                cv::Mat crop_flow;
+                cv::calcOpticalFlowFarneback(previous(crop), current(crop), crop_flow, config.pyr_scale,
+                    config.levels, config.winsize, config.iterations, config.poly_n, config.poly_sigma, 0);
+
+                cv::Mat flow_channels[2];
+                cv::split(crop_flow, flow_channels);
+                cv::cartToPolar(flow_channels[0], flow_channels[1], crop_mag, crop_ang, true);
+            }));
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+    } else {
+        for (const auto& crop : crops) {
+            cv::Mat crop_mag, crop_ang;
+            if (!calcPolarFlow(previous(crop), current(crop), crop_mag, crop_ang)) {
+                return false;
+            }
+            crop_mag.copyTo(mag(crop));
+            crop_ang.copyTo(ang(crop));
+        }
+    }
+    return true;
+}
+
+template <ComputeBackend Backend>
+void FarnebackEstimator<Backend>::estimate(const cv::Mat& frame, const cv::Mat& gray, const cv::Mat& gray_previous,
+                                           const std::vector<EstimatorZone>& zones,
+                                           std::vector<MotionEstimate>& estimates, cv::Mat& hsv,
+                                           EstimatorFrame* trace_frame) {
+    FlowEstimatorUtils::foregroundMask(*back_sub, frame, FOREGROUND_MAX_AREA * area_scale, 0, buffers, blob_regions,
+        config.flow_region_min_area * area_scale);
+    FlowEstimatorUtils::maskFrames(gray_previous, gray, buffers);
+
+    if (config.debug) {
+        showDebug("Pedestrian Motion (Farnebäck)", buffers.gray_filtered);
+    }
+
+    cv::Mat& mag = buffers.mag;
+    cv::Mat& ang = buffers.ang;
+    bool computed = blob_regions
+        ? calcBlobFlow(buffers.gray_filtered_previous, buffers.gray_filtered, buffers.blobs, mag, ang)
+        : calcPolarFlow(buffers.gray_filtered_previous, buffers.gray_filtered, mag, ang);
+    if (!computed) {
+        estimates.assign(zones.size(), {EstimateKind::None, -1.0f, false});
+        return;
+    }
+
+    if (trace_frame) {
+        FlowHistogramBuilder histogram(config.estimator_trace_min_magnitude, 0.0f);
+        histogram.addField(ang, mag);
+        histogram.finish(trace_frame->cells);
+    }
+
+    FlowEstimatorUtils::zoneFlowEstimates(mag, ang, zones, estimates, buffers.move_sense);
+
+    if (config.debug) {
+        for (const auto& estimate : estimates) {
+            std::cout << estimate.move_mode << std::endl;
+        }
+    }
+
+    FlowEstimatorUtils::drawFlow(ang, mag, hsv, buffers.hsv_channels);
+}
+
+}
+
+std::unique_ptr<MotionEstimator> createFarnebackEstimator(const AppConfig& config, ComputeBackend backend) {
+    switch (backend) {
+#ifdef HAVE_CUDA
+        case ComputeBackend::CUDA:
+            return std::make_unique<FarnebackEstimator<ComputeBackend::CUDA>>(config);
+#endif
+        case ComputeBackend::OpenCL:
+            return std::make_unique<FarnebackEstimator<ComputeBackend::OpenCL>>(config);
+        case ComputeBackend::CPUThreaded:
+            return std::make_unique<FarnebackEstimator<ComputeBackend::CPUThreaded>>(config);
+        default:
+            return std::make_unique<FarnebackEstimator<ComputeBackend::CPU>>(config);
+    }
+}
@@ -0,0 +1,223 @@
+#include <iostream>
+#include <cmath>
+
+#ifdef HAVE_CUDA
+#include <opencv2/cudaoptflow.hpp>
+#endif
+
+#include "motion_estimator.h"
+#include "../motion-detector/motion_detector.h"
+#include "../quality-governor/quality_governor.h"
+#include "../utils/motion_utils.h"
+
+namespace {
+
+// Only flow vectors slower than this are typical of pedestrians
+constexpr float LK_MAX_MAGNITUDE = 10.0f;
+
+// Sparse pyramidal Lucas-Kanade on corners of the previous frame. Tall or large foreground blobs are masked out
+// first, there is no multi-threaded variant so CPUThreaded runs the CPU path.
+template <ComputeBackend Backend>
+class LucasKanadeEstimator : public MotionEstimator {
+public:
+    explicit LucasKanadeEstimator(const AppConfig& config);
+
+    void estimate(const cv::Mat& frame, const cv::Mat& gray, const cv::Mat& gray_previous,
+                  const std::vector<EstimatorZone>& zones, std::vector<MotionEstimate>& estimates, cv::Mat& hsv,
+                  EstimatorFrame* trace_frame) override;
+    void describeTrace(EstimatorTrace& trace) const override;
+    void setQuality(const QualityLevel& level) override {
+        config.max_corners = level.max_corners;
+        area_scale = level.scaledArea(1.0);
+        max_magnitude = static_cast<float>(level.scaledMagnitude(LK_MAX_MAGNITUDE));
+    }
+    // MOG2 models the background on the color frame, a gray one gives it other foreground
+    bool needsColor() const override { return true; }
+    ComputeBackend backend() const override { return Backend; }
+
+private:
+    AppConfig config;
+    double area_scale = 1.0;
+    float max_magnitude = LK_MAX_MAGNITUDE;   // of the quality governor step, with its scale and stride
+    cv::Ptr<cv::BackgroundSubtractor> back_sub;
+    FlowBuffers buffers;
+    std::vector<cv::Point2f> prev_pts, curr_pts;
+    std::vector<uchar> status;
+    std::vector<float> err;
+    std::vector<std::vector<float>> zone_move_sense;
+    cv::UMat u_gray_previous, u_gray;
+
+#ifdef HAVE_CUDA
+    cv::Ptr<cv::cuda::SparsePyrLKOpticalFlow> lk;
+    cv::cuda::GpuMat d_gray_previous, d_gray, d_prev_pts, d_curr_pts, d_status;
+#endif
+
+    // Tracks corners of previous into current, prev_pts stays empty when there is nothing to track
+    void track(const cv::Mat& previous, const cv::Mat& current, const cv::Mat& current_unfiltered);
+};
+
+template <ComputeBackend Backend>
+LucasKanadeEstimator<Backend>::LucasKanadeEstimator(const AppConfig& config)
+    : config(config), back_sub(cv::createBackgroundSubtractorMOG2(500, 16, true)) {
+#ifdef HAVE_CUDA
+    if constexpr (Backend == ComputeBackend::CUDA) {
+        lk = cv::cuda::SparsePyrLKOpticalFlow::create();
+    }
+#endif
+}
+
+template <ComputeBackend Backend>
+void LucasKanadeEstimator<Backend>::describeTrace(EstimatorTrace& trace) const {
+    trace.min_magnitude = config.estimator_trace_min_magnitude;
+    trace.max_magnitude = LK_MAX_MAGNITUDE;
+}
+
+template <ComputeBackend Backend>
+void LucasKanadeEstimator<Backend>::track(const cv::Mat& previous, const cv::Mat& current,
+                                          const cv::Mat& current_unfiltered) {
+    if constexpr (Backend == ComputeBackend::OpenCL) {
+        previous.copyTo(u_gray_previous);
+        current.copyTo(u_gray);
+
+        cv::goodFeaturesToTrack(u_gray_previous, prev_pts, config.max_corners, config.quality_level,
+            config.min_distance, cv::Mat(), 7, false, 0.04);
+        if (prev_pts.empty()) {
+            return;
+        }
+        cv::calcOpticalFlowPyrLK(u_gray_previous, u_gray, prev_pts, curr_pts, status, err);
+        return;
+    }
+
+    cv::goodFeaturesToTrack(previous, prev_pts, config.max_corners, config.quality_level, config.min_distance,
+        cv::Mat(), 7, false, 0.04);
+    if (prev_pts.empty()) {
+        return;
+    }
+
+    if constexpr (Backend == ComputeBackend::CUDA) {
+#ifdef HAVE_CUDA
+        d_prev_pts.upload(cv::Mat(prev_pts).reshape(2, 1));
+        d_gray_previous.upload(previous);
+        d_gray.upload(current);
+
+        lk->calc(d_gray_previous, d_gray, d_prev_pts, d_curr_pts, d_status);
+
+        cv::Mat h_curr_pts, h_status;
+        d_curr_pts.download(h_curr_pts);
+        d_status.download(h_status);
+
+        curr_pts.resize(prev_pts.size());
+        status.resize(prev_pts.size());
+        for (size_t i = 0; i < prev_pts.size(); ++i) {
+            status[i] = h_status.at<uchar>(static_cast<int>(i)) ? 1 : 0;
+            if (status[i]) {
+                curr_pts[i] = h_curr_pts.at<cv::Point2f>(static_cast<int>(i));
+            }
+        }
+#endif
+    } else {
+        // The CPU path tracks into the unfiltered frame
+        cv::calcOpticalFlowPyrLK(previous, current_unfiltered, prev_pts, curr_pts, status, err);
+    }
+}
+
+template <ComputeBackend Backend>
+void LucasKanadeEstimator<Backend>::estimate(const cv::Mat& frame, const cv::Mat& gray, const cv::Mat& gray_previous,
+                                             const std::vector<EstimatorZone>& zones,
+                                             std::vector<MotionEstimate>& estimates, cv::Mat& hsv,
+                                             EstimatorFrame* trace_frame) {
+    FlowEstimatorUtils::foregroundMask(*back_sub, frame, FOREGROUND_MAX_AREA * area_scale, 2.5, buffers);
+    FlowEstimatorUtils::maskFrames(gray_previous, gray, buffers);
+
+    if (config.debug) {
+        showDebug("Pedestrian Motion (LK)", buffers.gray_filtered);
+    }
+
+    track(buffers.gray_filtered_previous, buffers.gray_filtered, gray);
+
+    if (prev_pts.empty()) {
+        estimates.assign(zones.size(), {EstimateKind::Still, -1.0f, false});
+        return;
+    }
+
+    // Each tracked corner counts for the zones it starts in
+    zone_move_sense.resize(zones.size());
+    for (auto& move_sense : zone_move_sense) {
+        move_sense.clear();
+    }
+    FlowHistogramBuilder histogram(config.estimator_trace_min_magnitude, LK_MAX_MAGNITUDE);
+
+    // Sparse angle and magnitude maps, only used to draw the flow
+    cv::Mat& ang_map = buffers.ang;
+    cv::Mat& mag_map = buffers.mag;
+    ang_map.create(frame.size(), CV_32F);
+    ang_map.setTo(cv::Scalar(0));
+    mag_map.create(frame.size(), CV_32F);
+    mag_map.setTo(cv::Scalar(0));
+
+    for (size_t i = 0; i < status.size(); ++i) {
+        if (status[i]) {
+            float dx = curr_pts[i].x - prev_pts[i].x;
+            float dy = curr_pts[i].y - prev_pts[i].y;
+            float magnitude = std::sqrt(dx * dx + dy * dy);
+            float angle = std::atan2(dy, dx) * 180.0f / CV_PI;
+            if (angle < 0) angle += 360.0f;
+
+            if (trace_frame) {
+                histogram.add(angle, magnitude);
+            }
+
+            for (size_t z = 0; z < zones.size(); ++z) {
+                if (zones[z].rect.contains(prev_pts[i]) && magnitude > zones[z].threshold &&
+                    magnitude < max_magnitude) {
+                    zone_move_sense[z].push_back(angle);
+                }
+            }
+
+            ang_map.at<float>(prev_pts[i]) = angle;
+            mag_map.at<float>(prev_pts[i]) = magnitude;
+        }
+    }
+
+    if (trace_frame) {
+        histogram.finish(trace_frame->cells);
+    }
+
+    estimates.resize(zones.size());
+    for (size_t z = 0; z < zones.size(); ++z) {
+        float move_mode = MotionUtils::calculateMode(zone_move_sense[z]);
+        estimates[z] = {EstimateKind::Flow, move_mode, false};
+
+        if (config.debug) {
+            std::cout << "LK Mode: " << move_mode << std::endl;
+        }
+    }
+
+    FlowEstimatorUtils::drawFlow(ang_map, mag_map, hsv, buffers.hsv_channels);
+
+    if (config.debug) {
+        cv::Mat output_frame = frame.clone();
+        for (size_t i = 0; i < status.size(); ++i) {
+            if (status[i]) {
+                cv::line(output_frame, prev_pts[i], curr_pts[i], cv::Scalar(0, 255, 0), 2);
+                cv::circle(output_frame, curr_pts[i], 3, cv::Scalar(0, 0, 255), -1);
+            }
+        }
+        showDebug("LK Optical Flow", output_frame);
+    }
+}
+
+}
+
+std::unique_ptr<MotionEstimator> createLucasKanadeEstimator(const AppConfig& config, ComputeBackend backend) {
+    switch (backend) {
+#ifdef HAVE_CUDA
+        case ComputeBackend::CUDA:
+            return std::make_unique<LucasKanadeEstimator<ComputeBackend::CUDA>>(config);
+#endif
+        case ComputeBackend::OpenCL:
+            return std::make_unique<LucasKanadeEstimator<ComputeBackend::OpenCL>>(config);
+        default:
+            return std::make_unique<LucasKanadeEstimator<ComputeBackend::CPU>>(config);
+    }
+}
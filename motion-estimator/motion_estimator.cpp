@@ -0,0 +1,193 @@
+#include <iostream>
+#include <opencv2/core/ocl.hpp>
+
+#include "motion_estimator.h"
+#include "../motion-detector/motion_detector.h"
+#include "../utils/motion_utils.h"
+
+void MotionEstimator::showDebug(const std::string& name, const cv::Mat& image) {
+    for (auto& view : debug_views) {
+        if (view.name == name) {
+            image.copyTo(view.image);
+            return;
+        }
+    }
+    debug_views.push_back({name, image.clone()});
+}
+
+ComputeBackend resolveComputeBackend(const AppConfig& config) {
+    if (config.use_gpu) {
+#ifdef HAVE_CUDA
+        if (cv::cuda::getCudaEnabledDeviceCount() > 0) {
+            return ComputeBackend::CUDA;
+        }
+#endif
+        if (cv::ocl::haveOpenCL()) {
+            return ComputeBackend::OpenCL;
+        }
+    }
+    return config.use_multi_thread ? ComputeBackend::CPUThreaded : ComputeBackend::CPU;
+}
+
+std::string computeBackendName(ComputeBackend backend) {
+    switch (backend) {
+        case ComputeBackend::CPU: return "CPU";
+        case ComputeBackend::CPUThreaded: return "CPU (multi-threaded)";
+        case ComputeBackend::OpenCL: return "OpenCL";
+        case ComputeBackend::CUDA: return "CUDA";
+    }
+    return "";
+}
+
+std::unique_ptr<MotionEstimator> createMotionEstimator(const AppConfig& config) {
+    ComputeBackend backend = resolveComputeBackend(config);
+
+    // The transparent API is global, only the OpenCL backend may use it
+    cv::ocl::setUseOpenCL(backend == ComputeBackend::OpenCL);
+    if (backend == ComputeBackend::OpenCL && !cv::ocl::useOpenCL()) {
+        std::cout << "OpenCL is available, but not in use." << std::endl;
+    }
+
+    std::unique_ptr<MotionEstimator> estimator;
+    if (config.algorithm == "FARNE") {
+        estimator = createFarnebackEstimator(config, backend);
+    } else if (config.algorithm == "LK") {
+        estimator = createLucasKanadeEstimator(config, backend);
+    } else if (config.algorithm == "DIS") {
+        estimator = createDISEstimator(config, backend);
+    } else if (config.algorithm == "DIFF") {
+        estimator = createDifferenceEstimator(config, backend);
+    } else if (config.algorithm == "YOLO") {
+        estimator = createYOLOEstimator(config, backend);
+    } else {
+        std::cerr << "Error: Unknown algorithm " << config.algorithm << std::endl;
+        return nullptr;
+    }
+    if (!estimator) {
+        return nullptr;
+    }
+
+    // Estimators without a GPU path run on the CPU, the log names the backend that actually does the work
+    if (estimator->backend() != backend &&
+        (backend == ComputeBackend::CUDA || backend == ComputeBackend::OpenCL)) {
+        std::cerr << "Warning: " << config.algorithm << " has no " << computeBackendName(backend)
+                  << " backend, falling back to " << computeBackendName(estimator->backend()) << std::endl;
+    }
+    std::cout << config.algorithm << " motion estimation on " << computeBackendName(estimator->backend()) << std::endl;
+    return estimator;
+}
+
+void FlowEstimatorUtils::foregroundMask(cv::BackgroundSubtractor& back_sub, const cv::Mat& frame, double max_area,
+                                        double max_aspect_ratio, FlowBuffers& buffers, bool collect_blobs,
+                                        double min_blob_area) {
+    static const cv::Mat open_kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
+
+    back_sub.apply(frame, buffers.fg_mask);
+
+    cv::morphologyEx(buffers.fg_mask, buffers.fg_mask, cv::MORPH_OPEN, open_kernel);
+    cv::findContours(buffers.fg_mask, buffers.contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+    buffers.motion_mask.create(frame.size(), CV_8UC1);
+    buffers.motion_mask.setTo(cv::Scalar(255));
+    buffers.blobs.clear();
+    for (const auto& contour : buffers.contours) {
+        double area = cv::contourArea(contour);
+        cv::Rect bound = cv::boundingRect(contour);
+        double aspectRatio = static_cast<double>(bound.height) / bound.width;
+
+        if (area > max_area || (max_aspect_ratio > 0 && aspectRatio > max_aspect_ratio)) {
+            cv::rectangle(buffers.motion_mask, bound, cv::Scalar(0), cv::FILLED);
+        } else if (collect_blobs && area >= min_blob_area) {
+            buffers.blobs.push_back(bound);
+        }
+    }
+}
+
+void FlowEstimatorUtils::maskFrames(const cv::Mat& gray_previous, const cv::Mat& gray, FlowBuffers& buffers) {
+    // A masked copy leaves the pixels outside the mask alone, the reused buffers still hold the last frame there
+    buffers.gray_filtered_previous.create(gray_previous.size(), gray_previous.type());
+    buffers.gray_filtered_previous.setTo(cv::Scalar(0));
+    gray_previous.copyTo(buffers.gray_filtered_previous, buffers.motion_mask);
+
+    buffers.gray_filtered.create(gray.size(), gray.type());
+    buffers.gray_filtered.setTo(cv::Scalar(0));
+    gray.copyTo(buffers.gray_filtered, buffers.motion_mask);
+}
+
+std::vector<cv::Rect> FlowEstimatorUtils::blobCrops(const std::vector<cv::Rect>& blobs, int padding,
+                                                    const cv::Size& frame_size) {
+    cv::Rect frame_rect(cv::Point(), frame_size);
+
+    std::vector<cv::Rect> crops;
+    for (const auto& blob : blobs) {
+        cv::Rect crop = cv::Rect(blob.x - padding, blob.y - padding, blob.width + 2 * padding,
+                                 blob.height + 2 * padding) & frame_rect;
+        if (!crop.empty()) {
+            crops.push_back(crop);
+        }
+    }
+
+    // A merged crop can reach crops it did not overlap before, so merging repeats until nothing changes
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < crops.size() && !merged; ++i) {
+            for (size_t j = i + 1; j < crops.size(); ++j) {
+                if ((crops[i] & crops[j]).area() > 0) {
+                    crops[i] |= crops[j];
+                    crops.erase(crops.begin() + static_cast<std::ptrdiff_t>(j));
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+    return crops;
+}
+
+void FlowEstimatorUtils::zoneFlowEstimates(const cv::Mat& mag, const cv::Mat& ang,
+                                           const std::vector<EstimatorZone>& zones,
+                                           std::vector<MotionEstimate>& estimates,
+                                           std::vector<float>& move_sense) {
+    CV_Assert(mag.type() == CV_32F && ang.type() == CV_32F && mag.size() == ang.size());
+
+    // Angles of the zone pixels above the zone threshold, in row major order
+    estimates.resize(zones.size());
+    for (size_t i = 0; i < zones.size(); ++i) {
+        const cv::Rect& rect = zones[i].rect;
+        move_sense.clear();
+        for (int y = rect.y; y < rect.y + rect.height; ++y) {
+            const float* mag_row = mag.ptr<float>(y);
+            const float* ang_row = ang.ptr<float>(y);
+            for (int x = rect.x; x < rect.x + rect.width; ++x) {
+                if (mag_row[x] > zones[i].threshold) {
+                    move_sense.push_back(ang_row[x]);
+                }
+            }
+        }
+        estimates[i] = {EstimateKind::Flow, MotionUtils::calculateMode(move_sense), false};
+    }
+}
+
+void FlowEstimatorUtils::drawFlow(const cv::Mat& ang, const cv::Mat& mag, cv::Mat& hsv,
+                                  std::vector<cv::Mat>& hsv_channels) {
+    if (hsv.empty() || hsv.type() != CV_8UC3) {
+        hsv = cv::Mat(ang.size(), CV_8UC3, cv::Scalar(0, 255, 0));
+    }
+
+    cv::split(hsv, hsv_channels);
+
+    // Flow fields smaller than the drawn frame come from scaled estimators, they are stretched to it
+    if (ang.size() == hsv.size()) {
+        ang.convertTo(hsv_channels[0], CV_8U, 0.5);
+        cv::normalize(mag, hsv_channels[2], 0, 255, cv::NORM_MINMAX, CV_8U);
+    } else {
+        cv::Mat hue, value;
+        cv::resize(ang, hue, hsv.size());
+        cv::resize(mag, value, hsv.size());
+        hue.convertTo(hsv_channels[0], CV_8U, 0.5);
+        cv::normalize(value, hsv_channels[2], 0, 255, cv::NORM_MINMAX, CV_8U);
+    }
+
+    cv::merge(hsv_channels, hsv);
+}
@@ -0,0 +1,144 @@
+#ifndef MOTION_ESTIMATOR_H
+#define MOTION_ESTIMATOR_H
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+
+#include "../replay/estimator_trace.h"
+
+struct AppConfig;
+struct QualityLevel;
+class ThreadPool;
+
+// Where an estimator runs. It is resolved once from use_gpu, use_multi_thread and the devices that are present,
+// the estimators are specialized on it so the per frame code has no backend checks.
+enum class ComputeBackend {
+    CPU,
+    CPUThreaded,
+    OpenCL,
+    CUDA
+};
+
+// How the decision layer should read an estimate
+enum class EstimateKind {
+    None,         // the estimator failed, the frame does not vote
+    Flow,         // move_mode is the mode of the flow angles, NaN without motion
+    Detections,   // move_mode is the mean angle of the matched person boxes
+    Difference,   // the frame changed without measurable motion, it votes difference
+    Still         // nothing to track or nothing changed, the frame votes waiting
+};
+
+struct MotionEstimate {
+    EstimateKind kind;
+    float move_mode;
+    bool has_detections;
+};
+
+// Part of the estimated frame that gets its own estimate
+struct EstimatorZone {
+    cv::Rect rect;       // inside the frame passed to estimate
+    double threshold;    // flow magnitude threshold
+};
+
+// Image an estimator shows in debug mode. It is drawn by the render thread, the estimator only keeps a copy.
+struct DebugView {
+    std::string name;
+    cv::Mat image;
+};
+
+// Turns two consecutive frames into a motion estimate. Implementations keep their own state (background model,
+// device buffers, network) and must not depend on anything in MotionDetector, new algorithms only need a factory
+// entry in createMotionEstimator.
+class MotionEstimator {
+public:
+    virtual ~MotionEstimator() = default;
+
+    // frame is the color ROI, gray and gray_previous its gray versions. The motion is computed once over the whole
+    // frame and split into one estimate per zone. The flow is drawn into hsv, and the raw estimator output of the
+    // whole frame is recorded into trace_frame when it is set.
+    virtual void estimate(const cv::Mat& frame, const cv::Mat& gray, const cv::Mat& gray_previous,
+                          const std::vector<EstimatorZone>& zones, std::vector<MotionEstimate>& estimates,
+                          cv::Mat& hsv, EstimatorFrame* trace_frame) = 0;
+
+    // Fills the recording limits of an estimator trace
+    virtual void describeTrace(EstimatorTrace& trace) const = 0;
+
+    // True when the estimator needs color frames, gray frame caches and gray pushed frames are not used then. Every
+    // estimator that builds a MOG2 foreground mask does, only frame differencing works on gray alone.
+    virtual bool needsColor() const { return false; }
+
+    virtual ComputeBackend backend() const = 0;
+
+    // Applies the settings of a quality governor step, the scale and the stride are handled by the detector.
+    // Pixel count and area limits follow the scale. A scale change gives the estimator frames of another size, so
+    // MOG2 starts its background model over and trackers lose their points.
+    virtual void setQuality(const QualityLevel&) {}
+
+    // Pool the estimator splits its frames over, nullptr when it runs on the calling thread
+    virtual const ThreadPool* threadPool() const { return nullptr; }
+
+    // Debug images of the last frame, only filled in debug mode
+    const std::vector<DebugView>& debugViews() const { return debug_views; }
+
+protected:
+    // Copies image into the debug view called name, the copy reuses the buffer of the previous frame
+    void showDebug(const std::string& name, const cv::Mat& image);
+
+    std::vector<DebugView> debug_views;
+};
+
+ComputeBackend resolveComputeBackend(const AppConfig& config);
+std::string computeBackendName(ComputeBackend backend);
+
+// Estimator for config.algorithm on the resolved backend, nullptr for an unknown algorithm
+std::unique_ptr<MotionEstimator> createMotionEstimator(const AppConfig& config);
+
+// Per algorithm factories, each defined next to its estimator
+std::unique_ptr<MotionEstimator> createFarnebackEstimator(const AppConfig& config, ComputeBackend backend);
+std::unique_ptr<MotionEstimator> createDifferenceEstimator(const AppConfig& config, ComputeBackend backend);
+std::unique_ptr<MotionEstimator> createDISEstimator(const AppConfig& config, ComputeBackend backend);
+std::unique_ptr<MotionEstimator> createLucasKanadeEstimator(const AppConfig& config, ComputeBackend backend);
+std::unique_ptr<MotionEstimator> createYOLOEstimator(const AppConfig& config, ComputeBackend backend);
+
+// Per frame working buffers of a flow estimator. Estimators keep one as a member, so frames of the same ROI size
+// reuse the allocations of the previous frame, OpenCV outputs are only reallocated when their size or type changes.
+struct FlowBuffers {
+    cv::Mat fg_mask;
+    cv::Mat motion_mask;
+    cv::Mat gray_filtered_previous;
+    cv::Mat gray_filtered;
+    cv::Mat flow;
+    cv::Mat flow_channels[2];
+    cv::Mat mag;
+    cv::Mat ang;
+    std::vector<cv::Mat> hsv_channels;
+    std::vector<std::vector<cv::Point>> contours;
+    std::vector<cv::Rect> blobs;
+    std::vector<float> move_sense;
+};
+
+// Foreground blobs with a larger area in pixels of the full ROI are vehicles or lighting changes, not pedestrians
+constexpr double FOREGROUND_MAX_AREA = 12000.0;
+
+// Helpers shared by the flow estimators
+class FlowEstimatorUtils {
+public:
+    // buffers.motion_mask hides foreground blobs larger than max_area or taller than max_aspect_ratio (0 disables
+    // it). With collect_blobs the bounding boxes of the remaining blobs of at least min_blob_area go to buffers.blobs.
+    static void foregroundMask(cv::BackgroundSubtractor& back_sub, const cv::Mat& frame, double max_area,
+                               double max_aspect_ratio, FlowBuffers& buffers, bool collect_blobs = false,
+                               double min_blob_area = 0);
+    // buffers.gray_filtered_previous and buffers.gray_filtered, the frames with everything outside the motion mask
+    // set to zero
+    static void maskFrames(const cv::Mat& gray_previous, const cv::Mat& gray, FlowBuffers& buffers);
+    // Blob boxes grown by padding and clipped to frame_size, overlapping crops are merged until none overlap
+    static std::vector<cv::Rect> blobCrops(const std::vector<cv::Rect>& blobs, int padding, const cv::Size& frame_size);
+    // One flow estimate per zone, the mode of the angles of the zone pixels above the zone threshold
+    static void zoneFlowEstimates(const cv::Mat& mag, const cv::Mat& ang, const std::vector<EstimatorZone>& zones,
+                                  std::vector<MotionEstimate>& estimates, std::vector<float>& move_sense);
+    // Hue from the half angle in degrees and value from the normalized magnitude
+    static void drawFlow(const cv::Mat& ang, const cv::Mat& mag, cv::Mat& hsv, std::vector<cv::Mat>& hsv_channels);
+};
+
+#endif //MOTION_ESTIMATOR_H
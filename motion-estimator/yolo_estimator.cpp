@@ -0,0 +1,274 @@
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+#include "motion_estimator.h"
+#include "../benchmark/benchmark.h"
+#include "../motion-detector/motion_detector.h"
+#include "../quality-governor/quality_governor.h"
+#include "../utils/mapped_file.h"
+
+namespace {
+
+// Read-only mapping of a model file shared by every estimator of the process. Parallel sweep and segment
+// detectors load the same weights, they read them from the page cache instead of each reading its own copy. Only
+// the file is shared, readNetFromDarknet still copies the weights into the layers of every network.
+std::shared_ptr<const MappedFile> sharedModelFile(const std::string& path) {
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<const MappedFile>> files;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const MappedFile> file = files[path].lock();
+    if (file) {
+        return file;
+    }
+
+    auto mapped = std::make_shared<MappedFile>();
+    if (!mapped->open(path)) {
+        std::cerr << "Error: Could not map model file " << path << std::endl;
+        return nullptr;
+    }
+    files[path] = mapped;
+    return mapped;
+}
+
+// Person detection with YOLOv4, the motion is the mean displacement angle of boxes matched between frames.
+// The backend only selects the DNN target, so the estimator is not specialized on it.
+class YOLOEstimator : public MotionEstimator {
+public:
+    YOLOEstimator(const AppConfig& config, ComputeBackend backend);
+
+    void estimate(const cv::Mat& frame, const cv::Mat& gray, const cv::Mat& gray_previous,
+                  const std::vector<EstimatorZone>& zones, std::vector<MotionEstimate>& estimates, cv::Mat& hsv,
+                  EstimatorFrame* trace_frame) override;
+    void describeTrace(EstimatorTrace& trace) const override;
+    bool needsColor() const override { return true; }
+    // A smaller input only changes the blob, the network is resized on the next forward pass
+    void setQuality(const QualityLevel& level) override { config.yolo_input_size = level.yolo_input_size; }
+    ComputeBackend backend() const override { return compute_backend; }
+    bool initialized() const { return yolo_initialized; }
+
+private:
+    AppConfig config;
+    ComputeBackend compute_backend;
+
+    std::shared_ptr<const MappedFile> weights;
+    std::shared_ptr<const MappedFile> network_config;
+    cv::dnn::Net yolo_network;
+    std::vector<std::string> class_names;
+    std::vector<std::string> output_names;
+    std::vector<cv::Rect> previous_detections;
+    bool yolo_initialized = false;
+
+    // Kept across frames so the input blob and output tensors reuse their memory
+    cv::Mat blob;
+    std::vector<cv::Mat> outputs;
+    std::vector<RawDetection> candidates;
+
+    bool initializeYOLO();
+    // Forward passes on a blank input, so the first real frame does not pay for the lazy allocations of the backend
+    void warmUp();
+};
+
+// The network is loaded and warmed up when the detector is created, before the capture is opened
+YOLOEstimator::YOLOEstimator(const AppConfig& config, ComputeBackend backend)
+    : config(config), compute_backend(backend) {
+    if (initializeYOLO()) {
+        warmUp();
+    }
+}
+
+bool YOLOEstimator::initializeYOLO() {
+    weights = sharedModelFile(config.yolo_weights_path);
+    network_config = sharedModelFile(config.yolo_config_path);
+    if (!weights || !network_config) {
+        return false;
+    }
+
+    try {
+        yolo_network = cv::dnn::readNetFromDarknet(reinterpret_cast<const char*>(network_config->data()),
+                                                   network_config->size(),
+                                                   reinterpret_cast<const char*>(weights->data()), weights->size());
+        output_names = yolo_network.getUnconnectedOutLayersNames();
+
+        if (compute_backend == ComputeBackend::CUDA) {
+            yolo_network.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
+            yolo_network.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
+            std::cout << "YOLO using GPU acceleration" << std::endl;
+        } else if (compute_backend == ComputeBackend::OpenCL) {
+            yolo_network.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+            yolo_network.setPreferableTarget(cv::dnn::DNN_TARGET_OPENCL);
+            std::cout << "YOLO using OpenCL GPU acceleration" << std::endl;
+        } else {
+            yolo_network.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+            yolo_network.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+            std::cout << "YOLO using CPU" << std::endl;
+        }
+
+        std::ifstream class_file(config.yolo_classes_path);
+        if (class_file.is_open()) {
+            std::string line;
+            while (getline(class_file, line)) {
+                class_names.push_back(line);
+            }
+            class_file.close();
+        }
+
+        yolo_initialized = true;
+        std::cout << "YOLO initialized successfully with " << class_names.size() << " classes" << std::endl;
+        return true;
+
+    } catch (const cv::Exception& e) {
+        std::cerr << "Failed to initialize YOLO: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void YOLOEstimator::warmUp() {
+    if (config.yolo_warmup_runs <= 0) {
+        return;
+    }
+
+    Benchmark timer;
+    timer.start();
+    cv::Mat blank = cv::Mat::zeros(config.yolo_input_size, config.yolo_input_size, CV_8UC3);
+    cv::dnn::blobFromImage(blank, blob, 1.0 / 255.0, cv::Size(config.yolo_input_size, config.yolo_input_size),
+        cv::Scalar(0, 0, 0), true, false, CV_32F);
+
+    try {
+        for (int i = 0; i < config.yolo_warmup_runs; ++i) {
+            yolo_network.setInput(blob);
+            yolo_network.forward(outputs, output_names);
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "YOLO warm-up failed: " << e.what() << std::endl;
+        return;
+    }
+    std::cout << "YOLO warmed up with " << config.yolo_warmup_runs << " inferences in " << timer.stop() << " ms"
+              << std::endl;
+}
+
+void YOLOEstimator::describeTrace(EstimatorTrace& trace) const {
+    trace.min_confidence = config.estimator_trace_min_confidence;
+}
+
+// Boxes whose center lies in the zone, a zone covering the whole frame keeps all of them
+static std::vector<cv::Rect> detectionsInZone(const std::vector<cv::Rect>& detections, const cv::Rect& zone,
+                                              const cv::Size& frame_size) {
+    if (zone == cv::Rect(cv::Point(), frame_size)) {
+        return detections;
+    }
+
+    std::vector<cv::Rect> inside;
+    for (const auto& box : detections) {
+        if (zone.contains(cv::Point(box.x + box.width / 2, box.y + box.height / 2))) {
+            inside.push_back(box);
+        }
+    }
+    return inside;
+}
+
+void YOLOEstimator::estimate(const cv::Mat& frame, const cv::Mat&, const cv::Mat&,
+                             const std::vector<EstimatorZone>& zones, std::vector<MotionEstimate>& estimates,
+                             cv::Mat&, EstimatorFrame* trace_frame) {
+    if (!yolo_initialized) {
+        estimates.assign(zones.size(), {EstimateKind::None, -1.0f, false});
+        return;
+    }
+
+    cv::dnn::blobFromImage(frame, blob, 1.0 / 255.0, cv::Size(config.yolo_input_size, config.yolo_input_size),
+        cv::Scalar(0, 0, 0), true, false, CV_32F);
+
+    yolo_network.setInput(blob);
+
+    try {
+        yolo_network.forward(outputs, output_names);
+    } catch (const cv::Exception& e) {
+        std::cerr << "YOLO forward pass failed: " << e.what() << std::endl;
+        estimates.assign(zones.size(), {EstimateKind::None, -1.0f, false});
+        return;
+    }
+
+    // While recording, candidates down to the trace floor are kept so lower thresholds can be replayed later
+    float candidate_threshold = trace_frame
+        ? std::min(config.yolo_confidence_threshold, config.estimator_trace_min_confidence)
+        : config.yolo_confidence_threshold;
+
+    candidates.clear();
+    for (auto& output : outputs) {
+        for (int i = 0; i < output.rows; ++i) {
+            const float* data = output.ptr<float>(i);
+            float confidence = data[4];
+
+            if (confidence >= candidate_threshold) {
+                cv::Mat scores = output.row(i).colRange(5, output.cols);
+                cv::Point class_id_point;
+                double max_class_score;
+                minMaxLoc(scores, 0, &max_class_score, 0, &class_id_point);
+
+                if (max_class_score > candidate_threshold && class_id_point.x == 0) {
+                    int center_x = static_cast<int>(data[0] * frame.cols);
+                    int center_y = static_cast<int>(data[1] * frame.rows);
+                    int width = static_cast<int>(data[2] * frame.cols);
+                    int height = static_cast<int>(data[3] * frame.rows);
+                    int left = center_x - width / 2;
+                    int top = center_y - height / 2;
+
+                    candidates.push_back({cv::Rect(left, top, width, height), confidence,
+                                          static_cast<float>(max_class_score)});
+                }
+            }
+        }
+    }
+
+    if (config.debug) {
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            std::cout << "Detection " << i
+                      << ": class_id=0"
+                      << ", confidence=" << candidates[i].confidence
+                      << ", box=" << candidates[i].box << std::endl;
+        }
+    }
+
+    if (trace_frame) {
+        trace_frame->detections = candidates;
+    }
+
+    std::vector<cv::Rect> current_detections = DecisionLayer::selectDetections(candidates,
+        config.yolo_confidence_threshold, config.yolo_nms_threshold);
+
+    if (config.debug) {
+        cv::Mat display_frame = frame.clone();
+        for (const auto& box : current_detections) {
+            cv::rectangle(display_frame, box, cv::Scalar(0, 255, 0), 2);
+        }
+        showDebug("Pedestrian Detections", display_frame);
+    }
+
+    // Boxes are matched inside each zone, so a pedestrian leaving one zone does not pair with one in another
+    estimates.resize(zones.size());
+    for (size_t i = 0; i < zones.size(); ++i) {
+        std::vector<cv::Rect> zone_previous = detectionsInZone(previous_detections, zones[i].rect, frame.size());
+        std::vector<cv::Rect> zone_current = detectionsInZone(current_detections, zones[i].rect, frame.size());
+
+        float move_mode = DecisionLayer::calculateMotionFromDetections(zone_previous, zone_current);
+        estimates[i] = {EstimateKind::Detections, move_mode, !zone_current.empty()};
+    }
+
+    previous_detections.swap(current_detections);
+}
+
+}
+
+// Without a network every frame would decide on no motion, so a failed load fails the detector
+std::unique_ptr<MotionEstimator> createYOLOEstimator(const AppConfig& config, ComputeBackend backend) {
+    auto estimator = std::make_unique<YOLOEstimator>(config, backend);
+    if (!estimator->initialized()) {
+        std::cerr << "Error: Could not load the YOLO network from " << config.yolo_config_path << " and "
+                  << config.yolo_weights_path << std::endl;
+        return nullptr;
+    }
+    return estimator;
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cmath>
+
+#include "quality_governor.h"
+#include "../motion-detector/motion_detector.h"
+
+namespace {
+
+// Fractions of the configured settings per ladder step. The cheap knobs go first, the scale costs accuracy on
+// small pedestrians and the stride adds latency, so they come last.
+struct LadderStep {
+    double scale;
+    int level_drop;
+    int iteration_drop;
+    double winsize_factor;
+    double yolo_factor;
+    double corners_factor;
+    int frame_stride;
+};
+
+constexpr LadderStep LADDER_STEPS[] = {
+    {1.0, 0, 0, 1.0, 1.0, 1.0, 1},
+    {1.0, 1, 1, 1.0, 0.77, 0.75, 1},
+    {0.75, 1, 1, 0.75, 0.62, 0.6, 1},
+    {0.5, 2, 2, 0.6, 0.54, 0.5, 1},
+    {0.5, 2, 2, 0.6, 0.54, 0.5, 2},
+    {0.5, 2, 2, 0.6, 0.54, 0.5, 3},
+};
+
+}
+
+QualityGovernor::QualityGovernor(const AppConfig& config, double target_ms, int window, double upgrade_headroom)
+    : ladder(buildLadder(config)), target_ms(target_ms), upgrade_ms(target_ms * upgrade_headroom),
+      window(static_cast<size_t>(std::max(1, window)), 0.0), step_ratio(ladder.size(), 0.0) {}
+
+std::vector<QualityLevel> QualityGovernor::buildLadder(const AppConfig& config) {
+    std::vector<QualityLevel> levels;
+    for (const auto& step : LADDER_STEPS) {
+        QualityLevel level;
+        level.scale = step.scale;
+        level.levels = std::max(1, config.levels - step.level_drop);
+        level.iterations = std::max(1, config.iterations - step.iteration_drop);
+        // The window stays odd, like the configured ones
+        level.winsize = std::max(5, static_cast<int>(std::lround(config.winsize * step.winsize_factor)) | 1);
+        level.yolo_input_size = std::max(128, static_cast<int>(std::lround(config.yolo_input_size * step.yolo_factor
+                                                                           / 32.0)) * 32);
+        level.max_corners = std::max(10, static_cast<int>(std::lround(config.max_corners * step.corners_factor)));
+        level.frame_stride = step.frame_stride;
+        levels.push_back(level);
+    }
+
+    // Level 0 must be exactly the configured quality
+    levels[0].winsize = config.winsize;
+    levels[0].yolo_input_size = config.yolo_input_size;
+    levels[0].max_corners = config.max_corners;
+    return levels;
+}
+
+bool QualityGovernor::skipFrame() {
+    bool skip = stride_position != 0;
+    stride_position = (stride_position + 1) % ladder[active].frame_stride;
+    return skip;
+}
+
+bool QualityGovernor::observe(double frame_ms) {
+    // A decided frame pays for the skipped ones after it, so every level is measured per frame of the stream
+    double per_frame_ms = frame_ms / ladder[active].frame_stride;
+    window_sum += per_frame_ms - window[next];
+    window[next] = per_frame_ms;
+    next = (next + 1) % window.size();
+    filled = std::min(filled + 1, window.size());
+    if (filled < window.size()) {
+        return false;
+    }
+
+    double mean = window_sum / static_cast<double>(window.size());
+    if (left_level_ms > 0.0) {
+        step_ratio[active] = mean > 0.0 ? left_level_ms / mean : 0.0;
+        left_level_ms = 0.0;
+    }
+
+    if (mean > target_ms && active + 1 < static_cast<int>(ladder.size())) {
+        left_level_ms = mean;
+        setLevel(active + 1);
+        return true;
+    }
+
+    // The step down may have saved more than the headroom, the level above is estimated before going back
+    double above_ms = step_ratio[active] > 0.0 ? mean * step_ratio[active] : mean;
+    if (mean < upgrade_ms && above_ms <= target_ms && active > 0) {
+        setLevel(active - 1);
+        return true;
+    }
+    return false;
+}
+
+void QualityGovernor::setLevel(int new_level) {
+    active = new_level;
+    stride_position = 0;
+
+    // The old times say nothing about the new level
+    std::fill(window.begin(), window.end(), 0.0);
+    window_sum = 0.0;
+    filled = 0;
+    next = 0;
+}
+
+int QualityGovernor::level() const {
+    return active;
+}
+
+const QualityLevel& QualityGovernor::current() const {
+    return ladder[active];
+}
+
+size_t QualityGovernor::levelCount() const {
+    return ladder.size();
+}
@@ -0,0 +1,67 @@
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+#include <cstddef>
+#include <vector>
+
+struct AppConfig;
+
+// Settings of one step of the quality ladder, derived from the configured ones
+struct QualityLevel {
+    double scale;          // the ROI is resized by this before it is decided
+    int levels;            // Farnebäck pyramid levels
+    int iterations;        // Farnebäck iterations per level
+    int winsize;           // Farnebäck averaging window
+    int yolo_input_size;   // multiple of 32
+    int max_corners;       // Lucas-Kanade features
+    int frame_stride;      // only every frame_stride-th frame is decided, the others repeat its decision
+
+    // Pixel count or area measured on the full ROI, for the frame resized by scale
+    double scaledArea(double area) const { return area * scale * scale; }
+    // Flow magnitude set for the full ROI decided every frame, for the frame resized by scale whose flow spans
+    // frame_stride frames
+    double scaledMagnitude(double magnitude) const { return magnitude * scale * frame_stride; }
+};
+
+// Keeps the frame time under a target by stepping through a ladder of cheaper quality levels. The mean time per
+// frame over a moving window of decided frames is compared against the target: above it the governor steps down,
+// below upgrade_headroom times the target it steps back up. Between the two nothing changes, and after a step the
+// window is refilled at the new level before the next one. A step down remembers how much cheaper the new level
+// is, and a step back up is only taken when the level above would fit the target at that ratio, so a level that
+// just missed is not retried while the load stays the same.
+class QualityGovernor {
+public:
+    QualityGovernor(const AppConfig& config, double target_ms, int window, double upgrade_headroom);
+
+    // Level 0 is the configured quality, every further level is cheaper
+    static std::vector<QualityLevel> buildLadder(const AppConfig& config);
+
+    // True when the frame about to be read should only repeat the last decision, called once per frame
+    bool skipFrame();
+    // Adds the time the last decided frame took, it is spread over the frame_stride frames it stands for. Skipped
+    // frames are not observed. True when the level changed.
+    bool observe(double frame_ms);
+
+    int level() const;
+    const QualityLevel& current() const;
+    size_t levelCount() const;
+
+private:
+    std::vector<QualityLevel> ladder;
+    double target_ms;
+    double upgrade_ms;
+    std::vector<double> window;   // ring of the last times per frame
+    size_t next = 0;
+    size_t filled = 0;
+    double window_sum = 0.0;
+    int active = 0;
+    int stride_position = 0;
+    // Time per frame of the level above over that of each level, measured on the first full window after a step
+    // down, 0 while unknown
+    std::vector<double> step_ratio;
+    double left_level_ms = 0.0;   // mean of the level just stepped down from, until the ratio is measured
+
+    void setLevel(int new_level);
+};
+
+#endif //QUALITY_GOVERNOR_H
@@ -0,0 +1,155 @@
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "decision_replay.h"
+
+#include "../motion-detector/decision_layer.h"
+
+static int thresholdBin(double threshold) {
+    return static_cast<int>(std::lround(threshold * TRACE_MAGNITUDE_BINS_PER_PIXEL));
+}
+
+DecisionReplay::DecisionReplay(EstimatorTrace trace, const GroundTruth& ground_truth)
+    : trace(std::move(trace)) {
+    truth.resize(this->trace.frames.size(), 0);
+    for (size_t i = 0; i < truth.size(); ++i) {
+        truth[i] = ground_truth.isCrossing(this->trace.first_frame_index + static_cast<int>(i));
+    }
+}
+
+const EstimatorTrace& DecisionReplay::getTrace() const {
+    return trace;
+}
+
+bool DecisionReplay::supports(const AppConfig& config, std::string& reason) const {
+    if (config.algorithm != trace.algorithm) {
+        reason = "trace was recorded with " + trace.algorithm + ", not " + config.algorithm;
+        return false;
+    }
+
+    if (trace.algorithm == "DIFF") {
+        reason = "DIFF traces carry no estimator output";
+        return false;
+    }
+
+    if (trace.algorithm == "YOLO") {
+        if (config.yolo_confidence_threshold < trace.min_confidence) {
+            reason = "yolo_confidence_threshold below the recorded minimum " + std::to_string(trace.min_confidence);
+            return false;
+        }
+        return true;
+    }
+
+    if (config.difference_vote) {
+        reason = "difference votes need the frames, traces only hold the flow";
+        return false;
+    }
+    if (std::abs(config.threshold * TRACE_MAGNITUDE_BINS_PER_PIXEL - thresholdBin(config.threshold)) > 1e-6) {
+        reason = "threshold " + std::to_string(config.threshold) + " is not a multiple of 1/" +
+                 std::to_string(TRACE_MAGNITUDE_BINS_PER_PIXEL) + " pixel";
+        return false;
+    }
+    if (config.threshold < trace.min_magnitude) {
+        reason = "threshold below the recorded minimum magnitude " + std::to_string(trace.min_magnitude);
+        return false;
+    }
+    return true;
+}
+
+const std::vector<DecisionReplay::EstimatorStep>& DecisionReplay::estimatorSteps(const AppConfig& config) {
+    if (trace.algorithm == "YOLO") {
+        auto key = std::make_pair(config.yolo_confidence_threshold, config.yolo_nms_threshold);
+        auto it = detection_steps.find(key);
+        if (it != detection_steps.end()) {
+            return it->second;
+        }
+
+        std::vector<EstimatorStep> steps;
+        steps.reserve(trace.frames.size());
+
+        std::vector<cv::Rect> previous_detections;
+        for (const auto& frame : trace.frames) {
+            if (!frame.voted) {
+                steps.push_back({false, -1.0f, false});
+                continue;
+            }
+            std::vector<cv::Rect> current_detections = DecisionLayer::selectDetections(frame.detections,
+                config.yolo_confidence_threshold, config.yolo_nms_threshold);
+            float move_mode = DecisionLayer::calculateMotionFromDetections(previous_detections, current_detections);
+            previous_detections = current_detections;
+            steps.push_back({true, move_mode, !current_detections.empty()});
+        }
+
+        return detection_steps.emplace(key, std::move(steps)).first->second;
+    }
+
+    int min_bin = thresholdBin(config.threshold);
+    auto it = flow_steps.find(min_bin);
+    if (it != flow_steps.end()) {
+        return it->second;
+    }
+
+    std::vector<EstimatorStep> steps;
+    steps.reserve(trace.frames.size());
+
+    // Mode of the rounded angles, ties go to the lowest angle like MotionUtils::calculateMode
+    std::array<uint32_t, 361> counts{};
+    for (const auto& frame : trace.frames) {
+        counts.fill(0);
+        for (const auto& cell : frame.cells) {
+            if (cell.magnitude_bin >= min_bin && cell.angle < counts.size()) {
+                counts[cell.angle] += cell.count;
+            }
+        }
+
+        float move_mode = std::numeric_limits<float>::quiet_NaN();
+        uint32_t max_count = 0;
+        for (size_t angle = 0; angle < counts.size(); ++angle) {
+            if (counts[angle] > max_count) {
+                max_count = counts[angle];
+                move_mode = static_cast<float>(angle);
+            }
+        }
+        steps.push_back({frame.voted, move_mode, false});
+    }
+
+    return flow_steps.emplace(min_bin, std::move(steps)).first->second;
+}
+
+template <typename OnDecision>
+void DecisionReplay::decide(const AppConfig& config, OnDecision onDecision) {
+    const std::vector<EstimatorStep>& steps = estimatorSteps(config);
+    bool detections = trace.algorithm == "YOLO";
+
+    DecisionLayer decision_layer(config);
+    for (size_t i = 0; i < steps.size(); ++i) {
+        const EstimatorStep& step = steps[i];
+        if (step.voted) {
+            decision_layer.vote(detections
+                ? decision_layer.classifyDetections(step.move_mode, step.has_detections)
+                : decision_layer.classifyFlow(step.move_mode));
+        }
+        onDecision(i, DecisionLayer::isCrossing(decision_layer.decide()));
+    }
+}
+
+std::vector<BenchmarkResult> DecisionReplay::replay(const AppConfig& config) {
+    std::vector<BenchmarkResult> results;
+    results.reserve(trace.frames.size());
+
+    decide(config, [&](size_t i, bool is_crossing) {
+        results.push_back({trace.first_frame_index + static_cast<int>(i), config.use_gpu, 0.0, is_crossing});
+    });
+    return results;
+}
+
+CrossingMetrics DecisionReplay::evaluate(const AppConfig& config) {
+    std::array<int, 4> counts{};   // indexed by predicted * 2 + truth
+
+    decide(config, [&](size_t i, bool is_crossing) {
+        counts[(is_crossing ? 2 : 0) + (truth[i] ? 1 : 0)]++;
+    });
+
+    return crossingMetricsFromCounts(counts[3], counts[2], counts[0], counts[1]);
+}
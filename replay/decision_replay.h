@@ -0,0 +1,46 @@
+#ifndef DECISION_REPLAY_H
+#define DECISION_REPLAY_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "estimator_trace.h"
+#include "../benchmark/benchmark.h"
+#include "../motion-detector/motion_detector.h"
+
+// Re-runs the mode, vote, moving up lock and metrics on a recorded estimator trace. The estimator output only
+// depends on the magnitude or confidence thresholds, so it is computed once per threshold and every other
+// decision parameter costs one pass over the per-frame modes.
+class DecisionReplay {
+public:
+    DecisionReplay(EstimatorTrace trace, const GroundTruth& ground_truth);
+
+    // False with a reason when the config changes something the trace cannot reproduce
+    bool supports(const AppConfig& config, std::string& reason) const;
+
+    std::vector<BenchmarkResult> replay(const AppConfig& config);
+    CrossingMetrics evaluate(const AppConfig& config);
+
+    const EstimatorTrace& getTrace() const;
+
+private:
+    struct EstimatorStep {
+        bool voted;
+        float move_mode;
+        bool has_detections;
+    };
+
+    EstimatorTrace trace;
+    std::vector<char> truth;   // ground truth of every trace frame
+    std::map<int, std::vector<EstimatorStep>> flow_steps;                            // by magnitude bin
+    std::map<std::pair<float, float>, std::vector<EstimatorStep>> detection_steps;   // by confidence and NMS threshold
+
+    const std::vector<EstimatorStep>& estimatorSteps(const AppConfig& config);
+
+    template <typename OnDecision>
+    void decide(const AppConfig& config, OnDecision onDecision);
+};
+
+#endif //DECISION_REPLAY_H
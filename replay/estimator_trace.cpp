@@ -0,0 +1,202 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "estimator_trace.h"
+
+static const char TRACE_MAGIC[8] = {'Z', 'F', 'T', 'R', 'A', 'C', 'E', '1'};
+
+int magnitudeBin(float magnitude) {
+    int bin = static_cast<int>(std::ceil(magnitude * TRACE_MAGNITUDE_BINS_PER_PIXEL)) - 1;
+    return std::clamp(bin, 0, static_cast<int>(UINT16_MAX));
+}
+
+FlowHistogramBuilder::FlowHistogramBuilder(float min_magnitude, float max_magnitude)
+    : min_magnitude(min_magnitude), max_magnitude(max_magnitude) {
+}
+
+void FlowHistogramBuilder::add(float angle, float magnitude) {
+    if (!(magnitude > min_magnitude) || (max_magnitude > 0.0f && magnitude >= max_magnitude)) {
+        return;
+    }
+    auto angle_bin = static_cast<uint32_t>(std::round(angle));
+    keys.push_back(angle_bin << 16 | static_cast<uint32_t>(magnitudeBin(magnitude)));
+}
+
+void FlowHistogramBuilder::addField(const cv::Mat& ang, const cv::Mat& mag) {
+    CV_Assert(ang.type() == CV_32F && mag.type() == CV_32F && ang.size() == mag.size());
+
+    for (int y = 0; y < mag.rows; ++y) {
+        const float* ang_row = ang.ptr<float>(y);
+        const float* mag_row = mag.ptr<float>(y);
+        for (int x = 0; x < mag.cols; ++x) {
+            add(ang_row[x], mag_row[x]);
+        }
+    }
+}
+
+void FlowHistogramBuilder::finish(std::vector<FlowHistogramCell>& cells) {
+    cells.clear();
+    std::sort(keys.begin(), keys.end());
+
+    for (size_t i = 0; i < keys.size();) {
+        size_t j = i;
+        while (j < keys.size() && keys[j] == keys[i]) {
+            j++;
+        }
+        cells.push_back({static_cast<uint16_t>(keys[i] >> 16), static_cast<uint16_t>(keys[i] & 0xFFFF),
+                         static_cast<uint32_t>(j - i)});
+        i = j;
+    }
+
+    keys.clear();
+}
+
+template <typename T>
+static void writeValue(std::ofstream& file, const T& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool readValue(std::ifstream& file, T& value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+// Smallest frame record (voted flag, cell and detection counts) and the size of one detection record
+static const size_t FRAME_MIN_BYTES = sizeof(uint8_t) + 2 * sizeof(uint32_t);
+static const size_t DETECTION_BYTES = 4 * sizeof(int32_t) + 2 * sizeof(float);
+
+// Counts are read from the file, a corrupt one must not make load allocate more records than the rest of the file holds
+static bool fitsInFile(std::ifstream& file, std::streamoff file_size, uint32_t count, size_t record_bytes) {
+    std::streamoff remaining = file_size - static_cast<std::streamoff>(file.tellg());
+    return remaining >= 0 && count <= static_cast<uint64_t>(remaining) / record_bytes;
+}
+
+static void writeString(std::ofstream& file, const std::string& value) {
+    writeValue(file, static_cast<uint32_t>(value.size()));
+    file.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+static bool readString(std::ifstream& file, std::string& value) {
+    uint32_t size;
+    if (!readValue(file, size) || size > 4096) {
+        return false;
+    }
+    value.resize(size);
+    return static_cast<bool>(file.read(value.data(), size));
+}
+
+bool EstimatorTrace::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open estimator trace " << path << " for writing." << std::endl;
+        return false;
+    }
+
+    file.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    writeString(file, algorithm);
+    writeString(file, video_src);
+    writeString(file, video_annot);
+    writeValue(file, static_cast<int32_t>(first_frame_index));
+    writeValue(file, min_magnitude);
+    writeValue(file, max_magnitude);
+    writeValue(file, min_confidence);
+    writeValue(file, static_cast<uint32_t>(frames.size()));
+
+    for (const auto& frame : frames) {
+        writeValue(file, static_cast<uint8_t>(frame.voted));
+        writeValue(file, static_cast<uint32_t>(frame.cells.size()));
+        file.write(reinterpret_cast<const char*>(frame.cells.data()),
+            static_cast<std::streamsize>(frame.cells.size() * sizeof(FlowHistogramCell)));
+
+        writeValue(file, static_cast<uint32_t>(frame.detections.size()));
+        for (const auto& detection : frame.detections) {
+            writeValue(file, static_cast<int32_t>(detection.box.x));
+            writeValue(file, static_cast<int32_t>(detection.box.y));
+            writeValue(file, static_cast<int32_t>(detection.box.width));
+            writeValue(file, static_cast<int32_t>(detection.box.height));
+            writeValue(file, detection.confidence);
+            writeValue(file, detection.class_score);
+        }
+    }
+
+    if (!file.good()) {
+        std::cerr << "Error: Could not write estimator trace " << path << std::endl;
+        return false;
+    }
+
+    std::cout << "Estimator trace saved to " << path << " (" << frames.size() << " frames)" << std::endl;
+    return true;
+}
+
+bool EstimatorTrace::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open estimator trace " << path << std::endl;
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    std::streamoff file_size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    char magic[sizeof(TRACE_MAGIC)];
+    int32_t first_frame;
+    uint32_t frame_count;
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 ||
+        !readString(file, algorithm) || !readString(file, video_src) || !readString(file, video_annot) ||
+        !readValue(file, first_frame) || !readValue(file, min_magnitude) || !readValue(file, max_magnitude) ||
+        !readValue(file, min_confidence) || !readValue(file, frame_count)) {
+        std::cerr << "Error: " << path << " is not an estimator trace" << std::endl;
+        return false;
+    }
+    first_frame_index = first_frame;
+
+    if (!fitsInFile(file, file_size, frame_count, FRAME_MIN_BYTES)) {
+        std::cerr << "Error: estimator trace " << path << " is truncated" << std::endl;
+        frames.clear();
+        return false;
+    }
+    frames.assign(frame_count, EstimatorFrame{});
+    for (auto& frame : frames) {
+        uint8_t voted;
+        uint32_t cell_count, detection_count;
+
+        if (!readValue(file, voted) || !readValue(file, cell_count) ||
+            !fitsInFile(file, file_size, cell_count, sizeof(FlowHistogramCell))) {
+            file.setstate(std::ios::failbit);
+            break;
+        }
+        frame.voted = voted != 0;
+        frame.cells.resize(cell_count);
+        if (!file.read(reinterpret_cast<char*>(frame.cells.data()),
+                static_cast<std::streamsize>(cell_count * sizeof(FlowHistogramCell)))) {
+            break;
+        }
+
+        if (!readValue(file, detection_count) || !fitsInFile(file, file_size, detection_count, DETECTION_BYTES)) {
+            file.setstate(std::ios::failbit);
+            break;
+        }
+        frame.detections.resize(detection_count);
+        for (auto& detection : frame.detections) {
+            int32_t x, y, width, height;
+            readValue(file, x);
+            readValue(file, y);
+            readValue(file, width);
+            readValue(file, height);
+            readValue(file, detection.confidence);
+            readValue(file, detection.class_score);
+            detection.box = cv::Rect(x, y, width, height);
+        }
+    }
+
+    if (!file.good()) {
+        std::cerr << "Error: estimator trace " << path << " is truncated" << std::endl;
+        frames.clear();
+        return false;
+    }
+
+    return true;
+}
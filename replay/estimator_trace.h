@@ -0,0 +1,60 @@
+#ifndef ESTIMATOR_TRACE_H
+#define ESTIMATOR_TRACE_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../motion-detector/decision_layer.h"
+
+// Flow magnitudes are stored in 1/16 pixel steps, bin b holds magnitudes in (b/16, (b+1)/16]. Any magnitude
+// threshold that is a multiple of 1/16 selects exactly the same vectors as the live mag > threshold test.
+const int TRACE_MAGNITUDE_BINS_PER_PIXEL = 16;
+
+struct FlowHistogramCell {
+    uint16_t angle;           // rounded angle in degrees, the same binning as MotionUtils::calculateMode
+    uint16_t magnitude_bin;
+    uint32_t count;
+};
+
+// Estimator output of one processed frame. Flow algorithms fill the angle/magnitude histogram, YOLO the
+// person candidates before thresholding and NMS.
+struct EstimatorFrame {
+    bool voted = true;        // false when the estimator failed and the directions map was left unchanged
+    std::vector<FlowHistogramCell> cells;
+    std::vector<RawDetection> detections;
+};
+
+struct EstimatorTrace {
+    std::string algorithm;
+    std::string video_src;
+    std::string video_annot;
+    int first_frame_index = 0;
+    float min_magnitude = 0.0f;    // flow vectors at or below this were not recorded
+    float max_magnitude = 0.0f;    // flow vectors at or above this were not recorded, 0 when unbounded
+    float min_confidence = 0.0f;   // candidates at or below this were not recorded
+    std::vector<EstimatorFrame> frames;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
+
+// Collects flow vectors of one frame into sparse histogram cells
+class FlowHistogramBuilder {
+public:
+    FlowHistogramBuilder(float min_magnitude, float max_magnitude);
+
+    void add(float angle, float magnitude);
+    void addField(const cv::Mat& ang, const cv::Mat& mag);
+    void finish(std::vector<FlowHistogramCell>& cells);
+
+private:
+    float min_magnitude;
+    float max_magnitude;
+    std::vector<uint32_t> keys;
+};
+
+int magnitudeBin(float magnitude);
+
+#endif //ESTIMATOR_TRACE_H
@@ -0,0 +1,134 @@
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <stdexcept>
+
+#include "replay_sweep.h"
+
+static const std::vector<std::string> REPLAYABLE_KEYS = {
+    "threshold", "size", "angle_up_min", "angle_up_max", "angle_down_min", "angle_down_max",
+    "moving_up_lock_frames", "yolo_confidence_threshold", "yolo_nms_threshold"
+};
+
+bool ReplaySweep::isReplayableKey(const std::string& key) {
+    return std::find(REPLAYABLE_KEYS.begin(), REPLAYABLE_KEYS.end(), key) != REPLAYABLE_KEYS.end();
+}
+
+ReplaySweep::ReplaySweep(const std::string& replayFile) {
+    YAML::Node replay = YAML::LoadFile(replayFile);
+
+    base_config = YAML::LoadFile(replay["base_config"].as<std::string>());
+    test_prefix = replay["test_prefix"].as<std::string>("replay");
+    top = replay["top"].as<int>(10);
+
+    for (const auto& node : replay["traces"]) {
+        trace_paths.push_back(node["trace"].as<std::string>());
+        annotation_paths.push_back(node["annot"].as<std::string>(""));
+    }
+
+    grid = ParameterSweep::parseGrid(replay["grid"]);
+    for (const auto& [key, values] : grid) {
+        if (!isReplayableKey(key)) {
+            throw std::runtime_error("Replay grid key '" + key + "' changes the estimator output, "
+                                     "record a new trace and run a parameter sweep for it instead");
+        }
+    }
+}
+
+std::vector<ReplayVariant> ReplaySweep::buildVariants() const {
+    std::vector<ReplayVariant> variants;
+    for (const auto& [test_id, node] : ParameterSweep::expandGrid(base_config, grid, test_prefix)) {
+        variants.push_back({test_id, MotionDetector::parseConfig(node)});
+    }
+    return variants;
+}
+
+void ReplaySweep::run() {
+    std::vector<std::unique_ptr<DecisionReplay>> replays;
+    for (size_t i = 0; i < trace_paths.size(); ++i) {
+        EstimatorTrace trace;
+        if (!trace.load(trace_paths[i])) {
+            continue;
+        }
+        std::string annot = annotation_paths[i].empty() ? trace.video_annot : annotation_paths[i];
+        std::cout << "Loaded " << trace.frames.size() << " " << trace.algorithm << " frames from " << trace_paths[i]
+                  << std::endl;
+        replays.push_back(std::make_unique<DecisionReplay>(std::move(trace), loadGroundTruth(annot)));
+    }
+
+    std::vector<ReplayVariant> variants = buildVariants();
+    if (replays.empty() || variants.empty()) {
+        std::cerr << "Error: replay has no usable traces or no parameter combinations" << std::endl;
+        return;
+    }
+
+    std::string results_dir = "results";
+    std::filesystem::create_directories(results_dir);
+    std::string output_file = results_dir + "/" + test_prefix + "_replay_" + getTimestamp() + ".csv";
+
+    std::ofstream file(output_file);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << output_file << " for writing." << std::endl;
+        return;
+    }
+    file << "Test ID,Trace,Balanced Accuracy,Crossing Accuracy,Not Crossing Accuracy,TP,FP,TN,FN\n";
+
+    std::vector<std::pair<double, std::string>> ranking;
+    size_t evaluations = 0;
+
+    Benchmark timer;
+    timer.start();
+
+    for (const auto& variant : variants) {
+        double balanced_accuracy_sum = 0.0;
+        size_t evaluated = 0;
+
+        for (size_t i = 0; i < replays.size(); ++i) {
+            std::string reason;
+            // The recorded algorithm decides what is replayed, whatever the base config selects
+            AppConfig config = variant.config;
+            config.algorithm = replays[i]->getTrace().algorithm;
+            if (!replays[i]->supports(config, reason)) {
+                std::cerr << "Skipping " << variant.test_id << " on " << trace_paths[i] << ": " << reason << std::endl;
+                continue;
+            }
+
+            CrossingMetrics metrics = replays[i]->evaluate(config);
+            balanced_accuracy_sum += metrics.balanced_accuracy;
+            evaluated++;
+
+            file << variant.test_id << ","
+                 << std::filesystem::path(trace_paths[i]).filename().string() << ","
+                 << std::fixed << std::setprecision(4) << metrics.balanced_accuracy << ","
+                 << metrics.crossing_accuracy << ","
+                 << metrics.not_crossing_accuracy << ","
+                 << metrics.true_positives << ","
+                 << metrics.false_positives << ","
+                 << metrics.true_negatives << ","
+                 << metrics.false_negatives << "\n";
+        }
+
+        if (evaluated > 0) {
+            ranking.emplace_back(balanced_accuracy_sum / evaluated, variant.test_id);
+            evaluations += evaluated;
+        }
+    }
+
+    double elapsed = timer.stop();
+    file.close();
+
+    std::stable_sort(ranking.begin(), ranking.end(),
+        [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::cout << "Replayed " << evaluations << " variant/trace pairs in " << elapsed / 1000.0 << " s ("
+              << static_cast<int>(evaluations / std::max(elapsed / 1000.0, 1e-9)) << " per second)" << std::endl;
+    std::cout << "Best mean balanced accuracy:" << std::endl;
+    for (size_t i = 0; i < ranking.size() && static_cast<int>(i) < top; ++i) {
+        std::cout << "  " << std::fixed << std::setprecision(4) << ranking[i].first << "  " << ranking[i].second
+                  << std::endl;
+    }
+    std::cout << "Results saved to " << output_file << std::endl;
+}
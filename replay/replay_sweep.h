@@ -0,0 +1,36 @@
+#ifndef REPLAY_SWEEP_H
+#define REPLAY_SWEEP_H
+
+#include <yaml-cpp/yaml.h>
+#include <string>
+#include <vector>
+
+#include "decision_replay.h"
+#include "../sweep/parameter_sweep.h"
+
+struct ReplayVariant {
+    std::string test_id;
+    AppConfig config;
+};
+
+// Parameter grid over the decision parameters, evaluated on recorded estimator traces instead of videos
+class ReplaySweep {
+public:
+    explicit ReplaySweep(const std::string& replayFile);
+
+    std::vector<ReplayVariant> buildVariants() const;
+    void run();
+
+    // Keys that only change the decision layer, everything else needs a new recording
+    static bool isReplayableKey(const std::string& key);
+
+private:
+    YAML::Node base_config;
+    std::string test_prefix;
+    int top;
+    std::vector<std::string> trace_paths;
+    std::vector<std::string> annotation_paths;
+    ParameterGrid grid;
+};
+
+#endif //REPLAY_SWEEP_H
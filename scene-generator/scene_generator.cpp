@@ -0,0 +1,268 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <yaml-cpp/yaml.h>
+
+#include "scene_generator.h"
+
+#include "../utils/motion_utils.h"
+
+SceneGenerator::SceneGenerator(const SceneConfig& config) : config_(config) {
+    addRandomPedestrians();
+    buildBackground();
+    buildPedestrianTextures();
+}
+
+const SceneConfig& SceneGenerator::getConfig() const {
+    return config_;
+}
+
+SceneConfig SceneGenerator::loadConfig(const std::string& configFile) {
+    YAML::Node config = YAML::LoadFile(configFile);
+    SceneConfig scene;
+
+    scene.video_out = config["video_out"].as<std::string>();
+    scene.annot_out = config["annot_out"].as<std::string>();
+    scene.codec = config["codec"].as<std::string>("mp4v");
+    scene.width = config["width"].as<int>();
+    scene.height = config["height"].as<int>();
+    scene.frame_count = config["frame_count"].as<int>();
+    scene.fps = config["fps"].as<double>(30.0);
+    scene.seed = config["seed"].as<unsigned int>(0);
+    scene.noise_sigma = config["noise_sigma"].as<double>(0.0);
+    scene.lighting_drift = config["lighting_drift"].as<double>(0.0);
+    scene.lighting_period = config["lighting_period"].as<double>(0.0);
+    scene.frame_offset = config["frame_offset"].as<int>(0);
+    scene.random_pedestrians = config["random_pedestrians"].as<int>(0);
+    scene.random_min_speed = config["random_min_speed"].as<double>(0.05);
+    scene.random_max_speed = config["random_max_speed"].as<double>(0.2);
+    scene.crossing_angle_up_min = config["crossing_angle_up_min"].as<int>(160);
+    scene.crossing_angle_up_max = config["crossing_angle_up_max"].as<int>(190);
+    scene.crossing_angle_down_min = config["crossing_angle_down_min"].as<int>(350);
+    scene.crossing_angle_down_max = config["crossing_angle_down_max"].as<int>(20);
+
+    if (config["pedestrians"]) {
+        for (const auto& node : config["pedestrians"]) {
+            SyntheticPedestrian pedestrian;
+            pedestrian.start_x = node["start_x"].as<double>();
+            pedestrian.start_y = node["start_y"].as<double>();
+            pedestrian.heading = node["heading"].as<double>();
+            pedestrian.speed = node["speed"].as<double>();
+            pedestrian.width = node["width"].as<double>(0.05);
+            pedestrian.height = node["height"].as<double>(0.15);
+            pedestrian.start_frame = node["start_frame"].as<int>(0);
+            pedestrian.walk_end_frame = node["walk_end_frame"].as<int>(-1);
+            pedestrian.end_frame = node["end_frame"].as<int>(-1);
+            pedestrian.crossing = node["crossing"].as<bool>();
+            scene.pedestrians.push_back(pedestrian);
+        }
+    }
+
+    return scene;
+}
+
+void SceneGenerator::addRandomPedestrians() {
+    cv::RNG rng(config_.seed);
+
+    for (int i = 0; i < config_.random_pedestrians; ++i) {
+        SyntheticPedestrian pedestrian;
+        pedestrian.start_x = rng.uniform(0.1, 0.9);
+        pedestrian.start_y = rng.uniform(0.1, 0.9);
+        pedestrian.heading = rng.uniform(0.0, 360.0);
+        pedestrian.speed = rng.uniform(config_.random_min_speed, config_.random_max_speed);
+        pedestrian.width = rng.uniform(0.04, 0.07);
+        pedestrian.height = rng.uniform(0.12, 0.2);
+        pedestrian.start_frame = rng.uniform(0, std::max(1, config_.frame_count / 2));
+        pedestrian.walk_end_frame = -1;
+        pedestrian.end_frame = -1;
+        pedestrian.crossing =
+            MotionUtils::isAngleInRange(pedestrian.heading, config_.crossing_angle_up_min, config_.crossing_angle_up_max) ||
+            MotionUtils::isAngleInRange(pedestrian.heading, config_.crossing_angle_down_min, config_.crossing_angle_down_max);
+        config_.pedestrians.push_back(pedestrian);
+    }
+}
+
+void SceneGenerator::buildBackground() {
+    cv::RNG rng(config_.seed + 1);
+
+    // Low frequency asphalt texture gives the optical flow something to lock on to without moving
+    cv::Mat coarse(std::max(1, config_.height / 8), std::max(1, config_.width / 8), CV_8UC1);
+    rng.fill(coarse, cv::RNG::UNIFORM, cv::Scalar::all(70), cv::Scalar::all(110));
+
+    cv::Mat asphalt;
+    cv::resize(coarse, asphalt, cv::Size(config_.width, config_.height), 0, 0, cv::INTER_LINEAR);
+    cv::cvtColor(asphalt, background, cv::COLOR_GRAY2BGR);
+
+    int stripe_width = std::max(1, config_.width / 24);
+    int band_top = static_cast<int>(config_.height * 0.3);
+    int band_bottom = static_cast<int>(config_.height * 0.7);
+    for (int x = stripe_width; x < config_.width; x += 2 * stripe_width) {
+        cv::rectangle(background, cv::Point(x, band_top), cv::Point(x + stripe_width - 1, band_bottom),
+            cv::Scalar(215, 215, 215), cv::FILLED);
+    }
+}
+
+void SceneGenerator::buildPedestrianTextures() {
+    cv::RNG rng(config_.seed + 2);
+
+    pedestrian_textures.clear();
+    pedestrian_masks.clear();
+
+    for (const auto& pedestrian : config_.pedestrians) {
+        int width = std::max(4, static_cast<int>(std::round(pedestrian.width * config_.height)));
+        int height = std::max(4, static_cast<int>(std::round(pedestrian.height * config_.height)));
+
+        cv::Mat coarse(std::max(1, height / 4), std::max(1, width / 4), CV_8UC3);
+        rng.fill(coarse, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+
+        cv::Mat texture;
+        cv::resize(coarse, texture, cv::Size(width, height), 0, 0, cv::INTER_LINEAR);
+
+        cv::Mat mask(height, width, CV_8UC1, cv::Scalar(0));
+        cv::ellipse(mask, cv::Point(width / 2, height / 2), cv::Size(width / 2, height / 2), 0, 0, 360,
+            cv::Scalar(255), cv::FILLED);
+
+        pedestrian_textures.push_back(texture);
+        pedestrian_masks.push_back(mask);
+    }
+}
+
+bool SceneGenerator::isWalking(const SyntheticPedestrian& pedestrian, int frame_index) const {
+    return pedestrian.speed > 0.0 && frame_index >= pedestrian.start_frame &&
+           (pedestrian.walk_end_frame < 0 || frame_index <= pedestrian.walk_end_frame);
+}
+
+bool SceneGenerator::pedestrianPosition(const SyntheticPedestrian& pedestrian, int frame_index, cv::Point2d& center) const {
+    if (frame_index < pedestrian.start_frame || (pedestrian.end_frame >= 0 && frame_index > pedestrian.end_frame)) {
+        return false;
+    }
+
+    int last_walking_frame = pedestrian.walk_end_frame < 0 ? frame_index : std::min(frame_index, pedestrian.walk_end_frame);
+    int walked_frames = std::max(0, last_walking_frame - pedestrian.start_frame);
+
+    double pixels_per_frame = pedestrian.speed * config_.height / config_.fps;
+    double heading = pedestrian.heading * CV_PI / 180.0;
+
+    center.x = pedestrian.start_x * config_.width + std::cos(heading) * pixels_per_frame * walked_frames;
+    center.y = pedestrian.start_y * config_.height + std::sin(heading) * pixels_per_frame * walked_frames;
+
+    return center.x >= 0 && center.x < config_.width && center.y >= 0 && center.y < config_.height;
+}
+
+void SceneGenerator::renderFrame(int frame_index, cv::Mat& frame) const {
+    cv::Mat canvas = background.clone();
+    cv::Rect canvas_rect(0, 0, canvas.cols, canvas.rows);
+
+    for (size_t i = 0; i < config_.pedestrians.size(); ++i) {
+        cv::Point2d center;
+        if (!pedestrianPosition(config_.pedestrians[i], frame_index, center)) {
+            continue;
+        }
+
+        const cv::Mat& texture = pedestrian_textures[i];
+        cv::Rect target(cvRound(center.x - texture.cols / 2.0), cvRound(center.y - texture.rows / 2.0),
+            texture.cols, texture.rows);
+        cv::Rect visible = target & canvas_rect;
+        if (visible.empty()) {
+            continue;
+        }
+
+        cv::Rect source(visible.x - target.x, visible.y - target.y, visible.width, visible.height);
+        texture(source).copyTo(canvas(visible), pedestrian_masks[i](source));
+    }
+
+    double gain = 1.0;
+    if (config_.lighting_period > 0.0) {
+        gain += config_.lighting_drift * std::sin(2.0 * CV_PI * frame_index / config_.lighting_period);
+    }
+    canvas.convertTo(frame, CV_8UC3, gain);
+
+    if (config_.noise_sigma > 0.0) {
+        // Seeded per frame so any single frame can be reproduced without rendering its predecessors
+        cv::RNG rng(static_cast<uint64>(config_.seed) * 7919u + static_cast<uint64>(frame_index) + 3);
+        cv::Mat noise(frame.size(), CV_16SC3);
+        rng.fill(noise, cv::RNG::NORMAL, cv::Scalar::all(0), cv::Scalar::all(config_.noise_sigma));
+
+        cv::Mat noisy;
+        frame.convertTo(noisy, CV_16SC3);
+        noisy += noise;
+        noisy.convertTo(frame, CV_8UC3);
+    }
+}
+
+nlohmann::json SceneGenerator::groundTruth() const {
+    nlohmann::json j;
+    j["generator"] = "ZebraFlash synthetic scene";
+    j["seed"] = config_.seed;
+    j["width"] = config_.width;
+    j["height"] = config_.height;
+    j["frame_count"] = config_.frame_count;
+    j["pedestrians"] = nlohmann::json::array();
+
+    for (size_t i = 0; i < config_.pedestrians.size(); ++i) {
+        const auto& pedestrian = config_.pedestrians[i];
+        nlohmann::json state_per_frame = nlohmann::json::object();
+
+        for (int frame_index = 0; frame_index < config_.frame_count; ++frame_index) {
+            cv::Point2d center;
+            if (!pedestrianPosition(pedestrian, frame_index, center)) {
+                continue;
+            }
+
+            // Same labels as the Blender export: "zebra felé" (towards the crossing) and "áll" (standing)
+            bool is_crossing = pedestrian.crossing && isWalking(pedestrian, frame_index);
+            state_per_frame[std::to_string(frame_index + config_.frame_offset)] = is_crossing ? "zebra felé" : "áll";
+        }
+
+        j["pedestrians"].push_back({
+            {"id", static_cast<int>(i)},
+            {"heading", pedestrian.heading},
+            {"speed", pedestrian.speed},
+            {"state_per_frame", state_per_frame}
+        });
+    }
+
+    return j;
+}
+
+bool SceneGenerator::writeGroundTruth(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << filename << " for writing." << std::endl;
+        return false;
+    }
+
+    file << groundTruth().dump(2);
+    file.close();
+    std::cout << "Ground truth saved to " << filename << std::endl;
+    return true;
+}
+
+bool SceneGenerator::generate() {
+    const std::string& codec = config_.codec;
+    if (codec.size() != 4) {
+        std::cerr << "Error: codec must be a four character code, got: " << codec << std::endl;
+        return false;
+    }
+
+    cv::VideoWriter writer(config_.video_out, cv::VideoWriter::fourcc(codec[0], codec[1], codec[2], codec[3]),
+        config_.fps, cv::Size(config_.width, config_.height));
+
+    if (!writer.isOpened()) {
+        std::cerr << "Error: Could not open video writer: " << config_.video_out << std::endl;
+        return false;
+    }
+
+    cv::Mat frame;
+    for (int frame_index = 0; frame_index < config_.frame_count; ++frame_index) {
+        renderFrame(frame_index, frame);
+        writer.write(frame);
+    }
+    writer.release();
+
+    std::cout << "Synthetic scene saved to " << config_.video_out << " (" << config_.frame_count << " frames, "
+              << config_.width << "x" << config_.height << ", " << config_.pedestrians.size() << " pedestrians)"
+              << std::endl;
+
+    return writeGroundTruth(config_.annot_out);
+}
@@ -0,0 +1,74 @@
+#ifndef SCENE_GENERATOR_H
+#define SCENE_GENERATOR_H
+
+#include <opencv2/opencv.hpp>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+// Start positions are normalized to the frame (0..1), sizes are fractions of the frame height and speeds are
+// given in frame heights per second, so the same scene description renders identically at 720p, 1080p or 4K.
+// Headings use the image convention of cv::cartToPolar: 0 = right, 90 = down, 180 = left, 270 = up.
+struct SyntheticPedestrian {
+    double start_x;
+    double start_y;
+    double heading;
+    double speed;
+    double width;
+    double height;
+    int start_frame;
+    int walk_end_frame;  // the pedestrian stands still after this frame, -1 walks until end_frame
+    int end_frame;       // -1 stays in the scene until the last frame
+    bool crossing;
+};
+
+struct SceneConfig {
+    std::string video_out;
+    std::string annot_out;
+    std::string codec;
+    int width;
+    int height;
+    int frame_count;
+    double fps;
+    unsigned int seed;
+    double noise_sigma;          // standard deviation of per-frame sensor noise (0-255 scale)
+    double lighting_drift;       // relative amplitude of the global brightness oscillation
+    double lighting_period;      // period of the brightness oscillation in frames
+    int frame_offset;            // added to the frame numbers written into the annotation file
+    int random_pedestrians;      // additional pedestrians drawn from the seed
+    double random_min_speed;
+    double random_max_speed;
+    int crossing_angle_up_min;   // headings in these ranges count as crossing for random pedestrians
+    int crossing_angle_up_max;
+    int crossing_angle_down_min;
+    int crossing_angle_down_max;
+    std::vector<SyntheticPedestrian> pedestrians;
+};
+
+class SceneGenerator {
+public:
+    explicit SceneGenerator(const SceneConfig& config);
+
+    static SceneConfig loadConfig(const std::string& configFile);
+
+    bool generate();
+    void renderFrame(int frame_index, cv::Mat& frame) const;
+    nlohmann::json groundTruth() const;
+    bool writeGroundTruth(const std::string& filename) const;
+
+    const SceneConfig& getConfig() const;
+
+private:
+    SceneConfig config_;
+    cv::Mat background;
+    std::vector<cv::Mat> pedestrian_textures;
+    std::vector<cv::Mat> pedestrian_masks;
+
+    void addRandomPedestrians();
+    void buildBackground();
+    void buildPedestrianTextures();
+    bool pedestrianPosition(const SyntheticPedestrian& pedestrian, int frame_index, cv::Point2d& center) const;
+    bool isWalking(const SyntheticPedestrian& pedestrian, int frame_index) const;
+};
+
+#endif //SCENE_GENERATOR_H
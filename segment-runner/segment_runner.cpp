@@ -0,0 +1,181 @@
+#include <iostream>
+#include <algorithm>
+#include <thread>
+
+#include "segment_runner.h"
+
+#include "../frame-index/frame_index.h"
+#include "../thread-pool/thread_pool.h"
+
+SegmentRunner::SegmentRunner(const AppConfig& config, const std::string& testIdentifier)
+    : config(config), testIdentifier(testIdentifier) {
+    // Every segment would overwrite the same trace file
+    if (!this->config.estimator_trace_path.empty()) {
+        std::cerr << "Warning: estimator traces are not recorded in segment mode" << std::endl;
+        this->config.estimator_trace_path.clear();
+    }
+}
+
+std::vector<VideoSegment> SegmentRunner::splitSegments(int first_frame, int end_frame, int segments, int warmup) {
+    std::vector<VideoSegment> result;
+    int length = end_frame - first_frame;
+    if (length <= 0) {
+        return result;
+    }
+
+    segments = std::clamp(segments, 1, length);
+    for (int i = 0; i < segments; ++i) {
+        int start = first_frame + static_cast<int>(static_cast<int64_t>(length) * i / segments);
+        int end = first_frame + static_cast<int>(static_cast<int64_t>(length) * (i + 1) / segments);
+        // The first segment has nothing before it to warm up on, like a normal run
+        int warmup_start = i == 0 ? start : std::max(first_frame, start - warmup);
+        result.push_back({warmup_start, start, end});
+    }
+    return result;
+}
+
+int SegmentRunner::endFrame() const {
+    if (config.seek_end > 0) {
+        return config.seek_end;
+    }
+
+    FrameIndex index;
+    if (index.load(FrameIndex::sidecarPath(config.video_src), config.video_src)) {
+        return index.frameCount();
+    }
+
+    cv::VideoCapture cap(config.video_src);
+    return cap.isOpened() ? static_cast<int>(cap.get(cv::CAP_PROP_FRAME_COUNT)) : 0;
+}
+
+bool SegmentRunner::processSegment(const VideoSegment& segment, bool last,
+                                   std::vector<BenchmarkResult>& results) const {
+    results.clear();
+
+    cv::VideoCapture cap(config.video_src);
+    if (!cap.isOpened()) {
+        std::cerr << "Error: Could not open video source: " << config.video_src << std::endl;
+        return false;
+    }
+
+    int height = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+    int width = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
+
+    // Margins are still in their config form here, row_end and col_end count from the bottom and right edges
+    cv::Rect roi(config.col_start, config.row_start,
+        width - config.col_end - config.col_start, height - config.row_end - config.row_start);
+
+    FrameIndex::seek(cap, config.video_src, segment.warmup_start);
+
+    // Results are numbered from the seeding frame like in a normal run, so the last result of the segment needs
+    // the frame at segment.end
+    cv::Mat frame;
+    int frame_index = segment.warmup_start;
+    MotionDetector detector(config, testIdentifier);
+    results = detector.processFrames([&](cv::Mat& roi_frame) {
+        if (frame_index > segment.end || !cap.read(frame) || frame.empty()) {
+            return false;
+        }
+        frame_index++;
+        roi_frame = frame(roi);
+        return true;
+    }, segment.warmup_start);
+
+    // Warm-up decisions only served to fill the detector state
+    results.erase(std::remove_if(results.begin(), results.end(), [&](const BenchmarkResult& result) {
+        return result.frame_index < segment.start;
+    }), results.end());
+
+    // Only the last segment may end early, the video can be shorter than its frame count says
+    size_t expected = static_cast<size_t>(segment.end - segment.start);
+    if (results.empty() || (!last && results.size() < expected)) {
+        std::cerr << "Error: Segment " << segment.start << "-" << segment.end << " of " << config.video_src
+                  << " ended after " << results.size() << " of " << expected << " frames" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<BenchmarkResult> SegmentRunner::process() {
+    // processFrames keeps the decisions of the first zone only, the others would be dropped without a word
+    if (config.zones.size() > 1) {
+        std::cerr << "Error: Segment mode decides a single zone, " << config.video_src << " is configured with "
+                  << config.zones.size() << " zones" << std::endl;
+        return {};
+    }
+
+    std::vector<VideoSegment> segments = splitSegments(config.seek, endFrame(), config.segments,
+                                                       config.segment_warmup);
+    if (segments.empty()) {
+        std::cerr << "Error: no frames to process in " << config.video_src << std::endl;
+        return {};
+    }
+
+    std::vector<std::vector<BenchmarkResult>> segment_results(segments.size());
+    std::vector<char> segment_ok(segments.size(), 0);
+
+    // GPU detectors share the global OpenCL switch and the device, so their segments run one after another
+    int workers = config.use_gpu ? 1 : static_cast<int>(segments.size());
+    std::cout << "Processing " << config.video_src << " frames " << config.seek << "-" << segments.back().end
+              << " in " << segments.size() << " segments on " << workers << " workers" << std::endl;
+
+    // Segments are already spread over the cores, nested OpenCV threading would only oversubscribe them
+    int previous_threads = cv::getNumThreads();
+    if (workers > 1) {
+        cv::setNumThreads(1);
+    }
+
+    {
+        ThreadPool pool(workers);
+        std::vector<std::future<void>> futures;
+        for (size_t i = 0; i < segments.size(); ++i) {
+            futures.push_back(pool.enqueue([this, &segments, &segment_results, &segment_ok, i]() {
+                try {
+                    segment_ok[i] = processSegment(segments[i], i + 1 == segments.size(), segment_results[i]);
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Segment " << segments[i].start << "-" << segments[i].end << " failed: "
+                              << e.what() << std::endl;
+                }
+            }));
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+    }
+
+    cv::setNumThreads(previous_threads);
+
+    if (std::find(segment_ok.begin(), segment_ok.end(), 0) != segment_ok.end()) {
+        std::cerr << "Error: Not every segment of " << config.video_src << " was processed" << std::endl;
+        return {};
+    }
+
+    std::vector<BenchmarkResult> results;
+    for (const auto& part : segment_results) {
+        results.insert(results.end(), part.begin(), part.end());
+    }
+    return results;
+}
+
+bool SegmentRunner::run() {
+    Benchmark wall_timer;
+    wall_timer.start();
+
+    std::vector<BenchmarkResult> results = process();
+    if (results.empty()) {
+        return false;
+    }
+
+    // A single configured zone may have an annotation of its own
+    const std::string& annotation = config.zones.empty() ? config.video_annot : config.zones[0].video_annot;
+    saveBenchmarkResults(results, loadGroundTruth(annotation), testIdentifier);
+
+    double frame_time = 0.0;
+    for (const auto& result : results) {
+        frame_time += result.frame_time_ms;
+    }
+    double wall_time = wall_timer.stop();
+    std::cout << "Segments finished in " << wall_time / 1000.0 << " s, " << frame_time / 1000.0
+              << " s of frame time" << std::endl;
+    return true;
+}
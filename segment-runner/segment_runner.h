@@ -0,0 +1,44 @@
+#ifndef SEGMENT_RUNNER_H
+#define SEGMENT_RUNNER_H
+
+#include <string>
+#include <vector>
+
+#include "../benchmark/benchmark.h"
+#include "../motion-detector/motion_detector.h"
+
+// Part of a recording processed by one detector. Decoding starts at warmup_start, so the background model and
+// the direction history have converged when the results from start on are kept.
+struct VideoSegment {
+    int warmup_start;
+    int start;
+    int end;   // exclusive
+};
+
+// Offline processing of one long recording split into time segments, each decoded and decided by its own
+// detector on its own core. The results are merged back into one ordered stream and saved like a normal run.
+class SegmentRunner {
+public:
+    SegmentRunner(const AppConfig& config, const std::string& testIdentifier = "");
+
+    // Results of the whole range from seek to seek_end, empty when the video could not be read or any segment
+    // failed, a merged stream with a gap would be scored as if it were complete. Only single zone configs are
+    // supported, more zones are an error.
+    std::vector<BenchmarkResult> process();
+    // False when there were no results to save
+    bool run();
+
+    // Equal segments of [first_frame, end_frame), every segment but the first starts warmup frames early
+    static std::vector<VideoSegment> splitSegments(int first_frame, int end_frame, int segments, int warmup);
+
+private:
+    AppConfig config;
+    std::string testIdentifier;
+
+    // Last frame of the range, seek_end when it is set, otherwise the length of the video
+    int endFrame() const;
+    // False when the segment could not be opened or ended before segment.end
+    bool processSegment(const VideoSegment& segment, bool last, std::vector<BenchmarkResult>& results) const;
+};
+
+#endif //SEGMENT_RUNNER_H
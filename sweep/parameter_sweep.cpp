@@ -0,0 +1,230 @@
+#include <iostream>
+#include <map>
+#include <thread>
+
+#include "parameter_sweep.h"
+
+#include "../benchmark/benchmark.h"
+#include "../frame-index/frame_index.h"
+#include "../thread-pool/thread_pool.h"
+
+ParameterSweep::ParameterSweep(const std::string& sweepFile) {
+    YAML::Node sweep = YAML::LoadFile(sweepFile);
+
+    base_config = YAML::LoadFile(sweep["base_config"].as<std::string>());
+    test_prefix = sweep["test_prefix"].as<std::string>("sweep");
+    jobs = sweep["jobs"].as<int>(-1);
+
+    for (const auto& node : sweep["videos"]) {
+        videos.push_back({node["src"].as<std::string>(), node["annot"].as<std::string>()});
+    }
+
+    grid = parseGrid(sweep["grid"]);
+}
+
+ParameterGrid ParameterSweep::parseGrid(const YAML::Node& node) {
+    ParameterGrid grid;
+    if (!node) {
+        return grid;
+    }
+
+    for (auto it = node.begin(); it != node.end(); ++it) {
+        std::vector<YAML::Node> values;
+        if (it->second.IsSequence()) {
+            for (const auto& value : it->second) {
+                values.push_back(value);
+            }
+        } else {
+            values.push_back(it->second);
+        }
+        grid.emplace_back(it->first.as<std::string>(), values);
+    }
+    return grid;
+}
+
+std::vector<std::pair<std::string, YAML::Node>> ParameterSweep::expandGrid(const YAML::Node& base_config,
+                                                                           const ParameterGrid& grid,
+                                                                           const std::string& test_prefix) {
+    std::vector<std::pair<std::string, YAML::Node>> combinations;
+
+    size_t count = 1;
+    for (const auto& [key, values] : grid) {
+        count *= values.size();
+    }
+
+    for (size_t combination = 0; combination < count; ++combination) {
+        // Overrides are applied on the YAML level so the grid uses the same keys as params_input_file.yml
+        YAML::Node node = YAML::Clone(base_config);
+        std::string test_id = test_prefix;
+
+        size_t remainder = combination;
+        for (const auto& [key, values] : grid) {
+            const YAML::Node& value = values[remainder % values.size()];
+            remainder /= values.size();
+
+            node[key] = value;
+            test_id += "_" + key + "-" + value.Scalar();
+        }
+
+        combinations.emplace_back(test_id, node);
+    }
+
+    return combinations;
+}
+
+std::vector<SweepVariant> ParameterSweep::buildVariants() const {
+    std::vector<SweepVariant> variants;
+
+    auto combinations = expandGrid(base_config, grid, test_prefix);
+
+    for (size_t video = 0; video < videos.size(); ++video) {
+        for (const auto& [test_id, node] : combinations) {
+            SweepVariant variant;
+            variant.test_id = test_id + "_video" + std::to_string(video + 1);
+            variant.video = static_cast<int>(video);
+            variant.config = MotionDetector::parseConfig(node);
+            variant.config.video_src = videos[video].src;
+            variant.config.video_annot = videos[video].annot;
+            variant.config.debug = false;  // debug windows cannot be opened from worker threads
+            variant.config.estimator_trace_path = "";  // variants would overwrite each other's trace
+
+            variants.push_back(variant);
+        }
+    }
+
+    return variants;
+}
+
+std::shared_ptr<const DecodedClip> ParameterSweep::decodeClip(const AppConfig& config) {
+    cv::VideoCapture cap(config.video_src);
+    if (!cap.isOpened()) {
+        std::cerr << "Error: Could not open video source: " << config.video_src << std::endl;
+        return nullptr;
+    }
+
+    int height = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+    int width = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
+
+    // Margins are still in their config form here, row_end and col_end count from the bottom and right edges
+    cv::Rect roi(config.col_start, config.row_start,
+        width - config.col_end - config.col_start, height - config.row_end - config.row_start);
+
+    FrameIndex::seek(cap, config.video_src, config.seek);
+
+    auto clip = std::make_shared<DecodedClip>();
+    clip->first_frame_index = config.seek;
+
+    cv::Mat frame;
+    int frame_index = config.seek;
+    while (config.seek_end <= 0 || frame_index < config.seek_end) {
+        if (!cap.read(frame) || frame.empty()) {
+            break;
+        }
+        clip->frames.push_back(frame(roi).clone());
+        frame_index++;
+    }
+
+    cap.release();
+
+    double megabytes = clip->frames.empty() ? 0.0
+        : clip->frames.size() * clip->frames[0].total() * clip->frames[0].elemSize() / (1024.0 * 1024.0);
+    std::cout << "Decoded " << clip->frames.size() << " ROI frames from " << config.video_src
+              << " (" << static_cast<int>(megabytes) << " MB)" << std::endl;
+
+    return clip;
+}
+
+// GPU variants share the global OpenCL switch and the device, and multi-threaded ones bring their own thread pool sized
+// for all cores. Either would fight the other variants for it, so they do not run in the worker pool.
+static bool runsAlone(const AppConfig& config) {
+    return config.use_gpu || config.use_multi_thread;
+}
+
+static std::string clipKey(const AppConfig& config) {
+    return config.video_src + "|" + std::to_string(config.seek) + "|" + std::to_string(config.seek_end) + "|" +
+           std::to_string(config.row_start) + "|" + std::to_string(config.row_end) + "|" +
+           std::to_string(config.col_start) + "|" + std::to_string(config.col_end);
+}
+
+void ParameterSweep::run() {
+    std::vector<SweepVariant> variants = buildVariants();
+    if (variants.empty()) {
+        std::cerr << "Error: sweep has no videos or no parameter combinations" << std::endl;
+        return;
+    }
+
+    Benchmark wall_timer;
+    wall_timer.start();
+
+    std::map<std::string, std::shared_ptr<const DecodedClip>> clips;
+    for (const auto& variant : variants) {
+        std::string key = clipKey(variant.config);
+        if (clips.find(key) == clips.end()) {
+            clips[key] = decodeClip(variant.config);
+        }
+    }
+
+    std::vector<GroundTruth> ground_truth;
+    for (const auto& video : videos) {
+        ground_truth.push_back(loadGroundTruth(video.annot));
+    }
+
+    std::vector<std::vector<BenchmarkResult>> results(variants.size());
+    std::vector<char> succeeded(variants.size(), 0);  // not vector<bool>, workers write neighbouring entries
+
+    auto runVariant = [&](size_t i) {
+        const auto& clip = clips.at(clipKey(variants[i].config));
+        if (!clip) {
+            return;
+        }
+        try {
+            MotionDetector detector(variants[i].config, variants[i].test_id);
+            results[i] = detector.processFrames(clip->frames, clip->first_frame_index);
+            succeeded[i] = 1;
+        } catch (const std::exception& e) {
+            std::cerr << "Sweep variant " << variants[i].test_id << " failed: " << e.what() << std::endl;
+        }
+    };
+
+    int workers = jobs > 0 ? jobs : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::cout << "Running " << variants.size() << " sweep variants on " << workers << " workers" << std::endl;
+
+    // Variants are already spread over the cores, nested OpenCV threading would only oversubscribe them
+    int previous_threads = cv::getNumThreads();
+    if (workers > 1) {
+        cv::setNumThreads(1);
+    }
+
+    {
+        ThreadPool pool(workers);
+        std::vector<std::future<void>> futures;
+        for (size_t i = 0; i < variants.size(); ++i) {
+            if (!runsAlone(variants[i].config)) {
+                futures.push_back(pool.enqueue([&runVariant, i]() { runVariant(i); }));
+            }
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+    }
+
+    cv::setNumThreads(previous_threads);
+
+    for (size_t i = 0; i < variants.size(); ++i) {
+        if (runsAlone(variants[i].config)) {
+            runVariant(i);
+        }
+    }
+
+    for (size_t i = 0; i < variants.size(); ++i) {
+        if (succeeded[i]) {
+            saveBenchmarkResults(results[i], ground_truth[variants[i].video], variants[i].test_id);
+        }
+    }
+
+    std::cout << "Sweep finished in " << wall_timer.stop() / 1000.0 << " s" << std::endl;
+    if (workers > 1) {
+        std::cout << "Note: per-frame timings were measured with " << workers
+                  << " variants in parallel, use jobs: 1 for FPS comparable to single runs" << std::endl;
+    }
+}
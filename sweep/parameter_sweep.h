@@ -0,0 +1,56 @@
+#ifndef PARAMETER_SWEEP_H
+#define PARAMETER_SWEEP_H
+
+#include <opencv2/opencv.hpp>
+#include <yaml-cpp/yaml.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../motion-detector/motion_detector.h"
+
+struct SweepVideo {
+    std::string src;
+    std::string annot;
+};
+
+struct SweepVariant {
+    std::string test_id;
+    int video;
+    AppConfig config;
+};
+
+// ROI frames of one video range, decoded once and shared read-only by every variant that uses the same
+// source, seek range and margins
+struct DecodedClip {
+    int first_frame_index;
+    std::vector<cv::Mat> frames;
+};
+
+// Config keys with the values to try, in the order they appear in the sweep file
+using ParameterGrid = std::vector<std::pair<std::string, std::vector<YAML::Node>>>;
+
+class ParameterSweep {
+public:
+    explicit ParameterSweep(const std::string& sweepFile);
+
+    std::vector<SweepVariant> buildVariants() const;
+    void run();
+
+    static std::shared_ptr<const DecodedClip> decodeClip(const AppConfig& config);
+
+    static ParameterGrid parseGrid(const YAML::Node& node);
+    // Every combination of the grid applied to a copy of the base config, with test IDs naming the chosen values
+    static std::vector<std::pair<std::string, YAML::Node>> expandGrid(const YAML::Node& base_config,
+                                                                      const ParameterGrid& grid,
+                                                                      const std::string& test_prefix);
+
+private:
+    YAML::Node base_config;
+    std::string test_prefix;
+    int jobs;
+    std::vector<SweepVideo> videos;
+    ParameterGrid grid;
+};
+
+#endif //PARAMETER_SWEEP_H
@@ -0,0 +1,119 @@
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include "../motion-detector/motion_detector.h"
+#include "../benchmark/benchmark.h"
+#include "../auto-tuner/auto_tuner.h"
+#include "../benchmarks/benchmark_common.h"
+
+static AppConfig tunedConfig(const std::string& cache) {
+    AppConfig config = MotionDetector(BenchmarkHelpers::getInputFile()).getConfig();
+    config.algorithm = "FARNE";
+    config.use_gpu = false;
+    config.use_multi_thread = false;
+    config.thread_amount = -1;
+    config.flow_strips = "COLUMNS";
+    config.debug = false;
+    config.estimator_trace_path = "";
+    config.row_start = 0;
+    config.row_end = 0;
+    config.col_start = 0;
+    config.col_end = 0;
+    config.zones.clear();
+    config.auto_tune = true;
+    config.auto_tune_cache = cache;
+    config.auto_tune_frames = 2;
+    return config;
+}
+
+TEST(AutoTunerTest, CandidatesStartSingleThreaded) {
+    AppConfig config = tunedConfig("");
+    auto farneback = AutoTuner::candidates(config);
+    ASSERT_FALSE(farneback.empty());
+    EXPECT_FALSE(farneback[0].use_gpu);
+    EXPECT_FALSE(farneback[0].use_multi_thread);
+
+    // Only Farnebäck has its own threads, every thread count comes with both strip layouts
+    size_t threaded = 0, rows = 0;
+    for (const auto& variant : farneback) {
+        threaded += variant.use_multi_thread ? 1 : 0;
+        rows += variant.use_multi_thread && variant.flow_strips == "ROWS" ? 1 : 0;
+        EXPECT_TRUE(!variant.use_multi_thread || variant.thread_amount > 1);
+    }
+    EXPECT_EQ(rows * 2, threaded);
+    if (std::thread::hardware_concurrency() > 1) {
+        EXPECT_GT(threaded, 0u);
+    }
+
+    config.algorithm = "LK";
+    for (const auto& variant : AutoTuner::candidates(config)) {
+        EXPECT_FALSE(variant.use_multi_thread);
+    }
+}
+
+TEST(AutoTunerTest, SyntheticFramesMove) {
+    auto frames = AutoTuner::syntheticFrames(cv::Size(96, 64), 3);
+    ASSERT_EQ(frames.size(), 3u);
+    EXPECT_EQ(frames[0].size(), cv::Size(96, 64));
+    EXPECT_EQ(frames[0].type(), CV_8UC3);
+    EXPECT_GT(cv::norm(frames[0], frames[1], cv::NORM_L1), 0.0);
+}
+
+TEST(AutoTunerTest, SelectionIsCachedPerHostAndRoi) {
+    std::string cache = (std::filesystem::temp_directory_path() / "zebraflash_auto_tuner_test.json").string();
+    std::filesystem::remove(cache);
+
+    // An entry of another machine stays in the file and is never used here
+    {
+        nlohmann::json other = {{"entries", {{{"host", AutoTuner::hostName() + "-other"},
+                                              {"key", AutoTuner::cacheKey(tunedConfig(cache), cv::Size(96, 64))},
+                                              {"use_gpu", true}}}}};
+        std::ofstream(cache) << other.dump();
+    }
+
+    AutoTuner tuner(tunedConfig(cache));
+    bool measured = false;
+    ExecutionVariant first = tuner.select(cv::Size(96, 64), measured);
+    EXPECT_TRUE(measured);
+    EXPECT_GT(first.frame_ms, 0.0);
+
+    ExecutionVariant cached = tuner.select(cv::Size(96, 64), measured);
+    EXPECT_FALSE(measured);
+    EXPECT_EQ(cached.use_gpu, first.use_gpu);
+    EXPECT_EQ(cached.use_multi_thread, first.use_multi_thread);
+    EXPECT_EQ(cached.thread_amount, first.thread_amount);
+    EXPECT_EQ(cached.flow_strips, first.flow_strips);
+
+    // Another ROI size is measured again
+    tuner.select(cv::Size(64, 48), measured);
+    EXPECT_TRUE(measured);
+
+    std::ifstream file(cache);
+    nlohmann::json written = nlohmann::json::parse(file);
+    EXPECT_EQ(written["entries"].size(), 3u);
+    std::filesystem::remove(cache);
+}
+
+TEST(AutoTunerTest, BothStripLayoutsDecideEveryFrame) {
+    auto frames = AutoTuner::syntheticFrames(cv::Size(160, 120), 6);
+
+    AppConfig config = tunedConfig("");
+    config.auto_tune = false;
+    config.use_multi_thread = true;
+    config.thread_amount = 3;
+    for (const char* strips : {"COLUMNS", "ROWS"}) {
+        config.flow_strips = strips;
+        auto results = MotionDetector(config).processFrames(frames, 0);
+        EXPECT_EQ(results.size(), frames.size() - 1) << strips;
+    }
+}
+
+TEST(AutoTunerTest, CandidatesMustEstimateTheSingleThreadedAngles) {
+    float none = std::nanf("");
+    EXPECT_TRUE(AutoTuner::sameAngles({90.0f, none, 358.0f}, {92.0f, none, 1.0f}));
+    EXPECT_FALSE(AutoTuner::sameAngles({90.0f}, {110.0f}));
+    EXPECT_FALSE(AutoTuner::sameAngles({90.0f}, {none}));
+    EXPECT_FALSE(AutoTuner::sameAngles({90.0f, 90.0f}, {90.0f}));
+}
@@ -2,6 +2,7 @@
 #include <string>
 #include <filesystem>
 #include <motion_detector.h>
+#include <scene_generator.h>
 
 #ifndef BENCHMARK_COMMON_H
 #define BENCHMARK_COMMON_H
@@ -44,6 +45,60 @@ namespace BenchmarkHelpers {
         detector.getConfig().seek_end = 0;
     }
 
+    // One pedestrian crossing up through the middle of a 320x240 street, the scene of the synthetic detector tests
+    inline SceneConfig syntheticScene(int frame_count, unsigned int seed = 5) {
+        SceneConfig scene{};
+        scene.width = 320;
+        scene.height = 240;
+        scene.frame_count = frame_count;
+        scene.fps = 30.0;
+        scene.seed = seed;
+        scene.noise_sigma = 1.0;
+        scene.lighting_period = 0.0;
+        scene.pedestrians.push_back({0.5, 0.9, 270.0, 0.4, 0.1, 0.3, 0, -1, -1, true});
+        return scene;
+    }
+
+    // Whole frames of scene, as a video or the frame push API delivers them
+    inline std::vector<cv::Mat> syntheticFrames(const SceneConfig& scene) {
+        SceneGenerator generator(scene);
+        std::vector<cv::Mat> frames(scene.frame_count);
+        for (int i = 0; i < scene.frame_count; ++i) {
+            generator.renderFrame(i, frames[i]);
+        }
+        return frames;
+    }
+
+    // Frames of scene cut to the ROI of config, as processFrames and the equivalence harness take them
+    inline std::vector<cv::Mat> syntheticRoiFrames(const AppConfig& config, const SceneConfig& scene) {
+        std::vector<cv::Mat> frames = syntheticFrames(scene);
+        for (auto& frame : frames) {
+            frame = frame(cv::Range(config.row_start, frame.rows - config.row_end),
+                          cv::Range(config.col_start, frame.cols - config.col_end)).clone();
+        }
+        return frames;
+    }
+
+    inline std::vector<cv::Mat> syntheticRoiFrames(const AppConfig& config, int count, unsigned int seed = 5) {
+        return syntheticRoiFrames(config, syntheticScene(count, seed));
+    }
+
+    // Single-threaded Farnebäck on the CPU over one zone, with margins that leave a 300x200 ROI of the scene
+    inline AppConfig syntheticTestConfig() {
+        AppConfig config = MotionDetector(getInputFile()).getConfig();
+        config.algorithm = "FARNE";
+        config.use_gpu = false;
+        config.use_multi_thread = false;
+        config.debug = false;
+        config.estimator_trace_path = "";
+        config.row_start = 20;
+        config.row_end = 20;
+        config.col_start = 10;
+        config.col_end = 10;
+        config.zones.clear();
+        return config;
+    }
+
     inline void runBenchmarkTest(
         const std::string& testId,
         const std::string& algorithm,
@@ -0,0 +1,77 @@
+#include <filesystem>
+#include <gtest/gtest.h>
+#include "../motion-detector/motion_detector.h"
+#include "../benchmark/benchmark.h"
+#include "../benchmark_common.h"
+
+// Base configuration, same threshold as the Farnebäck default for a direct comparison
+TEST(BenchmarksTest, DISSingleCPU_DefaultConfig) {
+    BenchmarkHelpers::runBenchmarkTest(test_info_->name(), "DIS", false, false,
+        [](MotionDetector& d) {
+            d.getConfig().dis_preset = "FAST";
+            d.getConfig().dis_patch_size = -1;
+            d.getConfig().dis_patch_stride = -1;
+            d.getConfig().threshold = 2.5;
+        }
+    );
+}
+
+// Fastest preset
+TEST(BenchmarksTest, DISSingleCPU_UltraFast) {
+    BenchmarkHelpers::runBenchmarkTest(test_info_->name(), "DIS", false, false,
+        [](MotionDetector& d) {
+            d.getConfig().dis_preset = "ULTRAFAST";
+            d.getConfig().dis_patch_size = -1;
+            d.getConfig().dis_patch_stride = -1;
+            d.getConfig().threshold = 2.5;
+        }
+    );
+}
+
+// High accuracy configuration (medium preset)
+TEST(BenchmarksTest, DISSingleCPU_HighAccuracy) {
+    BenchmarkHelpers::runBenchmarkTest(test_info_->name(), "DIS", false, false,
+        [](MotionDetector& d) {
+            d.getConfig().dis_preset = "MEDIUM";
+            d.getConfig().dis_patch_size = -1;
+            d.getConfig().dis_patch_stride = -1;
+            d.getConfig().threshold = 2.0;
+        }
+    );
+}
+
+// Large patches with a wide stride (fewer, more robust matches)
+TEST(BenchmarksTest, DISSingleCPU_LargePatches) {
+    BenchmarkHelpers::runBenchmarkTest(test_info_->name(), "DIS", false, false,
+        [](MotionDetector& d) {
+            d.getConfig().dis_preset = "FAST";
+            d.getConfig().dis_patch_size = 12;
+            d.getConfig().dis_patch_stride = 6;
+            d.getConfig().threshold = 2.5;
+        }
+    );
+}
+
+// Sensitive detection (low threshold)
+TEST(BenchmarksTest, DISSingleCPU_SensitiveDetection) {
+    BenchmarkHelpers::runBenchmarkTest(test_info_->name(), "DIS", false, false,
+        [](MotionDetector& d) {
+            d.getConfig().dis_preset = "FAST";
+            d.getConfig().dis_patch_size = -1;
+            d.getConfig().dis_patch_stride = -1;
+            d.getConfig().threshold = 1.5;
+        }
+    );
+}
+
+// Conservative detection (high threshold)
+TEST(BenchmarksTest, DISSingleCPU_ConservativeDetection) {
+    BenchmarkHelpers::runBenchmarkTest(test_info_->name(), "DIS", false, false,
+        [](MotionDetector& d) {
+            d.getConfig().dis_preset = "FAST";
+            d.getConfig().dis_patch_size = -1;
+            d.getConfig().dis_patch_stride = -1;
+            d.getConfig().threshold = 4.0;
+        }
+    );
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../corpus/corpus_runner.h"
+
+// Stand-in for ZebraFlash: counts its attempts, fails for videos named bad, otherwise writes the results of a run
+static const char* FAKE_DETECTOR =
+    "#!/bin/sh\n"
+    "echo attempt >> attempts.txt\n"
+    "echo \"$OPENCV_FOR_THREADS_NUM\" > threads.txt\n"
+    "case \"$2\" in *bad*) exit 3;; esac\n"
+    "mkdir -p results\n"
+    "printf 'Test ID,Detail File\\n%s,%s_detail.csv\\n' \"$2\" \"$2\" > results/benchmark_summary.csv\n"
+    "echo detail > \"results/$2_detail.csv\"\n";
+
+class CorpusRunnerTest : public ::testing::Test {
+protected:
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "zebraflash_corpus_test";
+
+    void SetUp() override {
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+
+        std::ofstream(dir / "base.yml") << "{ algorithm: \"FARNE\", threshold: 2.5, size: 7 }\n";
+
+        std::ofstream(dir / "detector.sh") << FAKE_DETECTOR;
+        std::filesystem::permissions(dir / "detector.sh", std::filesystem::perms::owner_all);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    YAML::Node manifest(const std::string& videos) const {
+        return YAML::Load("{ base_config: \"" + (dir / "base.yml").string() + "\", detector: \"" +
+                          (dir / "detector.sh").string() + "\", output_dir: \"" + (dir / "out").string() +
+                          "\", workers: 2, retries: 1, videos: " + videos +
+                          ", configs: [ { name: \"a\", overlay: { threshold: 1.5 } }, { name: \"b\", overlay: {} } ] }");
+    }
+
+    static int lineCount(const std::filesystem::path& path) {
+        std::ifstream file(path);
+        int lines = 0;
+        for (std::string line; std::getline(file, line);) {
+            lines++;
+        }
+        return lines;
+    }
+};
+
+TEST_F(CorpusRunnerTest, AppliesOverlaysToEveryVideo) {
+    CorpusRunner runner(manifest("[ { name: \"v1\", src: \"one.mp4\" }, { src: \"/clips/two.mp4\" } ]"));
+    auto jobs = runner.buildJobs();
+
+    ASSERT_EQ(jobs.size(), 4u);
+    EXPECT_EQ(jobs[0].test_id, "a_v1");
+    EXPECT_EQ(jobs[1].test_id, "a_two");
+    EXPECT_EQ(jobs[2].test_id, "b_v1");
+    EXPECT_DOUBLE_EQ(jobs[0].config["threshold"].as<double>(), 1.5);
+    EXPECT_DOUBLE_EQ(jobs[2].config["threshold"].as<double>(), 2.5);
+    EXPECT_EQ(jobs[2].config["size"].as<int>(), 7);
+    EXPECT_EQ(jobs[1].config["video_src"].as<std::string>(), "/clips/two.mp4");
+    EXPECT_FALSE(jobs[0].config["display"].as<bool>());
+}
+
+TEST_F(CorpusRunnerTest, GathersResultsAndRetriesFailedJobs) {
+    CorpusRunner runner(manifest("[ { name: \"good\", src: \"good.mp4\" }, { name: \"bad\", src: \"bad.mp4\" } ]"));
+    EXPECT_FALSE(runner.run());
+
+    std::filesystem::path out = dir / "out";
+    EXPECT_EQ(lineCount(out / "benchmark_summary.csv"), 3);   // header and the two good jobs
+    EXPECT_TRUE(std::filesystem::exists(out / "good" / "a_good_detail.csv"));
+    EXPECT_TRUE(std::filesystem::exists(out / "good" / "b_good_detail.csv"));
+
+    EXPECT_EQ(lineCount(out / "jobs" / "a_good" / "attempts.txt"), 1);
+    EXPECT_EQ(lineCount(out / "jobs" / "a_bad" / "attempts.txt"), 2);
+    EXPECT_TRUE(std::filesystem::exists(out / "jobs" / "a_bad" / "job.log"));
+}
+
+TEST_F(CorpusRunnerTest, RerunReplacesTheSummary) {
+    CorpusRunner runner(manifest("[ { name: \"good\", src: \"good.mp4\" } ]"));
+    std::filesystem::path summary = dir / "out" / "benchmark_summary.csv";
+
+    EXPECT_TRUE(runner.run());
+    EXPECT_EQ(lineCount(summary), 3);   // header and the two configs
+    EXPECT_TRUE(runner.run());
+    EXPECT_EQ(lineCount(summary), 3);
+}
+
+TEST_F(CorpusRunnerTest, LimitsJobThreadsAndLeavesOtherChildrenAlone) {
+    // A child of the embedding program that exits while the corpus runs must still be reapable afterwards
+    pid_t other = fork();
+    ASSERT_GE(other, 0);
+    if (other == 0) {
+        _exit(7);
+    }
+
+    CorpusRunner runner(manifest("[ { name: \"good\", src: \"good.mp4\" } ]"));
+    EXPECT_TRUE(runner.run());
+
+    int status = 0;
+    ASSERT_EQ(waitpid(other, &status, 0), other);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 7);
+
+    std::ifstream threads(dir / "out" / "jobs" / "a_good" / "threads.txt");
+    std::string value;
+    std::getline(threads, value);
+    EXPECT_EQ(value, "1");
+}
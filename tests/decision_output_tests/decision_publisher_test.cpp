@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../decision-output/decision_publisher.h"
+
+static std::string tempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+TEST(DecisionPublisherTest, SharedMemoryRoundTrip) {
+    std::string path = tempPath("zebraflash_decisions_test.shm");
+    DecisionPublisher publisher(DecisionOutputMode::SHM, path, false);
+    ASSERT_TRUE(publisher.isOpen());
+
+    DecisionMailboxReader reader;
+    ASSERT_TRUE(reader.open(path));
+
+    publisher.publish(0, 10, 1000, 3, false, std::nanf(""));
+    publisher.publish(0, 11, 2000, 0, true, 92.0f);
+    publisher.publish(0, 12, 3000, 0, true, 91.0f);
+
+    DecisionMessage message{};
+    ASSERT_TRUE(reader.read(message));
+    EXPECT_EQ(message.magic, DECISION_MESSAGE_MAGIC);
+    EXPECT_EQ(message.type, static_cast<uint32_t>(DecisionMessageType::Transition));
+    EXPECT_EQ(message.frame_index, 10);
+    EXPECT_TRUE(std::isnan(message.move_mode));
+
+    ASSERT_TRUE(reader.read(message));
+    EXPECT_EQ(message.type, static_cast<uint32_t>(DecisionMessageType::Transition));
+    EXPECT_EQ(message.location, 0);
+    EXPECT_EQ(message.is_crossing, 1u);
+    EXPECT_EQ(message.capture_time_ns, 2000);
+
+    ASSERT_TRUE(reader.read(message));
+    EXPECT_EQ(message.type, static_cast<uint32_t>(DecisionMessageType::Heartbeat));
+    EXPECT_EQ(message.sequence, 2u);
+    EXPECT_FALSE(reader.read(message));
+
+    EXPECT_EQ(publisher.publishedMessages(), 3);
+    std::filesystem::remove(path);
+}
+
+TEST(DecisionPublisherTest, SlowReaderLosesOverwrittenMessages) {
+    std::string path = tempPath("zebraflash_decisions_lap_test.shm");
+    DecisionPublisher publisher(DecisionOutputMode::SHM, path, false);
+    DecisionMailboxReader reader;
+    ASSERT_TRUE(reader.open(path));
+
+    int total = static_cast<int>(DECISION_MAILBOX_SLOTS) + 10;
+    for (int i = 0; i < total; ++i) {
+        publisher.publish(0, i, i, i % 4, false, 0.0f);
+    }
+
+    DecisionMessage message{};
+    ASSERT_TRUE(reader.read(message));
+    EXPECT_EQ(message.frame_index, 10);
+    EXPECT_EQ(reader.lostMessages(), 10u);
+    std::filesystem::remove(path);
+}
+
+TEST(DecisionPublisherTest, EdgesOnlySkipsHeartbeats) {
+    std::string path = tempPath("zebraflash_decisions_edges_test.shm");
+    DecisionPublisher publisher(DecisionOutputMode::SHM, path, true);
+    DecisionMailboxReader reader;
+    ASSERT_TRUE(reader.open(path));
+
+    int locations[] = {3, 3, 0, 0, 0, 3, 3};
+    for (int i = 0; i < 7; ++i) {
+        publisher.publish(0, i, i, locations[i], locations[i] == 0, 0.0f);
+    }
+    // A second zone keeps its own previous decision
+    publisher.publish(1, 7, 7, 3, false, 0.0f);
+
+    std::vector<int64_t> frames;
+    DecisionMessage message{};
+    while (reader.read(message)) {
+        EXPECT_EQ(message.type, static_cast<uint32_t>(DecisionMessageType::Transition));
+        frames.push_back(message.frame_index);
+    }
+    EXPECT_EQ(frames, (std::vector<int64_t>{0, 2, 5, 7}));
+    std::filesystem::remove(path);
+}
+
+TEST(DecisionPublisherTest, DatagramsReachABoundSocket) {
+    std::string path = tempPath("zebraflash_decisions_test.sock");
+    unlink(path.c_str());
+
+    int consumer = socket(AF_UNIX, SOCK_DGRAM, 0);
+    ASSERT_GE(consumer, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    ASSERT_EQ(bind(consumer, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+    DecisionPublisher publisher(DecisionOutputMode::UDS, path, false);
+    ASSERT_TRUE(publisher.isOpen());
+    publisher.publish(0, 42, 100, 2, true, 10.0f);
+
+    DecisionMessage message{};
+    ASSERT_EQ(recv(consumer, &message, sizeof(message), 0), static_cast<ssize_t>(sizeof(message)));
+    EXPECT_EQ(message.frame_index, 42);
+    EXPECT_EQ(message.location, 2);
+    EXPECT_EQ(publisher.droppedMessages(), 0);
+
+    close(consumer);
+    unlink(path.c_str());
+}
+
+TEST(DecisionPublisherTest, MissingConsumerDropsWithoutBlocking) {
+    std::string path = tempPath("zebraflash_no_consumer_test.sock");
+    unlink(path.c_str());
+
+    DecisionPublisher publisher(DecisionOutputMode::UDS, path, false);
+    ASSERT_TRUE(publisher.isOpen());
+    for (int i = 0; i < 5; ++i) {
+        publisher.publish(0, i, i, 3, false, 0.0f);
+    }
+
+    EXPECT_EQ(publisher.publishedMessages(), 0);
+    EXPECT_EQ(publisher.droppedMessages(), 5);
+    EXPECT_GT(publisher.latencyPercentile(99.0), 0.0);
+}
@@ -0,0 +1,91 @@
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "../motion-detector/motion_detector.h"
+#include "../benchmark/benchmark.h"
+#include "../equivalence/equivalence_harness.h"
+#include "../benchmarks/benchmark_common.h"
+
+TEST(EquivalenceHarnessTest, AngleDifferenceWrapsAround) {
+    float none = std::nanf("");
+    EXPECT_DOUBLE_EQ(EquivalenceHarness::angleDifference(10.0f, 350.0f), 20.0);
+    EXPECT_DOUBLE_EQ(EquivalenceHarness::angleDifference(180.0f, 170.0f), 10.0);
+    EXPECT_DOUBLE_EQ(EquivalenceHarness::angleDifference(none, none), 0.0);
+    EXPECT_TRUE(std::isnan(EquivalenceHarness::angleDifference(none, 90.0f)));
+}
+
+TEST(EquivalenceHarnessTest, SameConfigIsEquivalent) {
+    AppConfig config = BenchmarkHelpers::syntheticTestConfig();
+    auto frames = BenchmarkHelpers::syntheticRoiFrames(config, 30, 11);
+
+    EquivalenceReport report = EquivalenceHarness(config, config).compare(frames, 100);
+    EXPECT_EQ(report.frames, 29);
+    EXPECT_EQ(report.zones, 1);
+    EXPECT_EQ(report.angle_mismatches, 0);
+    EXPECT_EQ(report.vote_mismatches, 0);
+    EXPECT_EQ(report.decision_mismatches, 0);
+    EXPECT_TRUE(report.divergences.empty());
+    EXPECT_GT(report.reference_ms, 0.0);
+    EXPECT_GT(report.speedup(), 0.0);
+    EXPECT_TRUE(report.passed(EquivalenceTolerance()));
+}
+
+TEST(EquivalenceHarnessTest, ReportsWhereTheCandidateDiverges) {
+    AppConfig reference = BenchmarkHelpers::syntheticTestConfig();
+    AppConfig candidate = reference;
+    // No flow is above this threshold, the candidate never sees the pedestrian move
+    candidate.threshold = 1000.0;
+    auto frames = BenchmarkHelpers::syntheticRoiFrames(reference, 30, 11);
+
+    EquivalenceReport report = EquivalenceHarness(reference, candidate).compare(frames, 100);
+    ASSERT_EQ(report.frames, 29);
+    EXPECT_GT(report.angle_mismatches, 0);
+    ASSERT_FALSE(report.divergences.empty());
+    // The 29 decided frames are numbered 100 to 128, like the results of processFrames
+    EXPECT_GE(report.divergences.front().frame_index, 100);
+    EXPECT_LE(report.divergences.back().frame_index, 128);
+    EXPECT_TRUE(std::isnan(report.divergences.front().candidate.move_mode));
+    EXPECT_FALSE(report.passed(EquivalenceTolerance()));
+
+    // Declared tolerances let the same divergences pass
+    EquivalenceTolerance loose;
+    loose.angle_mismatch = 1.0;
+    loose.vote_mismatch = 1.0;
+    loose.decision_mismatch = 1.0;
+    EXPECT_TRUE(report.passed(loose));
+
+    std::string csv = (std::filesystem::temp_directory_path() / "zebraflash_equivalence_test.csv").string();
+    ASSERT_TRUE(writeDivergenceCSV(report, csv));
+    std::ifstream file(csv);
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(file, line)) {
+        lines++;
+    }
+    EXPECT_EQ(lines, report.divergences.size() + 1);
+    std::filesystem::remove(csv);
+}
+
+TEST(EquivalenceHarnessTest, OtherMarginsAreNotCompared) {
+    AppConfig reference = BenchmarkHelpers::syntheticTestConfig();
+    AppConfig candidate = reference;
+    candidate.row_start = 0;
+
+    auto frames = BenchmarkHelpers::syntheticRoiFrames(reference, 3, 11);
+    EquivalenceReport report = EquivalenceHarness(reference, candidate).compare(frames);
+    EXPECT_EQ(report.comparedZoneFrames(), 0);
+    EXPECT_FALSE(report.passed(EquivalenceTolerance()));
+}
+
+TEST(EquivalenceHarnessTest, OtherZonesAreNotCompared) {
+    AppConfig reference = BenchmarkHelpers::syntheticTestConfig();
+    reference.zones.push_back({"left", 0, 0, 0, 150, 60, 120, 240, 300, 1.0, 5, 10, ""});
+    reference.zones.push_back({"right", 0, 0, 150, 0, 60, 120, 240, 300, 1.0, 5, 10, ""});
+    AppConfig candidate = reference;
+    candidate.zones[1].angle_up_min = 45;
+
+    auto frames = BenchmarkHelpers::syntheticRoiFrames(reference, 3, 11);
+    EquivalenceReport report = EquivalenceHarness(reference, candidate).compare(frames);
+    EXPECT_EQ(report.comparedZoneFrames(), 0);
+}
@@ -0,0 +1,25 @@
+#include <gtest/gtest.h>
+#include "../motion-estimator/motion_estimator.h"
+
+TEST(BlobCropsTest, PadsAndClipsToFrame) {
+    auto crops = FlowEstimatorUtils::blobCrops({cv::Rect(2, 50, 20, 30)}, 8, cv::Size(320, 240));
+
+    ASSERT_EQ(crops.size(), 1u);
+    EXPECT_EQ(crops[0], cv::Rect(0, 42, 30, 46));
+}
+
+TEST(BlobCropsTest, MergesOverlappingCropsTransitively) {
+    // The first two overlap at a corner once padded, only their merged crop reaches the third one
+    std::vector<cv::Rect> blobs = {cv::Rect(10, 10, 10, 10), cv::Rect(26, 26, 10, 10), cv::Rect(34, 6, 6, 6),
+                                   cv::Rect(200, 200, 10, 10)};
+    auto crops = FlowEstimatorUtils::blobCrops(blobs, 4, cv::Size(320, 240));
+
+    ASSERT_EQ(crops.size(), 2u);
+    EXPECT_EQ(crops[0], cv::Rect(6, 2, 38, 38));
+    EXPECT_EQ(crops[1], cv::Rect(196, 196, 18, 18));
+    EXPECT_EQ((crops[0] & crops[1]).area(), 0);
+}
+
+TEST(BlobCropsTest, NoBlobsGiveNoCrops) {
+    EXPECT_TRUE(FlowEstimatorUtils::blobCrops({}, 16, cv::Size(320, 240)).empty());
+}
@@ -0,0 +1,182 @@
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <gtest/gtest.h>
+#include "../motion-detector/motion_detector.h"
+#include "../benchmark/benchmark.h"
+#include "../frame-cache/frame_cache.h"
+#include "../benchmarks/benchmark_common.h"
+
+class FrameCacheTest : public ::testing::Test {
+protected:
+    std::filesystem::path dir;
+    std::string source;
+    std::vector<cv::Mat> frames;
+
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "zebraflash_frame_cache_test";
+        std::filesystem::create_directories(dir);
+
+        // The cache only stamps the source file, its content does not have to be a real video
+        source = (dir / "source.mp4").string();
+        std::ofstream(source) << "not a video";
+
+        frames = BenchmarkHelpers::syntheticRoiFrames(BenchmarkHelpers::syntheticTestConfig(), 40, 3);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    FrameCacheKey key(bool gray) const {
+        return {source, 10, 20, 5, 15, 100, 140, gray};
+    }
+
+    std::string writeCache(const FrameCacheKey& cache_key, FrameCacheCompression compression) {
+        std::string path = frameCachePath(dir.string(), cache_key);
+        FrameCacheWriter writer;
+        EXPECT_TRUE(writer.open(path, cache_key, compression, 8));
+        for (const auto& frame : frames) {
+            EXPECT_TRUE(writer.write(frame));
+        }
+        EXPECT_TRUE(writer.finish());
+        return path;
+    }
+};
+
+TEST_F(FrameCacheTest, RawCacheReturnsIdenticalFrames) {
+    std::string path = writeCache(key(false), FrameCacheCompression::None);
+
+    FrameCacheReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_TRUE(reader.matches(key(false)));
+    EXPECT_FALSE(reader.matches(key(true)));
+    EXPECT_EQ(reader.frameCount(), static_cast<int>(frames.size()));
+    EXPECT_EQ(reader.firstFrameIndex(), 100);
+
+    cv::Mat frame;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        ASSERT_TRUE(reader.frame(static_cast<int>(i), frame));
+        EXPECT_EQ(cv::norm(frame, frames[i], cv::NORM_INF), 0.0) << "frame " << i;
+    }
+}
+
+TEST_F(FrameCacheTest, DeltaCompressionIsLosslessWithRandomAccess) {
+    std::string path = writeCache(key(false), FrameCacheCompression::DeltaRLE);
+
+    FrameCacheReader reader;
+    ASSERT_TRUE(reader.open(path));
+
+    cv::Mat frame;
+    for (int i : {0, 1, 2, 9, 8, 30, 31, 39, 5}) {
+        ASSERT_TRUE(reader.frame(i, frame));
+        EXPECT_EQ(cv::norm(frame, frames[i], cv::NORM_INF), 0.0) << "frame " << i;
+    }
+
+    size_t raw_bytes = frames.size() * frames[0].total() * frames[0].elemSize();
+    EXPECT_LT(std::filesystem::file_size(path), raw_bytes);
+}
+
+TEST_F(FrameCacheTest, GrayCacheStoresConvertedFrames) {
+    std::string path = writeCache(key(true), FrameCacheCompression::None);
+
+    FrameCacheReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_TRUE(reader.matches(key(true)));
+
+    cv::Mat frame, expected;
+    ASSERT_TRUE(reader.frame(12, frame));
+    cv::cvtColor(frames[12], expected, cv::COLOR_BGR2GRAY);
+    EXPECT_EQ(frame.channels(), 1);
+    EXPECT_EQ(cv::norm(frame, expected, cv::NORM_INF), 0.0);
+}
+
+TEST_F(FrameCacheTest, ChangedSourceInvalidatesCache) {
+    std::string path = writeCache(key(false), FrameCacheCompression::None);
+
+    std::ofstream(source, std::ios::app) << " re-encoded";
+
+    FrameCacheReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_FALSE(reader.matches(key(false)));
+}
+
+TEST_F(FrameCacheTest, DiscardedCacheLeavesNoFile) {
+    std::string path = frameCachePath(dir.string(), key(false));
+    {
+        FrameCacheWriter writer;
+        ASSERT_TRUE(writer.open(path, key(false), FrameCacheCompression::None));
+        writer.write(frames[0]);
+    }
+
+    FrameCacheReader reader;
+    EXPECT_FALSE(reader.open(path));
+    EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+}
+
+// Predicted Intent column of the newest detail CSV of test_id
+static std::vector<std::string> predictedIntents(const std::string& test_id) {
+    std::filesystem::path newest;
+    for (const auto& entry : std::filesystem::directory_iterator("results")) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind(test_id + "_benchmark_", 0) == 0 &&
+            (newest.empty() || entry.last_write_time() > std::filesystem::last_write_time(newest))) {
+            newest = entry.path();
+        }
+    }
+
+    std::vector<std::string> intents;
+    std::ifstream file(newest);
+    std::string line;
+    bool rows = false;
+    while (std::getline(file, line)) {
+        if (rows) {
+            std::stringstream cells(line);
+            std::string cell;
+            for (int column = 0; column < 4 && std::getline(cells, cell, ','); ++column) {}
+            intents.push_back(cell);
+        }
+        rows = rows || line.rfind("Frame Index,", 0) == 0;
+    }
+    return intents;
+}
+
+TEST_F(FrameCacheTest, CachedRunDecidesLikeTheUncachedOne) {
+    SceneConfig scene = BenchmarkHelpers::syntheticScene(40, 3);
+    std::string video = (dir / "clip.avi").string();
+    {
+        cv::VideoWriter writer(video, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), scene.fps,
+                               cv::Size(scene.width, scene.height));
+        for (const auto& frame : BenchmarkHelpers::syntheticFrames(scene)) {
+            writer.write(frame);
+        }
+    }
+
+    // A GRAY cache is asked for, the flow estimators still cache color frames for their background model
+    for (const char* algorithm : {"FARNE", "LK", "DIS"}) {
+        AppConfig config = BenchmarkHelpers::syntheticTestConfig();
+        config.algorithm = algorithm;
+        config.display = false;
+        config.video_src = video;
+        config.video_annot = "";
+        config.seek = 0;
+        config.seek_end = 0;
+        config.frame_cache_dir = dir.string();
+        config.frame_cache_format = "GRAY";
+        config.frame_cache_compression = false;
+
+        std::string test_id = std::string("zebraflash_frame_cache_") + algorithm;
+        MotionDetector(config, test_id + "_uncached").run();
+        FrameCacheKey color_key = {video, config.row_start, config.row_end, config.col_start, config.col_end,
+                                   config.seek, config.seek_end, false};
+        std::string cache_path = frameCachePath(dir.string(), color_key);
+        ASSERT_TRUE(std::filesystem::exists(cache_path)) << algorithm;
+
+        MotionDetector(config, test_id + "_cached").run();
+
+        std::vector<std::string> uncached = predictedIntents(test_id + "_uncached");
+        ASSERT_FALSE(uncached.empty()) << algorithm;
+        EXPECT_EQ(predictedIntents(test_id + "_cached"), uncached) << algorithm;
+        std::filesystem::remove(cache_path);
+    }
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <opencv2/opencv.hpp>
+#include "../utils/frame_difference.h"
+
+static int referenceCount(const cv::Mat& current, const cv::Mat& previous, int threshold) {
+    cv::Mat diff;
+    cv::absdiff(current, previous, diff);
+    cv::threshold(diff, diff, threshold, 255, cv::THRESH_BINARY);
+    return cv::countNonZero(diff);
+}
+
+TEST(FrameDifferenceTest, MatchesAbsdiffThresholdCount) {
+    cv::RNG rng(42);
+    // Odd widths leave a scalar tail after the vector loop
+    for (const cv::Size& size : {cv::Size(1, 1), cv::Size(17, 3), cv::Size(641, 479), cv::Size(4099, 7)}) {
+        cv::Mat current(size, CV_8UC1), previous(size, CV_8UC1);
+        rng.fill(current, cv::RNG::UNIFORM, 0, 256);
+        rng.fill(previous, cv::RNG::UNIFORM, 0, 256);
+
+        for (int threshold : {0, 1, 50, 150, 254}) {
+            EXPECT_EQ(FrameDifference::countChanged(current, previous, threshold),
+                      referenceCount(current, previous, threshold)) << size << " threshold " << threshold;
+        }
+    }
+}
+
+TEST(FrameDifferenceTest, CountsNonContinuousRegions) {
+    cv::RNG rng(7);
+    cv::Mat current(240, 320, CV_8UC1), previous(240, 320, CV_8UC1);
+    rng.fill(current, cv::RNG::UNIFORM, 0, 256);
+    rng.fill(previous, cv::RNG::UNIFORM, 0, 256);
+
+    cv::Rect zone(13, 21, 151, 97);
+    ASSERT_FALSE(current(zone).isContinuous());
+    EXPECT_EQ(FrameDifference::countChanged(current(zone), previous(zone), 100),
+              referenceCount(current(zone), previous(zone), 100));
+}
+
+TEST(FrameDifferenceTest, ThresholdsOutsideThePixelRange) {
+    cv::Mat current(10, 10, CV_8UC1, cv::Scalar(255)), previous(10, 10, CV_8UC1, cv::Scalar(0));
+
+    EXPECT_EQ(FrameDifference::countChanged(current, previous, 255), 0);
+    EXPECT_EQ(FrameDifference::countChanged(current, current, -1), 100);
+}
+
+TEST(FrameDifferenceTest, StopsOnceTheCountIsReached) {
+    cv::Mat current(100, 64, CV_8UC1, cv::Scalar(200)), previous(100, 64, CV_8UC1, cv::Scalar(0));
+
+    // Whole rows are counted, so the count stops at the first row past stop_after
+    EXPECT_EQ(FrameDifference::countChanged(current, previous, 150, 100), 128);
+    EXPECT_EQ(FrameDifference::countChanged(current, previous, 150), 6400);
+}
+
+TEST(FrameDifferenceTest, HasChangedNeedsMoreThanMinCount) {
+    cv::Mat current(48, 48, CV_8UC1, cv::Scalar(0)), previous(48, 48, CV_8UC1, cv::Scalar(0));
+    current(cv::Rect(0, 0, 10, 1)).setTo(cv::Scalar(255));
+
+    EXPECT_TRUE(FrameDifference::hasChanged(current, previous, 150, 9));
+    EXPECT_FALSE(FrameDifference::hasChanged(current, previous, 150, 10));
+    EXPECT_FALSE(FrameDifference::hasChanged(current, current, 150, 0));
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "../frame-index/frame_index.h"
+
+// Every frame is filled with its own index times 4, so a decoded frame tells where the capture is
+static std::string writeNumberedClip(const std::string& name, int frames) {
+    std::string path = (std::filesystem::temp_directory_path() / name).string();
+    cv::VideoWriter writer(path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 25.0, cv::Size(64, 48));
+    for (int i = 0; i < frames; ++i) {
+        writer.write(cv::Mat(48, 64, CV_8UC3, cv::Scalar::all(i * 4)));
+    }
+    return path;
+}
+
+static int frameNumber(const cv::Mat& frame) {
+    return static_cast<int>(std::lround(cv::mean(frame)[0] / 4.0));
+}
+
+TEST(FrameIndexTest, IndexesEveryFrame) {
+    std::string source = writeNumberedClip("zebraflash_frame_index_test.avi", 40);
+    std::string sidecar = FrameIndex::sidecarPath(source);
+
+    ASSERT_TRUE(FrameIndex::build(source, sidecar));
+
+    FrameIndex index;
+    ASSERT_TRUE(index.load(sidecar, source));
+    EXPECT_EQ(index.frameCount(), 40);
+    EXPECT_TRUE(index.isKeyframe(0));
+    EXPECT_EQ(index.keyframeBefore(0), 0);
+    for (int i = 1; i < index.frameCount(); ++i) {
+        EXPECT_GT(index.timestampMs(i), index.timestampMs(i - 1));
+        EXPECT_LE(index.keyframeBefore(i), i);
+    }
+
+    std::filesystem::remove(sidecar);
+    std::filesystem::remove(source);
+}
+
+TEST(FrameIndexTest, SeekLandsOnTheExactFrame) {
+    std::string source = writeNumberedClip("zebraflash_frame_index_seek_test.avi", 40);
+    ASSERT_TRUE(FrameIndex::build(source, FrameIndex::sidecarPath(source)));
+
+    for (int target : {0, 1, 17, 39}) {
+        cv::VideoCapture cap(source);
+        ASSERT_TRUE(cap.isOpened());
+        FrameIndex::seek(cap, source, target);
+
+        cv::Mat frame;
+        ASSERT_TRUE(cap.read(frame));
+        EXPECT_EQ(frameNumber(frame), target);
+    }
+
+    std::filesystem::remove(FrameIndex::sidecarPath(source));
+    std::filesystem::remove(source);
+}
+
+TEST(FrameIndexTest, StaleIndexIsIgnored) {
+    std::string source = writeNumberedClip("zebraflash_frame_index_stale_test.avi", 20);
+    std::string sidecar = FrameIndex::sidecarPath(source);
+    ASSERT_TRUE(FrameIndex::build(source, sidecar));
+
+    writeNumberedClip("zebraflash_frame_index_stale_test.avi", 30);
+
+    FrameIndex index;
+    EXPECT_FALSE(index.load(sidecar, source));
+
+    std::filesystem::remove(sidecar);
+    std::filesystem::remove(source);
+}
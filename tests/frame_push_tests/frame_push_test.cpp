@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <vector>
+#include "../frame-push/frame_push.h"
+#include "../benchmarks/benchmark_common.h"
+
+static PushedFrame bgrFrame(const cv::Mat& image, int64_t timestamp_ns, int& releases) {
+    PushedFrame frame;
+    frame.data = image.data;
+    frame.width = image.cols;
+    frame.height = image.rows;
+    frame.stride = image.step;
+    frame.format = PixelFormat::BGR;
+    frame.timestamp_ns = timestamp_ns;
+    frame.release = [&releases]() { releases++; };
+    return frame;
+}
+
+TEST(FramePushTest, BgrAndLumaAreReadInPlace) {
+    cv::Mat bgr(48, 64, CV_8UC3, cv::Scalar(10, 20, 30));
+    cv::Rect roi(4, 2, 32, 20);
+    cv::Mat converted, image;
+
+    PushedFrame frame;
+    frame.data = bgr.data;
+    frame.width = bgr.cols;
+    frame.height = bgr.rows;
+    frame.stride = bgr.step;
+    ASSERT_TRUE(FramePushDetector::roiImage(frame, roi, false, converted, image));
+    EXPECT_EQ(image.data, bgr.ptr(2, 4));
+    EXPECT_EQ(image.size(), roi.size());
+
+    // NV12 with a padded stride, a gray estimator reads the luma plane directly
+    size_t stride = 80;
+    std::vector<uint8_t> nv12(stride * 48 * 3 / 2, 128);
+    frame.data = nv12.data();
+    frame.stride = stride;
+    frame.format = PixelFormat::NV12;
+    ASSERT_TRUE(FramePushDetector::roiImage(frame, roi, false, converted, image));
+    EXPECT_EQ(image.data, nv12.data() + 2 * stride + 4);
+    EXPECT_EQ(image.channels(), 1);
+
+    ASSERT_TRUE(FramePushDetector::roiImage(frame, roi, true, converted, image));
+    EXPECT_EQ(image.channels(), 3);
+    EXPECT_EQ(image.size(), roi.size());
+}
+
+TEST(FramePushTest, ConvertedFormatsMatchBgr) {
+    cv::Mat bgr(48, 64, CV_8UC3);
+    cv::randu(bgr, 0, 255);
+    cv::Mat rgb, bgra;
+    cv::cvtColor(bgr, rgb, cv::COLOR_BGR2RGB);
+    cv::cvtColor(bgr, bgra, cv::COLOR_BGR2BGRA);
+    cv::Rect roi(5, 3, 30, 21);
+
+    PushedFrame frame;
+    frame.width = bgr.cols;
+    frame.height = bgr.rows;
+    cv::Mat converted, image;
+
+    frame.data = rgb.data;
+    frame.format = PixelFormat::RGB;
+    ASSERT_TRUE(FramePushDetector::roiImage(frame, roi, true, converted, image));
+    EXPECT_EQ(cv::norm(image, bgr(roi), cv::NORM_INF), 0.0);
+
+    frame.data = bgra.data;
+    frame.format = PixelFormat::BGRA;
+    ASSERT_TRUE(FramePushDetector::roiImage(frame, roi, false, converted, image));
+    cv::Mat gray;
+    cv::cvtColor(bgr(roi), gray, cv::COLOR_BGR2GRAY);
+    EXPECT_LE(cv::norm(image, gray, cv::NORM_INF), 1.0);
+
+    // YUYV needs pixel pairs
+    frame.width = 63;
+    frame.format = PixelFormat::YUYV;
+    EXPECT_FALSE(FramePushDetector::roiImage(frame, roi, false, converted, image));
+}
+
+TEST(FramePushTest, PushMatchesProcessFramesAndReleasesEveryFrame) {
+    AppConfig config = BenchmarkHelpers::syntheticTestConfig();
+    std::vector<cv::Mat> frames = BenchmarkHelpers::syntheticFrames(BenchmarkHelpers::syntheticScene(30, 3));
+
+    cv::Range rows(config.row_start, frames[0].rows - config.row_end);
+    cv::Range cols(config.col_start, frames[0].cols - config.col_end);
+    std::vector<cv::Mat> roi_frames;
+    for (const auto& frame : frames) {
+        roi_frames.push_back(frame(rows, cols));
+    }
+    auto expected = MotionDetector(config).processFrames(roi_frames, 0);
+
+    FramePushDetector detector(config);
+    int releases = 0;
+    std::vector<PushDecision> decisions;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        PushedFrame frame = bgrFrame(frames[i], static_cast<int64_t>(i) * 1000, releases);
+        PushDecision decision;
+        if (detector.push(frame, decision)) {
+            decisions.push_back(decision);
+        }
+        EXPECT_EQ(releases, static_cast<int>(i) + 1);
+    }
+
+    ASSERT_EQ(decisions.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(decisions[i].zones.size(), 1u);
+        EXPECT_EQ(decisions[i].zones[0].is_crossing, expected[i].is_crossing) << "frame " << i;
+        EXPECT_EQ(decisions[i].frame_index, static_cast<int>(i) + 1);
+        EXPECT_EQ(decisions[i].timestamp_ns, static_cast<int64_t>(i + 1) * 1000);
+    }
+
+    // Another size is rejected and still released
+    cv::Mat small(120, 160, CV_8UC3, cv::Scalar::all(0));
+    PushedFrame frame = bgrFrame(small, 0, releases);
+    PushDecision decision;
+    EXPECT_FALSE(detector.push(frame, decision));
+    EXPECT_EQ(releases, static_cast<int>(frames.size()) + 1);
+    EXPECT_EQ(detector.droppedFrames(), 1u);
+}
+
+TEST(FramePushTest, AsyncReleasesDecidedAndDroppedFrames) {
+    std::vector<cv::Mat> frames = BenchmarkHelpers::syntheticFrames(BenchmarkHelpers::syntheticScene(40, 3));
+
+    std::atomic<int> releases{0};
+    std::atomic<int> decided{0};
+    {
+        FramePushDetector detector(BenchmarkHelpers::syntheticTestConfig());
+        ASSERT_TRUE(detector.start([&decided](const PushDecision&) { decided++; }));
+        for (const auto& image : frames) {
+            PushedFrame frame;
+            frame.data = image.data;
+            frame.width = image.cols;
+            frame.height = image.rows;
+            frame.stride = image.step;
+            frame.release = [&releases]() { releases++; };
+            detector.pushAsync(frame);
+        }
+        detector.stop();
+
+        EXPECT_EQ(static_cast<size_t>(decided.load()) + detector.droppedFrames() + 1, frames.size());
+    }
+    EXPECT_EQ(releases.load(), static_cast<int>(frames.size()));
+}
+
+TEST(FramePushTest, GrayFramesReachTheFlowEstimatorsInColor) {
+    AppConfig config = BenchmarkHelpers::syntheticTestConfig();
+    std::vector<cv::Mat> frames = BenchmarkHelpers::syntheticFrames(BenchmarkHelpers::syntheticScene(30, 3));
+
+    // MOG2 of the flow estimators models color, pushed gray frames are decided as gray BGR frames
+    std::vector<cv::Mat> grays(frames.size()), roi_frames(frames.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        cv::cvtColor(frames[i], grays[i], cv::COLOR_BGR2GRAY);
+        cv::Mat color;
+        cv::cvtColor(grays[i], color, cv::COLOR_GRAY2BGR);
+        roi_frames[i] = color(cv::Range(config.row_start, color.rows - config.row_end),
+                              cv::Range(config.col_start, color.cols - config.col_end));
+    }
+    auto expected = MotionDetector(config).processFrames(roi_frames, 0);
+
+    FramePushDetector detector(config);
+    int releases = 0;
+    std::vector<PushDecision> decisions;
+    for (size_t i = 0; i < grays.size(); ++i) {
+        PushedFrame frame = bgrFrame(grays[i], static_cast<int64_t>(i) * 1000, releases);
+        frame.format = PixelFormat::GRAY;
+        PushDecision decision;
+        if (detector.push(frame, decision)) {
+            decisions.push_back(decision);
+        }
+    }
+
+    ASSERT_EQ(decisions.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(decisions[i].zones[0].is_crossing, expected[i].is_crossing) << "frame " << i;
+    }
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include "../motion-detector/live_grabber.h"
+
+static std::string writeTestClip(int frames, double fps) {
+    std::string path = (std::filesystem::temp_directory_path() / "zebraflash_live_grabber_test.avi").string();
+    cv::VideoWriter writer(path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), fps, cv::Size(160, 120));
+    for (int i = 0; i < frames; ++i) {
+        writer.write(cv::Mat(120, 160, CV_8UC3, cv::Scalar(i * 5, i * 5, i * 5)));
+    }
+    return path;
+}
+
+TEST(LiveFrameGrabberTest, SlowReaderOnlySeesNewerFrames) {
+    std::string path = writeTestClip(30, 200.0);
+
+    LiveFrameGrabber grabber;
+    ASSERT_TRUE(grabber.open(path, 0, 0));
+    EXPECT_EQ(grabber.frameSize(), cv::Size(160, 120));
+
+    GrabbedFrame frame;
+    int taken = 0;
+    int last_index = -1;
+    int64_t last_capture = 0;
+    while (grabber.next(frame)) {
+        EXPECT_GT(frame.frame_index, last_index);
+        EXPECT_GE(frame.capture_time_ns, last_capture);
+        last_index = frame.frame_index;
+        last_capture = frame.capture_time_ns;
+        taken++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+    }
+    grabber.close();
+
+    EXPECT_EQ(grabber.grabbedFrames(), 30);
+    EXPECT_EQ(static_cast<size_t>(taken) + grabber.droppedFrames(), 30u);
+    EXPECT_GT(grabber.droppedFrames(), 0u);
+    EXPECT_EQ(last_index, 29);
+
+    std::filesystem::remove(path);
+}
+
+TEST(LiveFrameGrabberTest, StopsAtSeekEnd) {
+    std::string path = writeTestClip(20, 500.0);
+
+    LiveFrameGrabber grabber;
+    ASSERT_TRUE(grabber.open(path, 5, 10));
+
+    GrabbedFrame frame;
+    int last_index = -1;
+    while (grabber.next(frame)) {
+        last_index = frame.frame_index;
+    }
+    grabber.close();
+
+    EXPECT_EQ(grabber.grabbedFrames(), 5);
+    EXPECT_EQ(last_index, 9);
+
+    std::filesystem::remove(path);
+}
+
+TEST(LiveFrameGrabberTest, FastReaderWaitsForEveryFrameAfterReopening) {
+    std::string path = writeTestClip(10, 100.0);
+
+    // The reader is faster than the source, so next has to wait on an open mailbox, also after a second open
+    LiveFrameGrabber grabber;
+    for (int run = 0; run < 2; ++run) {
+        ASSERT_TRUE(grabber.open(path, 0, 0));
+
+        GrabbedFrame frame;
+        int taken = 0;
+        while (grabber.next(frame)) {
+            taken++;
+        }
+        grabber.close();
+
+        EXPECT_EQ(grabber.grabbedFrames(), 10) << "run " << run;
+        EXPECT_EQ(static_cast<size_t>(taken) + grabber.droppedFrames(), 10u) << "run " << run;
+        EXPECT_GT(taken, 1) << "run " << run;
+    }
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "../utils/latest_mailbox.h"
+
+TEST(LatestMailboxTest, NewestValueWins) {
+    LatestMailbox<int> mailbox;
+    for (int i = 1; i <= 3; ++i) {
+        int value = i;
+        mailbox.publish(value);
+    }
+
+    int taken = 0;
+    ASSERT_TRUE(mailbox.take(taken));
+    EXPECT_EQ(taken, 3);
+    EXPECT_EQ(mailbox.droppedCount(), 2u);
+}
+
+TEST(LatestMailboxTest, BuffersAreSwappedNotCopied) {
+    LatestMailbox<std::vector<int>> mailbox;
+    std::vector<int> writer(1000, 1);
+    const int* writer_data = writer.data();
+
+    mailbox.publish(writer);
+    EXPECT_TRUE(writer.empty());
+
+    std::vector<int> reader;
+    ASSERT_TRUE(mailbox.take(reader));
+    EXPECT_EQ(reader.data(), writer_data);
+}
+
+TEST(LatestMailboxTest, CloseWakesTheReader) {
+    LatestMailbox<int> mailbox;
+    std::thread closer([&mailbox] { mailbox.close(); });
+
+    int taken = 0;
+    EXPECT_FALSE(mailbox.take(taken));
+    closer.join();
+}
+
+TEST(LatestMailboxTest, LastValueIsTakenAfterClose) {
+    LatestMailbox<int> mailbox;
+    int value = 7;
+    mailbox.publish(value);
+    mailbox.close();
+
+    int taken = 0;
+    EXPECT_TRUE(mailbox.take(taken));
+    EXPECT_EQ(taken, 7);
+    EXPECT_FALSE(mailbox.take(taken));
+}
@@ -0,0 +1,91 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "../benchmark/benchmark.h"
+
+class CrossingMetricsTest : public ::testing::Test {
+protected:
+    std::string annot;
+
+    void SetUp() override {
+        annot = (std::filesystem::temp_directory_path() / "zebraflash_metrics_test.json").string();
+        std::ofstream file(annot);
+        // Two pedestrians overlap on frames 3 and 4, extra keys and nesting must not confuse the parser
+        file << R"({
+            "video": "clip.mp4",
+            "meta": { "state_per_frame_note": "ignored", "frames": [1, 2, 3] },
+            "pedestrians": [
+                { "id": 0, "box": { "x": 1, "y": 2 },
+                  "state_per_frame": { "1": "áll", "2": "zebra felé", "3": "zebra felé", "4": "áll" } },
+                { "id": 1, "state_per_frame": { "3": "áll", "4": "zebra felé", "5": "áll" } }
+            ]
+        })";
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(annot);
+    }
+};
+
+TEST_F(CrossingMetricsTest, StreamingLoaderKeepsEveryAnnotation) {
+    auto intents = loadGroundTruthCrossingIntent(annot);
+
+    ASSERT_EQ(intents.size(), 7u);
+    EXPECT_EQ(intents.front().frame_index, 1);
+    EXPECT_EQ(intents.back().frame_index, 5);
+    for (size_t i = 1; i < intents.size(); ++i) {
+        EXPECT_LE(intents[i - 1].frame_index, intents[i].frame_index);
+    }
+}
+
+TEST_F(CrossingMetricsTest, DenseGroundTruthIsCrossingIfAnyPedestrianCrosses) {
+    GroundTruth ground_truth = loadGroundTruth(annot);
+
+    EXPECT_EQ(ground_truth.annotatedFrames(), 5u);
+    EXPECT_FALSE(ground_truth.isCrossing(0));
+    EXPECT_FALSE(ground_truth.isCrossing(1));
+    EXPECT_TRUE(ground_truth.isCrossing(2));
+    EXPECT_TRUE(ground_truth.isCrossing(3));
+    EXPECT_TRUE(ground_truth.isCrossing(4));
+    EXPECT_FALSE(ground_truth.isCrossing(5));
+    EXPECT_FALSE(ground_truth.isCrossing(100));
+    EXPECT_FALSE(ground_truth.isCrossing(-1));
+}
+
+TEST_F(CrossingMetricsTest, AccumulatorMatchesBatchMetricsAfterEveryFrame) {
+    GroundTruth ground_truth = loadGroundTruth(annot);
+    std::vector<BenchmarkResult> results = {
+        {0, false, 10.0, false}, {1, false, 10.0, true}, {2, false, 10.0, true},
+        {3, false, 10.0, false}, {4, false, 10.0, true}, {5, false, 10.0, false}
+    };
+
+    CrossingMetricsAccumulator accumulator(ground_truth);
+    std::vector<BenchmarkResult> seen;
+    for (const auto& result : results) {
+        accumulator.add(result.frame_index, result.is_crossing);
+        seen.push_back(result);
+
+        CrossingMetrics batch = calculateCrossingMetrics(seen, ground_truth);
+        EXPECT_EQ(accumulator.metrics().true_positives, batch.true_positives);
+        EXPECT_DOUBLE_EQ(accumulator.metrics().balanced_accuracy, batch.balanced_accuracy);
+    }
+
+    const CrossingMetrics& metrics = accumulator.metrics();
+    EXPECT_EQ(metrics.true_positives, 2);
+    EXPECT_EQ(metrics.false_positives, 1);
+    EXPECT_EQ(metrics.true_negatives, 2);
+    EXPECT_EQ(metrics.false_negatives, 1);
+    EXPECT_DOUBLE_EQ(metrics.precision, 2.0 / 3.0);
+    EXPECT_DOUBLE_EQ(metrics.recall, 2.0 / 3.0);
+    EXPECT_DOUBLE_EQ(metrics.f1_score, 2.0 / 3.0);
+    EXPECT_DOUBLE_EQ(metrics.f2_score, 2.0 / 3.0);
+    EXPECT_DOUBLE_EQ(metrics.balanced_accuracy, 2.0 / 3.0);
+}
+
+TEST(CrossingMetricsEmptyTest, NoPredictionsGiveZeroScores) {
+    CrossingMetrics metrics = crossingMetricsFromCounts(0, 0, 5, 0);
+
+    EXPECT_DOUBLE_EQ(metrics.precision, 0.0);
+    EXPECT_DOUBLE_EQ(metrics.f2_score, 0.0);
+    EXPECT_DOUBLE_EQ(metrics.not_crossing_accuracy, 1.0);
+}
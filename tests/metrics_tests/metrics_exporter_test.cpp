@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "../metrics/detector_metrics.h"
+
+static bool contains(const std::string& text, const std::string& line) {
+    return text.find(line + "\n") != std::string::npos;
+}
+
+TEST(MetricsExporterTest, HistogramBucketsAreCumulative) {
+    LatencyHistogram histogram;
+    histogram.observe(0.0002);
+    histogram.observe(0.003);
+    histogram.observe(0.003);
+    histogram.observe(5.0);   // only in +Inf
+
+    std::ostringstream out;
+    histogram.write(out, "latency_seconds", "stage=\"read\"");
+    std::string text = out.str();
+
+    EXPECT_TRUE(contains(text, "latency_seconds_bucket{stage=\"read\",le=\"0.0005\"} 1"));
+    EXPECT_TRUE(contains(text, "latency_seconds_bucket{stage=\"read\",le=\"0.002\"} 1"));
+    EXPECT_TRUE(contains(text, "latency_seconds_bucket{stage=\"read\",le=\"0.005\"} 3"));
+    EXPECT_TRUE(contains(text, "latency_seconds_bucket{stage=\"read\",le=\"2\"} 3"));
+    EXPECT_TRUE(contains(text, "latency_seconds_bucket{stage=\"read\",le=\"+Inf\"} 4"));
+    EXPECT_TRUE(contains(text, "latency_seconds_count{stage=\"read\"} 4"));
+}
+
+TEST(MetricsExporterTest, DetectorMetricsNameEveryZone) {
+    DetectorMetrics metrics({"north", "south"});
+    metrics.frames_processed.add(3);
+    metrics.zones[1].decisions[0].add();
+    metrics.zones[1].locked.set(1.0);
+
+    std::ostringstream out;
+    metrics.write(out);
+    std::string text = out.str();
+
+    EXPECT_TRUE(contains(text, "# TYPE zebraflash_frames_processed_total counter"));
+    EXPECT_TRUE(contains(text, "zebraflash_frames_processed_total 3"));
+    EXPECT_TRUE(contains(text, "zebraflash_decisions_total{zone=\"north\",state=\"up\"} 0"));
+    EXPECT_TRUE(contains(text, "zebraflash_decisions_total{zone=\"south\",state=\"up\"} 1"));
+    EXPECT_TRUE(contains(text, "zebraflash_zone_locked{zone=\"south\"} 1"));
+    EXPECT_TRUE(contains(text, "zebraflash_stage_latency_seconds_count{stage=\"decide\"} 0"));
+}
+
+TEST(MetricsExporterTest, TextFileHoldsTheLastStateAfterStop) {
+    std::filesystem::path file = std::filesystem::temp_directory_path() / "zebraflash_metrics_test.prom";
+    std::filesystem::remove(file);
+
+    MetricCounter frames;
+    {
+        MetricsExporter exporter(0, file.string(), 10);
+        exporter.addCounter("frames_total", "Frames.", [&frames]() { return static_cast<double>(frames.get()); });
+        ASSERT_TRUE(exporter.start());
+        frames.add(41);
+        frames.add();
+    }
+
+    std::ifstream in(file);
+    std::stringstream text;
+    text << in.rdbuf();
+    EXPECT_TRUE(contains(text.str(), "# HELP frames_total Frames."));
+    EXPECT_TRUE(contains(text.str(), "frames_total 42"));
+    EXPECT_FALSE(std::filesystem::exists(file.string() + ".tmp"));
+    std::filesystem::remove(file);
+}
+
+TEST(MetricsExporterTest, DoesNotStartWithoutOutput) {
+    MetricsExporter exporter(0, "", 1000);
+    EXPECT_FALSE(exporter.start());
+}
@@ -0,0 +1,84 @@
+#include <atomic>
+#include <thread>
+#include <gtest/gtest.h>
+#include "../motion-detector/motion_detector.h"
+#include "../motion-detector/decision_layer.h"
+#include "../motion-estimator/motion_estimator.h"
+#include "../utils/allocation_counter.h"
+
+// The per frame steps of the single-threaded Farnebäck path that the detector owns, on buffers kept across frames.
+// The flow itself, the background model and findContours allocate inside OpenCV and are not part of the check.
+TEST(AllocationCounterTest, FarnebackFrameLayersDoNotAllocateInSteadyState) {
+    if (!AllocationCounter::enabled()) {
+        GTEST_SKIP() << "Configure with -DZEBRAFLASH_COUNT_ALLOCATIONS=ON to count allocations";
+    }
+    AllocationCounter::install();
+
+    cv::Size size(160, 120);
+    cv::Mat gray_previous(size, CV_8UC1), gray(size, CV_8UC1);
+    cv::randu(gray_previous, 0, 255);
+    cv::randu(gray, 0, 255);
+
+    FlowBuffers buffers;
+    buffers.motion_mask = cv::Mat(size, CV_8UC1, cv::Scalar(255));
+    buffers.mag = cv::Mat(size, CV_32F);
+    buffers.ang = cv::Mat(size, CV_32F);
+    cv::randu(buffers.mag, 0.0f, 4.0f);
+    cv::randu(buffers.ang, 0.0f, 360.0f);
+
+    AppConfig config{};
+    config.angle_up_min = 60;
+    config.angle_up_max = 120;
+    config.angle_down_min = 240;
+    config.angle_down_max = 300;
+    config.moving_up_lock_frames = 10;
+    config.size = 5;
+    DecisionLayer decision_layer(config);
+
+    std::vector<EstimatorZone> zones = {{cv::Rect(0, 0, 80, 120), 1.0}, {cv::Rect(80, 0, 80, 120), 1.0}};
+    std::vector<MotionEstimate> estimates;
+    auto decideFrame = [&]() {
+        FlowEstimatorUtils::maskFrames(gray_previous, gray, buffers);
+        FlowEstimatorUtils::zoneFlowEstimates(buffers.mag, buffers.ang, zones, estimates, buffers.move_sense);
+        for (const auto& estimate : estimates) {
+            decision_layer.vote(decision_layer.classifyFlow(estimate.move_mode));
+        }
+        decision_layer.decide();
+    };
+
+    // The first frame sizes the buffers
+    decideFrame();
+
+    uint64_t before = AllocationCounter::count();
+    for (int frame = 0; frame < 20; ++frame) {
+        decideFrame();
+    }
+    EXPECT_EQ(AllocationCounter::count() - before, 0u);
+}
+
+TEST(AllocationCounterTest, CountsOnlyTheCallingThread) {
+    if (!AllocationCounter::enabled()) {
+        GTEST_SKIP() << "Configure with -DZEBRAFLASH_COUNT_ALLOCATIONS=ON to count allocations";
+    }
+
+    std::atomic<bool> start{false};
+    uint64_t worker_allocations = 0;
+    std::thread worker([&]() {
+        while (!start) {
+            std::this_thread::yield();
+        }
+        uint64_t worker_before = AllocationCounter::count();
+        std::vector<std::vector<int>> values;
+        for (int i = 0; i < 100; ++i) {
+            values.emplace_back(64);
+        }
+        worker_allocations = AllocationCounter::count() - worker_before;
+    });
+
+    uint64_t before = AllocationCounter::count();
+    start = true;
+    worker.join();
+
+    EXPECT_EQ(AllocationCounter::count(), before);
+    EXPECT_GE(worker_allocations, 100u);
+}
@@ -0,0 +1,22 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "../utils/motion_utils.h"
+
+TEST(CalculateModeTest, EmptyIsNaN) {
+    EXPECT_TRUE(std::isnan(MotionUtils::calculateMode({})));
+}
+
+TEST(CalculateModeTest, BinsToWholeDegrees) {
+    EXPECT_FLOAT_EQ(MotionUtils::calculateMode({89.6f, 90.2f, 45.0f, 359.7f}), 90.0f);
+    EXPECT_FLOAT_EQ(MotionUtils::calculateMode({359.7f, 360.0f, 0.2f}), 360.0f);
+}
+
+TEST(CalculateModeTest, TiesGoToTheLowestAngle) {
+    EXPECT_FLOAT_EQ(MotionUtils::calculateMode({270.0f, 90.0f, 270.0f, 90.0f}), 90.0f);
+}
+
+TEST(CalculateModeTest, ValuesOutsideTheAngleRange) {
+    EXPECT_FLOAT_EQ(MotionUtils::calculateMode({-30.0f, -30.2f, 10.0f}), -30.0f);
+    EXPECT_FLOAT_EQ(MotionUtils::calculateMode({400.0f, 10.0f, 400.0f}), 400.0f);
+    EXPECT_FLOAT_EQ(MotionUtils::calculateMode({-5.0f, 500.0f}), -5.0f);
+}
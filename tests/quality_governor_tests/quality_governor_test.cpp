@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <vector>
+#include "../motion-detector/motion_detector.h"
+#include "../benchmark/benchmark.h"
+#include "../quality-governor/quality_governor.h"
+#include "../benchmarks/benchmark_common.h"
+
+static AppConfig governedConfig() {
+    AppConfig config = BenchmarkHelpers::syntheticTestConfig();
+    config.levels = 3;
+    config.iterations = 3;
+    config.winsize = 15;
+    config.yolo_input_size = 416;
+    config.max_corners = 200;
+    return config;
+}
+
+static void observeFrames(QualityGovernor& governor, double frame_ms, int count) {
+    for (int i = 0; i < count; ++i) {
+        governor.observe(frame_ms);
+    }
+}
+
+// Runs frames whose decision time depends on the level like a real estimator, skipped frames cost nothing and are
+// not observed. Returns the number of level changes.
+static int runFrames(QualityGovernor& governor, const std::vector<double>& level_ms, int count) {
+    int changes = 0;
+    for (int i = 0; i < count; ++i) {
+        if (!governor.skipFrame()) {
+            changes += governor.observe(level_ms[governor.level()]) ? 1 : 0;
+        }
+    }
+    return changes;
+}
+
+TEST(QualityGovernorTest, LadderStartsAtTheConfigAndOnlyGetsCheaper) {
+    AppConfig config = governedConfig();
+    std::vector<QualityLevel> ladder = QualityGovernor::buildLadder(config);
+    ASSERT_GE(ladder.size(), 2u);
+
+    EXPECT_EQ(ladder[0].scale, 1.0);
+    EXPECT_EQ(ladder[0].levels, config.levels);
+    EXPECT_EQ(ladder[0].iterations, config.iterations);
+    EXPECT_EQ(ladder[0].winsize, config.winsize);
+    EXPECT_EQ(ladder[0].yolo_input_size, config.yolo_input_size);
+    EXPECT_EQ(ladder[0].max_corners, config.max_corners);
+    EXPECT_EQ(ladder[0].frame_stride, 1);
+
+    for (size_t i = 1; i < ladder.size(); ++i) {
+        EXPECT_LE(ladder[i].scale, ladder[i - 1].scale);
+        EXPECT_LE(ladder[i].levels, ladder[i - 1].levels);
+        EXPECT_LE(ladder[i].iterations, ladder[i - 1].iterations);
+        EXPECT_LE(ladder[i].winsize, ladder[i - 1].winsize);
+        EXPECT_LE(ladder[i].yolo_input_size, ladder[i - 1].yolo_input_size);
+        EXPECT_LE(ladder[i].max_corners, ladder[i - 1].max_corners);
+        EXPECT_GE(ladder[i].frame_stride, ladder[i - 1].frame_stride);
+        EXPECT_EQ(ladder[i].winsize % 2, 1);
+        EXPECT_EQ(ladder[i].yolo_input_size % 32, 0);
+        EXPECT_GE(ladder[i].levels, 1);
+    }
+
+    // Area limits shrink with the square of the scale
+    EXPECT_DOUBLE_EQ(ladder[0].scaledArea(12000.0), 12000.0);
+    EXPECT_DOUBLE_EQ(ladder.back().scaledArea(12000.0), 12000.0 * ladder.back().scale * ladder.back().scale);
+}
+
+TEST(QualityGovernorTest, StepsDownAndBackUpOncePerWindow) {
+    QualityGovernor governor(governedConfig(), 10.0, 5, 0.7);
+    EXPECT_EQ(governor.level(), 0);
+
+    // A window that is not full yet does not count
+    observeFrames(governor, 20.0, 4);
+    EXPECT_EQ(governor.level(), 0);
+    EXPECT_TRUE(governor.observe(20.0));
+    EXPECT_EQ(governor.level(), 1);
+
+    // The window is refilled at the new level before the next step
+    observeFrames(governor, 20.0, 4);
+    EXPECT_EQ(governor.level(), 1);
+    observeFrames(governor, 100.0, 100);
+    EXPECT_EQ(governor.level(), static_cast<int>(governor.levelCount()) - 1);
+
+    observeFrames(governor, 1.0, 5);
+    EXPECT_EQ(governor.level(), static_cast<int>(governor.levelCount()) - 2);
+    observeFrames(governor, 1.0, 100);
+    EXPECT_EQ(governor.level(), 0);
+}
+
+TEST(QualityGovernorTest, HoldsTheLevelBetweenTargetAndHeadroom) {
+    QualityGovernor governor(governedConfig(), 10.0, 5, 0.7);
+    observeFrames(governor, 12.0, 5);
+    ASSERT_EQ(governor.level(), 1);
+
+    // 8 ms is under the target but over 7 ms, the level neither drops nor comes back
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_FALSE(governor.observe(8.0));
+    }
+    EXPECT_EQ(governor.level(), 1);
+}
+
+TEST(QualityGovernorTest, SettlesWhenAStepSavesMoreThanTheHeadroom) {
+    QualityGovernor governor(governedConfig(), 10.0, 5, 0.7);
+    ASSERT_EQ(governor.levelCount(), 6u);
+
+    // Level 2 misses the target at 11 ms, level 3 is well under the headroom at 6 ms. Going back up would miss again.
+    std::vector<double> level_ms = {20.0, 15.0, 11.0, 6.0, 6.0, 6.0};
+    runFrames(governor, level_ms, 100);
+    EXPECT_EQ(governor.level(), 3);
+    EXPECT_EQ(runFrames(governor, level_ms, 1000), 0);
+    EXPECT_EQ(governor.level(), 3);
+
+    // Once the load drops, level 2 would fit and the governor goes back up
+    std::vector<double> lighter = {8.0, 6.0, 4.4, 2.4, 2.4, 2.4};
+    runFrames(governor, lighter, 200);
+    EXPECT_LT(governor.level(), 3);
+}
+
+TEST(QualityGovernorTest, StrideIsMeasuredPerFrameOfTheStream) {
+    QualityGovernor governor(governedConfig(), 10.0, 5, 0.7);
+
+    // Every decided frame takes 13 ms. Every other frame gives 6.5 ms per frame, under the headroom, but deciding all
+    // of them again would miss the target.
+    std::vector<double> level_ms(governor.levelCount(), 13.0);
+    runFrames(governor, level_ms, 200);
+    EXPECT_EQ(governor.current().frame_stride, 2);
+    int level = governor.level();
+    EXPECT_EQ(runFrames(governor, level_ms, 1000), 0);
+    EXPECT_EQ(governor.level(), level);
+}
+
+TEST(QualityGovernorTest, StrideSkipsFramesBetweenDecidedOnes) {
+    QualityGovernor governor(governedConfig(), 10.0, 1, 0.7);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_FALSE(governor.skipFrame());
+    }
+
+    observeFrames(governor, 100.0, static_cast<int>(governor.levelCount()));
+    int stride = governor.current().frame_stride;
+    ASSERT_GT(stride, 1);
+    int decided = 0;
+    for (int i = 0; i < stride * 4; ++i) {
+        decided += governor.skipFrame() ? 0 : 1;
+    }
+    EXPECT_EQ(decided, 4);
+}
+
+TEST(QualityGovernorTest, DetectorDecidesEveryFrameAtTheLowestLevel) {
+    AppConfig config = governedConfig();
+    std::vector<cv::Mat> roi_frames = BenchmarkHelpers::syntheticRoiFrames(config, 40);
+
+    // No frame is that fast, the governor walks down the whole ladder
+    config.quality_target_ms = 1e-6;
+    config.quality_window = 1;
+    auto results = MotionDetector(config).processFrames(roi_frames, 0);
+
+    ASSERT_EQ(results.size(), roi_frames.size() - 1);
+    EXPECT_EQ(results.front().quality_level, 0);
+    EXPECT_EQ(results.back().quality_level,
+              static_cast<int>(QualityGovernor::buildLadder(config).size()) - 1);
+    // The lowest level has a stride, its skipped frames are marked so the timings leave them out
+    EXPECT_TRUE(std::any_of(results.begin(), results.end(), [](const BenchmarkResult& r) { return !r.decided; }));
+
+    // Without a target the results carry no level
+    config.quality_target_ms = 0.0;
+    auto ungoverned = MotionDetector(config).processFrames(roi_frames, 0);
+    ASSERT_FALSE(ungoverned.empty());
+    EXPECT_EQ(ungoverned.front().quality_level, -1);
+}
+
+TEST(QualityGovernorTest, SkippedFramesAreLeftOutOfTheTimings) {
+    std::vector<BenchmarkResult> results;
+    for (int i = 0; i < 8; ++i) {
+        // Every fourth frame is decided in 20 ms, the skipped ones only copy its decision
+        bool decided = i % 4 == 0;
+        results.push_back({i, false, decided ? 20.0 : 0.01, false, decided ? 3 : 0, 0.0, 0.0, 2, decided});
+    }
+
+    EXPECT_DOUBLE_EQ(calculateAverageFps(results), 50.0);
+    EXPECT_DOUBLE_EQ(calculateLatencyPercentile(results, 50.0), 20.0);
+    EXPECT_DOUBLE_EQ(calculateMeanAllocations(results), 3.0);
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "../motion-detector/video_recorder.h"
+
+static RenderSnapshot testSnapshot(int value) {
+    RenderSnapshot snapshot;
+    snapshot.frame = cv::Mat(120, 160, CV_8UC3, cv::Scalar(value, value, value));
+    snapshot.roi_width = 160;
+    snapshot.zones.push_back({"", cv::Rect(0, 0, 160, 120), 90.0f, 0, true, false, 0, 0});
+    snapshot.fps = 30.0;
+    snapshot.balanced_accuracy = -1.0;
+    return snapshot;
+}
+
+TEST(VideoRecorderTest, EveryPushedFrameIsRecordedOrDropped) {
+    std::string path = (std::filesystem::temp_directory_path() / "zebraflash_recorder_test.avi").string();
+
+    for (RecorderDropPolicy policy : {RecorderDropPolicy::Oldest, RecorderDropPolicy::Newest}) {
+        VideoRecorder recorder(path, "MJPG", 30.0, 2, policy);
+        for (int i = 0; i < 40; ++i) {
+            recorder.push(testSnapshot(i * 5));
+        }
+        recorder.finish();
+
+        EXPECT_GT(recorder.recordedFrames(), 0);
+        EXPECT_EQ(recorder.recordedFrames() + recorder.droppedFrames(), 40);
+
+        cv::VideoCapture video(path);
+        ASSERT_TRUE(video.isOpened());
+        EXPECT_EQ(static_cast<int>(video.get(cv::CAP_PROP_FRAME_COUNT)), recorder.recordedFrames());
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(VideoRecorderTest, FramesAfterAFailedOpenCountAsDropped) {
+    std::string path = (std::filesystem::temp_directory_path() / "zebraflash_missing_dir" / "recorder.avi").string();
+
+    VideoRecorder recorder(path, "MJPG", 30.0, 2, RecorderDropPolicy::Oldest);
+    for (int i = 0; i < 20; ++i) {
+        recorder.push(testSnapshot(i * 5));
+    }
+    recorder.finish();
+    recorder.push(testSnapshot(0));
+
+    EXPECT_EQ(recorder.recordedFrames(), 0);
+    EXPECT_EQ(recorder.droppedFrames(), 21);
+}
+
+TEST(VideoRecorderTest, UnknownDropPolicyKeepsTheStreamCurrent) {
+    EXPECT_EQ(VideoRecorder::parseDropPolicy("NEWEST"), RecorderDropPolicy::Newest);
+    EXPECT_EQ(VideoRecorder::parseDropPolicy("OLDEST"), RecorderDropPolicy::Oldest);
+    EXPECT_EQ(VideoRecorder::parseDropPolicy("SOMETIMES"), RecorderDropPolicy::Oldest);
+}
@@ -0,0 +1,180 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "../benchmark/benchmark_compare.h"
+
+static SummaryRow makeRow(const std::string& id, double fps, double accuracy, double p95) {
+    return {id, "2025-01-01_00-00", fps, accuracy, p95 * 0.8, p95, p95 * 1.2, true, 1000};
+}
+
+static const MetricComparison* findMetric(const ComparisonReport& report, const std::string& id, const std::string& metric) {
+    for (const auto& c : report.comparisons) {
+        if (c.test_id == id && c.metric == metric) {
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+TEST(RegressionGateTest, DetectsFpsDrop) {
+    std::vector<SummaryRow> baseline = {makeRow("FarneMultiCPU_DefaultConfig_video1", 40.0, 0.8, 30.0)};
+    std::vector<SummaryRow> candidate = {makeRow("FarneMultiCPU_DefaultConfig_video1", 34.0, 0.8, 30.0)};
+
+    RegressionThresholds thresholds;
+    ComparisonReport report = compareSummaries(baseline, candidate, thresholds);
+
+    const MetricComparison* fps = findMetric(report, "FarneMultiCPU_DefaultConfig_video1", "Avg FPS");
+    ASSERT_NE(fps, nullptr);
+    EXPECT_TRUE(fps->regressed);
+    EXPECT_NEAR(fps->change, -0.15, 1e-9);
+    EXPECT_FALSE(report.passed(thresholds));
+}
+
+TEST(RegressionGateTest, ToleratesChangesWithinThresholds) {
+    std::vector<SummaryRow> baseline = {makeRow("LKSingleCPU_DefaultConfig_video1", 40.0, 0.80, 30.0)};
+    std::vector<SummaryRow> candidate = {makeRow("LKSingleCPU_DefaultConfig_video1", 38.0, 0.79, 32.0)};
+
+    RegressionThresholds thresholds;
+    ComparisonReport report = compareSummaries(baseline, candidate, thresholds);
+
+    EXPECT_EQ(report.regressions, 0);
+    EXPECT_TRUE(report.passed(thresholds));
+}
+
+TEST(RegressionGateTest, NoisyBaselineWidensLimit) {
+    std::vector<SummaryRow> baseline = {
+        makeRow("YOLOGPU_DefaultConfig_video1", 30.0, 0.8, 30.0),
+        makeRow("YOLOGPU_DefaultConfig_video1", 40.0, 0.8, 30.0),
+        makeRow("YOLOGPU_DefaultConfig_video1", 50.0, 0.8, 30.0)
+    };
+    std::vector<SummaryRow> candidate = {makeRow("YOLOGPU_DefaultConfig_video1", 34.0, 0.8, 30.0)};
+
+    RegressionThresholds thresholds;
+    ComparisonReport report = compareSummaries(baseline, candidate, thresholds);
+
+    const MetricComparison* fps = findMetric(report, "YOLOGPU_DefaultConfig_video1", "Avg FPS");
+    ASSERT_NE(fps, nullptr);
+    EXPECT_FALSE(fps->regressed);
+    EXPECT_GT(fps->allowed, thresholds.fps_drop);
+}
+
+TEST(RegressionGateTest, NoisyCandidateKeepsTheBaselineLimit) {
+    std::vector<SummaryRow> baseline = {
+        makeRow("DISSingleCPU_DefaultConfig_video1", 40.0, 0.8, 30.0),
+        makeRow("DISSingleCPU_DefaultConfig_video1", 40.0, 0.8, 30.0)
+    };
+    std::vector<SummaryRow> candidate = {
+        makeRow("DISSingleCPU_DefaultConfig_video1", 20.0, 0.8, 30.0),
+        makeRow("DISSingleCPU_DefaultConfig_video1", 34.0, 0.8, 30.0),
+        makeRow("DISSingleCPU_DefaultConfig_video1", 48.0, 0.8, 30.0)
+    };
+
+    RegressionThresholds thresholds;
+    ComparisonReport report = compareSummaries(baseline, candidate, thresholds);
+
+    const MetricComparison* fps = findMetric(report, "DISSingleCPU_DefaultConfig_video1", "Avg FPS");
+    ASSERT_NE(fps, nullptr);
+    EXPECT_DOUBLE_EQ(fps->allowed, thresholds.fps_drop);
+    EXPECT_TRUE(fps->regressed);
+}
+
+TEST(RegressionGateTest, DetectsAccuracyAndLatencyRegressions) {
+    std::vector<SummaryRow> baseline = {makeRow("FarneGPU_DefaultConfig_video2", 40.0, 0.80, 30.0)};
+    std::vector<SummaryRow> candidate = {makeRow("FarneGPU_DefaultConfig_video2", 40.0, 0.70, 40.0)};
+
+    ComparisonReport report = compareSummaries(baseline, candidate, RegressionThresholds());
+
+    EXPECT_TRUE(findMetric(report, "FarneGPU_DefaultConfig_video2", "Balanced Accuracy")->regressed);
+    EXPECT_TRUE(findMetric(report, "FarneGPU_DefaultConfig_video2", "P95 Latency ms")->regressed);
+    EXPECT_FALSE(findMetric(report, "FarneGPU_DefaultConfig_video2", "Avg FPS")->regressed);
+}
+
+TEST(RegressionGateTest, ReportsMissingConfigurations) {
+    std::vector<SummaryRow> baseline = {makeRow("A_video1", 40.0, 0.8, 30.0), makeRow("B_video1", 40.0, 0.8, 30.0)};
+    std::vector<SummaryRow> candidate = {makeRow("A_video1", 40.0, 0.8, 30.0), makeRow("C_video1", 40.0, 0.8, 30.0)};
+
+    RegressionThresholds thresholds;
+    ComparisonReport report = compareSummaries(baseline, candidate, thresholds);
+
+    ASSERT_EQ(report.missing_in_candidate.size(), 1u);
+    EXPECT_EQ(report.missing_in_candidate[0], "B_video1");
+    ASSERT_EQ(report.new_in_candidate.size(), 1u);
+    EXPECT_EQ(report.new_in_candidate[0], "C_video1");
+    EXPECT_TRUE(report.passed(thresholds));
+
+    thresholds.fail_on_missing = true;
+    EXPECT_FALSE(report.passed(thresholds));
+}
+
+TEST(RegressionGateTest, LoadsSummaryWithAndWithoutLatencyColumns) {
+    auto dir = std::filesystem::temp_directory_path();
+    std::string old_summary = (dir / "zebraflash_summary_old.csv").string();
+    std::string new_summary = (dir / "zebraflash_summary_new.csv").string();
+
+    {
+        std::ofstream file(old_summary);
+        file << "Test ID,Timestamp,Avg FPS,Balanced Accuracy,Crossing Accuracy,Not Crossing Accuracy,"
+             << "Precision,Recall,F1 Score,F2 Score,TP,FP,TN,FN,Total Frames,Detail File\n";
+        file << "A_video1,2025-01-01_00-00,41.50,0.8100,0.7,0.9,0.5,0.7,0.6,0.65,7,7,9,3,26,a.csv\n";
+    }
+    {
+        std::ofstream file(new_summary);
+        file << "Test ID,Timestamp,Avg FPS,Balanced Accuracy,Crossing Accuracy,Not Crossing Accuracy,"
+             << "Precision,Recall,F1 Score,F2 Score,TP,FP,TN,FN,Total Frames,"
+             << "Detail File,P50 Latency ms,P95 Latency ms,P99 Latency ms\n";
+        file << "A_video1,2025-01-02_00-00,40.00,0.8000,0.7,0.9,0.5,0.7,0.6,0.65,7,7,9,3,26,b.csv,20.5,30.25,35.0\n";
+    }
+
+    auto old_rows = loadSummaryCSV(old_summary);
+    auto new_rows = loadSummaryCSV(new_summary);
+    std::filesystem::remove(old_summary);
+    std::filesystem::remove(new_summary);
+
+    ASSERT_EQ(old_rows.size(), 1u);
+    EXPECT_FALSE(old_rows[0].has_latency);
+    EXPECT_DOUBLE_EQ(old_rows[0].avg_fps, 41.5);
+
+    ASSERT_EQ(new_rows.size(), 1u);
+    EXPECT_TRUE(new_rows[0].has_latency);
+    EXPECT_DOUBLE_EQ(new_rows[0].p95_latency_ms, 30.25);
+
+    ComparisonReport report = compareSummaries(old_rows, new_rows, RegressionThresholds());
+    EXPECT_EQ(findMetric(report, "A_video1", "P95 Latency ms"), nullptr);
+    EXPECT_NE(findMetric(report, "A_video1", "Avg FPS"), nullptr);
+}
+
+TEST(RegressionGateTest, LoadsRowsAppendedUnderAnOlderHeader) {
+    auto summary = (std::filesystem::temp_directory_path() / "zebraflash_summary_appended.csv").string();
+    {
+        std::ofstream file(summary);
+        file << "Test ID,Timestamp,Avg FPS,Balanced Accuracy,Crossing Accuracy,Not Crossing Accuracy,"
+             << "Precision,Recall,F1 Score,F2 Score,TP,FP,TN,FN,Total Frames,Detail File\n";
+        file << "A_video1,2025-01-01_00-00,41.50,0.8100,0.7,0.9,0.5,0.7,0.6,0.65,7,7,9,3,26,a.csv\n";
+        file << "A_video1,2025-01-02_00-00,40.00,0.8000,0.7,0.9,0.5,0.7,0.6,0.65,7,7,9,3,26,b.csv,"
+             << "20.5,30.25,35.0,1.0,2.0,3.0,120.0\n";
+    }
+
+    auto rows = loadSummaryCSV(summary);
+    std::filesystem::remove(summary);
+
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_DOUBLE_EQ(rows[1].avg_fps, 40.0);
+    EXPECT_EQ(rows[1].total_frames, 26);
+    EXPECT_FALSE(rows[1].has_latency);
+}
+
+TEST(RegressionGateTest, DetectsSlowerStartup) {
+    std::vector<SummaryRow> baseline = {makeRow("YOLOCPU_video1", 10.0, 0.8, 90.0)};
+    std::vector<SummaryRow> candidate = {makeRow("YOLOCPU_video1", 10.0, 0.8, 90.0)};
+    baseline[0].has_startup = true;
+    baseline[0].time_to_first_decision_ms = 400.0;
+    candidate[0].has_startup = true;
+    candidate[0].time_to_first_decision_ms = 900.0;
+
+    ComparisonReport report = compareSummaries(baseline, candidate, RegressionThresholds());
+
+    const MetricComparison* startup = findMetric(report, "YOLOCPU_video1", "Time to First Decision ms");
+    ASSERT_NE(startup, nullptr);
+    EXPECT_TRUE(startup->regressed);
+    EXPECT_EQ(report.regressions, 1);
+}
@@ -0,0 +1,180 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "../motion-detector/motion_detector.h"
+#include "../benchmark/benchmark.h"
+#include "../replay/decision_replay.h"
+#include "../replay/estimator_trace.h"
+#include "../benchmarks/benchmark_common.h"
+
+// The crossing pedestrian and one walking along the curb, which must not count as a crossing
+static std::vector<cv::Mat> renderCrossingFrames(const AppConfig& config, int count) {
+    SceneConfig scene = BenchmarkHelpers::syntheticScene(count, 11);
+    scene.pedestrians.push_back({0.1, 0.3, 0.0, 0.5, 0.1, 0.3, 10, -1, -1, false});
+    return BenchmarkHelpers::syntheticRoiFrames(config, scene);
+}
+
+static AppConfig flowConfig(const std::string& algorithm) {
+    AppConfig config = BenchmarkHelpers::syntheticTestConfig();
+    config.algorithm = algorithm;
+    return config;
+}
+
+static std::vector<CrossIntent> syntheticGroundTruth(int count) {
+    std::vector<CrossIntent> ground_truth;
+    for (int i = 0; i < count; ++i) {
+        ground_truth.push_back({i, i >= 10 && i < 30});
+    }
+    return ground_truth;
+}
+
+class DecisionReplayTest : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(DecisionReplayTest, ReplayMatchesLiveProcessing) {
+    const std::vector<cv::Mat> frames = renderCrossingFrames(flowConfig(GetParam()), 50);
+    const std::vector<CrossIntent> ground_truth = syntheticGroundTruth(50);
+    std::string trace_path = (std::filesystem::temp_directory_path() / ("zebraflash_replay_" + GetParam() + ".zft")).string();
+
+    AppConfig recording = flowConfig(GetParam());
+    recording.estimator_trace_path = trace_path;
+    recording.estimator_trace_min_magnitude = 0.5f;
+    auto recorded = MotionDetector(recording).processFrames(frames, 0);
+
+    EstimatorTrace trace;
+    ASSERT_TRUE(trace.load(trace_path));
+    std::filesystem::remove(trace_path);
+    ASSERT_EQ(trace.frames.size(), recorded.size());
+    EXPECT_EQ(trace.algorithm, GetParam());
+
+    DecisionReplay replay(trace, GroundTruth(ground_truth));
+
+    std::vector<AppConfig> variants;
+    for (double threshold : {0.5, 1.5, 2.5}) {
+        for (int size : {3, 11}) {
+            for (int lock : {0, 5}) {
+                AppConfig config = flowConfig(GetParam());
+                config.threshold = threshold;
+                config.size = size;
+                config.moving_up_lock_frames = lock;
+                variants.push_back(config);
+            }
+        }
+    }
+
+    for (const auto& config : variants) {
+        std::string reason;
+        ASSERT_TRUE(replay.supports(config, reason)) << reason;
+
+        auto live = MotionDetector(config).processFrames(frames, 0);
+        auto replayed = replay.replay(config);
+
+        ASSERT_EQ(replayed.size(), live.size());
+        for (size_t i = 0; i < live.size(); ++i) {
+            EXPECT_EQ(replayed[i].frame_index, live[i].frame_index);
+            EXPECT_EQ(replayed[i].is_crossing, live[i].is_crossing)
+                << "threshold " << config.threshold << ", size " << config.size
+                << ", lock " << config.moving_up_lock_frames << ", frame " << i;
+        }
+
+        CrossingMetrics expected = calculateCrossingMetrics(live, ground_truth);
+        CrossingMetrics metrics = replay.evaluate(config);
+        EXPECT_EQ(metrics.true_positives, expected.true_positives);
+        EXPECT_EQ(metrics.false_positives, expected.false_positives);
+        EXPECT_EQ(metrics.true_negatives, expected.true_negatives);
+        EXPECT_EQ(metrics.false_negatives, expected.false_negatives);
+        EXPECT_DOUBLE_EQ(metrics.balanced_accuracy, expected.balanced_accuracy);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(FlowAlgorithms, DecisionReplayTest, ::testing::Values("FARNE", "LK"));
+
+TEST(DecisionReplayLimitsTest, RejectsParametersTheTraceCannotReproduce) {
+    EstimatorTrace trace;
+    trace.algorithm = "FARNE";
+    trace.min_magnitude = 1.0f;
+    trace.frames.resize(3);
+    DecisionReplay replay(trace, GroundTruth());
+
+    AppConfig config = flowConfig("FARNE");
+    std::string reason;
+
+    config.threshold = 2.5;
+    EXPECT_TRUE(replay.supports(config, reason));
+
+    config.threshold = 2.3;
+    EXPECT_FALSE(replay.supports(config, reason));
+
+    config.threshold = 0.5;
+    EXPECT_FALSE(replay.supports(config, reason));
+
+    config.threshold = 2.5;
+    config.algorithm = "YOLO";
+    EXPECT_FALSE(replay.supports(config, reason));
+}
+
+TEST(EstimatorTraceTest, SaveAndLoadRoundTrip) {
+    EstimatorTrace trace;
+    trace.algorithm = "YOLO";
+    trace.video_src = "video.mp4";
+    trace.video_annot = "video.json";
+    trace.first_frame_index = 120;
+    trace.min_confidence = 0.1f;
+
+    trace.frames.resize(2);
+    trace.frames[0].detections.push_back({cv::Rect(10, 20, 30, 60), 0.8f, 0.9f});
+    trace.frames[0].detections.push_back({cv::Rect(12, 22, 28, 58), 0.4f, 0.7f});
+    trace.frames[1].voted = false;
+    trace.frames[1].cells.push_back({90, 40, 17});
+
+    std::string path = (std::filesystem::temp_directory_path() / "zebraflash_trace_test.zft").string();
+    ASSERT_TRUE(trace.save(path));
+
+    EstimatorTrace loaded;
+    ASSERT_TRUE(loaded.load(path));
+    std::filesystem::remove(path);
+
+    EXPECT_EQ(loaded.algorithm, "YOLO");
+    EXPECT_EQ(loaded.video_annot, "video.json");
+    EXPECT_EQ(loaded.first_frame_index, 120);
+    EXPECT_FLOAT_EQ(loaded.min_confidence, 0.1f);
+    ASSERT_EQ(loaded.frames.size(), 2u);
+    ASSERT_EQ(loaded.frames[0].detections.size(), 2u);
+    EXPECT_EQ(loaded.frames[0].detections[1].box, cv::Rect(12, 22, 28, 58));
+    EXPECT_FLOAT_EQ(loaded.frames[0].detections[1].confidence, 0.4f);
+    EXPECT_FALSE(loaded.frames[1].voted);
+    ASSERT_EQ(loaded.frames[1].cells.size(), 1u);
+    EXPECT_EQ(loaded.frames[1].cells[0].count, 17u);
+}
+
+TEST(EstimatorTraceTest, CorruptCountsAreRejected) {
+    EstimatorTrace trace;
+    trace.algorithm = "LK";
+    trace.frames.resize(2);
+    trace.frames[0].cells.push_back({90, 40, 17});
+
+    std::string path = (std::filesystem::temp_directory_path() / "zebraflash_corrupt_trace_test.zft").string();
+    // Magic, the three strings with their sizes, the first frame index and the three limits come before the counts
+    const std::streamoff frame_count_offset = 8 + (4 + 2) + 4 + 4 + 4 + 3 * 4;
+    const std::streamoff cell_count_offset = frame_count_offset + 4 + 1;
+    auto corrupt = [&](std::streamoff offset) {
+        ASSERT_TRUE(trace.save(path));
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        uint32_t count = UINT32_MAX;
+        file.seekp(offset);
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    };
+
+    EstimatorTrace loaded;
+    corrupt(frame_count_offset);
+    EXPECT_FALSE(loaded.load(path));
+    EXPECT_TRUE(loaded.frames.empty());
+
+    corrupt(cell_count_offset);
+    EXPECT_FALSE(loaded.load(path));
+    EXPECT_TRUE(loaded.frames.empty());
+
+    ASSERT_TRUE(trace.save(path));
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    EXPECT_FALSE(loaded.load(path));
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,103 @@
+#include <filesystem>
+#include <gtest/gtest.h>
+#include "../segment-runner/segment_runner.h"
+#include "../benchmarks/benchmark_common.h"
+
+TEST(SegmentRunnerTest, SegmentsCoverTheRangeWithWarmup) {
+    auto segments = SegmentRunner::splitSegments(10, 110, 4, 20);
+    ASSERT_EQ(segments.size(), 4u);
+
+    EXPECT_EQ(segments[0].warmup_start, 10);
+    EXPECT_EQ(segments[0].start, 10);
+    for (size_t i = 1; i < segments.size(); ++i) {
+        EXPECT_EQ(segments[i].start, segments[i - 1].end);
+        EXPECT_EQ(segments[i].warmup_start, segments[i].start - 20);
+    }
+    EXPECT_EQ(segments.back().end, 110);
+}
+
+TEST(SegmentRunnerTest, WarmupIsClippedToTheRange) {
+    auto segments = SegmentRunner::splitSegments(0, 30, 3, 50);
+    ASSERT_EQ(segments.size(), 3u);
+    EXPECT_EQ(segments[1].warmup_start, 0);
+
+    segments = SegmentRunner::splitSegments(0, 30, 3, 0);
+    EXPECT_EQ(segments[1].warmup_start, segments[1].start);
+
+    EXPECT_EQ(SegmentRunner::splitSegments(0, 2, 8, 10).size(), 2u);
+    EXPECT_TRUE(SegmentRunner::splitSegments(5, 5, 4, 10).empty());
+}
+
+TEST(SegmentRunnerTest, MergedResultsMatchASingleRun) {
+    SceneConfig scene = BenchmarkHelpers::syntheticScene(60, 7);
+
+    std::string video = (std::filesystem::temp_directory_path() / "zebraflash_segment_test.avi").string();
+    {
+        cv::VideoWriter writer(video, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), scene.fps,
+                               cv::Size(scene.width, scene.height));
+        for (const auto& frame : BenchmarkHelpers::syntheticFrames(scene)) {
+            writer.write(frame);
+        }
+    }
+
+    AppConfig config = BenchmarkHelpers::syntheticTestConfig();
+    config.video_src = video;
+    config.seek = 0;
+    config.seek_end = 0;
+
+    config.segments = 1;
+    auto single = SegmentRunner(config).process();
+
+    // A warm-up that reaches back to the first frame gives every segment the state of the single run
+    config.segments = 3;
+    config.segment_warmup = scene.frame_count;
+    auto merged = SegmentRunner(config).process();
+    std::filesystem::remove(video);
+
+    ASSERT_EQ(single.size(), static_cast<size_t>(scene.frame_count - 1));
+    ASSERT_EQ(merged.size(), single.size());
+    for (size_t i = 0; i < merged.size(); ++i) {
+        EXPECT_EQ(merged[i].frame_index, static_cast<int>(i));
+        EXPECT_EQ(merged[i].frame_index, single[i].frame_index);
+        EXPECT_EQ(merged[i].is_crossing, single[i].is_crossing) << "frame " << i;
+    }
+}
+
+TEST(SegmentRunnerTest, FailedSegmentFailsTheRun) {
+    AppConfig config = BenchmarkHelpers::syntheticTestConfig();
+    config.video_src = (std::filesystem::temp_directory_path() / "zebraflash_missing_segment_test.avi").string();
+    config.seek = 0;
+    config.seek_end = 30;
+    config.segments = 3;
+
+    SegmentRunner runner(config);
+    EXPECT_TRUE(runner.process().empty());
+    EXPECT_FALSE(runner.run());
+}
+
+TEST(SegmentRunnerTest, SeveralZonesAreRejected) {
+    SceneConfig scene = BenchmarkHelpers::syntheticScene(20, 7);
+    std::string video = (std::filesystem::temp_directory_path() / "zebraflash_zoned_segment_test.avi").string();
+    {
+        cv::VideoWriter writer(video, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), scene.fps,
+                               cv::Size(scene.width, scene.height));
+        for (const auto& frame : BenchmarkHelpers::syntheticFrames(scene)) {
+            writer.write(frame);
+        }
+    }
+
+    AppConfig config = BenchmarkHelpers::syntheticTestConfig();
+    config.video_src = video;
+    config.seek = 0;
+    config.seek_end = 0;
+    config.segments = 2;
+    config.zones.push_back({"left", 20, 20, 10, 160, 60, 120, 240, 300, 1.0, 5, 10, ""});
+    EXPECT_FALSE(SegmentRunner(config).process().empty());
+
+    // Only the first zone would reach the results
+    config.zones.push_back({"right", 20, 20, 160, 10, 60, 120, 240, 300, 1.0, 5, 10, ""});
+    SegmentRunner runner(config);
+    EXPECT_TRUE(runner.process().empty());
+    EXPECT_FALSE(runner.run());
+    std::filesystem::remove(video);
+}
@@ -0,0 +1,60 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "../motion-detector/motion_detector.h"
+#include "../benchmark/benchmark.h"
+#include "../sweep/parameter_sweep.h"
+#include "../thread-pool/thread_pool.h"
+#include "../benchmarks/benchmark_common.h"
+
+TEST(ParameterSweepTest, BuildsCartesianProductOfGrid) {
+    std::string sweep_file = (std::filesystem::temp_directory_path() / "zebraflash_sweep_test.yml").string();
+    {
+        std::ofstream file(sweep_file);
+        file << "{ base_config: \"" << BenchmarkHelpers::getInputFile() << "\", test_prefix: \"t\", jobs: 2,\n"
+             << "  videos: [ { src: \"a.mp4\", annot: \"a.json\" }, { src: \"b.mp4\", annot: \"b.json\" } ],\n"
+             << "  grid: { algorithm: \"FARNE\", threshold: [1.5, 2.5, 3.5], size: [7, 11] } }\n";
+    }
+
+    ParameterSweep sweep(sweep_file);
+    auto variants = sweep.buildVariants();
+    std::filesystem::remove(sweep_file);
+
+    ASSERT_EQ(variants.size(), 12u);
+    EXPECT_EQ(variants[0].test_id, "t_algorithm-FARNE_threshold-1.5_size-7_video1");
+    EXPECT_EQ(variants[0].config.video_src, "a.mp4");
+    EXPECT_DOUBLE_EQ(variants[1].config.threshold, 2.5);
+    EXPECT_EQ(variants[5].config.size, 11);
+    EXPECT_EQ(variants[6].config.video_src, "b.mp4");
+    EXPECT_FALSE(variants[0].config.debug);
+}
+
+TEST(ParameterSweepTest, SharedFramesGiveSameResultsInParallel) {
+    AppConfig config = BenchmarkHelpers::syntheticTestConfig();
+    const std::vector<cv::Mat> frames = BenchmarkHelpers::syntheticRoiFrames(config, 40, 7);
+
+    auto expected = MotionDetector(config).processFrames(frames, 0);
+    ASSERT_EQ(expected.size(), frames.size() - 1);
+
+    std::vector<std::vector<BenchmarkResult>> parallel(4);
+    {
+        ThreadPool pool(4);
+        std::vector<std::future<void>> futures;
+        for (size_t i = 0; i < parallel.size(); ++i) {
+            futures.push_back(pool.enqueue([&, i]() {
+                parallel[i] = MotionDetector(config).processFrames(frames, 0);
+            }));
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+    }
+
+    for (const auto& results : parallel) {
+        ASSERT_EQ(results.size(), expected.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            EXPECT_EQ(results[i].frame_index, expected[i].frame_index);
+            EXPECT_EQ(results[i].is_crossing, expected[i].is_crossing);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#include <filesystem>
+#include <gtest/gtest.h>
+#include "../scene-generator/scene_generator.h"
+#include "../benchmark/benchmark.h"
+
+static SceneConfig makeSmallScene() {
+    SceneConfig scene;
+    scene.video_out = "";
+    scene.annot_out = "";
+    scene.codec = "mp4v";
+    scene.width = 160;
+    scene.height = 120;
+    scene.frame_count = 30;
+    scene.fps = 30.0;
+    scene.seed = 42;
+    scene.noise_sigma = 2.0;
+    scene.lighting_drift = 0.05;
+    scene.lighting_period = 20.0;
+    scene.frame_offset = 0;
+    scene.random_pedestrians = 0;
+    scene.random_min_speed = 0.05;
+    scene.random_max_speed = 0.2;
+    scene.crossing_angle_up_min = 160;
+    scene.crossing_angle_up_max = 190;
+    scene.crossing_angle_down_min = 350;
+    scene.crossing_angle_down_max = 20;
+
+    // Crosses from frame 10 to 20, then stands still
+    scene.pedestrians.push_back({0.8, 0.5, 180.0, 0.15, 0.1, 0.3, 10, 20, -1, true});
+    // Walks downwards through the whole clip, never crossing
+    scene.pedestrians.push_back({0.3, 0.2, 90.0, 0.05, 0.1, 0.3, 0, -1, -1, false});
+    return scene;
+}
+
+TEST(SyntheticSceneTest, RenderingIsDeterministic) {
+    SceneGenerator first(makeSmallScene());
+    SceneGenerator second(makeSmallScene());
+
+    cv::Mat frame_a, frame_b, frame_c;
+    first.renderFrame(15, frame_a);
+    second.renderFrame(15, frame_b);
+    first.renderFrame(16, frame_c);
+
+    ASSERT_EQ(frame_a.size(), cv::Size(160, 120));
+    EXPECT_EQ(cv::norm(frame_a, frame_b, cv::NORM_INF), 0.0);
+    EXPECT_GT(cv::norm(frame_a, frame_c, cv::NORM_INF), 0.0);
+}
+
+TEST(SyntheticSceneTest, GroundTruthMatchesBenchmarkFormat) {
+    SceneGenerator generator(makeSmallScene());
+    std::string annot = (std::filesystem::temp_directory_path() / "zebraflash_synthetic_test.json").string();
+
+    ASSERT_TRUE(generator.writeGroundTruth(annot));
+    auto ground_truth = loadGroundTruthCrossingIntent(annot);
+    std::filesystem::remove(annot);
+
+    int crossing_frames = 0;
+    for (const auto& truth : ground_truth) {
+        if (truth.is_crossing) {
+            crossing_frames++;
+            EXPECT_GE(truth.frame_index, 10);
+            EXPECT_LE(truth.frame_index, 20);
+        }
+    }
+
+    EXPECT_EQ(ground_truth.size(), 50u);
+    EXPECT_EQ(crossing_frames, 11);
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include "../motion-detector/motion_detector.h"
+#include "../benchmark/benchmark.h"
+#include "../benchmarks/benchmark_common.h"
+
+static YAML::Node configWithZones(const std::string& zones) {
+    YAML::Node config = YAML::LoadFile(BenchmarkHelpers::getInputFile());
+    config["upper_margin"] = 20;
+    config["bottom_margin"] = 20;
+    config["left_margin"] = 10;
+    config["right_margin"] = 10;
+    config["zones"] = YAML::Load(zones);
+    return config;
+}
+
+TEST(ZoneTest, RoiIsUnionOfZones) {
+    AppConfig config = MotionDetector::parseConfig(configWithZones(
+        "[ { name: north, upper_margin: 30, bottom_margin: 120, left_margin: 40, right_margin: 60, angle_up_min: 10 },"
+        "  { name: south, upper_margin: 100, bottom_margin: 50, left_margin: 80, right_margin: 20, threshold: 1.5 } ]"));
+
+    ASSERT_EQ(config.zones.size(), 2u);
+    EXPECT_EQ(config.row_start, 30);
+    EXPECT_EQ(config.row_end, 50);
+    EXPECT_EQ(config.col_start, 40);
+    EXPECT_EQ(config.col_end, 20);
+
+    // Unset zone parameters come from the top level
+    EXPECT_EQ(config.zones[0].angle_up_min, 10);
+    EXPECT_EQ(config.zones[0].angle_up_max, config.angle_up_max);
+    EXPECT_DOUBLE_EQ(config.zones[0].threshold, config.threshold);
+    EXPECT_DOUBLE_EQ(config.zones[1].threshold, 1.5);
+    EXPECT_EQ(config.zones[1].video_annot, config.video_annot);
+
+    // A 640x480 frame gives a 580x400 ROI
+    cv::Size roi(640 - 40 - 20, 480 - 30 - 50);
+    EXPECT_EQ(MotionDetector::zoneRect(config, config.zones[0], roi), cv::Rect(0, 0, 540, 330));
+    EXPECT_EQ(MotionDetector::zoneRect(config, config.zones[1], roi), cv::Rect(40, 70, 540, 330));
+
+    AppConfig south = MotionDetector::zoneConfig(config, config.zones[1]);
+    EXPECT_DOUBLE_EQ(south.threshold, 1.5);
+    EXPECT_TRUE(south.zones.empty());
+}
+
+TEST(ZoneTest, ZoneCoveringRoiMatchesSingleZoneRun) {
+    AppConfig single = MotionDetector::parseConfig(configWithZones("[]"));
+    AppConfig zoned = MotionDetector::parseConfig(configWithZones(
+        "[ { name: full }, { name: corner, upper_margin: 100, left_margin: 150, threshold: 0.5 } ]"));
+    for (AppConfig* config : {&single, &zoned}) {
+        config->algorithm = "FARNE";
+        config->use_gpu = false;
+        config->use_multi_thread = false;
+        config->debug = false;
+        config->estimator_trace_path = "";
+    }
+    std::vector<cv::Mat> frames = BenchmarkHelpers::syntheticRoiFrames(single, 40);
+
+    auto expected = MotionDetector(single).processFrames(frames, 0);
+    auto actual = MotionDetector(zoned).processFrames(frames, 0);
+
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(actual[i].is_crossing, expected[i].is_crossing) << "frame " << i;
+    }
+}
@@ -17,7 +17,9 @@ ThreadPool::ThreadPool(size_t threads) : stop(false) {
                     this->tasks.pop();
                 }
 
+                busy.fetch_add(1, std::memory_order_relaxed);
                 task();
+                busy.fetch_sub(1, std::memory_order_relaxed);
             }
         });
 }
@@ -6,6 +6,7 @@
 #include <condition_variable>
 #include <functional>
 #include <future>
+#include <atomic>
 
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
@@ -18,6 +19,10 @@ public:
     template<class F>
     auto enqueue(F&& f) -> std::future<typename std::result_of<F()>::type>;
 
+    size_t size() const { return workers.size(); }
+    // Workers running a task right now, for utilization metrics
+    int busyWorkers() const { return busy.load(std::memory_order_relaxed); }
+
 private:
     std::vector<std::thread> workers;
     std::queue<std::function<void()>> tasks;
@@ -25,6 +30,7 @@ private:
     std::mutex queue_mutex;
     std::condition_variable condition;
     bool stop;
+    std::atomic<int> busy{0};
 };
 
 template<class F>
@@ -0,0 +1,41 @@
+#include <iostream>
+#include <string>
+
+#include "../frame-index/frame_index.h"
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <video> [<video> ...]\n"
+              << "  Writes <video>.zfidx with the keyframes and timestamps of every frame\n";
+}
+
+// Exit codes: 0 = every index was written, 1 = at least one video failed, 2 = usage error
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    int failed = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string source = argv[i];
+        std::string path = FrameIndex::sidecarPath(source);
+        if (!FrameIndex::build(source, path)) {
+            failed++;
+            continue;
+        }
+
+        FrameIndex index;
+        if (!index.load(path, source)) {
+            failed++;
+            continue;
+        }
+
+        int keyframes = 0;
+        for (int frame = 0; frame < index.frameCount(); ++frame) {
+            keyframes += index.isKeyframe(frame) ? 1 : 0;
+        }
+        std::cout << path << ": " << index.frameCount() << " frames, " << keyframes << " keyframes" << std::endl;
+    }
+
+    return failed > 0 ? 1 : 0;
+}
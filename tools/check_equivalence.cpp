@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <yaml-cpp/yaml.h>
+
+#include "../equivalence/equivalence_harness.h"
+#include "../frame-cache/frame_cache.h"
+#include "../scene-generator/scene_generator.h"
+
+const std::string INPUT_FILE = "../../config/equivalence.yml";
+
+// base_config with the keys of overrides replaced, on the YAML level like the sweep grid
+static AppConfig variantConfig(const YAML::Node& base_config, const YAML::Node& overrides) {
+    YAML::Node node = YAML::Clone(base_config);
+    if (overrides && overrides.IsMap()) {
+        for (const auto& entry : overrides) {
+            node[entry.first.as<std::string>()] = entry.second;
+        }
+    }
+    return MotionDetector::parseConfig(node);
+}
+
+// Exit codes: 0 = equivalent, 1 = diverged, 2 = input error
+int main(int argc, char** argv) {
+    std::string equivalence_file = argc > 1 ? argv[1] : INPUT_FILE;
+
+    try {
+        YAML::Node equivalence = YAML::LoadFile(equivalence_file);
+        YAML::Node base_config = YAML::LoadFile(equivalence["base_config"].as<std::string>());
+        // The detector config defaults to YOLO, whose weights are not part of the repository
+        if (equivalence["algorithm"]) {
+            base_config["algorithm"] = equivalence["algorithm"];
+        }
+        AppConfig reference = variantConfig(base_config, equivalence["reference"]);
+        AppConfig candidate = variantConfig(base_config, equivalence["candidate"]);
+
+        EquivalenceTolerance tolerance;
+        tolerance.angle_degrees = equivalence["angle_tolerance"].as<double>(tolerance.angle_degrees);
+        tolerance.angle_mismatch = equivalence["angle_mismatch"].as<double>(tolerance.angle_mismatch);
+        tolerance.vote_mismatch = equivalence["vote_mismatch"].as<double>(tolerance.vote_mismatch);
+        tolerance.decision_mismatch = equivalence["decision_mismatch"].as<double>(tolerance.decision_mismatch);
+
+        int max_frames = equivalence["max_frames"].as<int>(0);
+        std::string cache_path = equivalence["frame_cache"].as<std::string>("");
+        int frame_count = 0;
+        int first_frame_index = 0;
+
+        FrameCacheReader cache_reader;
+        std::unique_ptr<SceneGenerator> scene;
+        cv::Mat scene_frame;
+        if (!cache_path.empty()) {
+            if (!cache_reader.open(cache_path)) {
+                std::cerr << "Error: Could not open frame cache " << cache_path << std::endl;
+                return 2;
+            }
+            frame_count = cache_reader.frameCount();
+            first_frame_index = cache_reader.firstFrameIndex();
+        } else {
+            scene = std::make_unique<SceneGenerator>(
+                SceneGenerator::loadConfig(equivalence["scene"].as<std::string>()));
+            frame_count = scene->getConfig().frame_count;
+        }
+        if (max_frames > 0) {
+            frame_count = std::min(frame_count, max_frames);
+        }
+
+        // Margins are still in their config form, row_end and col_end count from the bottom and right edges
+        int next_frame = 0;
+        std::function<bool(cv::Mat&)> nextFrame = [&](cv::Mat& roi_frame) {
+            if (next_frame >= frame_count) {
+                return false;
+            }
+            if (scene) {
+                scene->renderFrame(next_frame++, scene_frame);
+                roi_frame = scene_frame(cv::Range(reference.row_start, scene_frame.rows - reference.row_end),
+                                        cv::Range(reference.col_start, scene_frame.cols - reference.col_end));
+                return true;
+            }
+            return cache_reader.frame(next_frame++, roi_frame);
+        };
+
+        EquivalenceHarness harness(reference, candidate, tolerance);
+        EquivalenceReport report = harness.compare(nextFrame, first_frame_index);
+        if (report.comparedZoneFrames() == 0) {
+            std::cerr << "Error: No frames were compared" << std::endl;
+            return 2;
+        }
+
+        printEquivalenceReport(report, tolerance, std::cout);
+        std::string report_path = equivalence["report"].as<std::string>("");
+        if (!report_path.empty()) {
+            writeDivergenceCSV(report, report_path);
+        }
+
+        bool passed = report.passed(tolerance);
+        std::cout << (passed ? "Equivalent" : "Diverged") << std::endl;
+        return passed ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 2;
+    }
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <string>
+
+#include "../benchmark/benchmark_compare.h"
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <baseline_summary.csv> <candidate_summary.csv> [options]\n"
+              << "  --fps-drop <ratio>          allowed relative Avg FPS drop (default 0.10)\n"
+              << "  --latency-increase <ratio>  allowed relative latency percentile increase (default 0.10)\n"
+              << "  --accuracy-drop <value>     allowed absolute balanced accuracy drop (default 0.02)\n"
+              << "  --noise-factor <k>          widen limits to k robust deviations of repeated runs (default 3)\n"
+              << "  --fail-on-missing           fail when a baseline configuration has no candidate rows\n";
+}
+
+// Exit codes: 0 = no regression, 1 = regression detected, 2 = usage or input error
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    RegressionThresholds thresholds;
+    try {
+        for (int i = 3; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+
+            if (arg == "--fps-drop" && has_value) {
+                thresholds.fps_drop = std::stod(argv[++i]);
+            } else if (arg == "--latency-increase" && has_value) {
+                thresholds.latency_increase = std::stod(argv[++i]);
+            } else if (arg == "--accuracy-drop" && has_value) {
+                thresholds.accuracy_drop = std::stod(argv[++i]);
+            } else if (arg == "--noise-factor" && has_value) {
+                thresholds.noise_factor = std::stod(argv[++i]);
+            } else if (arg == "--fail-on-missing") {
+                thresholds.fail_on_missing = true;
+            } else {
+                printUsage(argv[0]);
+                return 2;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid option value: " << e.what() << std::endl;
+        return 2;
+    }
+
+    auto baseline = loadSummaryCSV(argv[1]);
+    auto candidate = loadSummaryCSV(argv[2]);
+    if (baseline.empty() || candidate.empty()) {
+        std::cerr << "Error: baseline and candidate summaries must both contain rows" << std::endl;
+        return 2;
+    }
+
+    ComparisonReport report = compareSummaries(baseline, candidate, thresholds);
+    printComparisonReport(report, std::cout);
+
+    return report.passed(thresholds) ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+#include <iostream>
+
+#include "../scene-generator/scene_generator.h"
+
+const std::string INPUT_FILE = "../../config/synthetic_scene.yml";
+
+int main(int argc, char** argv) {
+    std::string config_file = argc > 1 ? argv[1] : INPUT_FILE;
+
+    try {
+        SceneGenerator generator(SceneGenerator::loadConfig(config_file));
+        if (!generator.generate()) {
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
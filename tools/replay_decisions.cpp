@@ -0,0 +1,19 @@
+#include <iostream>
+
+#include "../replay/replay_sweep.h"
+
+const std::string INPUT_FILE = "../../config/replay.yml";
+
+int main(int argc, char** argv) {
+    std::string replay_file = argc > 1 ? argv[1] : INPUT_FILE;
+
+    try {
+        ReplaySweep replay(replay_file);
+        replay.run();
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+#include <iostream>
+
+#include "../corpus/corpus_runner.h"
+
+const std::string INPUT_FILE = "../../config/corpus.yml";
+
+// Exit codes: 0 = every job succeeded, 1 = at least one job failed or the manifest could not be read
+int main(int argc, char** argv) {
+    std::string manifest_file = argc > 1 ? argv[1] : INPUT_FILE;
+
+    try {
+        CorpusRunner runner(manifest_file);
+        return runner.run() ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+}
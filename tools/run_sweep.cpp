@@ -0,0 +1,19 @@
+#include <iostream>
+
+#include "../sweep/parameter_sweep.h"
+
+const std::string INPUT_FILE = "../../config/sweep.yml";
+
+int main(int argc, char** argv) {
+    std::string sweep_file = argc > 1 ? argv[1] : INPUT_FILE;
+
+    try {
+        ParameterSweep sweep(sweep_file);
+        sweep.run();
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "allocation_counter.h"
+
+#ifdef ZEBRAFLASH_COUNT_ALLOCATIONS
+
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <opencv2/core.hpp>
+
+// Per thread, so the detectors of a sweep or a segment run never count each other's allocations
+static thread_local uint64_t allocations = 0;
+
+// The array, nothrow and sized forms of the standard library forward to these two
+void* operator new(std::size_t size) {
+    allocations++;
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+// Counts new Mat data and leaves the work to the standard allocator. Mats over user data allocate nothing.
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags,
+                           cv::UMatUsageFlags usage_flags) const override {
+        if (!data) {
+            allocations++;
+        }
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage_flags);
+    }
+
+    bool allocate(cv::UMatData* data, cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override {
+        return cv::Mat::getStdAllocator()->allocate(data, flags, usage_flags);
+    }
+
+    void deallocate(cv::UMatData* data) const override {
+        cv::Mat::getStdAllocator()->deallocate(data);
+    }
+};
+
+void AllocationCounter::install() {
+    static CountingMatAllocator allocator;
+    static std::once_flag installed;
+    std::call_once(installed, [] { cv::Mat::setDefaultAllocator(&allocator); });
+}
+
+bool AllocationCounter::enabled() {
+    return true;
+}
+
+uint64_t AllocationCounter::count() {
+    return allocations;
+}
+
+#else
+
+void AllocationCounter::install() {
+}
+
+bool AllocationCounter::enabled() {
+    return false;
+}
+
+uint64_t AllocationCounter::count() {
+    return 0;
+}
+
+#endif
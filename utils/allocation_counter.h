@@ -0,0 +1,19 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+// Heap allocations of the calling thread, counted only when built with ZEBRAFLASH_COUNT_ALLOCATIONS. The option
+// replaces the global operator new and routes cv::Mat data through a counting allocator, OpenCV allocates Mat data
+// with its own allocator and not operator new. Allocations of pool threads working for the caller are not part of
+// its count. Without the option count() stays 0.
+class AllocationCounter {
+public:
+    // Installs the counting cv::Mat allocator once per process, repeated calls do nothing
+    static void install();
+
+    static bool enabled();
+    static uint64_t count();
+};
+
+#endif //ALLOCATION_COUNTER_H
@@ -0,0 +1,69 @@
+#include <cstdlib>
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "frame_difference.h"
+
+static int countChangedRow(const uchar* current, const uchar* previous, int width, uchar threshold) {
+    int count = 0;
+    int x = 0;
+
+#if CV_SIMD
+    const cv::v_uint8 v_threshold = cv::vx_setall_u8(threshold);
+    const cv::v_uint8 v_one = cv::vx_setall_u8(1);
+
+    while (x <= width - CV_SIMD_WIDTH) {
+        // 8 bit lane counters, summed up before 255 vectors can overflow them
+        cv::v_uint8 v_count = cv::vx_setzero_u8();
+        for (int i = 0; i < 255 && x <= width - CV_SIMD_WIDTH; ++i, x += CV_SIMD_WIDTH) {
+            cv::v_uint8 v_diff = cv::v_absdiff(cv::vx_load(current + x), cv::vx_load(previous + x));
+            v_count += (v_diff > v_threshold) & v_one;
+        }
+
+        cv::v_uint16 v_low, v_high;
+        cv::v_expand(v_count, v_low, v_high);
+        cv::v_uint32 v_sum_low, v_sum_high;
+        cv::v_expand(v_low + v_high, v_sum_low, v_sum_high);
+        count += static_cast<int>(cv::v_reduce_sum(v_sum_low + v_sum_high));
+    }
+    cv::vx_cleanup();
+#endif
+
+    for (; x < width; ++x) {
+        count += std::abs(current[x] - previous[x]) > threshold;
+    }
+    return count;
+}
+
+int FrameDifference::countChanged(const cv::Mat& current, const cv::Mat& previous, int threshold, int stop_after) {
+    CV_Assert(current.type() == CV_8UC1 && previous.type() == CV_8UC1 && current.size() == previous.size());
+
+    // No pixel differs by more than 255, and every pixel differs by more than a negative threshold
+    if (threshold >= 255) {
+        return 0;
+    }
+    if (threshold < 0) {
+        return static_cast<int>(current.total());
+    }
+    auto pixel_threshold = static_cast<uchar>(threshold);
+
+    // Continuous images are one long row, the early exit then only happens at the end
+    int rows = current.rows;
+    int width = current.cols;
+    if (current.isContinuous() && previous.isContinuous() && stop_after < 0) {
+        width *= rows;
+        rows = 1;
+    }
+
+    int count = 0;
+    for (int y = 0; y < rows; ++y) {
+        count += countChangedRow(current.ptr<uchar>(y), previous.ptr<uchar>(y), width, pixel_threshold);
+        if (stop_after >= 0 && count > stop_after) {
+            break;
+        }
+    }
+    return count;
+}
+
+bool FrameDifference::hasChanged(const cv::Mat& current, const cv::Mat& previous, int threshold, int min_count) {
+    return countChanged(current, previous, threshold, min_count) > min_count;
+}
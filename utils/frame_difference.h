@@ -0,0 +1,18 @@
+#ifndef FRAME_DIFFERENCE_H
+#define FRAME_DIFFERENCE_H
+
+#include <opencv2/core.hpp>
+
+// Absolute difference, threshold and count of two gray images in one vectorized pass, without the temporary
+// images of absdiff, threshold and countNonZero
+class FrameDifference {
+public:
+    // Pixels whose absolute difference is above threshold. Rows are counted as blocks, once the count exceeds
+    // stop_after the remaining rows are skipped, -1 counts every pixel.
+    static int countChanged(const cv::Mat& current, const cv::Mat& previous, int threshold, int stop_after = -1);
+
+    // True when more than min_count pixels differ by more than threshold, stops at the first row that decides it
+    static bool hasChanged(const cv::Mat& current, const cv::Mat& previous, int threshold, int min_count);
+};
+
+#endif //FRAME_DIFFERENCE_H
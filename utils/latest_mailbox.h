@@ -0,0 +1,63 @@
+#ifndef LATEST_MAILBOX_H
+#define LATEST_MAILBOX_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+// Single slot mailbox where the newest value wins. Values are swapped through the slot instead of copied, so the
+// writer, the slot and the reader pass three buffers around and warm buffers are never reallocated. A value that is
+// replaced before the reader takes it is dropped, the writer never waits for the reader.
+template <typename T>
+class LatestMailbox {
+public:
+    // Swaps value into the slot, value gets an older buffer back to fill next
+    void publish(T& value) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::swap(slot, value);
+            if (fresh) {
+                dropped++;
+            }
+            fresh = true;
+        }
+        ready.notify_one();
+    }
+
+    // Waits for a value that was not taken yet and swaps it into value, false once closed and empty
+    bool take(T& value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return fresh || closed; });
+        if (!fresh) {
+            return false;
+        }
+        std::swap(slot, value);
+        fresh = false;
+        return true;
+    }
+
+    // Wakes the reader, take returns false once the last value is taken
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        ready.notify_all();
+    }
+
+    size_t droppedCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return dropped;
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable ready;
+    T slot{};
+    bool fresh = false;
+    bool closed = false;
+    size_t dropped = 0;
+};
+
+#endif //LATEST_MAILBOX_H
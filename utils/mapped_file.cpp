@@ -0,0 +1,127 @@
+#include <iostream>
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::isOpen() const {
+    return mapped_data != nullptr;
+}
+
+const unsigned char* MappedFile::data() const {
+    return mapped_data;
+}
+
+size_t MappedFile::size() const {
+    return mapped_size;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        std::cerr << "Error: Could not map file: " << path << std::endl;
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        std::cerr << "Error: Could not map file: " << path << std::endl;
+        return false;
+    }
+
+    file_handle = file;
+    mapping_handle = mapping;
+    mapped_data = static_cast<const unsigned char*>(view);
+    mapped_size = static_cast<size_t>(file_size.QuadPart);
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapped_data != nullptr) {
+        UnmapViewOfFile(mapped_data);
+    }
+    if (mapping_handle != nullptr) {
+        CloseHandle(mapping_handle);
+    }
+    if (file_handle != nullptr) {
+        CloseHandle(file_handle);
+    }
+    mapped_data = nullptr;
+    mapped_size = 0;
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        std::cerr << "Error: Could not map file: " << path << std::endl;
+        return false;
+    }
+
+    file_descriptor = fd;
+    mapped_data = static_cast<const unsigned char*>(view);
+    mapped_size = static_cast<size_t>(file_stat.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapped_data != nullptr) {
+        munmap(const_cast<unsigned char*>(mapped_data), mapped_size);
+    }
+    if (file_descriptor >= 0) {
+        ::close(file_descriptor);
+    }
+    mapped_data = nullptr;
+    mapped_size = 0;
+    file_descriptor = -1;
+}
+
+#endif
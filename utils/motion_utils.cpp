@@ -3,6 +3,7 @@
 #include "motion_utils.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <limits>
 
@@ -11,16 +12,30 @@ float MotionUtils::calculateMode(const std::vector<float>& values) {
         return std::numeric_limits<float>::quiet_NaN();
     }
 
+    // Flow angles are binned to whole degrees in [0, 360], they are counted on the stack without allocating
+    int min_bin = static_cast<int>(std::round(*std::min_element(values.begin(), values.end())));
+    int max_bin = static_cast<int>(std::round(*std::max_element(values.begin(), values.end())));
+    if (min_bin >= 0 && max_bin <= 360) {
+        std::array<int, 361> counts{};
+        for (const float& value : values) {
+            counts[static_cast<int>(std::round(value))]++;
+        }
+        // The first largest bin is the lowest angle, like the tie rule below
+        return static_cast<float>(std::distance(counts.begin(), std::max_element(counts.begin(), counts.end())));
+    }
+
     std::unordered_map<float, int> frequency_map;
     for (const float& value : values) {
         int binned = static_cast<int>(std::round(value));
         frequency_map[binned]++;
     }
 
+    // Ties go to the lowest angle, so the mode does not depend on the hash map order and can be recomputed
+    // from angle histograms
     float mode = values[0];
     int max_count = 0;
     for (const auto& pair : frequency_map) {
-        if (pair.second > max_count) {
+        if (pair.second > max_count || (pair.second == max_count && pair.first < mode)) {
             mode = pair.first;
             max_count = pair.second;
         }